@@ -0,0 +1,124 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <algorithm>
+#include <stdexcept>
+#include "../Codec/xe_format.h"
+#include "../Codec/bxe_format.h"
+#include "../Codec/mapped_file.h"
+#include "../Codec/bxe_codec.h"
+
+using namespace XEFormat;
+
+template <typename F>
+static double time_seconds(F &&f) {
+    const auto start = std::chrono::steady_clock::now();
+    f();
+    const auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(end - start).count();
+}
+
+//nome de uma configuração para a tabela
+static std::string policy_name(const BlockPolicy &policy) {
+    std::ostringstream name;
+    if (policy.max_events > 0)
+        name << "events<=" << policy.max_events << " ";
+    if (policy.max_compressed_bytes > 0)
+        name << "bytes<=" << policy.max_compressed_bytes << " ";
+    if (policy.max_time_span > 0)
+        name << "span<=" << policy.max_time_span << "us ";
+    return name.str();
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2 || argc > 3) {
+        std::cerr << "Usage: " << argv[0] << " INPUT_XE_FILE [TEMP_BXE_FILE]" << std::endl;
+        return 1;
+    }
+    const std::string temp_path = argc == 3 ? argv[2] : "bench_block_policy.tmp.bxe";
+
+    const FieldsDefinition fields_def = FieldsDefinition::make_reference();
+
+    //configurações a comparar: só contagem, só tamanho comprimido estimado, só intervalo de tempo, e combinações
+    std::vector<BlockPolicy> policies;
+    for (size_t events : {256, 1024, 4096, 16384, 65536, 262144})
+        policies.push_back(BlockPolicy{events, 0, 0});
+    for (size_t bytes : {1024, 4096, 16384, 65536})
+        policies.push_back(BlockPolicy{0, bytes, 0});
+    for (timestamp_t span : {1000, 10000, 100000})
+        policies.push_back(BlockPolicy{0, 0, span});
+    policies.push_back(BlockPolicy{65536, 16384, 10000});
+    policies.push_back(BlockPolicy{1024, 4096, 1000});
+
+    try {
+        const XEFile input_file(argv[1], fields_def);
+        const size_t total_events = input_file.num_events();
+        const double input_size = static_cast<double>(total_events * fields_def.event_size_bytes);
+
+        std::cout << "policy | blocks | mean events | mean span (us) | max span (us) | block overhead | ratio | split+write Mev/s | compress MB/s" << std::endl;
+        for (const BlockPolicy &policy : policies) {
+            //1) divisão em blocos e escrita do .bxe
+            uint8_t flags = bxe_flag_time_base | bxe_flag_checksum;
+            if (policy.max_events == 0 || policy.max_events > max_block_events(flags))
+                flags |= bxe_flag_wide_count;
+            size_t num_written_blocks = 0;
+            uint64_t bxe_size = 0;
+            const double split_secs = time_seconds([&]() {
+                std::ofstream output_file(temp_path, std::ios::binary);
+                BlockXEWriter writer(output_file, fields_def, 0, flags);
+                BlockSplitter splitter(policy, fields_def);
+                size_t i = 0;
+                while (i < total_events) {
+                    const uint8_t* block_bytes = input_file.event_bytes() + i * fields_def.event_size_bytes;
+                    const size_t n = splitter.fill(block_bytes, total_events - i);
+                    splitter.next_block();
+                    writer.write_block(block_bytes, n);
+                    i += n;
+                }
+                writer.finish();
+                num_written_blocks = writer.num_blocks();
+                bxe_size = writer.bytes_written();
+            });
+
+            //2) latência: intervalo de tempo coberto por cada bloco (tempo de espera até o bloco poder ser enviado), lido do índice do ficheiro
+            const BlockXEFile bxe_file(temp_path, fields_def);
+            double span_sum = 0;
+            timestamp_t span_max = 0;
+            for (size_t b = 0; b < bxe_file.num_indexed_blocks(); ++b) {
+                const BlockIndexEntry entry = bxe_file.index_entry(b);
+                const timestamp_t span = entry.last_timestamp - entry.first_timestamp;
+                span_sum += span;
+                span_max = std::max(span_max, span);
+            }
+
+            //3) taxa de compressão com as opções por omissão
+            CompressionOptions options;
+            std::ostringstream compressed;
+            size_t compressed_size = 0;
+            const double compress_secs = time_seconds([&]() {
+                compressed_size = compress_bxe(bxe_file, fields_def, options, compressed);
+            });
+
+            const size_t num_blocks = std::max<size_t>(1, num_written_blocks);
+            std::cout << policy_name(policy) << "| " << num_written_blocks
+                      << " | " << static_cast<double>(total_events) / num_blocks
+                      << " | " << span_sum / num_blocks
+                      << " | " << span_max
+                      << " | " << 100.0 * (bxe_size - input_size) / input_size << "%"
+                      << " | " << 100.0 * compressed_size / input_size << "%"
+                      << " | " << total_events / split_secs / 1e6
+                      << " | " << input_size / compress_secs / 1e6 << std::endl;
+        }
+    } catch (const std::runtime_error &e) {
+        std::remove(temp_path.c_str());
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    std::remove(temp_path.c_str());
+    return 0;
+}
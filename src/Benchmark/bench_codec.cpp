@@ -0,0 +1,242 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <ctime>
+#include <thread>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+#include <stdexcept>
+#include "../Codec/xe_format.h"
+#include "../Codec/bxe_format.h"
+#include "../Codec/mapped_file.h"
+#include "../Codec/bxe_codec.h"
+#include "../Codec/synthetic_stream.h"
+
+using namespace XEFormat;
+
+template <typename F>
+static double time_seconds(F &&f) {
+    const auto start = std::chrono::steady_clock::now();
+    f();
+    const auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(end - start).count();
+}
+
+//cenário a medir: um ficheiro .xe sintético (ou dado pelo utilizador)
+struct Scenario {
+    std::string name;
+    SyntheticStreamOptions options;
+    std::string input_path;
+};
+
+//resultado de uma etapa: tempos de todas as repetições e tamanhos de entrada/saída
+struct StageResult {
+    std::string scenario;
+    std::string stage;
+    size_t events = 0;
+    size_t input_bytes = 0;
+    size_t output_bytes = 0;
+    size_t xe_bytes = 0;
+    std::vector<double> seconds;
+
+    double min_seconds() const { return *std::min_element(seconds.begin(), seconds.end()); }
+    double median_seconds() const {
+        std::vector<double> sorted = seconds;
+        std::sort(sorted.begin(), sorted.end());
+        return sorted[sorted.size() / 2];
+    }
+};
+
+//repete uma etapa e guarda os tempos; output_bytes é devolvido pela etapa
+template <typename F>
+static StageResult run_stage(const std::string &scenario, const std::string &stage, size_t events, size_t input_bytes, size_t xe_bytes, size_t repetitions, F &&f) {
+    StageResult result;
+    result.scenario = scenario;
+    result.stage = stage;
+    result.events = events;
+    result.input_bytes = input_bytes;
+    result.xe_bytes = xe_bytes;
+    for (size_t r = 0; r < repetitions; ++r)
+        result.seconds.push_back(time_seconds([&]() { result.output_bytes = f(); }));
+    return result;
+}
+
+//etapas: leitura do .xe, divisão em blocos (.bxe), compressão e descompressão com cada codificador
+static void bench_scenario(const Scenario &scenario, const std::string &temp_prefix, size_t repetitions, const FieldsDefinition &fields_def, std::vector<StageResult> &results) {
+    const std::string xe_path = scenario.input_path.empty() ? temp_prefix + ".xe" : scenario.input_path;
+    const std::string bxe_path = temp_prefix + ".bxe";
+    if (scenario.input_path.empty()) {
+        std::ofstream xe_file(xe_path, std::ios::binary);
+        write_synthetic_stream(scenario.options, fields_def, xe_file);
+    }
+
+    const XEFile input_file(xe_path, fields_def);
+    const size_t total_events = input_file.num_events();
+    const size_t xe_bytes = input_file.mapping().size();
+
+    //1) leitura em chunks de 1 Mi eventos, com validação do cabeçalho
+    results.push_back(run_stage(scenario.name, "read", total_events, xe_bytes, xe_bytes, repetitions, [&]() {
+        std::ifstream is(xe_path, std::ios::binary);
+        if (!Decoder::assert_jpegxe_canonical_header(is))
+            throw std::runtime_error("Input is not a JPEG_XE canonical raw event file: " + xe_path);
+        std::vector<encoded_event_t> chunk(1 << 20);
+        size_t n, read = 0;
+        while ((n = Decoder::read_encoded_events(is, fields_def, chunk.data(), chunk.size())) > 0)
+            read += n;
+        if (read != total_events)
+            throw std::runtime_error("Read stage lost events.");
+        return read * fields_def.event_size_bytes;
+    }));
+
+    //2) divisão em blocos com a política por omissão, como o xe_to_blockxe
+    results.push_back(run_stage(scenario.name, "block", total_events, xe_bytes, xe_bytes, repetitions, [&]() {
+        std::ofstream output_file(bxe_path, std::ios::binary);
+        BlockXEWriter writer(output_file, fields_def);
+        BlockSplitter splitter(BlockPolicy{}, fields_def);
+        size_t i = 0;
+        while (i < total_events) {
+            const uint8_t* block_bytes = input_file.event_bytes() + i * fields_def.event_size_bytes;
+            const size_t n = splitter.fill(block_bytes, total_events - i);
+            splitter.next_block();
+            writer.write_block(block_bytes, n);
+            i += n;
+        }
+        writer.finish();
+        return static_cast<size_t>(writer.bytes_written());
+    }));
+
+    const BlockXEFile bxe_file(bxe_path, fields_def);
+    const size_t bxe_bytes = bxe_file.mapping().size();
+    for (const std::string coder_name : {"range", "huffman", "context", "rans"}) {
+        CompressionOptions options;
+        parse_entropy_coder(coder_name, options.coder);
+
+        //3) compressão
+        std::string compressed;
+        results.push_back(run_stage(scenario.name, "compress/" + coder_name, total_events, bxe_bytes, xe_bytes, repetitions, [&]() {
+            std::ostringstream os;
+            const size_t size = compress_bxe(bxe_file, fields_def, options, os);
+            compressed = os.str();
+            return size;
+        }));
+
+        //4) descompressão, que tem de devolver o .bxe original
+        std::string decompressed;
+        results.push_back(run_stage(scenario.name, "decompress/" + coder_name, total_events, compressed.size(), xe_bytes, repetitions, [&]() {
+            std::ostringstream os;
+            decompress_bxe(reinterpret_cast<const uint8_t*>(compressed.data()), compressed.size(), fields_def, os);
+            decompressed = os.str();
+            return decompressed.size();
+        }));
+        if (decompressed.size() != bxe_bytes || std::memcmp(decompressed.data(), bxe_file.mapping().data(), bxe_bytes) != 0)
+            throw std::runtime_error("Round trip through the " + coder_name + " coder does not rebuild the .bxe file (" + scenario.name + ").");
+    }
+
+    std::remove(bxe_path.c_str());
+    if (scenario.input_path.empty())
+        std::remove(xe_path.c_str());
+}
+
+//resultados em JSON (um objeto por etapa, no estilo do Google Benchmark) para comparar entre versões
+static void write_json(std::ostream &os, const std::vector<StageResult> &results, size_t repetitions) {
+    char date[32];
+    const std::time_t now = std::time(nullptr);
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+    os.precision(9);
+    os << "{\n  \"context\": {\"date\": \"" << date << "\", \"num_cpus\": " << std::thread::hardware_concurrency()
+       << ", \"repetitions\": " << repetitions << "},\n  \"benchmarks\": [";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const StageResult &r = results[i];
+        const double median = r.median_seconds();
+        os << (i ? ",\n" : "\n")
+           << "    {\"name\": \"" << r.scenario << "/" << r.stage << "\", \"scenario\": \"" << r.scenario << "\", \"stage\": \"" << r.stage << "\""
+           << ", \"events\": " << r.events << ", \"input_bytes\": " << r.input_bytes << ", \"output_bytes\": " << r.output_bytes
+           << ", \"stage_ratio\": " << static_cast<double>(r.output_bytes) / std::max<size_t>(1, r.input_bytes)
+           << ", \"ratio_to_xe\": " << static_cast<double>(r.output_bytes) / std::max<size_t>(1, r.xe_bytes)
+           << ", \"min_time_s\": " << r.min_seconds() << ", \"median_time_s\": " << median
+           << ", \"events_per_second\": " << r.events / median << ", \"bytes_per_second\": " << r.input_bytes / median << "}";
+    }
+    os << "\n  ]\n}\n";
+}
+
+int main(int argc, char* argv[]) {
+    const char* usage = " [--events N] [--repetitions N] [--json OUTPUT_JSON_FILE] [--input XE_FILE] [--temp TEMP_PREFIX]";
+    size_t num_events = 2000000;
+    size_t repetitions = 3;
+    std::string json_path, input_path, temp_prefix = "bench_codec.tmp";
+    for (int i = 1; i < argc; ++i) {
+        if (i + 1 < argc && std::strcmp(argv[i], "--events") == 0) {
+            num_events = std::strtoull(argv[++i], nullptr, 10);
+        } else if (i + 1 < argc && std::strcmp(argv[i], "--repetitions") == 0) {
+            repetitions = std::max<size_t>(1, std::strtoull(argv[++i], nullptr, 10));
+        } else if (i + 1 < argc && std::strcmp(argv[i], "--json") == 0) {
+            json_path = argv[++i];
+        } else if (i + 1 < argc && std::strcmp(argv[i], "--input") == 0) {
+            input_path = argv[++i];
+        } else if (i + 1 < argc && std::strcmp(argv[i], "--temp") == 0) {
+            temp_prefix = argv[++i];
+        } else {
+            std::cerr << "Usage: " << argv[0] << usage << std::endl;
+            return 1;
+        }
+    }
+
+    const FieldsDefinition fields_def = FieldsDefinition::make_reference();
+
+    //cenários sintéticos: ruído uniforme, objetos em movimento, taxa alta e baixa, triggers e polaridade desequilibrada
+    std::vector<Scenario> scenarios;
+    if (!input_path.empty()) {
+        scenarios.push_back(Scenario{"input", SyntheticStreamOptions{}, input_path});
+    } else {
+        auto add = [&](const std::string &name, double rate, double clustering, double on_fraction, double trigger_rate) {
+            SyntheticStreamOptions options;
+            options.num_events = num_events;
+            options.event_rate = rate;
+            options.clustering = clustering;
+            options.on_fraction = on_fraction;
+            options.trigger_rate = trigger_rate;
+            scenarios.push_back(Scenario{name, options, ""});
+        };
+        add("noise", 1e6, 0.0, 0.5, 0);
+        add("objects", 1e6, 0.9, 0.5, 0);
+        add("dense", 1e7, 0.9, 0.5, 0);
+        add("sparse", 1e4, 0.8, 0.5, 0);
+        add("triggers", 1e6, 0.8, 0.5, 2e4);
+        add("unbalanced", 1e6, 0.8, 0.9, 0);
+    }
+
+    std::vector<StageResult> results;
+    try {
+        for (const Scenario &scenario : scenarios)
+            bench_scenario(scenario, temp_prefix, repetitions, fields_def, results);
+    } catch (const std::runtime_error &e) {
+        std::remove((temp_prefix + ".xe").c_str());
+        std::remove((temp_prefix + ".bxe").c_str());
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    std::cout << "scenario | stage | events | input bytes | output bytes | ratio to .xe | median (s) | Mev/s | MB/s" << std::endl;
+    for (const StageResult &r : results) {
+        const double median = r.median_seconds();
+        std::cout << r.scenario << " | " << r.stage << " | " << r.events << " | " << r.input_bytes << " | " << r.output_bytes
+                  << " | " << 100.0 * r.output_bytes / std::max<size_t>(1, r.xe_bytes) << "%"
+                  << " | " << median << " | " << r.events / median / 1e6 << " | " << r.input_bytes / median / 1e6 << std::endl;
+    }
+
+    if (!json_path.empty()) {
+        std::ofstream json_file(json_path);
+        if (!json_file) {
+            std::cerr << "Cannot open output file: " << json_path << std::endl;
+            return 1;
+        }
+        write_json(json_file, results, repetitions);
+    }
+    return 0;
+}
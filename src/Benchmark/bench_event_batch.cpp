@@ -0,0 +1,161 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cstdint>
+#include <stdexcept>
+#include "../Codec/xe_format.h"
+#include "../Codec/mapped_file.h"
+#include "../Codec/event_batch.h"
+#include "../Codec/thread_pool.h"
+#include "../Codec/instrumentation.h"
+
+using namespace XEFormat;
+
+template <typename F>
+static double time_seconds(F &&f) {
+    const auto start = std::chrono::steady_clock::now();
+    f();
+    const auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(end - start).count();
+}
+
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        std::cerr << "Usage: " << argv[0] << " INPUT_BXE_FILE" << std::endl;
+        return 1;
+    }
+
+    const FieldsDefinition fields_def = FieldsDefinition::make_reference();
+
+    try {
+        const BlockXEFile input_file(argv[1], fields_def);
+        size_t total_events = 0;
+        for (const BlockXEFile::Block &block : input_file)
+            total_events += block.available_events;
+        const int repetitions = 5;
+
+        //caminho antigo: um CDEvent (24 bytes) por evento, vetor novo por bloco
+        uint64_t aos_checksum = 0;
+        std::vector<CDEvent> all_events;
+        const double aos_secs = time_seconds([&]() {
+            for (int r = 0; r < repetitions; ++r) {
+                all_events.clear();
+                timestamp_t abs_time_base = 0;
+                for (const BlockXEFile::Block &block : input_file) {
+                    std::vector<CDEvent> events;
+                    size_t time_base_events = 0;
+                    for (size_t i = 0; i < block.available_events; ++i) {
+                        encoded_event_t ev;
+                        Decoder::unpack_encoded_events(block.event_bytes + i * fields_def.event_size_bytes, 1, fields_def, &ev);
+                        switch (Decoder::decode_event_type(ev, fields_def)) {
+                            case EventType::CD:
+                                events.push_back(Decoder::decode_event_cd(ev, abs_time_base, fields_def));
+                                break;
+                            case EventType::ABSTimeStamp:
+                                abs_time_base = Decoder::decode_event_timestamp(ev, fields_def);
+                                ++time_base_events;
+                                break;
+                            default:
+                                break;
+                        }
+                    }
+                    XE_METRICS_ADD(CDEventsDecoded, events.size());
+                    XE_METRICS_ADD(TimeBaseEventsDecoded, time_base_events);
+                    all_events.insert(all_events.end(), events.begin(), events.end());
+                }
+            }
+        });
+
+        //EventBatch reutilizado: um bloco de cada vez, sem alocações depois do primeiro bloco
+        uint64_t batch_checksum = 0;
+        EventBatch batch;
+        size_t batch_events = 0;
+        const double batch_secs = time_seconds([&]() {
+            for (int r = 0; r < repetitions; ++r) {
+                timestamp_t abs_time_base = 0;
+                batch_events = 0;
+                for (const BlockXEFile::Block &block : input_file) {
+                    batch.clear();
+                    Decoder::decode_events(block.event_bytes, block.available_events, abs_time_base, fields_def, batch);
+                    batch_events += batch.size();
+                    for (size_t i = 0; i < batch.size(); ++i)
+                        batch_checksum += batch.timestamp()[i] ^ batch.x()[i];
+                }
+            }
+        });
+
+        //leitura de um único campo: contagem de polaridades positivas
+        size_t aos_positive = 0, soa_positive = 0;
+        EventBatch whole;
+        timestamp_t abs_time_base = 0;
+        for (const BlockXEFile::Block &block : input_file)
+            Decoder::decode_events(block.event_bytes, block.available_events, abs_time_base, fields_def, whole);
+        const double aos_scan_secs = time_seconds([&]() {
+            for (int r = 0; r < repetitions; ++r)
+                for (const CDEvent &ev : all_events)
+                    aos_positive += ev.polarity;
+        });
+        const double soa_scan_secs = time_seconds([&]() {
+            for (int r = 0; r < repetitions; ++r)
+                for (size_t i = 0; i < whole.size(); ++i)
+                    soa_positive += whole.polarity()[i];
+        });
+
+        bool same = whole.size() == all_events.size() && aos_positive == soa_positive;
+        for (size_t i = 0; same && i < whole.size(); ++i)
+            same = whole.cd_event(i) == all_events[i];
+        for (const CDEvent &ev : all_events)
+            aos_checksum += ev.timestamp ^ ev.x;
+        if (!same || aos_checksum * repetitions != batch_checksum) {
+            std::cerr << "EventBatch content differs from the per-event decoder!" << std::endl;
+            return 1;
+        }
+
+        //blocos com base de tempo no cabeçalho: cada thread descodifica uma fatia de blocos de forma independente
+        double parallel_secs = 0;
+        unsigned num_threads = 0;
+        if (input_file.self_contained_blocks()) {
+            std::vector<BlockXEFile::Block> blocks(input_file.begin(), input_file.end());
+            ThreadPool pool;
+            num_threads = pool.size();
+            std::vector<EventBatch> batches(num_threads);
+            std::vector<uint64_t> checksums(num_threads, 0);
+            parallel_secs = time_seconds([&]() {
+                for (int r = 0; r < repetitions; ++r) {
+                    pool.parallel_for(num_threads, [&](size_t t) {
+                        const size_t first = blocks.size() * t / num_threads;
+                        const size_t last = blocks.size() * (t + 1) / num_threads;
+                        for (size_t b = first; b < last; ++b) {
+                            batches[t].clear();
+                            Decoder::decode_block(blocks[b], fields_def, batches[t]);
+                            for (size_t i = 0; i < batches[t].size(); ++i)
+                                checksums[t] += batches[t].timestamp()[i] ^ batches[t].x()[i];
+                        }
+                    });
+                }
+            });
+            uint64_t parallel_checksum = 0;
+            for (uint64_t c : checksums)
+                parallel_checksum += c;
+            if (parallel_checksum != batch_checksum) {
+                std::cerr << "Independent block decode differs from the sequential decode!" << std::endl;
+                return 1;
+            }
+        }
+
+        std::cout << "Records: " << total_events << ", CD events: " << batch_events << std::endl;
+        std::cout << "Per-event decode into std::vector<CDEvent>: " << repetitions * total_events / aos_secs / 1e6 << " Mev/s" << std::endl;
+        std::cout << "Decoder::decode_events into EventBatch: " << repetitions * total_events / batch_secs / 1e6 << " Mev/s" << std::endl;
+        if (num_threads > 0)
+            std::cout << "Decoder::decode_block, independent blocks on " << num_threads << " threads: " << repetitions * total_events / parallel_secs / 1e6 << " Mev/s" << std::endl;
+        else
+            std::cout << "Blocks without time base: independent block decode skipped" << std::endl;
+        std::cout << "Polarity scan, CDEvent array: " << repetitions * all_events.size() / aos_scan_secs / 1e6 << " Mev/s" << std::endl;
+        std::cout << "Polarity scan, EventBatch column: " << repetitions * whole.size() / soa_scan_secs / 1e6 << " Mev/s" << std::endl;
+    } catch (const std::runtime_error &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,117 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <random>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include "../Codec/xe_format.h"
+#include "../Codec/event_kernels.h"
+#include "../Codec/xe_layout.h"
+
+using namespace XEFormat;
+
+template <typename F>
+static double time_seconds(F &&f) {
+    const auto start = std::chrono::steady_clock::now();
+    f();
+    const auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(end - start).count();
+}
+
+//mede f várias vezes e devolve o melhor débito em milhões de eventos por segundo
+template <typename F>
+static double best_mevs(size_t num_events, F &&f) {
+    double best = 0;
+    for (int rep = 0; rep < 5; ++rep) {
+        const double secs = time_seconds(f);
+        best = std::max(best, num_events / secs / 1e6);
+    }
+    return best;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 2) {
+        std::cerr << "Usage: " << argv[0] << " [NUM_EVENTS]" << std::endl;
+        return 1;
+    }
+    const size_t num_events = argc == 2 ? std::strtoull(argv[1], nullptr, 10) : 4000000;
+
+    const FieldsDefinition fields_def = FieldsDefinition::make_reference();
+    const timestamp_t abs_time_base = 1 << 20;
+
+    //eventos CD sintéticos dentro do alcance do timestamp relativo
+    std::mt19937_64 rng(42);
+    std::vector<CDEvent> events(num_events);
+    std::vector<timestamp_t> ts(num_events);
+    std::vector<unsigned int> pol(num_events), xs(num_events), ys(num_events);
+    for (size_t i = 0; i < num_events; ++i) {
+        events[i] = CDEvent{abs_time_base + rng() % (1 << 23), static_cast<unsigned int>(rng() & 1), static_cast<unsigned int>(rng() % 1280), static_cast<unsigned int>(rng() % 720)};
+        ts[i] = events[i].timestamp;
+        pol[i] = events[i].polarity;
+        xs[i] = events[i].x;
+        ys[i] = events[i].y;
+    }
+    const CDEventColumns columns{ts.data(), pol.data(), xs.data(), ys.data()};
+
+    //referência: um evento de cada vez com encode_event_cd e escrita byte a byte
+    std::vector<uint8_t> reference(num_events * fields_def.event_size_bytes);
+    const double reference_mevs = best_mevs(num_events, [&]() {
+        for (size_t i = 0; i < num_events; ++i) {
+            const encoded_event_t ev = Encoder::encode_event_cd(events[i], abs_time_base, fields_def);
+            for (size_t b = 0; b < fields_def.event_size_bytes; ++b)
+                reference[i * fields_def.event_size_bytes + b] = static_cast<uint8_t>(ev >> ((fields_def.event_size_bytes - 1 - b) * 8));
+        }
+    });
+    std::cout << "encode_event_cd (per event): " << reference_mevs << " Mev/s" << std::endl;
+
+    //mesmo ciclo com o codec de layout fixo (deslocamentos e máscaras constantes)
+    std::vector<uint8_t> bytes(reference.size());
+    const double static_mevs = best_mevs(num_events, [&]() {
+        for (size_t i = 0; i < num_events; ++i)
+            ReferenceLayout::store_record(ReferenceLayout::encode_event_cd(events[i], abs_time_base), bytes.data() + i * ReferenceLayout::event_size_bytes());
+    });
+    std::cout << "ReferenceLayout::encode_event_cd (per event): " << static_mevs << " Mev/s" << std::endl;
+    bool ok = bytes == reference;
+
+    std::vector<CDEvent> decoded(num_events);
+    std::vector<encoded_event_t> encoded(num_events);
+    std::vector<timestamp_t> ts_out(num_events);
+    std::vector<unsigned int> pol_out(num_events), xs_out(num_events), ys_out(num_events);
+    const CDEventColumns columns_out{ts_out.data(), pol_out.data(), xs_out.data(), ys_out.data()};
+
+    for (KernelISA isa : {KernelISA::Scalar, KernelISA::SSE41, KernelISA::AVX2}) {
+        if (!set_kernel_isa(isa))
+            continue;
+        const std::string name = kernel_isa_name(isa);
+
+        const double pack_cd = best_mevs(num_events, [&]() { Encoder::pack_cd_events(events.data(), num_events, abs_time_base, fields_def, bytes.data()); });
+        ok &= bytes == reference;
+        const double unpack_cd = best_mevs(num_events, [&]() { Decoder::unpack_cd_events(bytes.data(), num_events, abs_time_base, fields_def, decoded.data()); });
+        ok &= decoded == events;
+
+        std::fill(bytes.begin(), bytes.end(), 0);
+        const double pack_columns = best_mevs(num_events, [&]() { Encoder::pack_cd_columns(columns, num_events, abs_time_base, fields_def, bytes.data()); });
+        ok &= bytes == reference;
+        const double unpack_columns = best_mevs(num_events, [&]() { Decoder::unpack_cd_columns(bytes.data(), num_events, abs_time_base, fields_def, columns_out); });
+        ok &= ts_out == ts && pol_out == pol && xs_out == xs && ys_out == ys;
+
+        const double unpack_records = best_mevs(num_events, [&]() { Decoder::unpack_encoded_events(bytes.data(), num_events, fields_def, encoded.data()); });
+        std::fill(bytes.begin(), bytes.end(), 0);
+        const double pack_records = best_mevs(num_events, [&]() { Encoder::pack_encoded_events(encoded.data(), num_events, fields_def, bytes.data()); });
+        ok &= bytes == reference;
+
+        std::cout << name << ": pack_cd_events " << pack_cd << " Mev/s, unpack_cd_events " << unpack_cd
+                  << " Mev/s, pack_cd_columns " << pack_columns << " Mev/s, unpack_cd_columns " << unpack_columns
+                  << " Mev/s, pack_encoded_events " << pack_records << " Mev/s, unpack_encoded_events " << unpack_records << " Mev/s" << std::endl;
+    }
+    set_kernel_isa(detect_kernel_isa());
+
+    if (!ok) {
+        std::cerr << "Kernel output does not match the per-event reference." << std::endl;
+        return 1;
+    }
+    std::cout << "All kernels match the per-event reference." << std::endl;
+    return 0;
+}
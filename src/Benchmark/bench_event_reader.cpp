@@ -0,0 +1,106 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <random>
+#include <cstdint>
+#include <cstdlib>
+#include "../Codec/xe_format.h"
+
+using namespace XEFormat;
+
+//gera um stream sintético de eventos CD já empacotados (sem cabeçalho)
+static std::string make_synthetic_stream(size_t num_events, const FieldsDefinition &fdef) {
+    std::mt19937_64 rng(42);
+    std::ostringstream os;
+    timestamp_t abs_time_base = 0;
+    timestamp_t ts = 0;
+    for (size_t i = 0; i < num_events; ++i) {
+        ts += rng() % 64;
+        CDEvent ev{ts, static_cast<unsigned int>(rng() & 1), static_cast<unsigned int>(rng() % 1280), static_cast<unsigned int>(rng() % 720)};
+        Encoder::write_event_cd(ev, abs_time_base, fdef, os);
+    }
+    return os.str();
+}
+
+//leitura original de um evento: um read() por byte, mantida aqui como referência
+//(Decoder::read_next_encoded_event passou a usar o caminho em bloco e não serve de comparação)
+static bool read_event_per_byte(std::istream &is, const FieldsDefinition &fdef, encoded_event_t &read_encoded_event) {
+    read_encoded_event = 0;
+    for (int i = 0; i < fdef.event_size_bytes; ++i) {
+        uint8_t read_byte;
+        if (!is.read((char*) &read_byte, 1))
+            return false;
+        read_encoded_event = (read_encoded_event << 8) + read_byte;
+    }
+    return true;
+}
+
+template <typename F>
+static double time_seconds(F &&f) {
+    const auto start = std::chrono::steady_clock::now();
+    f();
+    const auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(end - start).count();
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 2) {
+        std::cerr << "Usage: " << argv[0] << " [RAW_EVENTS_FILE]" << std::endl;
+        return 1;
+    }
+
+    const FieldsDefinition fields_def = FieldsDefinition::make_reference();
+
+    std::string data;
+    if (argc == 2) {
+        std::ifstream input_file(argv[1], std::ios::binary);
+        if (!input_file) {
+            std::cerr << "Cannot open input file: " << argv[1] << std::endl;
+            return 1;
+        }
+        std::ostringstream ss;
+        ss << input_file.rdbuf();
+        data = ss.str();
+    } else {
+        data = make_synthetic_stream(20000000, fields_def);
+    }
+    const size_t total_events = data.size() / fields_def.event_size_bytes;
+
+    //caminho antigo: um evento por chamada, um read() por byte
+    {
+        std::istringstream is(data);
+        encoded_event_t ev;
+        uint64_t checksum = 0;
+        size_t n = 0;
+        const double secs = time_seconds([&]() {
+            while (read_event_per_byte(is, fields_def, ev)) {
+                checksum ^= ev;
+                ++n;
+            }
+        });
+        std::cout << "per-event read(): " << n << " events, " << (n / secs) / 1e6 << " Mev/s (checksum " << checksum << ")" << std::endl;
+    }
+
+    //caminho em bloco com vários tamanhos de chunk
+    for (size_t chunk_mib : {1, 4, 16}) {
+        std::istringstream is(data);
+        std::vector<encoded_event_t> chunk((chunk_mib << 20) / sizeof(encoded_event_t));
+        uint64_t checksum = 0;
+        size_t n = 0;
+        const double secs = time_seconds([&]() {
+            size_t read;
+            while ((read = Decoder::read_encoded_events(is, fields_def, chunk.data(), chunk.size())) > 0) {
+                for (size_t i = 0; i < read; ++i)
+                    checksum ^= chunk[i];
+                n += read;
+            }
+        });
+        std::cout << "read_encoded_events (" << chunk_mib << " MiB chunks): " << n << " events, " << (n / secs) / 1e6 << " Mev/s (checksum " << checksum << ")" << std::endl;
+    }
+
+    std::cout << "Total events in stream: " << total_events << std::endl;
+    return 0;
+}
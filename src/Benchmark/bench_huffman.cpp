@@ -0,0 +1,76 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <stdexcept>
+#include "../Codec/xe_format.h"
+#include "../Codec/mapped_file.h"
+#include "../Codec/huffman.h"
+
+using namespace XEFormat;
+
+template <typename F>
+static double time_seconds(F &&f) {
+    const auto start = std::chrono::steady_clock::now();
+    f();
+    const auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(end - start).count();
+}
+
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        std::cerr << "Usage: " << argv[0] << " INPUT_BXE_FILE" << std::endl;
+        return 1;
+    }
+
+    const FieldsDefinition fields_def = FieldsDefinition::make_reference();
+
+    try {
+        //bytes dos eventos de todos os blocos, como nos scripts de compressão
+        const BlockXEFile input_file(argv[1], fields_def);
+        std::vector<uint8_t> event_bytes;
+        for (const BlockXEFile::Block &block : input_file)
+            event_bytes.insert(event_bytes.end(), block.event_bytes, block.event_bytes + block.available_events * fields_def.event_size_bytes);
+
+        std::vector<uint64_t> counts(256, 0);
+        for (uint8_t b : event_bytes)
+            ++counts[b];
+        const std::vector<uint8_t> lengths = build_huffman_code_lengths(counts);
+
+        //codificado em troços de 1024 eventos, como os blocos do .bxe
+        const size_t run_bytes = 1024 * fields_def.event_size_bytes;
+        std::vector<uint8_t> compressed;
+        const HuffmanEncoder encoder(lengths);
+        const double encode_secs = time_seconds([&]() {
+            for (size_t i = 0; i < event_bytes.size(); i += run_bytes)
+                encoder.encode(event_bytes.data() + i, std::min(run_bytes, event_bytes.size() - i), compressed);
+        });
+
+        const HuffmanDecoder decoder(lengths);
+        std::vector<uint8_t> decoded(event_bytes.size());
+        const int repetitions = 5;
+        const double decode_secs = time_seconds([&]() {
+            for (int r = 0; r < repetitions; ++r) {
+                size_t pos = 0;
+                for (size_t i = 0; i < event_bytes.size(); i += run_bytes)
+                    pos += decoder.decode(compressed.data() + pos, compressed.size() - pos, decoded.data() + i, std::min(run_bytes, event_bytes.size() - i));
+            }
+        });
+
+        if (decoded != event_bytes) {
+            std::cerr << "Decoded bytes differ from the input!" << std::endl;
+            return 1;
+        }
+
+        const double gb = event_bytes.size() / 1e9;
+        std::cout << "Huffman encode: " << gb / encode_secs << " GB/s" << std::endl;
+        std::cout << "Huffman decode: " << repetitions * gb / decode_secs << " GB/s" << std::endl;
+        std::cout << "Compression ratio: " << 100.0 * (compressed.size() + 128) / event_bytes.size() << "%" << std::endl;
+    } catch (const std::runtime_error &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
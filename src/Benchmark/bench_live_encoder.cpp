@@ -0,0 +1,143 @@
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <random>
+#include <atomic>
+#include <new>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+#include <stdexcept>
+#include "../Codec/xe_format.h"
+#include "../Codec/live_encoder.h"
+
+using namespace XEFormat;
+
+//contador de alocações, para verificar que o caminho estável do encoder não aloca memória
+static std::atomic<size_t> allocations(0);
+
+void* operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size == 0 ? 1 : size))
+        return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+//eventos de um sensor sintético com uma dada taxa: timestamps em microssegundos, píxeis agrupados à volta de um ponto que se move
+static std::vector<CDEvent> make_sensor_events(double events_per_second, double seconds) {
+    std::mt19937_64 rng(7);
+    const size_t num_events = static_cast<size_t>(events_per_second * seconds);
+    std::vector<CDEvent> events(num_events);
+    unsigned cx = 640, cy = 360;
+    for (size_t i = 0; i < num_events; ++i) {
+        if (i % 64 == 0) {
+            cx = (cx + 1280 + rng() % 9 - 4) % 1280;
+            cy = (cy + 720 + rng() % 9 - 4) % 720;
+        }
+        const timestamp_t ts = static_cast<timestamp_t>(i * 1e6 / events_per_second);
+        events[i] = CDEvent{ts, static_cast<unsigned int>(rng() & 1), static_cast<unsigned int>((cx + rng() % 32) % 1280), static_cast<unsigned int>((cy + rng() % 32) % 720)};
+    }
+    return events;
+}
+
+static double percentile(const std::vector<double> &sorted, double p) {
+    if (sorted.empty())
+        return 0;
+    return sorted[std::min(sorted.size() - 1, static_cast<size_t>(p * sorted.size()))];
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 3) {
+        std::cerr << "Usage: " << argv[0] << " [SECONDS_PER_RATE] [MAX_DELAY_US]" << std::endl;
+        return 1;
+    }
+    const double seconds = argc >= 2 ? std::atof(argv[1]) : 1.0;
+    const long max_delay_us = argc == 3 ? std::atol(argv[2]) : 2000;
+
+    const FieldsDefinition fields_def = FieldsDefinition::make_reference();
+
+    std::cout << "rate (ev/s) | blocks | mean events | p50 (us) | p99 (us) | p999 (us) | max (us) | ratio | allocations" << std::endl;
+    for (double rate : {1e4, 1e5, 1e6, 3e6}) {
+        const std::vector<CDEvent> events = make_sensor_events(rate, seconds);
+
+        //memória reservada antes da medição: latência de cada bloco e blocos comprimidos
+        std::vector<double> latencies;
+        latencies.reserve(events.size() + 16);
+        std::vector<uint8_t> compressed;
+        compressed.reserve(events.size() * fields_def.event_size_bytes + 1024);
+        std::vector<size_t> block_sizes;
+        block_sizes.reserve(events.size() + 16);
+
+        LiveEncoderOptions options;
+        options.max_delay = std::chrono::microseconds(max_delay_us);
+        LiveEncoder encoder(fields_def, options, [&](const LiveBlock &block) {
+            //latência do bloco: desde a chegada do seu primeiro evento até o bloco comprimido estar pronto
+            const auto ready = std::chrono::steady_clock::now();
+            latencies.push_back(std::chrono::duration<double, std::micro>(ready - block.first_push).count());
+            compressed.insert(compressed.end(), block.data, block.data + block.size);
+            block_sizes.push_back(block.size);
+        });
+
+        //reprodução em tempo real: cada evento é entregue quando o relógio chega ao seu timestamp, em pacotes
+        const size_t max_packet = 4096;
+        const auto start = std::chrono::steady_clock::now();
+        size_t warmup_allocations = 0;
+        bool warm = false;
+        size_t next = 0;
+        while (next < events.size()) {
+            const timestamp_t now_us = static_cast<timestamp_t>(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+            size_t end = next;
+            while (end < events.size() && end - next < max_packet && events[end].timestamp <= now_us)
+                ++end;
+            if (end > next) {
+                encoder.push(events.data() + next, end - next);
+                next = end;
+            } else {
+                encoder.poll();
+            }
+            //os primeiros 10% servem para aquecer modelos e buffers
+            if (!warm && next >= events.size() / 10) {
+                warm = true;
+                warmup_allocations = allocations.load();
+            }
+        }
+        encoder.flush();
+        const size_t steady_allocations = allocations.load() - warmup_allocations;
+
+        //verificação: os blocos descodificados têm de ser iguais aos eventos escritos por Encoder::write_event_cd
+        std::ostringstream reference;
+        timestamp_t abs_time_base = 0;
+        for (const CDEvent &ev : events)
+            Encoder::write_event_cd(ev, abs_time_base, fields_def, reference);
+        LiveDecoder decoder(fields_def);
+        std::vector<uint8_t> decoded;
+        size_t offset = 0;
+        for (size_t size : block_sizes) {
+            decoder.decode(compressed.data() + offset, size, decoded);
+            offset += size;
+        }
+        const std::string reference_bytes = reference.str();
+        if (decoded.size() != reference_bytes.size() || std::memcmp(decoded.data(), reference_bytes.data(), decoded.size()) != 0) {
+            std::cerr << "Live stream does not decode to the pushed events!" << std::endl;
+            return 1;
+        }
+
+        std::vector<double> sorted = latencies;
+        std::sort(sorted.begin(), sorted.end());
+        std::cout << rate
+                  << " | " << encoder.num_blocks()
+                  << " | " << static_cast<double>(reference_bytes.size()) / fields_def.event_size_bytes / std::max<uint64_t>(1, encoder.num_blocks())
+                  << " | " << percentile(sorted, 0.5)
+                  << " | " << percentile(sorted, 0.99)
+                  << " | " << percentile(sorted, 0.999)
+                  << " | " << (sorted.empty() ? 0 : sorted.back())
+                  << " | " << 100.0 * compressed.size() / reference_bytes.size() << "%"
+                  << " | " << steady_allocations << std::endl;
+    }
+    return 0;
+}
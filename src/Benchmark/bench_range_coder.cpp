@@ -0,0 +1,54 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <chrono>
+#include <cstdint>
+#include <stdexcept>
+#include "../Codec/xe_format.h"
+#include "../Codec/mapped_file.h"
+#include "../Codec/bxe_codec.h"
+
+using namespace XEFormat;
+
+template <typename F>
+static double time_seconds(F &&f) {
+    const auto start = std::chrono::steady_clock::now();
+    f();
+    const auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(end - start).count();
+}
+
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        std::cerr << "Usage: " << argv[0] << " INPUT_BXE_FILE" << std::endl;
+        return 1;
+    }
+
+    const FieldsDefinition fields_def = FieldsDefinition::make_reference();
+
+    try {
+        const BlockXEFile input_file(argv[1], fields_def);
+        const double input_mb = input_file.mapping().size() / 1e6;
+
+        CompressionOptions options;
+        std::ostringstream compressed;
+        size_t compressed_size = 0;
+        const double encode_secs = time_seconds([&]() {
+            compressed_size = compress_bxe(input_file, fields_def, options, compressed);
+        });
+
+        const std::string data = compressed.str();
+        std::ostringstream reconstructed;
+        const double decode_secs = time_seconds([&]() {
+            decompress_bxe(reinterpret_cast<const uint8_t*>(data.data()), data.size(), fields_def, reconstructed);
+        });
+
+        //comparar com os valores de src/Scripts/bench_arit_reference.py no mesmo ficheiro
+        std::cout << "C++ range coder: encode " << input_mb / encode_secs << " MB/s, decode " << input_mb / decode_secs << " MB/s" << std::endl;
+        std::cout << "Compression ratio: " << 100.0 * compressed_size / input_file.mapping().size() << "%" << std::endl;
+    } catch (const std::runtime_error &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
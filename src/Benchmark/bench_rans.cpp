@@ -0,0 +1,86 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <stdexcept>
+#include "../Codec/xe_format.h"
+#include "../Codec/mapped_file.h"
+#include "../Codec/event_kernels.h"
+#include "../Codec/rans.h"
+
+using namespace XEFormat;
+
+template <typename F>
+static double time_seconds(F &&f) {
+    const auto start = std::chrono::steady_clock::now();
+    f();
+    const auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(end - start).count();
+}
+
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        std::cerr << "Usage: " << argv[0] << " INPUT_BXE_FILE" << std::endl;
+        return 1;
+    }
+
+    const FieldsDefinition fields_def = FieldsDefinition::make_reference();
+
+    try {
+        //bytes dos eventos de todos os blocos, como no bench_huffman
+        const BlockXEFile input_file(argv[1], fields_def);
+        std::vector<uint8_t> event_bytes;
+        for (const BlockXEFile::Block &block : input_file)
+            event_bytes.insert(event_bytes.end(), block.event_bytes, block.event_bytes + block.available_events * fields_def.event_size_bytes);
+
+        //tabela estática a partir das contagens globais, como as freqs do compress_block_arit.py
+        std::vector<uint64_t> counts(256, 0);
+        for (uint8_t b : event_bytes)
+            ++counts[b];
+        const std::vector<uint16_t> freqs = build_rans_frequencies(counts);
+
+        //codificado em troços de 64 blocos de 1024 eventos, como os segmentos do compress_blockxe
+        const size_t run_bytes = 64 * 1024 * fields_def.event_size_bytes;
+        const double gb = event_bytes.size() / 1e9;
+        const KernelISA best_isa = detect_kernel_isa();
+        for (unsigned lanes : {4, 8, 16, 32}) {
+            std::vector<uint8_t> compressed;
+            const RansEncoder encoder(freqs, lanes);
+            const double encode_secs = time_seconds([&]() {
+                for (size_t i = 0; i < event_bytes.size(); i += run_bytes)
+                    encoder.encode(event_bytes.data() + i, std::min(run_bytes, event_bytes.size() - i), compressed);
+            });
+            std::cout << lanes << " lanes: encode " << gb / encode_secs << " GB/s, compression ratio "
+                      << 100.0 * (compressed.size() + 512) / event_bytes.size() << "%" << std::endl;
+
+            //descodificação com cada conjunto de instruções disponível (o escalar e o AVX2 têm de dar o mesmo)
+            const RansDecoder decoder(freqs, lanes);
+            for (KernelISA isa : {KernelISA::Scalar, KernelISA::AVX2}) {
+                if (!set_kernel_isa(isa))
+                    continue;
+                std::vector<uint8_t> decoded(event_bytes.size());
+                const int repetitions = 5;
+                double best = 1e30;
+                for (int r = 0; r < repetitions; ++r) {
+                    best = std::min(best, time_seconds([&]() {
+                        size_t pos = 0;
+                        for (size_t i = 0; i < event_bytes.size(); i += run_bytes)
+                            pos += decoder.decode(compressed.data() + pos, compressed.size() - pos, decoded.data() + i, std::min(run_bytes, event_bytes.size() - i));
+                    }));
+                }
+                if (decoded != event_bytes) {
+                    std::cerr << "Decoded bytes differ from the input!" << std::endl;
+                    return 1;
+                }
+                std::cout << "  decode (" << kernel_isa_name(isa) << "): " << gb / best << " GB/s" << std::endl;
+            }
+            set_kernel_isa(best_isa);
+        }
+    } catch (const std::runtime_error &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,193 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <cstdint>
+#include <cstdlib>
+#include <algorithm>
+#include "../Codec/xe_format.h"
+#include "../Codec/spsc_ring.h"
+#include "../Codec/bounded_queue.h"
+
+using namespace XEFormat;
+
+template <typename F>
+static double time_seconds(F &&f) {
+    const auto start = std::chrono::steady_clock::now();
+    f();
+    const auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(end - start).count();
+}
+
+static uint64_t now_ns() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+//teste de stress: sequência 0..n-1 com lotes de tamanho aleatório e os dois estilos de API (cópia e spans no ring)
+static bool stress(size_t capacity, size_t n) {
+    SpscRing<encoded_event_t> ring(capacity);
+    std::thread producer([&]() {
+        std::mt19937_64 rng(1);
+        std::vector<encoded_event_t> batch(4096);
+        encoded_event_t next = 0;
+        while (next < n) {
+            const size_t size = std::min<size_t>(1 + rng() % batch.size(), n - next);
+            if (rng() & 1) {
+                for (size_t i = 0; i < size; ++i)
+                    batch[i] = next + i;
+                ring.push(batch.data(), size);
+                next += size;
+            } else {
+                size_t room;
+                encoded_event_t* span = ring.wait_write_span(room);
+                room = std::min(room, size);
+                for (size_t i = 0; i < room; ++i)
+                    span[i] = next + i;
+                ring.publish(room);
+                next += room;
+            }
+        }
+        ring.close();
+    });
+
+    std::mt19937_64 rng(2);
+    std::vector<encoded_event_t> batch(4096);
+    encoded_event_t expected = 0;
+    bool ok = true;
+    for (;;) {
+        if (rng() & 1) {
+            const size_t got = ring.pop(batch.data(), 1 + rng() % batch.size());
+            if (got == 0)
+                break;
+            for (size_t i = 0; i < got; ++i)
+                ok &= batch[i] == expected++;
+        } else {
+            size_t got;
+            const encoded_event_t* span = ring.wait_read_span(got);
+            if (got == 0)
+                break;
+            got = std::min<size_t>(got, 1 + rng() % batch.size());
+            for (size_t i = 0; i < got; ++i)
+                ok &= span[i] == expected++;
+            ring.consume(got);
+        }
+    }
+    producer.join();
+    return ok && expected == n;
+}
+
+//débito do ring: o produtor publica lotes de batch eventos, o consumidor lê tudo o que estiver disponível
+static double ring_throughput(size_t n, size_t batch_size) {
+    SpscRing<encoded_event_t> ring(1 << 16);
+    uint64_t checksum = 0;
+    const double secs = time_seconds([&]() {
+        std::thread producer([&]() {
+            std::vector<encoded_event_t> batch(batch_size);
+            for (size_t next = 0; next < n; next += batch_size) {
+                const size_t size = std::min(batch_size, n - next);
+                for (size_t i = 0; i < size; ++i)
+                    batch[i] = next + i;
+                ring.push(batch.data(), size);
+            }
+            ring.close();
+        });
+        size_t got;
+        const encoded_event_t* span;
+        while ((span = ring.wait_read_span(got), got > 0)) {
+            for (size_t i = 0; i < got; ++i)
+                checksum += span[i];
+            ring.consume(got);
+        }
+        producer.join();
+    });
+    if (checksum != static_cast<uint64_t>(n) * (n - 1) / 2)
+        std::cerr << "Ring lost events!" << std::endl;
+    return n / secs / 1e6;
+}
+
+//débito com o mutex/condition variable da BoundedQueue, um lote (vetor) por push
+static double queue_throughput(size_t n, size_t batch_size) {
+    BoundedQueue<std::vector<encoded_event_t>> queue((1 << 16) / batch_size + 1);
+    uint64_t checksum = 0;
+    const double secs = time_seconds([&]() {
+        std::thread producer([&]() {
+            for (size_t next = 0; next < n; next += batch_size) {
+                const size_t size = std::min(batch_size, n - next);
+                std::vector<encoded_event_t> batch(size);
+                for (size_t i = 0; i < size; ++i)
+                    batch[i] = next + i;
+                queue.push(std::move(batch));
+            }
+            queue.close();
+        });
+        std::vector<encoded_event_t> batch;
+        while (queue.pop(batch))
+            for (encoded_event_t ev : batch)
+                checksum += ev;
+        producer.join();
+    });
+    if (checksum != static_cast<uint64_t>(n) * (n - 1) / 2)
+        std::cerr << "Queue lost events!" << std::endl;
+    return n / secs / 1e6;
+}
+
+//latência de entrega de um evento isolado (o evento leva o instante em que foi publicado)
+template <typename Push, typename Pop>
+static std::vector<double> handoff_latencies(size_t samples, Push push, Pop pop) {
+    std::vector<double> latencies;
+    latencies.reserve(samples);
+    std::thread producer([&]() {
+        for (size_t i = 0; i < samples; ++i) {
+            const uint64_t start = now_ns();
+            while (now_ns() - start < 2000) {
+            }
+            push(now_ns());
+        }
+        push(0);
+    });
+    uint64_t stamp;
+    while (pop(stamp) && stamp != 0)
+        latencies.push_back((now_ns() - stamp) / 1e3);
+    producer.join();
+    std::sort(latencies.begin(), latencies.end());
+    return latencies;
+}
+
+static void print_latencies(const std::string &name, const std::vector<double> &sorted) {
+    auto at = [&](double p) { return sorted[std::min(sorted.size() - 1, static_cast<size_t>(p * sorted.size()))]; };
+    std::cout << name << " handoff latency: p50 " << at(0.5) << " us, p99 " << at(0.99) << " us, p999 " << at(0.999) << " us" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 2) {
+        std::cerr << "Usage: " << argv[0] << " [NUM_EVENTS]" << std::endl;
+        return 1;
+    }
+    const size_t num_events = argc == 2 ? std::strtoull(argv[1], nullptr, 10) : 50000000;
+
+    for (size_t capacity : {1, 7, 64, 4096}) {
+        if (!stress(capacity, 2000000)) {
+            std::cerr << "SpscRing stress test failed with capacity " << capacity << std::endl;
+            return 1;
+        }
+    }
+    std::cout << "Stress test passed" << std::endl;
+
+    for (size_t batch_size : {1, 64, 1024}) {
+        std::cout << "Batch " << batch_size << ": SpscRing " << ring_throughput(num_events, batch_size) << " Mev/s, BoundedQueue "
+                  << queue_throughput(batch_size == 1 ? num_events / 10 : num_events, batch_size) << " Mev/s" << std::endl;
+    }
+
+    const size_t samples = 100000;
+    SpscRing<uint64_t> ring(1024);
+    print_latencies("SpscRing", handoff_latencies(samples,
+        [&](uint64_t v) { ring.push(&v, 1); },
+        [&](uint64_t &v) { return ring.pop(&v, 1) == 1; }));
+    BoundedQueue<uint64_t> queue(1024);
+    print_latencies("BoundedQueue", handoff_latencies(samples,
+        [&](uint64_t v) { queue.push(v); },
+        [&](uint64_t &v) { return queue.pop(v); }));
+    return 0;
+}
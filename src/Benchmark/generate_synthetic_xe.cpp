@@ -0,0 +1,58 @@
+#include <iostream>
+#include <fstream>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <stdexcept>
+#include "../Codec/xe_format.h"
+#include "../Codec/synthetic_stream.h"
+
+using namespace XEFormat;
+
+int main(int argc, char* argv[]) {
+    const char* usage = " OUTPUT_XE_FILE NUM_EVENTS [--rate EV_PER_S] [--clustering 0..1] [--objects N] [--on-fraction 0..1] [--trigger-rate HZ] [--seed N]";
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << usage << std::endl;
+        return 1;
+    }
+
+    //parâmetros do sensor sintético (a mesma semente gera sempre o mesmo ficheiro)
+    SyntheticStreamOptions options;
+    options.num_events = std::strtoull(argv[2], nullptr, 10);
+    for (int i = 3; i < argc; ++i) {
+        if (i + 1 < argc && std::strcmp(argv[i], "--rate") == 0) {
+            options.event_rate = std::atof(argv[++i]);
+        } else if (i + 1 < argc && std::strcmp(argv[i], "--clustering") == 0) {
+            options.clustering = std::atof(argv[++i]);
+        } else if (i + 1 < argc && std::strcmp(argv[i], "--objects") == 0) {
+            options.num_objects = std::strtoull(argv[++i], nullptr, 10);
+        } else if (i + 1 < argc && std::strcmp(argv[i], "--on-fraction") == 0) {
+            options.on_fraction = std::atof(argv[++i]);
+        } else if (i + 1 < argc && std::strcmp(argv[i], "--trigger-rate") == 0) {
+            options.trigger_rate = std::atof(argv[++i]);
+        } else if (i + 1 < argc && std::strcmp(argv[i], "--seed") == 0) {
+            options.seed = std::strtoull(argv[++i], nullptr, 10);
+        } else {
+            std::cerr << "Usage: " << argv[0] << usage << std::endl;
+            return 1;
+        }
+    }
+
+    const FieldsDefinition fields_def = FieldsDefinition::make_reference();
+
+    try {
+        std::ofstream output_file(argv[1], std::ios::binary);
+        if (!output_file) {
+            std::cerr << "Cannot open output file: " << argv[1] << std::endl;
+            return 1;
+        }
+        const size_t written = write_synthetic_stream(options, fields_def, output_file);
+        output_file.close();
+        std::cout << "Wrote " << written << " events to " << argv[1] << std::endl;
+    } catch (const std::runtime_error &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,71 @@
+/**********************************************************************************************************************
+ * MIT License                                                                                                        *
+ *                                                                                                                    *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and                  *
+ * associated documentation files (the “Software”), to deal in the Software without restriction,                      *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,              *
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,              *
+ * subject to the following conditions:                                                                               *
+ *                                                                                                                    *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial               *
+ * portions of the Software.                                                                                          *
+ *                                                                                                                    *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,                                *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND               *
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES               *
+ * OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN                *
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ **********************************************************************************************************************/
+
+#include <new>
+#include <stdexcept>
+#include "arena.h"
+
+namespace XEFormat {
+
+void Arena::ChunkDeleter::operator()(std::uint8_t *p) const {
+    ::operator delete[](p, std::align_val_t(max_alignment));
+}
+
+void Arena::add_chunk(std::size_t min_size) {
+    const std::size_t size = min_size > chunk_size_ ? min_size : chunk_size_;
+    Chunk chunk{std::unique_ptr<std::uint8_t[], ChunkDeleter>(static_cast<std::uint8_t*>(::operator new[](size, std::align_val_t(max_alignment)))), size};
+    chunks_.push_back(std::move(chunk));
+    used_ = 0;
+}
+
+void *Arena::allocate(std::size_t size, std::size_t align) {
+    if(align == 0 || (align & (align - 1)) != 0 || align > max_alignment) {
+        throw std::runtime_error("Invalid arena alignment.");
+    }
+    if(!chunks_.empty()) {
+        const std::size_t offset = (used_ + align - 1) & ~(align - 1);
+        if(offset <= chunks_.back().size && size <= chunks_.back().size - offset) {
+            used_ = offset + size;
+            return chunks_.back().data.get() + offset;
+        }
+    }
+    // chunks start on a max_alignment boundary, so a fresh chunk of size bytes always fits
+    add_chunk(size);
+    used_ = size;
+    return chunks_.back().data.get();
+}
+
+void Arena::reset() {
+    if(chunks_.size() > 1) {
+        const std::size_t total = capacity();
+        chunks_.clear();
+        add_chunk(total);
+    }
+    used_ = 0;
+}
+
+std::size_t Arena::capacity() const {
+    std::size_t total = 0;
+    for(const Chunk &chunk : chunks_) {
+        total += chunk.size;
+    }
+    return total;
+}
+
+} // namespace XEFormat
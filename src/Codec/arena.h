@@ -0,0 +1,76 @@
+/**********************************************************************************************************************
+ * MIT License                                                                                                        *
+ *                                                                                                                    *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and                  *
+ * associated documentation files (the “Software”), to deal in the Software without restriction,                      *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,              *
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,              *
+ * subject to the following conditions:                                                                               *
+ *                                                                                                                    *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial               *
+ * portions of the Software.                                                                                          *
+ *                                                                                                                    *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,                                *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND               *
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES               *
+ * OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN                *
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ **********************************************************************************************************************/
+
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <type_traits>
+#include <cstddef>
+#include <cstdint>
+
+namespace XEFormat {
+
+/// @brief  Bump allocator for buffers that all die together. reset() releases every allocation at once and keeps the
+///         memory: the chunks are merged into a single one, so a workload that repeats the same allocations (e.g. one
+///         block after the other) stops touching the system allocator after the first round.
+class Arena {
+public:
+    /// @brief  Creates an empty arena; nothing is allocated until the first allocate().
+    /// @param chunk_size minimum size of the chunks requested from the system.
+    explicit Arena(std::size_t chunk_size = std::size_t(1) << 20) : chunk_size_(chunk_size) {}
+
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    /// @brief  Returns size bytes aligned to align (a power of two, at most max_alignment), valid until reset().
+    void *allocate(std::size_t size, std::size_t align = alignof(std::max_align_t));
+
+    /// @brief  Typed allocate(): room for n objects of type T, not constructed, aligned on a cache line.
+    template <typename T>
+    T *allocate_array(std::size_t n) {
+        static_assert(std::is_trivially_copyable<T>::value && alignof(T) <= max_alignment, "arena arrays hold plain values");
+        return static_cast<T*>(allocate(n*sizeof(T), max_alignment));
+    }
+
+    /// @brief  Releases every allocation, keeping the memory for the next ones.
+    void reset();
+
+    /// @brief  Total size of the chunks held by the arena.
+    std::size_t capacity() const;
+
+    static constexpr std::size_t max_alignment = 64;
+
+private:
+    struct ChunkDeleter {
+        void operator()(std::uint8_t *p) const;
+    };
+    struct Chunk {
+        std::unique_ptr<std::uint8_t[], ChunkDeleter> data;
+        std::size_t size;
+    };
+
+    void add_chunk(std::size_t min_size);
+
+    std::vector<Chunk> chunks_;
+    std::size_t used_ = 0;  // bytes used in the last chunk
+    std::size_t chunk_size_;
+};
+
+} // namespace XEFormat
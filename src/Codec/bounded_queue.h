@@ -0,0 +1,83 @@
+/**********************************************************************************************************************
+ * MIT License                                                                                                        *
+ *                                                                                                                    *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and                  *
+ * associated documentation files (the “Software”), to deal in the Software without restriction,                      *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,              *
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,              *
+ * subject to the following conditions:                                                                               *
+ *                                                                                                                    *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial               *
+ * portions of the Software.                                                                                          *
+ *                                                                                                                    *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,                                *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND               *
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES               *
+ * OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN                *
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ **********************************************************************************************************************/
+
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <cstddef>
+
+namespace XEFormat {
+
+/// @brief  Fixed-capacity blocking FIFO used to connect the stages of a producer/consumer pipeline.
+///         push() blocks while the queue is full, pop() blocks while it is empty. Once closed, pop() drains the
+///         remaining items and then returns false.
+template <typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(std::size_t capacity) : capacity_(capacity) {}
+
+    /// @brief  Appends an item, waiting for room if the queue is full.
+    /// @param value item to append.
+    /// @return false if the queue was closed, true otherwise.
+    bool push(T value) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_full_.wait(lock, [this]() { return closed_ || items_.size() < capacity_; });
+        if(closed_) {
+            return false;
+        }
+        items_.push_back(std::move(value));
+        not_empty_.notify_one();
+        return true;
+    }
+
+    /// @brief  Removes the oldest item, waiting for one if the queue is empty.
+    /// @param value output parameter to store the removed item.
+    /// @return false if the queue is closed and empty, true otherwise.
+    bool pop(T &value) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_empty_.wait(lock, [this]() { return closed_ || !items_.empty(); });
+        if(items_.empty()) {
+            return false;
+        }
+        value = std::move(items_.front());
+        items_.pop_front();
+        not_full_.notify_one();
+        return true;
+    }
+
+    /// @brief  Closes the queue, waking up every waiting producer and consumer.
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+        not_empty_.notify_all();
+        not_full_.notify_all();
+    }
+
+private:
+    const std::size_t capacity_;
+    std::deque<T> items_;
+    bool closed_ = false;
+    std::mutex mutex_;
+    std::condition_variable not_empty_;
+    std::condition_variable not_full_;
+};
+
+} // namespace XEFormat
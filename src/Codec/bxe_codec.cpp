@@ -0,0 +1,806 @@
+/**********************************************************************************************************************
+ * MIT License                                                                                                        *
+ *                                                                                                                    *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and                  *
+ * associated documentation files (the “Software”), to deal in the Software without restriction,                      *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,              *
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,              *
+ * subject to the following conditions:                                                                               *
+ *                                                                                                                    *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial               *
+ * portions of the Software.                                                                                          *
+ *                                                                                                                    *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,                                *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND               *
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES               *
+ * OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN                *
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ **********************************************************************************************************************/
+
+#include <vector>
+#include <sstream>
+#include <memory>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include "bxe_codec.h"
+#include "bxe_format.h"
+#include "range_coder.h"
+#include "huffman.h"
+#include "rans.h"
+#include "thread_pool.h"
+#include "integrity.h"
+#include "context_coder.h"
+#include "crc32c.h"
+#include "instrumentation.h"
+
+namespace XEFormat {
+
+namespace {
+
+const char compressed_magic[4] = {'B', 'X', 'E', 'Z'};
+// the only version read: the earlier numbers were development layouts that never left the tree
+constexpr std::uint8_t compressed_version = 8;
+
+/// @brief  Where the model of a compressed file comes from.
+constexpr std::uint8_t model_in_header = 0;      // stored in the header
+constexpr std::uint8_t model_pretrained = 1;     // u64 ID of a pre-trained model (see ModelStore)
+
+/// @brief  The segment index ends the file: one entry per segment (u64 offset, then u32 CRC-32C of the segment),
+///         then the u32 CRC-32C of the header (the bytes before the first segment), and last the u64 offset of the
+///         index.
+constexpr std::size_t index_entry_size = 12;
+constexpr std::size_t index_trailer_size = 12;
+
+template <typename T>
+void write_le(std::ostream &os, T value) {
+    char bytes[sizeof(T)];
+    for(std::size_t i=0; i<sizeof(T); ++i) {
+        bytes[i] = static_cast<char>((static_cast<std::uint64_t>(value) >> (8*i)) & 0xFF);
+    }
+    os.write(bytes, sizeof(T));
+}
+
+/// @brief  Bounds-checked little-endian reader over the compressed file.
+class ByteReader {
+public:
+    ByteReader(const std::uint8_t *data, std::size_t size) : data_(data), size_(size) {}
+
+    template <typename T>
+    T read_le() {
+        const std::uint8_t *p = take(sizeof(T));
+        std::uint64_t value = 0;
+        for(std::size_t i=0; i<sizeof(T); ++i) {
+            value |= static_cast<std::uint64_t>(p[i]) << (8*i);
+        }
+        return static_cast<T>(value);
+    }
+
+    std::uint64_t varint() {
+        std::uint64_t value = 0;
+        for(unsigned shift=0; shift<64; shift+=7) {
+            const std::uint8_t b = *take(1);
+            value |= static_cast<std::uint64_t>(b & 0x7F) << shift;
+            if(!(b & 0x80)) {
+                return value;
+            }
+        }
+        throw std::runtime_error("Invalid compressed .bxe header.");
+    }
+
+    const std::uint8_t *take(std::size_t n) {
+        if(n > size_ - pos_) {
+            throw std::runtime_error("Truncated compressed .bxe file.");
+        }
+        const std::uint8_t *p = data_ + pos_;
+        pos_ += n;
+        return p;
+    }
+
+    void seek(std::size_t pos) {
+        if(pos > size_) {
+            throw std::runtime_error("Truncated compressed .bxe file.");
+        }
+        pos_ = pos;
+    }
+
+private:
+    const std::uint8_t *data_;
+    std::size_t size_;
+    std::size_t pos_ = 0;
+};
+
+void put_varint(std::uint64_t value, std::vector<std::uint8_t> &output) {
+    while(value >= 0x80) {
+        output.push_back(static_cast<std::uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    output.push_back(static_cast<std::uint8_t>(value));
+}
+
+void write_varint(std::ostream &os, std::uint64_t value) {
+    while(value >= 0x80) {
+        os.put(static_cast<char>(value | 0x80));
+        value >>= 7;
+    }
+    os.put(static_cast<char>(value));
+}
+
+/// @brief  Model shared by every segment of a file, one entry per transformed stream. It is built once from the
+///         whole file and stored once in the header, instead of one table per block.
+struct GlobalModel {
+    std::vector<std::vector<std::uint32_t>> range_freqs;      // initial frequencies of each stream
+    std::vector<std::vector<std::uint8_t>> huffman_lengths;   // code lengths of each stream
+    std::vector<std::vector<std::uint16_t>> rans_freqs;       // static rANS table of each stream
+    unsigned rans_lanes = rans_default_lanes;
+};
+
+/// @brief  Builds the model of the given counts. A pre-trained model also has to code the bytes missing from its
+///         corpus, which only changes the rANS tables: the other coders already give every byte a code.
+GlobalModel build_model(const CompressionOptions &options, const std::vector<std::vector<std::uint64_t>> &counts, bool code_any_byte = false) {
+    const EntropyCoder coder = options.coder;
+    GlobalModel model;
+    model.rans_lanes = options.rans_lanes;
+    for(const std::vector<std::uint64_t> &stream_counts : counts) {
+        if(coder == EntropyCoder::AdaptiveRange) {
+            // the stored table is the one the adaptive model starts from, so it already fits its total
+            std::vector<std::uint32_t> freqs(256);
+            const std::uint64_t max_count = *std::max_element(stream_counts.begin(), stream_counts.end());
+            for(std::size_t s=0; s<256; ++s) {
+                freqs[s] = static_cast<std::uint32_t>(max_count > 0xFFFF ? stream_counts[s]*0xFFFF/max_count : stream_counts[s]);
+            }
+            AdaptiveFrequencyModel scaled;
+            scaled.reset(freqs);
+            for(std::size_t s=0; s<256; ++s) {
+                freqs[s] = scaled.freq(s);
+            }
+            model.range_freqs.push_back(freqs);
+        } else if(coder == EntropyCoder::Huffman) {
+            model.huffman_lengths.push_back(build_huffman_code_lengths(stream_counts));
+        } else if(coder == EntropyCoder::Rans) {
+            model.rans_freqs.push_back(build_rans_frequencies(stream_counts, code_any_byte));
+        }
+    }
+    return model;
+}
+
+void write_model(std::ostream &os, EntropyCoder coder, const GlobalModel &model) {
+    if(coder == EntropyCoder::AdaptiveRange) {
+        for(const std::vector<std::uint32_t> &freqs : model.range_freqs) {
+            for(std::uint32_t f : freqs) {
+                write_le<std::uint16_t>(os, static_cast<std::uint16_t>(f));
+            }
+        }
+    } else if(coder == EntropyCoder::Huffman) {
+        // only the code lengths are stored, two per byte
+        for(const std::vector<std::uint8_t> &lengths : model.huffman_lengths) {
+            for(std::size_t s=0; s<lengths.size(); s+=2) {
+                write_le<std::uint8_t>(os, static_cast<std::uint8_t>(lengths[s] | (lengths[s+1] << 4)));
+            }
+        }
+    } else if(coder == EntropyCoder::Rans) {
+        write_le<std::uint8_t>(os, static_cast<std::uint8_t>(model.rans_lanes));
+        for(const std::vector<std::uint16_t> &freqs : model.rans_freqs) {
+            for(std::uint16_t f : freqs) {
+                write_le<std::uint16_t>(os, f);
+            }
+        }
+    }
+}
+
+GlobalModel read_model(ByteReader &reader, EntropyCoder coder, std::size_t num_streams) {
+    GlobalModel model;
+    switch(coder) {
+        case EntropyCoder::AdaptiveRange:
+            model.range_freqs.assign(num_streams, std::vector<std::uint32_t>(256));
+            for(std::vector<std::uint32_t> &freqs : model.range_freqs) {
+                std::uint32_t total = 0;
+                for(std::uint32_t &f : freqs) {
+                    f = reader.read_le<std::uint16_t>();
+                    total += f;
+                }
+                if(total > RangeEncoder::max_total) {
+                    throw std::runtime_error("Invalid range coder model.");
+                }
+            }
+            break;
+        case EntropyCoder::Huffman:
+            model.huffman_lengths.assign(num_streams, std::vector<std::uint8_t>(256));
+            for(std::vector<std::uint8_t> &lengths : model.huffman_lengths) {
+                for(std::size_t s=0; s<256; s+=2) {
+                    const std::uint8_t packed = reader.read_le<std::uint8_t>();
+                    lengths[s] = packed & 0x0F;
+                    lengths[s+1] = packed >> 4;
+                }
+                for(std::uint8_t len : lengths) {
+                    if(len == 0 || len > huffman_max_code_length) {
+                        throw std::runtime_error("Invalid Huffman code lengths.");
+                    }
+                }
+            }
+            break;
+        case EntropyCoder::Rans:
+            model.rans_lanes = reader.read_le<std::uint8_t>();
+            if(!valid_rans_lanes(model.rans_lanes)) {
+                throw std::runtime_error("Invalid rANS model.");
+            }
+            model.rans_freqs.assign(num_streams, std::vector<std::uint16_t>(256));
+            for(std::vector<std::uint16_t> &freqs : model.rans_freqs) {
+                for(std::uint16_t &f : freqs) {
+                    f = reader.read_le<std::uint16_t>();
+                }
+            }
+            // a stream that is empty in the whole file has an all-zero table, and no segment codes it
+            break;
+        case EntropyCoder::Context:
+            // the context models start from a fixed state and adapt within each segment
+            break;
+        default:
+            throw std::runtime_error("Entropy coder not supported!");
+    }
+    return model;
+}
+
+/// @brief  Applies the transform to a group of consecutive blocks.
+void split_segment(const BlockXEFile::Block *blocks, std::size_t num_blocks, EventTransform transform, const FieldsDefinition &fdef, std::vector<std::vector<std::uint8_t>> &streams) {
+    streams.resize(transform_num_streams(transform, fdef));
+    for(std::vector<std::uint8_t> &stream : streams) {
+        stream.clear();
+    }
+    for(std::size_t k=0; k<num_blocks; ++k) {
+        split_block(transform, blocks[k].event_bytes, blocks[k].num_events, fdef, streams);
+    }
+}
+
+/// @brief  Adds the symbol histograms of each transformed stream of the blocks to counts, the segments counted in
+///         parallel.
+void count_symbols(const std::vector<BlockXEFile::Block> &blocks, std::size_t blocks_per_segment, EventTransform transform, const FieldsDefinition &fdef,
+                   ThreadPool &pool, std::vector<std::vector<std::uint64_t>> &counts) {
+    const std::size_t num_streams = counts.size();
+    const std::size_t num_segments = (blocks.size() + blocks_per_segment - 1)/blocks_per_segment;
+    std::vector<std::vector<std::vector<std::uint64_t>>> segment_counts(num_streams > 0 ? num_segments : 0);
+    pool.parallel_for(segment_counts.size(), [&](std::size_t seg) {
+        std::vector<std::vector<std::uint8_t>> streams;
+        split_segment(blocks.data() + seg*blocks_per_segment, std::min(blocks_per_segment, blocks.size() - seg*blocks_per_segment), transform, fdef, streams);
+        std::vector<std::vector<std::uint64_t>> seg_counts(num_streams, std::vector<std::uint64_t>(256, 0));
+        for(std::size_t k=0; k<num_streams; ++k) {
+            for(std::uint8_t symbol : streams[k]) {
+                ++seg_counts[k][symbol];
+            }
+        }
+        segment_counts[seg] = std::move(seg_counts);
+    });
+    for(const auto &seg_counts : segment_counts) {
+        for(std::size_t k=0; k<num_streams; ++k) {
+            for(std::size_t s=0; s<256; ++s) {
+                counts[k][s] += seg_counts[k][s];
+            }
+        }
+    }
+}
+
+/// @brief  Returns the blocks of a .bxe file, throwing std::runtime_error on a truncated or corrupted block.
+std::vector<BlockXEFile::Block> file_blocks(const BlockXEFile &input, const FieldsDefinition &fdef) {
+    std::vector<BlockXEFile::Block> blocks;
+    for(const BlockXEFile::Block &block : input) {
+        if(block.truncated()) {
+            throw std::runtime_error("Unexpected EOF while reading event.");
+        }
+        if(!verify_block(input, block, fdef)) {
+            throw std::runtime_error("Corrupted block " + std::to_string(blocks.size()) + " at offset " + std::to_string(block.offset) + " of the .bxe file (checksum mismatch).");
+        }
+        blocks.push_back(block);
+    }
+    return blocks;
+}
+
+/// @brief  Checks the coder, transform and lane count of the options.
+void check_options(const CompressionOptions &options) {
+    if(options.coder != EntropyCoder::AdaptiveRange && options.coder != EntropyCoder::Huffman && options.coder != EntropyCoder::Context
+       && options.coder != EntropyCoder::Rans) {
+        throw std::runtime_error("Entropy coder not supported!");
+    }
+    if(options.coder == EntropyCoder::Rans && !valid_rans_lanes(options.rans_lanes)) {
+        throw std::runtime_error("Invalid number of rANS lanes.");
+    }
+    if(options.transform != EventTransform::Raw && options.transform != EventTransform::Fields) {
+        throw std::runtime_error("Event transform not supported!");
+    }
+}
+
+/// @brief  Parses the tables of a pre-trained model.
+GlobalModel read_pretrained_model(const PretrainedModel &pretrained, const FieldsDefinition &fdef) {
+    const EntropyCoder coder = static_cast<EntropyCoder>(pretrained.coder);
+    if(coder == EntropyCoder::Context) {
+        throw std::runtime_error("Invalid pre-trained model.");
+    }
+    ByteReader reader(pretrained.tables.data(), pretrained.tables.size());
+    return read_model(reader, coder, transform_num_streams(static_cast<EventTransform>(pretrained.transform), fdef));
+}
+
+/// @brief  Codes the events of a group of consecutive blocks. Segments only depend on the global model, so any
+///         number of them can be coded or decoded at the same time. A segment holds the length of each transformed
+///         stream, then each stream coded with its own model.
+void encode_segment(const BlockXEFile::Block *blocks, std::size_t num_blocks, const CompressionOptions &options, const GlobalModel &model, const FieldsDefinition &fdef, std::vector<std::uint8_t> &output) {
+    if(options.coder == EntropyCoder::Context) {
+        // one range coded sequence per segment; the coder is kept per thread so its pixel surface is allocated once
+        XE_METRICS_TIME(EntropyEncode);
+        XE_METRICS_ADD(SegmentsEncoded, 1);
+        thread_local ContextEventCoder context_coder;
+        context_coder.reset(fdef);
+        RangeEncoder encoder(output);
+        for(std::size_t k=0; k<num_blocks; ++k) {
+            context_coder.encode(blocks[k].event_bytes, blocks[k].num_events, encoder);
+        }
+        encoder.finish();
+        return;
+    }
+    std::vector<std::vector<std::uint8_t>> streams;
+    {
+        XE_METRICS_TIME(Transform);
+        split_segment(blocks, num_blocks, options.transform, fdef, streams);
+    }
+    for(const std::vector<std::uint8_t> &stream : streams) {
+        put_varint(stream.size(), output);
+    }
+    XE_METRICS_TIME(EntropyEncode);
+    XE_METRICS_ADD(SegmentsEncoded, 1);
+    std::vector<std::uint8_t> coded;
+    for(std::size_t k=0; k<streams.size(); ++k) {
+        coded.clear();
+        if(!streams[k].empty()) {
+            if(options.coder == EntropyCoder::AdaptiveRange) {
+                AdaptiveFrequencyModel stream_model;
+                stream_model.reset(model.range_freqs[k]);
+                RangeEncoder encoder(coded);
+                for(std::uint8_t symbol : streams[k]) {
+                    encoder.encode(stream_model, symbol);
+                }
+                encoder.finish();
+            } else if(options.coder == EntropyCoder::Rans) {
+                RansEncoder(model.rans_freqs[k], model.rans_lanes).encode(streams[k].data(), streams[k].size(), coded);
+            } else {
+                HuffmanEncoder(model.huffman_lengths[k]).encode(streams[k].data(), streams[k].size(), coded);
+            }
+        }
+        put_varint(coded.size(), output);
+        output.insert(output.end(), coded.begin(), coded.end());
+    }
+}
+
+/// @brief  Decodes the events of a segment, the blocks one after the other.
+void decode_segment(const std::uint8_t *data, std::size_t size, const std::uint32_t *block_sizes, std::size_t num_blocks, EntropyCoder coder, EventTransform transform, const GlobalModel &model, const FieldsDefinition &fdef, std::vector<std::uint8_t> &output) {
+    if(coder == EntropyCoder::Context) {
+        XE_METRICS_TIME(EntropyDecode);
+        XE_METRICS_ADD(SegmentsDecoded, 1);
+        std::size_t total_events = 0;
+        for(std::size_t k=0; k<num_blocks; ++k) {
+            total_events += block_sizes[k];
+        }
+        output.resize(total_events*fdef.event_size_bytes);
+        thread_local ContextEventCoder context_coder;
+        context_coder.reset(fdef);
+        RangeDecoder decoder(data, size);
+        context_coder.decode(decoder, total_events, output.data());
+        return;
+    }
+    const std::size_t num_streams = transform_num_streams(transform, fdef);
+    StreamReader segment(data, size);
+    std::vector<std::size_t> stream_lengths(num_streams);
+    for(std::size_t &length : stream_lengths) {
+        length = static_cast<std::size_t>(segment.varint());
+        if(length > (std::size_t(1) << 40)) {
+            throw std::runtime_error("Invalid compressed .bxe segment.");
+        }
+    }
+    std::vector<std::vector<std::uint8_t>> streams(num_streams);
+    std::vector<StreamReader> readers(num_streams);
+    XE_METRICS_ADD(SegmentsDecoded, 1);
+    for(std::size_t k=0; k<num_streams; ++k) {
+        XE_METRICS_TIME(EntropyDecode);
+        const std::size_t coded_size = static_cast<std::size_t>(segment.varint());
+        const std::uint8_t *coded = segment.bytes(coded_size);
+        streams[k].resize(stream_lengths[k]);
+        if(coder == EntropyCoder::AdaptiveRange) {
+            AdaptiveFrequencyModel stream_model;
+            stream_model.reset(model.range_freqs[k]);
+            RangeDecoder decoder(coded, coded_size);
+            for(std::uint8_t &symbol : streams[k]) {
+                symbol = static_cast<std::uint8_t>(decoder.decode(stream_model));
+            }
+        } else if(stream_lengths[k] > 0 && coder == EntropyCoder::Rans) {
+            RansDecoder(model.rans_freqs[k], model.rans_lanes).decode(coded, coded_size, streams[k].data(), streams[k].size());
+        } else if(stream_lengths[k] > 0) {
+            HuffmanDecoder(model.huffman_lengths[k]).decode(coded, coded_size, streams[k].data(), streams[k].size());
+        }
+        readers[k] = StreamReader(streams[k].data(), streams[k].size());
+    }
+
+    std::size_t total_events = 0;
+    for(std::size_t k=0; k<num_blocks; ++k) {
+        total_events += block_sizes[k];
+    }
+    output.resize(total_events*fdef.event_size_bytes);
+    std::uint8_t *out = output.data();
+    XE_METRICS_TIME(Transform);
+    for(std::size_t k=0; k<num_blocks; ++k) {
+        merge_block(transform, readers, block_sizes[k], fdef, out);
+        out += static_cast<std::size_t>(block_sizes[k])*fdef.event_size_bytes;
+    }
+}
+
+/// @brief  Segment index of a compressed file.
+struct SegmentIndex {
+    std::vector<std::uint64_t> offsets;     // offset of each segment, then of the index
+    std::vector<std::uint32_t> checksums;   // CRC-32C of each segment
+    std::uint32_t header_checksum = 0;      // CRC-32C of the header
+
+    std::size_t num_segments() const { return offsets.size() - 1; }
+    std::size_t header_size() const { return static_cast<std::size_t>(offsets.front()); }
+};
+
+/// @brief  Reads the segment index, located through the end of the file. The number of segments follows from the
+///         size of the index, for the caller to check against the header. Throws std::runtime_error on an index
+///         that does not fit the file.
+SegmentIndex read_segment_index(const std::uint8_t *data, std::size_t size) {
+    if(size < index_trailer_size) {
+        throw std::runtime_error("Truncated compressed .bxe file.");
+    }
+    ByteReader reader(data, size);
+    reader.seek(size - 8);
+    const std::uint64_t index_offset = reader.read_le<std::uint64_t>();
+    if(index_offset > size - index_trailer_size || (size - index_trailer_size - index_offset) % index_entry_size != 0) {
+        throw std::runtime_error("Invalid compressed .bxe segment index.");
+    }
+    const std::size_t num_segments = static_cast<std::size_t>((size - index_trailer_size - index_offset)/index_entry_size);
+    SegmentIndex index;
+    index.offsets.resize(num_segments + 1);
+    reader.seek(static_cast<std::size_t>(index_offset));
+    for(std::size_t seg=0; seg<num_segments; ++seg) {
+        index.offsets[seg] = reader.read_le<std::uint64_t>();
+        index.checksums.push_back(reader.read_le<std::uint32_t>());
+        if(index.offsets[seg] > index_offset || (seg > 0 && index.offsets[seg] < index.offsets[seg-1])) {
+            throw std::runtime_error("Invalid compressed .bxe segment index.");
+        }
+    }
+    index.header_checksum = reader.read_le<std::uint32_t>();
+    index.offsets[num_segments] = index_offset;
+    return index;
+}
+
+/// @brief  Rebuilds the .bxe file in its original version: version 2 files go through the block writer, which
+///         recomputes their index and block time bases.
+class BxeRebuildSink : public DecodedEventSink {
+public:
+    BxeRebuildSink(std::ostream &os, const FieldsDefinition &fdef) : os_(os), fdef_(fdef) {}
+
+    void begin(timestamp_t abs_time_base, std::uint8_t bxe_file_version, std::uint8_t bxe_file_flags) override {
+        if(bxe_file_version == bxe_version) {
+            writer_.reset(new BlockXEWriter(os_, fdef_, abs_time_base, bxe_file_flags));
+        }
+    }
+
+    void segment(const std::uint8_t *event_bytes, const std::uint32_t *block_sizes, std::size_t num_blocks) override {
+        for(std::size_t b=0; b<num_blocks; ++b) {
+            if(writer_) {
+                writer_->write_block(event_bytes, block_sizes[b]);
+            } else {
+                const BlockHeader block_header{static_cast<decltype(BlockHeader::num_events)>(block_sizes[b])};
+                os_.write(reinterpret_cast<const char*>(&block_header), sizeof(block_header));
+                os_.write(reinterpret_cast<const char*>(event_bytes), static_cast<std::streamsize>(block_sizes[b]*fdef_.event_size_bytes));
+            }
+            event_bytes += static_cast<std::size_t>(block_sizes[b])*fdef_.event_size_bytes;
+        }
+    }
+
+    void finish() override {
+        if(writer_) {
+            writer_->finish();
+        }
+    }
+
+private:
+    std::ostream &os_;
+    FieldsDefinition fdef_;
+    std::unique_ptr<BlockXEWriter> writer_;
+};
+
+} // namespace
+
+bool parse_entropy_coder(const std::string &name, EntropyCoder &coder) {
+    if(name == "range") {
+        coder = EntropyCoder::AdaptiveRange;
+    } else if(name == "huffman") {
+        coder = EntropyCoder::Huffman;
+    } else if(name == "context") {
+        coder = EntropyCoder::Context;
+    } else if(name == "rans") {
+        coder = EntropyCoder::Rans;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool parse_event_transform(const std::string &name, EventTransform &transform) {
+    if(name == "raw") {
+        transform = EventTransform::Raw;
+    } else if(name == "fields") {
+        transform = EventTransform::Fields;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+PretrainedModel train_model(const std::vector<const BlockXEFile*> &corpus, const FieldsDefinition &fdef, const CompressionOptions &options) {
+    check_options(options);
+    if(options.coder == EntropyCoder::Context) {
+        throw std::runtime_error("The context coder has no model to train.");
+    }
+    ThreadPool pool(options.num_threads);
+    const std::size_t blocks_per_segment = std::max<std::size_t>(1, options.blocks_per_segment);
+    std::vector<std::vector<std::uint64_t>> counts(transform_num_streams(options.transform, fdef), std::vector<std::uint64_t>(256, 0));
+    std::uint64_t events = 0;
+    for(const BlockXEFile *input : corpus) {
+        const std::vector<BlockXEFile::Block> blocks = file_blocks(*input, fdef);
+        count_symbols(blocks, blocks_per_segment, options.transform, fdef, pool, counts);
+        for(const BlockXEFile::Block &block : blocks) {
+            events += block.num_events;
+        }
+    }
+    std::ostringstream tables;
+    write_model(tables, options.coder, build_model(options, counts, true));
+    const std::string table_bytes = tables.str();
+
+    PretrainedModel model;
+    model.coder = static_cast<std::uint8_t>(options.coder);
+    model.transform = static_cast<std::uint8_t>(options.transform);
+    model.trained_events = static_cast<std::uint32_t>(std::min<std::uint64_t>(events, 0xFFFFFFFFu));
+    model.tables.assign(table_bytes.begin(), table_bytes.end());
+    model.id = model_id(model.coder, model.transform, model.tables);
+    return model;
+}
+
+std::size_t compress_bxe(const BlockXEFile &input, const FieldsDefinition &fdef, const CompressionOptions &options, std::ostream &os) {
+    check_options(options);
+    const PretrainedModel *pretrained = options.model;
+    if(pretrained != nullptr && (pretrained->coder != static_cast<std::uint8_t>(options.coder) || pretrained->transform != static_cast<std::uint8_t>(options.transform))) {
+        throw std::runtime_error("The pre-trained model was built for another coder or transform.");
+    }
+    const std::vector<BlockXEFile::Block> blocks = file_blocks(input, fdef);
+    const std::size_t blocks_per_segment = std::max<std::size_t>(1, options.blocks_per_segment);
+    const std::size_t num_segments = (blocks.size() + blocks_per_segment - 1)/blocks_per_segment;
+    auto segment_blocks = [&](std::size_t seg) { return std::min(blocks_per_segment, blocks.size() - seg*blocks_per_segment); };
+
+    ThreadPool pool(options.num_threads);
+
+    // first pass: symbol histograms of each transformed stream (the context coder has no global model, and a
+    // pre-trained model replaces the pass, so that the file is read only once)
+    GlobalModel model;
+    if(pretrained != nullptr) {
+        model = read_pretrained_model(*pretrained, fdef);
+    } else {
+        const std::size_t num_streams = options.coder == EntropyCoder::Context ? 0 : transform_num_streams(options.transform, fdef);
+        std::vector<std::vector<std::uint64_t>> counts(num_streams, std::vector<std::uint64_t>(256, 0));
+        count_symbols(blocks, blocks_per_segment, options.transform, fdef, pool, counts);
+        model = build_model(options, counts);
+    }
+
+    std::uint64_t written = 0;
+    auto write_bytes = [&](const void *p, std::size_t n) {
+        os.write(static_cast<const char*>(p), static_cast<std::streamsize>(n));
+        written += n;
+    };
+    std::ostringstream header;
+    header.write(compressed_magic, sizeof(compressed_magic));
+    write_le<std::uint8_t>(header, compressed_version);
+    write_le<std::uint8_t>(header, static_cast<std::uint8_t>(options.coder));
+    write_le<std::uint8_t>(header, static_cast<std::uint8_t>(options.transform));
+    write_le<std::uint8_t>(header, input.version());
+    write_le<std::uint8_t>(header, input.flags());
+    // time base the writer starts from, so that the rebuilt block headers and index match the original ones
+    timestamp_t initial_time_base = 0;
+    if(!blocks.empty() && blocks.front().has_time_base) {
+        initial_time_base = blocks.front().abs_time_base;
+    } else if(input.indexed() && input.num_indexed_blocks() > 0) {
+        initial_time_base = input.index_entry(0).abs_time_base;
+    }
+    write_le<std::uint64_t>(header, initial_time_base);
+    write_le<std::uint32_t>(header, static_cast<std::uint32_t>(blocks.size()));
+    write_le<std::uint32_t>(header, static_cast<std::uint32_t>(blocks_per_segment));
+    if(pretrained != nullptr) {
+        write_le<std::uint8_t>(header, model_pretrained);
+        write_le<std::uint64_t>(header, pretrained->id);
+    } else {
+        write_le<std::uint8_t>(header, model_in_header);
+        write_model(header, options.coder, model);
+    }
+    for(const BlockXEFile::Block &block : blocks) {
+        write_varint(header, block.num_events);
+    }
+    const std::string header_bytes = header.str();
+    write_bytes(header_bytes.data(), header_bytes.size());
+
+    // second pass: segments are coded in waves of a few per thread and written in order, so only one wave of
+    // compressed data is held in memory
+    std::vector<std::uint64_t> segment_offsets;
+    std::vector<std::uint32_t> segment_checksums(num_segments);
+    const std::size_t wave_size = 4*pool.size();
+    std::vector<std::vector<std::uint8_t>> wave(wave_size);
+    for(std::size_t first_seg=0; first_seg<num_segments; first_seg+=wave_size) {
+        const std::size_t n = std::min(wave_size, num_segments - first_seg);
+        pool.parallel_for(n, [&](std::size_t i) {
+            const std::size_t seg = first_seg + i;
+            wave[i].clear();
+            encode_segment(blocks.data() + seg*blocks_per_segment, segment_blocks(seg), options, model, fdef, wave[i]);
+            segment_checksums[seg] = crc32c(wave[i].data(), wave[i].size());
+        });
+        for(std::size_t i=0; i<n; ++i) {
+            segment_offsets.push_back(written);
+            write_bytes(wave[i].data(), wave[i].size());
+        }
+    }
+
+    // segment index with the checksums, located through the last 8 bytes of the file
+    const std::uint64_t index_offset = written;
+    std::ostringstream index;
+    for(std::size_t seg=0; seg<num_segments; ++seg) {
+        write_le<std::uint64_t>(index, segment_offsets[seg]);
+        write_le<std::uint32_t>(index, segment_checksums[seg]);
+    }
+    write_le<std::uint32_t>(index, crc32c(header_bytes.data(), header_bytes.size()));
+    write_le<std::uint64_t>(index, index_offset);
+    const std::string index_bytes = index.str();
+    write_bytes(index_bytes.data(), index_bytes.size());
+
+    return static_cast<std::size_t>(written);
+}
+
+bool is_compressed_bxe(const std::uint8_t *data, std::size_t size) {
+    return size >= sizeof(compressed_magic) && std::memcmp(data, compressed_magic, sizeof(compressed_magic)) == 0;
+}
+
+std::size_t decompress_bxe(const std::uint8_t *data, std::size_t size, const FieldsDefinition &fdef, DecodedEventSink &sink, unsigned num_threads, const ModelStore *models) {
+    ByteReader reader(data, size);
+    if(!is_compressed_bxe(data, size)) {
+        throw std::runtime_error("Input is not a compressed .bxe file.");
+    }
+    reader.take(sizeof(compressed_magic));
+    const std::uint8_t file_version = reader.read_le<std::uint8_t>();
+    if(file_version != compressed_version) {
+        throw std::runtime_error("Compressed .bxe version not supported!");
+    }
+    // the header is checked before it is parsed
+    const SegmentIndex index = read_segment_index(data, size);
+    if(index.header_size() > size || crc32c(data, index.header_size()) != index.header_checksum) {
+        throw std::runtime_error("Corrupted compressed .bxe header (checksum mismatch).");
+    }
+    const EntropyCoder coder = static_cast<EntropyCoder>(reader.read_le<std::uint8_t>());
+    const EventTransform transform = static_cast<EventTransform>(reader.read_le<std::uint8_t>());
+    const std::uint8_t bxe_file_version = reader.read_le<std::uint8_t>();
+    const std::uint8_t bxe_file_flags = reader.read_le<std::uint8_t>();
+    const timestamp_t initial_time_base = reader.read_le<std::uint64_t>();
+    if((bxe_file_version != 1 && bxe_file_version != bxe_version) || (bxe_file_version == 1 && bxe_file_flags != 0)) {
+        throw std::runtime_error("Unsupported .bxe file version.");
+    }
+    const std::uint32_t num_blocks = reader.read_le<std::uint32_t>();
+    const std::uint32_t blocks_per_segment = reader.read_le<std::uint32_t>();
+    if(blocks_per_segment == 0) {
+        throw std::runtime_error("Invalid compressed .bxe header.");
+    }
+    const std::uint8_t model_source = reader.read_le<std::uint8_t>();
+    GlobalModel model;
+    if(model_source == model_pretrained) {
+        const std::uint64_t id = reader.read_le<std::uint64_t>();
+        if(models == nullptr) {
+            throw std::runtime_error("The compressed file uses pre-trained model " + model_id_string(id) + ": a model store is needed.");
+        }
+        const std::shared_ptr<const PretrainedModel> pretrained = models->load(id);
+        if(pretrained->coder != static_cast<std::uint8_t>(coder) || pretrained->transform != static_cast<std::uint8_t>(transform)) {
+            throw std::runtime_error("Pre-trained model " + model_id_string(id) + " does not match the compressed file.");
+        }
+        model = read_pretrained_model(*pretrained, fdef);
+    } else if(model_source == model_in_header) {
+        model = read_model(reader, coder, coder == EntropyCoder::Context ? 0 : transform_num_streams(transform, fdef));
+    } else {
+        throw std::runtime_error("Invalid compressed .bxe header.");
+    }
+    // blocks are rebuilt with the header width of the original file
+    const std::size_t max_events = bxe_file_version == 1 ? max_block_events(0) : max_block_events(bxe_file_flags);
+    std::vector<std::uint32_t> block_sizes(num_blocks);
+    for(std::uint32_t &n : block_sizes) {
+        const std::uint64_t block_events = reader.varint();
+        if(block_events > max_events) {
+            throw std::runtime_error("Invalid compressed .bxe header.");
+        }
+        n = static_cast<std::uint32_t>(block_events);
+    }
+
+    const std::size_t num_segments = (static_cast<std::size_t>(num_blocks) + blocks_per_segment - 1)/blocks_per_segment;
+    if(index.num_segments() != num_segments) {
+        throw std::runtime_error("Invalid compressed .bxe segment index.");
+    }
+    const std::vector<std::uint64_t> &segment_offsets = index.offsets;
+
+    sink.begin(initial_time_base, bxe_file_version, bxe_file_flags);
+    ThreadPool pool(num_threads);
+    const std::size_t wave_size = 4*pool.size();
+    std::vector<std::vector<std::uint8_t>> wave(wave_size);
+    for(std::size_t first_seg=0; first_seg<num_segments; first_seg+=wave_size) {
+        const std::size_t n = std::min(wave_size, num_segments - first_seg);
+        pool.parallel_for(n, [&](std::size_t i) {
+            const std::size_t seg = first_seg + i;
+            const std::size_t first_block = seg*blocks_per_segment;
+            const std::size_t seg_blocks = std::min<std::size_t>(blocks_per_segment, num_blocks - first_block);
+            const std::size_t seg_size = static_cast<std::size_t>(segment_offsets[seg+1] - segment_offsets[seg]);
+            if(crc32c(data + segment_offsets[seg], seg_size) != index.checksums[seg]) {
+                throw std::runtime_error("Corrupted segment " + std::to_string(seg) + " of the compressed .bxe file (blocks " + std::to_string(first_block) + " to " +
+                                         std::to_string(first_block + seg_blocks - 1) + ", checksum mismatch).");
+            }
+            decode_segment(data + segment_offsets[seg], seg_size, block_sizes.data() + first_block, seg_blocks, coder, transform, model, fdef, wave[i]);
+        });
+        for(std::size_t i=0; i<n; ++i) {
+            const std::size_t first_block = (first_seg + i)*blocks_per_segment;
+            const std::size_t last_block = std::min<std::size_t>(first_block + blocks_per_segment, num_blocks);
+            sink.segment(wave[i].data(), block_sizes.data() + first_block, last_block - first_block);
+        }
+    }
+    sink.finish();
+
+    std::size_t num_events = 0;
+    for(std::uint32_t n : block_sizes) {
+        num_events += n;
+    }
+    return num_events;
+}
+
+IntegrityReport verify_compressed_bxe(const std::uint8_t *data, std::size_t size, unsigned num_threads) {
+    // number of blocks and blocks per segment, at fixed offsets of the header
+    constexpr std::size_t num_blocks_offset = 17;
+    if(!is_compressed_bxe(data, size) || size <= sizeof(compressed_magic)) {
+        throw std::runtime_error("Input is not a compressed .bxe file.");
+    }
+    const std::uint8_t file_version = data[sizeof(compressed_magic)];
+    if(file_version != compressed_version) {
+        throw std::runtime_error("Compressed .bxe version not supported!");
+    }
+    const SegmentIndex index = read_segment_index(data, size);
+    if(index.header_size() < num_blocks_offset + 8) {
+        throw std::runtime_error("Invalid compressed .bxe header.");
+    }
+    const std::uint32_t num_blocks = load_le<std::uint32_t>(data + num_blocks_offset);
+    const std::uint32_t blocks_per_segment = std::max<std::uint32_t>(1, load_le<std::uint32_t>(data + num_blocks_offset + 4));
+
+    IntegrityReport report;
+    report.checksummed = true;
+    report.num_blocks = num_blocks;
+    report.bytes_checked = size;
+    if(crc32c(data, index.header_size()) != index.header_checksum) {
+        report.corrupted.push_back(CorruptedBlocks{0, 0, num_blocks, "header checksum mismatch"});
+    } else if(index.num_segments() != (static_cast<std::size_t>(num_blocks) + blocks_per_segment - 1)/blocks_per_segment) {
+        report.corrupted.push_back(CorruptedBlocks{0, 0, num_blocks, "header does not match the segment index"});
+    }
+    // the segments are checked in parallel, without decoding them
+    std::vector<std::uint8_t> intact(index.num_segments());
+    ThreadPool pool(num_threads);
+    pool.parallel_for(index.num_segments(), [&](std::size_t seg) {
+        const std::size_t seg_size = static_cast<std::size_t>(index.offsets[seg+1] - index.offsets[seg]);
+        intact[seg] = crc32c(data + index.offsets[seg], seg_size) == index.checksums[seg];
+    });
+    for(std::size_t seg=0; seg<index.num_segments(); ++seg) {
+        if(!intact[seg]) {
+            const std::size_t first_block = seg*blocks_per_segment;
+            const std::size_t seg_blocks = first_block < num_blocks ? std::min<std::size_t>(blocks_per_segment, num_blocks - first_block) : 0;
+            report.corrupted.push_back(CorruptedBlocks{index.offsets[seg], first_block, seg_blocks, "checksum mismatch"});
+        }
+    }
+    return report;
+}
+
+std::size_t decompress_bxe(const std::uint8_t *data, std::size_t size, const FieldsDefinition &fdef, std::ostream &os, unsigned num_threads, const ModelStore *models) {
+    BxeRebuildSink sink(os, fdef);
+    return decompress_bxe(data, size, fdef, sink, num_threads, models);
+}
+
+} // namespace XEFormat
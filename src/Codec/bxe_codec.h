@@ -0,0 +1,150 @@
+/**********************************************************************************************************************
+ * MIT License                                                                                                        *
+ *                                                                                                                    *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and                  *
+ * associated documentation files (the “Software”), to deal in the Software without restriction,                      *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,              *
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,              *
+ * subject to the following conditions:                                                                               *
+ *                                                                                                                    *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial               *
+ * portions of the Software.                                                                                          *
+ *                                                                                                                    *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,                                *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND               *
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES               *
+ * OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN                *
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ **********************************************************************************************************************/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <ostream>
+#include <cstddef>
+#include <cstdint>
+#include "xe_format.h"
+#include "mapped_file.h"
+#include "field_transform.h"
+#include "rans.h"
+#include "model_store.h"
+#include "integrity.h"
+
+namespace XEFormat {
+
+/// @brief  Entropy coders available to compress the event payload of a .bxe file.
+enum class EntropyCoder : std::uint8_t {
+    AdaptiveRange = 0x00, // Adaptive order-0 range coder.
+    Huffman       = 0x01, // Static canonical Huffman code built from the histogram of the whole file.
+    Context       = 0x02, // Range coder with models conditioned on the previous events and the activity of each pixel.
+    Rans          = 0x03, // Static interleaved rANS with tables built from the histogram of the whole file.
+};
+
+struct CompressionOptions {
+    EntropyCoder coder = EntropyCoder::AdaptiveRange;
+    EventTransform transform = EventTransform::Fields;
+    std::size_t blocks_per_segment = 64;  // blocks coded together as one independent segment
+    unsigned num_threads = 0;             // threads coding segments in parallel; 0 uses every hardware thread
+    unsigned rans_lanes = rans_default_lanes;  // interleaved rANS states, stored in the header (4, 8, 16 or 32)
+    const PretrainedModel *model = nullptr;    // pre-trained model for coder and transform, referenced by its ID
+};
+
+/// @brief  Parses an entropy coder name as given on the command line ("range", "huffman", "context" or "rans").
+/// @param name coder name.
+/// @param coder output parameter to store the parsed coder.
+/// @return true if the name is a known coder, false otherwise.
+bool parse_entropy_coder(const std::string &name, EntropyCoder &coder);
+
+/// @brief  Parses an event transform name as given on the command line ("raw" or "fields").
+/// @param name transform name.
+/// @param transform output parameter to store the parsed transform.
+/// @return true if the name is a known transform, false otherwise.
+bool parse_event_transform(const std::string &name, EventTransform &transform);
+
+/// @brief  Compresses a .bxe file. The output keeps the block sizes and the .bxe format version so that decompression rebuilds the same .bxe file.
+///         Groups of blocks (segments) are coded independently on a thread pool, all of them starting from one global
+///         model stored once in the header, and an index of the segment offsets is written at the end of the file,
+///         with the CRC-32C of each segment and of the header. Throws std::runtime_error on a corrupted input block.
+///         Before coding, the events are split into streams by options.transform, each stream with its own model.
+///         The context coder codes the events directly instead (see ContextEventCoder): it has no global model, and
+///         its models restart at each segment.
+/// @param input .bxe file to compress.
+/// @param fdef fields definition.
+/// @param options compression options.
+/// @param os output stream to write the compressed file to.
+/// @return the size in bytes of the compressed file.
+std::size_t compress_bxe(const BlockXEFile &input, const FieldsDefinition &fdef, const CompressionOptions &options, std::ostream &os);
+
+/// @brief  Trains a model on a corpus of .bxe files, from the symbol histograms of all of them, for the coder,
+///         transform and rANS lanes of the options. Unlike the model built for a single file, it can code any byte.
+///         Throws std::runtime_error for the context coder, which has no global model.
+/// @param corpus .bxe files to train on.
+/// @param fdef fields definition.
+/// @param options coder, transform and threads counting the histograms.
+/// @return the model, with its ID computed.
+PretrainedModel train_model(const std::vector<const BlockXEFile*> &corpus, const FieldsDefinition &fdef, const CompressionOptions &options);
+
+/// @brief  Receives the events of a compressed .bxe file as they are decoded, one segment at a time and in file order,
+///         so that they can be consumed without rebuilding the .bxe file (see decompress_bxe).
+class DecodedEventSink {
+public:
+    virtual ~DecodedEventSink() = default;
+
+    /// @brief  Called once the header is read, before the first segment.
+    /// @param abs_time_base absolute time base in effect before the first event.
+    /// @param bxe_file_version version of the compressed .bxe file.
+    /// @param bxe_file_flags file header flags of the compressed .bxe file.
+    virtual void begin(timestamp_t abs_time_base, std::uint8_t bxe_file_version, std::uint8_t bxe_file_flags) = 0;
+
+    /// @brief  Called for each decoded segment. The buffer is reused once the call returns.
+    /// @param event_bytes packed big-endian events of the blocks of the segment, one block after the other.
+    /// @param block_sizes number of events of each block.
+    /// @param num_blocks number of blocks.
+    virtual void segment(const std::uint8_t *event_bytes, const std::uint32_t *block_sizes, std::size_t num_blocks) = 0;
+
+    /// @brief  Called after the last segment.
+    virtual void finish() {}
+};
+
+/// @brief  Returns true if a buffer starts like a file produced by compress_bxe.
+bool is_compressed_bxe(const std::uint8_t *data, std::size_t size);
+
+/// @brief  Decodes a file produced by compress_bxe, handing the events of each segment to a sink. Segments are decoded
+///         in parallel, a wave of them at a time, and handed over in file order on the calling thread. Each segment
+///         is checked against its checksum before it is decoded.
+///         Throws std::runtime_error if the input is not a valid compressed .bxe file, if a checksum does not match,
+///         or if it references a pre-trained model missing from the store.
+/// @param data compressed file content.
+/// @param size compressed file size in bytes.
+/// @param fdef fields definition.
+/// @param sink receiver of the decoded events.
+/// @param num_threads threads decoding segments in parallel; 0 uses every hardware thread.
+/// @param models store of the pre-trained models, needed by files compressed with one.
+/// @return the number of events decompressed.
+std::size_t decompress_bxe(const std::uint8_t *data, std::size_t size, const FieldsDefinition &fdef, DecodedEventSink &sink, unsigned num_threads = 0,
+                           const ModelStore *models = nullptr);
+
+/// @brief  Checks the checksums of the header and of every segment of a file produced by compress_bxe, on a thread
+///         pool and without decoding the segments. Throws std::runtime_error if the input is not a compressed .bxe
+///         file of a supported version or its segment index is unreadable.
+/// @param data compressed file content.
+/// @param size compressed file size in bytes.
+/// @param num_threads threads checking segments in parallel; 0 uses every hardware thread.
+/// @return the corrupted segments, with the blocks they hold.
+IntegrityReport verify_compressed_bxe(const std::uint8_t *data, std::size_t size, unsigned num_threads = 0);
+
+/// @brief  Decompresses a file produced by compress_bxe back into a .bxe file.
+///         Throws std::runtime_error if the input is not a valid compressed .bxe file, if a checksum does not match,
+///         or if it references a pre-trained model missing from the store.
+/// @param data compressed file content.
+/// @param size compressed file size in bytes.
+/// @param fdef fields definition.
+/// @param os output stream to write the .bxe file to.
+/// @param num_threads threads decoding segments in parallel; 0 uses every hardware thread.
+/// @param models store of the pre-trained models, needed by files compressed with one.
+/// @return the number of events decompressed.
+std::size_t decompress_bxe(const std::uint8_t *data, std::size_t size, const FieldsDefinition &fdef, std::ostream &os, unsigned num_threads = 0,
+                           const ModelStore *models = nullptr);
+
+} // namespace XEFormat
@@ -0,0 +1,300 @@
+/**********************************************************************************************************************
+ * MIT License                                                                                                        *
+ *                                                                                                                    *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and                  *
+ * associated documentation files (the “Software”), to deal in the Software without restriction,                      *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,              *
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,              *
+ * subject to the following conditions:                                                                               *
+ *                                                                                                                    *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial               *
+ * portions of the Software.                                                                                          *
+ *                                                                                                                    *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,                                *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND               *
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES               *
+ * OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN                *
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ **********************************************************************************************************************/
+
+#include <stdexcept>
+#include <limits>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <cstdio>
+#include <utility>
+#include "bxe_format.h"
+#include "crc32c.h"
+#include "xe_layout.h"
+#include "instrumentation.h"
+
+namespace XEFormat {
+
+namespace {
+
+/// @brief  Replays the events of a block: returns the timestamps of its first and last events and updates the
+///         absolute time base.
+template <typename Layout>
+void scan_block(const Layout &layout, const std::uint8_t *event_bytes, std::size_t n_events, timestamp_t &abs_time_base, BlockIndexEntry &entry) {
+    const std::size_t ev_bytes = layout.event_size_bytes();
+    timestamp_t timestamp = abs_time_base;
+    for(std::size_t i=0; i<n_events; ++i) {
+        const encoded_event_t encoded_event = layout.load_record(event_bytes + i*ev_bytes);
+        if(layout.type_bits(encoded_event) == EventType::ABSTimeStamp) {
+            abs_time_base = layout.decode_event_timestamp(encoded_event);
+            timestamp = abs_time_base;
+        } else {
+            timestamp = abs_time_base + layout.decode_event_timestamp(encoded_event);
+        }
+        if(i == 0) {
+            entry.first_timestamp = timestamp;
+        }
+    }
+    if(n_events == 0) {
+        entry.first_timestamp = timestamp;
+    }
+    entry.last_timestamp = timestamp;
+}
+
+} // namespace
+
+BlockSplitter::BlockSplitter(const BlockPolicy &policy, const FieldsDefinition &fdef, timestamp_t abs_time_base)
+    : policy_(policy), fdef_(fdef), abs_time_base_(abs_time_base), byte_counts_(256, 0) {
+    next_block();
+}
+
+void BlockSplitter::next_block() {
+    block_events_ = 0;
+    complete_ = false;
+    std::fill(byte_counts_.begin(), byte_counts_.end(), 0);
+    // the estimate cannot exceed the raw size, so there is nothing to check before the raw size reaches the budget
+    next_estimate_ = std::max<std::size_t>(1, policy_.max_compressed_bytes/fdef_.event_size_bytes);
+}
+
+double BlockSplitter::estimated_compressed_bytes() const {
+    const double total = static_cast<double>(block_events_*fdef_.event_size_bytes);
+    double bits = total*std::log2(total);
+    for(std::uint64_t count : byte_counts_) {
+        if(count > 0) {
+            bits -= static_cast<double>(count)*std::log2(static_cast<double>(count));
+        }
+    }
+    return bits/8;
+}
+
+template <typename Layout>
+std::size_t BlockSplitter::fill_block(const Layout &layout, const std::uint8_t *event_bytes, std::size_t n_events) {
+    const std::size_t ev_bytes = layout.event_size_bytes();
+    std::size_t i = 0;
+    for(; i<n_events && !complete_; ++i) {
+        const std::uint8_t *record = event_bytes + i*ev_bytes;
+        if(policy_.max_time_span > 0) {
+            const encoded_event_t encoded_event = layout.load_record(record);
+            timestamp_t timestamp;
+            if(layout.type_bits(encoded_event) == EventType::ABSTimeStamp) {
+                timestamp = layout.decode_event_timestamp(encoded_event);
+            } else {
+                timestamp = abs_time_base_ + layout.decode_event_timestamp(encoded_event);
+            }
+            if(block_events_ == 0) {
+                first_timestamp_ = timestamp;
+            } else if(timestamp > first_timestamp_ && timestamp - first_timestamp_ > policy_.max_time_span) {
+                // the event opens the next block
+                complete_ = true;
+                break;
+            }
+            if(layout.type_bits(encoded_event) == EventType::ABSTimeStamp) {
+                abs_time_base_ = timestamp;
+            }
+        }
+        ++block_events_;
+        if(policy_.max_compressed_bytes > 0) {
+            for(std::size_t b=0; b<ev_bytes; ++b) {
+                ++byte_counts_[record[b]];
+            }
+            if(block_events_ >= next_estimate_) {
+                // estimates are spaced by half the events still expected to fit, so a block converges on its budget
+                // with a few estimates
+                const double estimate = estimated_compressed_bytes();
+                const double budget = static_cast<double>(policy_.max_compressed_bytes);
+                if(estimate >= budget) {
+                    complete_ = true;
+                } else {
+                    const double remaining = estimate > 0 ? (budget - estimate)*static_cast<double>(block_events_)/estimate : static_cast<double>(block_events_);
+                    next_estimate_ = block_events_ + std::max<std::size_t>(1, static_cast<std::size_t>(remaining/2));
+                }
+            }
+        }
+        if(policy_.max_events > 0 && block_events_ >= policy_.max_events) {
+            complete_ = true;
+        }
+    }
+    return i;
+}
+
+std::size_t BlockSplitter::fill(const std::uint8_t *event_bytes, std::size_t n_events) {
+    XE_METRICS_TIME(Block);
+    std::size_t taken = 0;
+    with_layout(fdef_, [&](const auto &layout) { taken = fill_block(layout, event_bytes, n_events); });
+    return taken;
+}
+
+BlockXEWriter::BlockXEWriter(std::ostream &os, const FieldsDefinition &fdef, timestamp_t abs_time_base, std::uint8_t flags)
+    : os_(os), fdef_(fdef), abs_time_base_(abs_time_base), flags_(flags) {
+    if(flags_ & ~bxe_supported_flags) {
+        throw std::runtime_error("Unsupported .bxe file flags.");
+    }
+    std::uint8_t header[bxe_file_header_size] = {};
+    std::copy(bxe_magic, bxe_magic + 4, header);
+    header[4] = bxe_version;
+    header[5] = flags_;
+    os_.write(reinterpret_cast<const char*>(header), sizeof(header));
+    start_offset_ = sizeof(header);
+    offset_ = sizeof(header);
+}
+
+BlockXEWriter::BlockXEWriter(std::ostream &os, const FieldsDefinition &fdef, timestamp_t abs_time_base, std::uint8_t flags, std::uint64_t offset)
+    : os_(os), fdef_(fdef), abs_time_base_(abs_time_base), flags_(flags), start_offset_(offset), offset_(offset), part_(true) {
+    if(flags_ & ~bxe_supported_flags) {
+        throw std::runtime_error("Unsupported .bxe file flags.");
+    }
+}
+
+BlockXEPart BlockXEWriter::take_part() {
+    if(!part_ || finished_) {
+        throw std::runtime_error("Not a .bxe part writer.");
+    }
+    finished_ = true;
+    BlockXEPart part;
+    part.flags = flags_;
+    part.start_offset = start_offset_;
+    part.end_offset = offset_;
+    part.abs_time_base = abs_time_base_;
+    part.index = std::move(index_);
+    index_.clear();
+    return part;
+}
+
+void BlockXEWriter::append_part(const BlockXEPart &part) {
+    if(finished_ || part.flags != flags_ || part.start_offset != offset_) {
+        throw std::runtime_error("Part does not continue the .bxe file.");
+    }
+    for(const BlockIndexEntry &entry : part.index) {
+        add_index_entry(entry);
+    }
+    offset_ = part.end_offset;
+    abs_time_base_ = part.abs_time_base;
+    os_.seekp(static_cast<std::streamoff>(offset_));
+}
+
+void BlockXEWriter::write_block(const std::uint8_t *event_bytes, std::size_t n_events) {
+    XE_METRICS_TIME(Write);
+    if(finished_) {
+        throw std::runtime_error("Block written after the .bxe index.");
+    }
+    if(n_events > max_block_events(flags_)) {
+        throw std::runtime_error("Too many events for a .bxe block.");
+    }
+    BlockIndexEntry entry;
+    entry.offset = offset_;
+    entry.abs_time_base = abs_time_base_;
+    entry.num_events = static_cast<std::uint32_t>(n_events);
+
+    // the header is assembled first, so that the checksum can cover it
+    std::uint8_t header[sizeof(WideBlockHeader) + sizeof(encoded_event_t) + block_checksum_size];
+    std::size_t header_size = 0;
+    if(flags_ & bxe_flag_wide_count) {
+        const WideBlockHeader count{static_cast<decltype(WideBlockHeader::num_events)>(n_events)};
+        std::memcpy(header, &count, sizeof(count));
+        header_size = sizeof(count);
+    } else {
+        const BlockHeader count{static_cast<decltype(BlockHeader::num_events)>(n_events)};
+        std::memcpy(header, &count, sizeof(count));
+        header_size = sizeof(count);
+    }
+    if(flags_ & bxe_flag_time_base) {
+        // time base the block starts from, as the absolute time base event a decoder would have seen last
+        const encoded_event_t time_base_event = Encoder::encode_event_absts(abs_time_base_, fdef_);
+        Encoder::pack_encoded_events(&time_base_event, 1, fdef_, header + header_size);
+        header_size += fdef_.event_size_bytes;
+    }
+    const std::size_t payload_size = n_events*fdef_.event_size_bytes;
+    if(flags_ & bxe_flag_checksum) {
+        const std::uint32_t checksum = crc32c(event_bytes, payload_size, crc32c(header, header_size));
+        store_le<std::uint32_t>(checksum, header + header_size);
+        header_size += block_checksum_size;
+    }
+    os_.write(reinterpret_cast<const char*>(header), static_cast<std::streamsize>(header_size));
+    os_.write(reinterpret_cast<const char*>(event_bytes), static_cast<std::streamsize>(payload_size));
+    offset_ += block_header_size(flags_, fdef_) + payload_size;
+    XE_METRICS_ADD(BlocksWritten, 1);
+    XE_METRICS_ADD(BlockBytesWritten, block_header_size(flags_, fdef_) + n_events*fdef_.event_size_bytes);
+
+    with_layout(fdef_, [&](const auto &layout) { scan_block(layout, event_bytes, n_events, abs_time_base_, entry); });
+    add_index_entry(entry);
+}
+
+void BlockXEWriter::add_index_entry(const BlockIndexEntry &entry) {
+    if(!part_ && index_.size() == index_buffer_entries) {
+        spill_index();
+    }
+    index_.push_back(entry);
+}
+
+void BlockXEWriter::spill_index() {
+    if(!spill_) {
+        spill_.reset(std::tmpfile());
+        if(!spill_) {
+            throw std::runtime_error("Cannot create the temporary file of the .bxe index.");
+        }
+    }
+    std::vector<std::uint8_t> bytes(index_.size()*bxe_index_entry_size);
+    for(std::size_t i=0; i<index_.size(); ++i) {
+        store_index_entry(index_[i], bytes.data() + i*bxe_index_entry_size);
+    }
+    if(std::fwrite(bytes.data(), 1, bytes.size(), spill_.get()) != bytes.size()) {
+        throw std::runtime_error("Cannot write the temporary file of the .bxe index.");
+    }
+    spilled_blocks_ += index_.size();
+    index_.clear();
+}
+
+void BlockXEWriter::finish() {
+    if(finished_) {
+        return;
+    }
+    if(part_) {
+        throw std::runtime_error("A part of a .bxe file has no index.");
+    }
+    finished_ = true;
+    const std::size_t num_entries = num_blocks();
+    if(num_entries > std::numeric_limits<std::uint32_t>::max()) {
+        throw std::runtime_error("Too many blocks for a .bxe index.");
+    }
+    // the spilled entries are copied back in chunks of the size of the in-memory buffer
+    if(spill_) {
+        std::vector<char> chunk(index_buffer_entries*bxe_index_entry_size);
+        std::rewind(spill_.get());
+        std::size_t n;
+        while((n = std::fread(chunk.data(), 1, chunk.size(), spill_.get())) > 0) {
+            os_.write(chunk.data(), static_cast<std::streamsize>(n));
+        }
+        if(std::ferror(spill_.get())) {
+            throw std::runtime_error("Cannot read the temporary file of the .bxe index.");
+        }
+        spill_.reset();
+    }
+    std::vector<std::uint8_t> footer(index_.size()*bxe_index_entry_size + bxe_footer_size);
+    for(std::size_t i=0; i<index_.size(); ++i) {
+        store_index_entry(index_[i], footer.data() + i*bxe_index_entry_size);
+    }
+    std::uint8_t *trailer = footer.data() + index_.size()*bxe_index_entry_size;
+    store_le<std::uint64_t>(offset_, trailer);
+    store_le<std::uint32_t>(static_cast<std::uint32_t>(num_entries), trailer + 8);
+    std::copy(bxe_index_magic, bxe_index_magic + 4, trailer + 12);
+    os_.write(reinterpret_cast<const char*>(footer.data()), static_cast<std::streamsize>(footer.size()));
+    offset_ += num_entries*bxe_index_entry_size + bxe_footer_size;
+}
+
+} // namespace XEFormat
@@ -0,0 +1,258 @@
+/**********************************************************************************************************************
+ * MIT License                                                                                                        *
+ *                                                                                                                    *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and                  *
+ * associated documentation files (the “Software”), to deal in the Software without restriction,                      *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,              *
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,              *
+ * subject to the following conditions:                                                                               *
+ *                                                                                                                    *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial               *
+ * portions of the Software.                                                                                          *
+ *                                                                                                                    *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,                                *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND               *
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES               *
+ * OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN                *
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ **********************************************************************************************************************/
+
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <cstdio>
+#include <ostream>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include "xe_format.h"
+
+namespace XEFormat {
+
+// A .bxe file is a sequence of blocks, each one a BlockHeader followed by the packed events of the block.
+// Version 1 files hold nothing else. Version 2 files start with a file header and end with a footer index
+// (one BlockIndexEntry per block, then a 16-byte trailer), which allows seeking to the blocks of a time window.
+// When the file header has the bxe_flag_time_base flag, every BlockHeader is extended with the absolute time base
+// in effect at the start of the block, stored as a packed absolute time base event: any block then decodes alone.
+// With the bxe_flag_wide_count flag the block headers are WideBlockHeader, for blocks of more than 65535 events.
+// With the bxe_flag_checksum flag every block header ends with the little-endian CRC-32C of the bytes of the block
+// before it (number of events and time base) followed by the packed events of the block.
+// All the integers of the file header, index and footer are little-endian.
+
+/// @brief  Header written before each block of a .bxe file, holding the number of events stored in the block.
+struct BlockHeader {
+    std::uint16_t num_events;
+};
+
+/// @brief  Block header of the files with the bxe_flag_wide_count flag.
+struct WideBlockHeader {
+    std::uint32_t num_events;
+};
+
+/// @brief  First bytes of a version 2 .bxe file.
+constexpr char bxe_magic[4] = {'B', 'X', 'E', 'F'};
+constexpr std::uint8_t bxe_version = 2;
+constexpr std::size_t bxe_file_header_size = 8;    // magic, u8 version, u8 flags, u16 reserved
+
+/// @brief  Flags of the file header.
+constexpr std::uint8_t bxe_flag_time_base = 0x01;  // block headers hold the absolute time base of the block
+constexpr std::uint8_t bxe_flag_wide_count = 0x02; // block headers hold a 32-bit number of events
+constexpr std::uint8_t bxe_flag_checksum = 0x04;   // block headers end with the CRC-32C of the block
+constexpr std::uint8_t bxe_supported_flags = bxe_flag_time_base | bxe_flag_wide_count | bxe_flag_checksum;
+
+/// @brief  Size of the checksum ending the block headers of a file with the bxe_flag_checksum flag.
+constexpr std::size_t block_checksum_size = 4;
+
+/// @brief  Size of the number of events field of the block headers of a file with the given flags.
+inline std::size_t block_count_size(std::uint8_t flags) {
+    return (flags & bxe_flag_wide_count) ? sizeof(WideBlockHeader) : sizeof(BlockHeader);
+}
+
+/// @brief  Size of the block headers of a file with the given flags.
+inline std::size_t block_header_size(std::uint8_t flags, const FieldsDefinition &fdef) {
+    return block_count_size(flags) + ((flags & bxe_flag_time_base) ? fdef.event_size_bytes : 0) + ((flags & bxe_flag_checksum) ? block_checksum_size : 0);
+}
+
+/// @brief  Largest number of events a block of a file with the given flags can hold.
+inline std::size_t max_block_events(std::uint8_t flags) {
+    return (flags & bxe_flag_wide_count) ? std::numeric_limits<decltype(WideBlockHeader::num_events)>::max()
+                                         : std::numeric_limits<decltype(BlockHeader::num_events)>::max();
+}
+
+/// @brief  Last bytes of a version 2 .bxe file, pointing to the index.
+constexpr char bxe_index_magic[4] = {'B', 'X', 'E', 'I'};
+constexpr std::size_t bxe_footer_size = 16;        // u64 index offset, u32 number of blocks, magic
+constexpr std::size_t bxe_index_entry_size = 36;
+
+/// @brief  Index entry of a block. The timestamps are absolute: time base events count with their time base.
+struct BlockIndexEntry {
+    std::uint64_t offset;           // offset of the block header in the file
+    timestamp_t first_timestamp;    // timestamp of the first event of the block
+    timestamp_t last_timestamp;     // timestamp of the last event of the block
+    timestamp_t abs_time_base;      // absolute time base in effect at the start of the block
+    std::uint32_t num_events;
+};
+
+template <typename T>
+inline void store_le(T value, std::uint8_t *p) {
+    for(std::size_t i=0; i<sizeof(T); ++i) {
+        p[i] = static_cast<std::uint8_t>(static_cast<std::uint64_t>(value) >> (8*i));
+    }
+}
+
+template <typename T>
+inline T load_le(const std::uint8_t *p) {
+    std::uint64_t value = 0;
+    for(std::size_t i=0; i<sizeof(T); ++i) {
+        value |= static_cast<std::uint64_t>(p[i]) << (8*i);
+    }
+    return static_cast<T>(value);
+}
+
+inline void store_index_entry(const BlockIndexEntry &entry, std::uint8_t *p) {
+    store_le<std::uint64_t>(entry.offset, p);
+    store_le<std::uint64_t>(entry.first_timestamp, p + 8);
+    store_le<std::uint64_t>(entry.last_timestamp, p + 16);
+    store_le<std::uint64_t>(entry.abs_time_base, p + 24);
+    store_le<std::uint32_t>(entry.num_events, p + 32);
+}
+
+inline BlockIndexEntry load_index_entry(const std::uint8_t *p) {
+    BlockIndexEntry entry;
+    entry.offset = load_le<std::uint64_t>(p);
+    entry.first_timestamp = load_le<std::uint64_t>(p + 8);
+    entry.last_timestamp = load_le<std::uint64_t>(p + 16);
+    entry.abs_time_base = load_le<std::uint64_t>(p + 24);
+    entry.num_events = load_le<std::uint32_t>(p + 32);
+    return entry;
+}
+
+/// @brief  Rules closing a block: a block ends as soon as one of its limits is reached, 0 disabling a limit. The
+///         compressed size of a block is estimated from the order-0 entropy of its bytes, the coders using a model
+///         shared by all the blocks of a file.
+struct BlockPolicy {
+    std::size_t max_events = 1024;          // number of events
+    std::size_t max_compressed_bytes = 0;   // estimated compressed size in bytes
+    timestamp_t max_time_span = 0;          // time between the first and last events of the block, in microseconds
+};
+
+/// @brief  Splits a stream of packed events into blocks following a BlockPolicy. The events may be fed in chunks of
+///         any size, a block spanning several chunks:
+///             while(n > 0) { k = splitter.fill(p, n); append k events; if(splitter.complete()) { write block; splitter.next_block(); } }
+///         and a last incomplete block (block_events() > 0) is written at the end of the stream.
+class BlockSplitter {
+public:
+    /// @param policy rules closing the blocks.
+    /// @param fdef fields definition.
+    /// @param abs_time_base absolute time base in effect before the first event.
+    BlockSplitter(const BlockPolicy &policy, const FieldsDefinition &fdef, timestamp_t abs_time_base = 0);
+
+    /// @brief  Adds events to the current block until it is complete. A block always takes at least one event.
+    /// @param event_bytes packed big-endian events.
+    /// @param n_events number of events available.
+    /// @return number of events added to the block.
+    std::size_t fill(const std::uint8_t *event_bytes, std::size_t n_events);
+
+    /// @brief  Returns true once the current block has reached one of the limits of the policy.
+    bool complete() const { return complete_; }
+
+    /// @brief  Number of events of the current block.
+    std::size_t block_events() const { return block_events_; }
+
+    /// @brief  Starts a new, empty block.
+    void next_block();
+
+private:
+    template <typename Layout>
+    std::size_t fill_block(const Layout &layout, const std::uint8_t *event_bytes, std::size_t n_events);
+    double estimated_compressed_bytes() const;
+
+    BlockPolicy policy_;
+    FieldsDefinition fdef_;
+    timestamp_t abs_time_base_;
+    timestamp_t first_timestamp_ = 0;
+    std::size_t block_events_ = 0;
+    bool complete_ = false;
+    std::vector<std::uint64_t> byte_counts_;
+    std::size_t next_estimate_ = 0;  // number of events at which the compressed size is estimated next
+};
+
+/// @brief  Blocks written by a part writer (see BlockXEWriter::take_part), kept once the stream of the part is closed.
+struct BlockXEPart {
+    std::uint8_t flags = 0;
+    std::uint64_t start_offset = 0;         // file offset of the first block of the part
+    std::uint64_t end_offset = 0;           // file offset just past the last block of the part
+    timestamp_t abs_time_base = 0;          // absolute time base in effect after the last block
+    std::vector<BlockIndexEntry> index;     // index entries of the blocks of the part
+};
+
+/// @brief  Writes a version 2 .bxe file block by block: the file header is written on construction, each block
+///         is scanned once to fill its index entry, and finish() appends the index. Every tool producing .bxe
+///         files goes through this writer. The writer of a whole file keeps at most index_buffer_entries index
+///         entries in memory and spills the others to an anonymous temporary file, read back by finish(), so
+///         that its memory stays constant however long the stream (the temporary file grows by
+///         bxe_index_entry_size bytes per block). A part writer keeps the index entries of its part in memory.
+class BlockXEWriter {
+public:
+    /// @brief  Writes the file header. Throws std::runtime_error on an unknown flag.
+    /// @param os output stream (a file or a pipe; the writer counts the bytes itself).
+    /// @param fdef fields definition.
+    /// @param abs_time_base absolute time base in effect before the first block.
+    /// @param flags file header flags; by default every block records its time base and checksum.
+    BlockXEWriter(std::ostream &os, const FieldsDefinition &fdef, timestamp_t abs_time_base = 0, std::uint8_t flags = bxe_flag_time_base | bxe_flag_checksum);
+
+    /// @brief  Writer for a part of a file written in parallel: writes blocks only, no file header, the first one at
+    ///         byte offset of the file. The stream must already be positioned there. Once its blocks are written, the
+    ///         part is taken with take_part (the stream may then be closed) and added to the writer of the whole file
+    ///         with append_part; finish() cannot be called on a part.
+    /// @param os output stream positioned at offset.
+    /// @param fdef fields definition.
+    /// @param abs_time_base absolute time base in effect before the first block of the part.
+    /// @param flags file header flags of the whole file.
+    /// @param offset file offset of the first block of the part.
+    BlockXEWriter(std::ostream &os, const FieldsDefinition &fdef, timestamp_t abs_time_base, std::uint8_t flags, std::uint64_t offset);
+
+    /// @brief  Writes a block. Throws std::runtime_error if n_events does not fit a block header.
+    /// @param event_bytes packed big-endian events of the block.
+    /// @param n_events number of events.
+    void write_block(const std::uint8_t *event_bytes, std::size_t n_events);
+
+    /// @brief  Takes the blocks written by a part writer, which can write nothing afterwards. Throws
+    ///         std::runtime_error if this writer is not a part writer.
+    BlockXEPart take_part();
+
+    /// @brief  Adds the blocks of a part, which must start where this writer stopped and have the same flags, as if
+    ///         this writer had written them. The stream is moved past them, so it must be seekable. Throws
+    ///         std::runtime_error if the part does not fit.
+    void append_part(const BlockXEPart &part);
+
+    /// @brief  Writes the index and the footer. Nothing can be written afterwards.
+    void finish();
+
+    std::size_t num_blocks() const { return spilled_blocks_ + index_.size(); }
+    std::uint64_t bytes_written() const { return offset_; }
+    timestamp_t abs_time_base() const { return abs_time_base_; }
+    std::uint8_t flags() const { return flags_; }
+
+    /// @brief  Number of index entries the writer of a whole file keeps in memory before spilling them.
+    static constexpr std::size_t index_buffer_entries = 4096;
+
+private:
+    void add_index_entry(const BlockIndexEntry &entry);
+    void spill_index();
+
+    std::ostream &os_;
+    FieldsDefinition fdef_;
+    timestamp_t abs_time_base_;
+    std::uint8_t flags_;
+    std::uint64_t start_offset_ = 0;
+    std::uint64_t offset_ = 0;
+    std::vector<BlockIndexEntry> index_;    // entries not spilled yet (all of them for a part writer)
+    std::unique_ptr<std::FILE, int(*)(std::FILE*)> spill_{nullptr, &std::fclose};
+    std::size_t spilled_blocks_ = 0;
+    bool part_ = false;
+    bool finished_ = false;
+};
+
+} // namespace XEFormat
@@ -0,0 +1,342 @@
+/**********************************************************************************************************************
+ * MIT License                                                                                                        *
+ *                                                                                                                    *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and                  *
+ * associated documentation files (the “Software”), to deal in the Software without restriction,                      *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,              *
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,              *
+ * subject to the following conditions:                                                                               *
+ *                                                                                                                    *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial               *
+ * portions of the Software.                                                                                          *
+ *                                                                                                                    *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,                                *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND               *
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES               *
+ * OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN                *
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ **********************************************************************************************************************/
+
+#include <algorithm>
+#include "context_coder.h"
+#include "xe_layout.h"
+
+namespace XEFormat {
+
+namespace {
+
+constexpr std::size_t cd_type = 0;
+constexpr std::size_t trigger_type = 1;
+constexpr std::size_t abs_time_type = 2;
+constexpr std::size_t escape_type = 3;
+constexpr std::size_t num_types = 4;
+
+constexpr unsigned mantissa_bits = 3;       // bits below the leading one coded with a model
+constexpr unsigned max_surface_bits = 22;   // larger sensors share surface entries through a hash
+constexpr unsigned surface_time_bits = 30;
+constexpr std::size_t num_age_classes = 8;
+
+constexpr std::uint64_t mask_bits(unsigned bits) {
+    return bits >= 64 ? ~std::uint64_t(0) : (std::uint64_t(1) << bits) - 1;
+}
+
+unsigned bit_length(std::uint64_t value) {
+    unsigned n = 0;
+    for(unsigned shift=32; shift>0; shift >>= 1) {
+        if(value >> shift) {
+            n += shift;
+            value >>= shift;
+        }
+    }
+    return n + static_cast<unsigned>(value);
+}
+
+std::uint64_t zigzag(std::int64_t value) {
+    return (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63);
+}
+
+std::int64_t unzigzag(std::uint64_t value) {
+    return static_cast<std::int64_t>(value >> 1) ^ -static_cast<std::int64_t>(value & 1);
+}
+
+/// @brief  Zigzag coded difference of two values of a bits-wide field, wrapped to the field width.
+std::uint64_t wrapped_delta(std::uint64_t value, std::uint64_t previous, unsigned bits) {
+    const std::uint64_t delta = (value - previous) & mask_bits(bits);
+    return zigzag(delta >= (std::uint64_t(1) << (bits - 1)) ? static_cast<std::int64_t>(delta) - static_cast<std::int64_t>(std::uint64_t(1) << bits) : static_cast<std::int64_t>(delta));
+}
+
+std::uint64_t apply_delta(std::uint64_t previous, std::uint64_t coded, unsigned bits) {
+    return (previous + static_cast<std::uint64_t>(unzigzag(coded))) & mask_bits(bits);
+}
+
+} // namespace
+
+ValueModel::ValueModel(unsigned max_bits) : length_(max_bits + 1) {
+    mantissa_.reserve(max_bits + 1);
+    for(unsigned n=0; n<=max_bits; ++n) {
+        mantissa_.emplace_back(std::size_t(1) << std::min(n > 0 ? n - 1 : 0, mantissa_bits));
+    }
+}
+
+void ValueModel::encode(RangeEncoder &encoder, std::uint64_t value) {
+    const unsigned n = bit_length(value);
+    encoder.encode(length_, n);
+    if(n < 2) {
+        return;
+    }
+    const unsigned low_bits = n - 1;
+    const unsigned raw_bits = low_bits - std::min(low_bits, mantissa_bits);
+    encoder.encode(mantissa_[n], static_cast<std::size_t>((value >> raw_bits) & mask_bits(low_bits - raw_bits)));
+    for(unsigned shift=0; shift<raw_bits; shift+=16) {
+        const unsigned k = std::min(16u, raw_bits - shift);
+        encoder.encode(static_cast<std::uint32_t>((value >> shift) & mask_bits(k)), 1, 1u << k);
+    }
+}
+
+std::uint64_t ValueModel::decode(RangeDecoder &decoder) {
+    const unsigned n = static_cast<unsigned>(decoder.decode(length_));
+    if(n < 2) {
+        return n;
+    }
+    const unsigned low_bits = n - 1;
+    const unsigned raw_bits = low_bits - std::min(low_bits, mantissa_bits);
+    std::uint64_t value = ((std::uint64_t(1) << (low_bits - raw_bits)) | decoder.decode(mantissa_[n])) << raw_bits;
+    for(unsigned shift=0; shift<raw_bits; shift+=16) {
+        const unsigned k = std::min(16u, raw_bits - shift);
+        const std::uint32_t bits = decoder.target(1u << k);
+        decoder.consume(bits, 1);
+        value |= static_cast<std::uint64_t>(bits) << shift;
+    }
+    return value;
+}
+
+
+void ContextEventCoder::reset(const FieldsDefinition &fdef) {
+    fdef_ = fdef;
+    const unsigned time_bits = std::max(fdef.cd_ev.relativetimestamp, fdef.tr_ev.relativetimestamp);
+    type_models_.assign(num_types, AdaptiveFrequencyModel(num_types));
+    time_models_.assign(2*(time_bits + 1), ValueModel(time_bits));
+    recent_models_.assign(num_recent, AdaptiveFrequencyModel(num_recent));
+    y_models_.assign(2*(fdef.cd_ev.y + 1), ValueModel(fdef.cd_ev.y));
+    x_models_.assign(4*(fdef.cd_ev.x + 1), ValueModel(fdef.cd_ev.x));
+    polarity_models_.assign(3*num_age_classes*2, ValueModel(fdef.cd_ev.polarity));
+    trigger_polarity_models_.assign(2, ValueModel(fdef.tr_ev.polarity));
+    trigger_id_models_.assign(1, ValueModel(fdef.tr_ev.triggerid));
+    abs_time_models_.assign(1, ValueModel(64));
+    raw_models_.assign(fdef.event_size_bytes, AdaptiveFrequencyModel(256));
+
+    prev_type_ = cd_type;
+    std::fill(recent_x_, recent_x_ + num_recent, 0);
+    std::fill(recent_y_, recent_y_ + num_recent, 0);
+    prev_recent_ = 0;
+    prev_rel_ = prev_abs_ = 0;
+    prev_dt_ = prev_dx_ = prev_dy_ = 0;
+    prev_polarity_ = prev_trigger_polarity_ = 0;
+
+    x_bits_ = fdef.cd_ev.x;
+    const std::size_t bits = std::min<std::size_t>(fdef.cd_ev.x + fdef.cd_ev.y, max_surface_bits);
+    if(bits != surface_bits_ || surface_.empty()) {
+        surface_bits_ = bits;
+        surface_.assign(std::size_t(1) << surface_bits_, 0);
+    } else {
+        for(std::uint32_t pixel : touched_) {
+            surface_[pixel] = 0;
+        }
+    }
+    touched_.clear();
+}
+
+std::size_t ContextEventCoder::nearest_recent(std::uint64_t x, std::uint64_t y) const {
+    std::size_t nearest = 0;
+    std::uint64_t nearest_distance = ~std::uint64_t(0);
+    for(std::size_t k=0; k<num_recent; ++k) {
+        const std::uint64_t distance = (x > recent_x_[k] ? x - recent_x_[k] : recent_x_[k] - x) + (y > recent_y_[k] ? y - recent_y_[k] : recent_y_[k] - y);
+        if(distance < nearest_distance) {
+            nearest = k;
+            nearest_distance = distance;
+        }
+    }
+    return nearest;
+}
+
+void ContextEventCoder::promote_recent(std::size_t index, std::uint64_t x, std::uint64_t y) {
+    // move to front: the reference is replaced by the new position, the positions before it shift back by one
+    for(std::size_t k=index; k>0; --k) {
+        recent_x_[k] = recent_x_[k-1];
+        recent_y_[k] = recent_y_[k-1];
+    }
+    recent_x_[0] = x;
+    recent_y_[0] = y;
+    prev_recent_ = index;
+}
+
+std::size_t ContextEventCoder::pixel_index(std::uint64_t x, std::uint64_t y) const {
+    const std::uint64_t pixel = (y << x_bits_) | x;
+    if(fdef_.cd_ev.x + fdef_.cd_ev.y <= max_surface_bits) {
+        return static_cast<std::size_t>(pixel);
+    }
+    return static_cast<std::size_t>((pixel*0x9E3779B97F4A7C15ull) >> (64 - surface_bits_));
+}
+
+std::size_t ContextEventCoder::polarity_context(std::size_t pixel, std::uint64_t timestamp) const {
+    const std::uint32_t state = surface_[pixel];
+    std::size_t context = 0;
+    if(state & 1) {
+        // pixels that fired recently tend to repeat their polarity, old ones are closer to the global balance
+        const std::uint64_t age = (timestamp - (state >> 2)) & mask_bits(std::min(fdef_.cd_ev.relativetimestamp, surface_time_bits));
+        context = (1 + ((state >> 1) & 1))*num_age_classes + std::min<std::size_t>(bit_length(age)/3, num_age_classes - 1);
+    }
+    return context*2 + (prev_polarity_ & 1);
+}
+
+void ContextEventCoder::update_pixel(std::size_t pixel, std::uint64_t timestamp, std::uint64_t polarity) {
+    if(surface_[pixel] == 0) {
+        touched_.push_back(static_cast<std::uint32_t>(pixel));
+    }
+    surface_[pixel] = static_cast<std::uint32_t>(((timestamp & mask_bits(surface_time_bits)) << 2) | ((polarity & 1) << 1) | 1);
+}
+
+template <typename Layout>
+void ContextEventCoder::encode_events(const Layout &layout, const std::uint8_t *event_bytes, std::size_t n_events, RangeEncoder &encoder) {
+    const std::size_t ev_bytes = layout.event_size_bytes();
+    for(std::size_t i=0; i<n_events; ++i) {
+        const std::uint8_t *raw = event_bytes + i*ev_bytes;
+        const encoded_event_t encoded_event = layout.load_record(raw);
+        const std::uint64_t type_bits = layout.type_bits(encoded_event);
+        std::size_t type = escape_type;
+        if(type_bits == EventType::CD) {
+            const CDEvent ev = layout.decode_event_cd(encoded_event, 0);
+            if(layout.encode_event_cd(ev, 0) == encoded_event) {
+                type = cd_type;
+            }
+        } else if(type_bits == EventType::Trigger) {
+            // the padding bits are dropped by the decoder: events with non-zero padding are escaped
+            if(layout.encode_event_trigger(layout.decode_event_trigger(encoded_event, 0), 0) == encoded_event) {
+                type = trigger_type;
+            }
+        } else if(type_bits == EventType::ABSTimeStamp) {
+            if(layout.encode_event_absts(layout.decode_event_timestamp(encoded_event)) == encoded_event) {
+                type = abs_time_type;
+            }
+        }
+        encoder.encode(type_models_[prev_type_], type);
+        prev_type_ = type;
+
+        switch(type) {
+            case cd_type: {
+                const CDEvent ev = layout.decode_event_cd(encoded_event, 0);
+                const std::uint64_t dt = (ev.timestamp - prev_rel_) & mask_bits(fdef_.cd_ev.relativetimestamp);
+                time_models_[bit_length(prev_dt_)].encode(encoder, dt);
+                const std::size_t ref = nearest_recent(ev.x, ev.y);
+                encoder.encode(recent_models_[prev_recent_], ref);
+                const std::uint64_t dy = wrapped_delta(ev.y, recent_y_[ref], fdef_.cd_ev.y);
+                y_models_[(ref == 0)*(fdef_.cd_ev.y + 1) + bit_length(prev_dy_)].encode(encoder, dy);
+                const std::size_t x_context = dy == 0 ? bit_length(prev_dx_) : fdef_.cd_ev.x + 1 + std::min<std::size_t>(bit_length(dy), fdef_.cd_ev.x);
+                const std::uint64_t dx = wrapped_delta(ev.x, recent_x_[ref], fdef_.cd_ev.x);
+                x_models_[(ref == 0)*2*(fdef_.cd_ev.x + 1) + x_context].encode(encoder, dx);
+                promote_recent(ref, ev.x, ev.y);
+                const std::size_t pixel = pixel_index(ev.x, ev.y);
+                polarity_models_[polarity_context(pixel, ev.timestamp)].encode(encoder, ev.polarity);
+                update_pixel(pixel, ev.timestamp, ev.polarity);
+                prev_rel_ = ev.timestamp;
+                prev_dt_ = dt;
+                prev_dx_ = dx;
+                prev_dy_ = dy;
+                prev_polarity_ = ev.polarity;
+                break;
+            }
+            case trigger_type: {
+                const TriggerEvent ev = layout.decode_event_trigger(encoded_event, 0);
+                const std::uint64_t dt = (ev.timestamp - prev_rel_) & mask_bits(fdef_.tr_ev.relativetimestamp);
+                time_models_[time_models_.size()/2 + bit_length(prev_dt_)].encode(encoder, dt);
+                trigger_polarity_models_[prev_trigger_polarity_ & 1].encode(encoder, ev.polarity);
+                trigger_id_models_[0].encode(encoder, ev.triggerid);
+                prev_rel_ = ev.timestamp;
+                prev_dt_ = dt;
+                prev_trigger_polarity_ = ev.polarity;
+                break;
+            }
+            case abs_time_type: {
+                const timestamp_t abs_ts = layout.decode_event_timestamp(encoded_event);
+                abs_time_models_[0].encode(encoder, zigzag(static_cast<std::int64_t>(abs_ts - prev_abs_)));
+                prev_abs_ = abs_ts;
+                break;
+            }
+            default:
+                for(std::size_t b=0; b<ev_bytes; ++b) {
+                    encoder.encode(raw_models_[b], raw[b]);
+                }
+                break;
+        }
+    }
+}
+
+template <typename Layout>
+void ContextEventCoder::decode_events(const Layout &layout, RangeDecoder &decoder, std::size_t n_events, std::uint8_t *event_bytes) {
+    const std::size_t ev_bytes = layout.event_size_bytes();
+    for(std::size_t i=0; i<n_events; ++i) {
+        std::uint8_t *raw = event_bytes + i*ev_bytes;
+        const std::size_t type = decoder.decode(type_models_[prev_type_]);
+        prev_type_ = type;
+        encoded_event_t encoded_event;
+        switch(type) {
+            case cd_type: {
+                CDEvent ev;
+                const std::uint64_t dt = time_models_[bit_length(prev_dt_)].decode(decoder);
+                ev.timestamp = (prev_rel_ + dt) & mask_bits(fdef_.cd_ev.relativetimestamp);
+                const std::size_t ref = decoder.decode(recent_models_[prev_recent_]);
+                const std::uint64_t dy = y_models_[(ref == 0)*(fdef_.cd_ev.y + 1) + bit_length(prev_dy_)].decode(decoder);
+                ev.y = static_cast<unsigned int>(apply_delta(recent_y_[ref], dy, fdef_.cd_ev.y));
+                const std::size_t x_context = dy == 0 ? bit_length(prev_dx_) : fdef_.cd_ev.x + 1 + std::min<std::size_t>(bit_length(dy), fdef_.cd_ev.x);
+                const std::uint64_t dx = x_models_[(ref == 0)*2*(fdef_.cd_ev.x + 1) + x_context].decode(decoder);
+                ev.x = static_cast<unsigned int>(apply_delta(recent_x_[ref], dx, fdef_.cd_ev.x));
+                promote_recent(ref, ev.x, ev.y);
+                const std::size_t pixel = pixel_index(ev.x, ev.y);
+                ev.polarity = static_cast<unsigned int>(polarity_models_[polarity_context(pixel, ev.timestamp)].decode(decoder));
+                update_pixel(pixel, ev.timestamp, ev.polarity);
+                encoded_event = layout.encode_event_cd(ev, 0);
+                prev_rel_ = ev.timestamp;
+                prev_dt_ = dt;
+                prev_dx_ = dx;
+                prev_dy_ = dy;
+                prev_polarity_ = ev.polarity;
+                break;
+            }
+            case trigger_type: {
+                TriggerEvent ev;
+                const std::uint64_t dt = time_models_[time_models_.size()/2 + bit_length(prev_dt_)].decode(decoder);
+                ev.timestamp = (prev_rel_ + dt) & mask_bits(fdef_.tr_ev.relativetimestamp);
+                ev.polarity = static_cast<unsigned int>(trigger_polarity_models_[prev_trigger_polarity_ & 1].decode(decoder));
+                ev.triggerid = static_cast<unsigned int>(trigger_id_models_[0].decode(decoder));
+                ev.padding = 0;
+                encoded_event = layout.encode_event_trigger(ev, 0);
+                prev_rel_ = ev.timestamp;
+                prev_dt_ = dt;
+                prev_trigger_polarity_ = ev.polarity;
+                break;
+            }
+            case abs_time_type: {
+                const timestamp_t abs_ts = (prev_abs_ + static_cast<std::uint64_t>(unzigzag(abs_time_models_[0].decode(decoder)))) & mask_bits(fdef_.absts.abstimestamp);
+                encoded_event = layout.encode_event_absts(abs_ts);
+                prev_abs_ = abs_ts;
+                break;
+            }
+            default:
+                for(std::size_t b=0; b<ev_bytes; ++b) {
+                    raw[b] = static_cast<std::uint8_t>(decoder.decode(raw_models_[b]));
+                }
+                continue;
+        }
+        layout.store_record(encoded_event, raw);
+    }
+}
+
+void ContextEventCoder::encode(const std::uint8_t *event_bytes, std::size_t n_events, RangeEncoder &encoder) {
+    with_layout(fdef_, [&](const auto &layout) { encode_events(layout, event_bytes, n_events, encoder); });
+}
+
+void ContextEventCoder::decode(RangeDecoder &decoder, std::size_t n_events, std::uint8_t *event_bytes) {
+    with_layout(fdef_, [&](const auto &layout) { decode_events(layout, decoder, n_events, event_bytes); });
+}
+
+} // namespace XEFormat
@@ -0,0 +1,113 @@
+/**********************************************************************************************************************
+ * MIT License                                                                                                        *
+ *                                                                                                                    *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and                  *
+ * associated documentation files (the “Software”), to deal in the Software without restriction,                      *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,              *
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,              *
+ * subject to the following conditions:                                                                               *
+ *                                                                                                                    *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial               *
+ * portions of the Software.                                                                                          *
+ *                                                                                                                    *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,                                *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND               *
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES               *
+ * OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN                *
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ **********************************************************************************************************************/
+
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include "xe_format.h"
+#include "range_coder.h"
+
+namespace XEFormat {
+
+/// @brief  Adaptive model of an unsigned integer: the bit length of the value is coded first, then the three bits
+///         below its leading one with a model per bit length, and the remaining low bits as they are.
+class ValueModel {
+public:
+    /// @param max_bits largest bit length of the coded values (at most 64).
+    explicit ValueModel(unsigned max_bits = 64);
+
+    void encode(RangeEncoder &encoder, std::uint64_t value);
+    std::uint64_t decode(RangeDecoder &decoder);
+
+private:
+    AdaptiveFrequencyModel length_;
+    std::vector<AdaptiveFrequencyModel> mantissa_;   // one model per bit length
+};
+
+/// @brief  Context-modelled coder of packed events. Instead of one order-0 model per field stream, every field is
+///         coded with a model selected from what the decoder already knows: the previous event, the fields of the
+///         current event coded before it, and a surface holding the last timestamp and polarity of each pixel.
+///         The position of a CD event is coded relative to one of the last distinct positions (the closest one, its
+///         index coded first), so that events alternating between several moving edges keep small deltas. The fields
+///         are coded in the order time, reference, y, x, polarity, so that the polarity model is conditioned on the
+///         past activity of the pixel of the event.
+///         The state carries over from one call to the next; reset() starts a new independent sequence.
+class ContextEventCoder {
+public:
+    ContextEventCoder() = default;
+
+    /// @brief  Starts a new sequence: every model returns to its initial state and the surface is cleared. The
+    ///         surface is allocated once (2^(x+y bits) pixels, hashed above 2^22) and only its touched pixels are
+    ///         cleared, so a coder reused for many small sequences costs nothing per reset.
+    void reset(const FieldsDefinition &fdef);
+
+    /// @brief  Codes packed events.
+    /// @param event_bytes packed big-endian events.
+    /// @param n_events number of events.
+    /// @param encoder range encoder receiving the coded events.
+    void encode(const std::uint8_t *event_bytes, std::size_t n_events, RangeEncoder &encoder);
+
+    /// @brief  Decodes events coded by encode(), with the state the encoder had.
+    /// @param decoder range decoder positioned at the events.
+    /// @param n_events number of events.
+    /// @param event_bytes output buffer with room for n_events*fdef.event_size_bytes bytes.
+    void decode(RangeDecoder &decoder, std::size_t n_events, std::uint8_t *event_bytes);
+
+private:
+    template <typename Layout>
+    void encode_events(const Layout &layout, const std::uint8_t *event_bytes, std::size_t n_events, RangeEncoder &encoder);
+    template <typename Layout>
+    void decode_events(const Layout &layout, RangeDecoder &decoder, std::size_t n_events, std::uint8_t *event_bytes);
+
+    std::size_t nearest_recent(std::uint64_t x, std::uint64_t y) const;
+    void promote_recent(std::size_t index, std::uint64_t x, std::uint64_t y);
+    std::size_t pixel_index(std::uint64_t x, std::uint64_t y) const;
+    std::size_t polarity_context(std::size_t pixel, std::uint64_t timestamp) const;
+    void update_pixel(std::size_t pixel, std::uint64_t timestamp, std::uint64_t polarity);
+
+    FieldsDefinition fdef_{};
+    std::vector<AdaptiveFrequencyModel> type_models_;   // context: type of the previous event
+    std::vector<ValueModel> time_models_;               // context: bit length of the previous time delta, per type
+    std::vector<AdaptiveFrequencyModel> recent_models_; // context: previous reference index
+    std::vector<ValueModel> y_models_;                  // context: bit length of the previous y delta, reference index 0
+    std::vector<ValueModel> x_models_;                  // context: reference index 0, y delta or previous x delta
+    std::vector<ValueModel> polarity_models_;           // context: pixel state and age, previous polarity
+    std::vector<ValueModel> trigger_polarity_models_;   // context: previous trigger polarity
+    std::vector<ValueModel> trigger_id_models_;
+    std::vector<ValueModel> abs_time_models_;
+    std::vector<AdaptiveFrequencyModel> raw_models_;    // escaped events, one model per byte position
+
+    // last event state
+    std::size_t prev_type_ = 0;
+    static constexpr std::size_t num_recent = 8;
+    std::uint64_t recent_x_[num_recent] = {}, recent_y_[num_recent] = {};  // most recent first
+    std::size_t prev_recent_ = 0;
+    std::uint64_t prev_rel_ = 0, prev_abs_ = 0;
+    std::uint64_t prev_dt_ = 0, prev_dx_ = 0, prev_dy_ = 0;
+    std::uint64_t prev_polarity_ = 0, prev_trigger_polarity_ = 0;
+
+    // per pixel: bit 0 set once the pixel fired, bit 1 its last polarity, the upper bits its last timestamp
+    std::vector<std::uint32_t> surface_;
+    std::vector<std::uint32_t> touched_;
+    std::size_t x_bits_ = 0, surface_bits_ = 0;
+};
+
+} // namespace XEFormat
@@ -0,0 +1,232 @@
+/**********************************************************************************************************************
+ * MIT License                                                                                                        *
+ *                                                                                                                    *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and                  *
+ * associated documentation files (the “Software”), to deal in the Software without restriction,                      *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,              *
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,              *
+ * subject to the following conditions:                                                                               *
+ *                                                                                                                    *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial               *
+ * portions of the Software.                                                                                          *
+ *                                                                                                                    *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,                                *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND               *
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES               *
+ * OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN                *
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ **********************************************************************************************************************/
+
+#include <cstring>
+#include "crc32c.h"
+
+#if defined(__x86_64__)
+#define XE_CRC32C_X86 1
+#include <immintrin.h>
+#define XE_TARGET_SSE42 __attribute__((target("sse4.2")))
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#define XE_CRC32C_ARM 1
+#include <arm_acle.h>
+#endif
+
+namespace XEFormat {
+
+namespace {
+
+constexpr std::uint32_t polynomial = 0x82F63B78;   // Castagnoli polynomial, bit-reversed
+
+// The hardware loops code three streams of stream_long (then stream_short) bytes at once, and merge their checksums
+// by shifting the first ones over the bytes of the next ones: the CRC register is linear, so running it over n
+// bytes from state s gives shift_n(s) XOR (the register run over the same bytes from 0).
+constexpr std::size_t stream_long = 8192;
+constexpr std::size_t stream_short = 256;
+
+/// @brief  Slicing-by-8 tables, and the tables of the operators shifting a register over stream_long and
+///         stream_short zero bytes, one table per byte of the register.
+struct Tables {
+    std::uint32_t slice[8][256];
+    std::uint32_t shift_long[4][256];
+    std::uint32_t shift_short[4][256];
+
+    Tables() {
+        for(std::uint32_t n=0; n<256; ++n) {
+            std::uint32_t crc = n;
+            for(int k=0; k<8; ++k) {
+                crc = (crc >> 1) ^ (polynomial & (0u - (crc & 1)));
+            }
+            slice[0][n] = crc;
+        }
+        for(std::uint32_t n=0; n<256; ++n) {
+            for(int k=1; k<8; ++k) {
+                slice[k][n] = (slice[k-1][n] >> 8) ^ slice[0][slice[k-1][n] & 0xFF];
+            }
+        }
+        make_shift(stream_long, shift_long);
+        make_shift(stream_short, shift_short);
+    }
+
+    void make_shift(std::size_t num_bytes, std::uint32_t (&table)[4][256]) const {
+        // image of each bit of the register, then of each value of each byte by linearity
+        std::uint32_t columns[32];
+        for(int bit=0; bit<32; ++bit) {
+            std::uint32_t crc = 1u << bit;
+            for(std::size_t i=0; i<num_bytes; ++i) {
+                crc = (crc >> 8) ^ slice[0][crc & 0xFF];
+            }
+            columns[bit] = crc;
+        }
+        for(int byte=0; byte<4; ++byte) {
+            for(std::uint32_t n=0; n<256; ++n) {
+                std::uint32_t crc = 0;
+                for(int bit=0; bit<8; ++bit) {
+                    if(n & (1u << bit)) {
+                        crc ^= columns[8*byte + bit];
+                    }
+                }
+                table[byte][n] = crc;
+            }
+        }
+    }
+};
+
+const Tables &tables() {
+    static const Tables instance;
+    return instance;
+}
+
+inline std::uint32_t shift(const std::uint32_t (&table)[4][256], std::uint32_t crc) {
+    return table[0][crc & 0xFF] ^ table[1][(crc >> 8) & 0xFF] ^ table[2][(crc >> 16) & 0xFF] ^ table[3][crc >> 24];
+}
+
+inline std::uint64_t load_u64(const std::uint8_t *p) {
+    std::uint64_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+/// @brief  Runs the (pre-inverted) register over a buffer, 8 bytes at a time through the slicing tables.
+std::uint32_t update_software(std::uint32_t crc, const std::uint8_t *p, std::size_t size) {
+    const Tables &t = tables();
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    for(; size >= 8; size -= 8, p += 8) {
+        const std::uint64_t word = load_u64(p) ^ crc;
+        crc = t.slice[7][word & 0xFF] ^ t.slice[6][(word >> 8) & 0xFF] ^ t.slice[5][(word >> 16) & 0xFF] ^ t.slice[4][(word >> 24) & 0xFF]
+            ^ t.slice[3][(word >> 32) & 0xFF] ^ t.slice[2][(word >> 40) & 0xFF] ^ t.slice[1][(word >> 48) & 0xFF] ^ t.slice[0][word >> 56];
+    }
+#endif
+    for(; size > 0; --size, ++p) {
+        crc = (crc >> 8) ^ t.slice[0][(crc ^ *p) & 0xFF];
+    }
+    return crc;
+}
+
+#ifdef XE_CRC32C_X86
+/// @brief  Runs the register over groups of three streams of length bytes while they fit, p being 8-byte aligned.
+XE_TARGET_SSE42 std::uint32_t three_streams_sse42(std::uint32_t crc, const std::uint8_t *&p, std::size_t &size, std::size_t length, const std::uint32_t (&shift_table)[4][256]) {
+    while(size >= 3*length) {
+        std::uint64_t crc0 = crc, crc1 = 0, crc2 = 0;
+        for(const std::uint8_t *end = p + length; p < end; p += 8) {
+            crc0 = _mm_crc32_u64(crc0, load_u64(p));
+            crc1 = _mm_crc32_u64(crc1, load_u64(p + length));
+            crc2 = _mm_crc32_u64(crc2, load_u64(p + 2*length));
+        }
+        crc = shift(shift_table, static_cast<std::uint32_t>(crc0)) ^ static_cast<std::uint32_t>(crc1);
+        crc = shift(shift_table, crc) ^ static_cast<std::uint32_t>(crc2);
+        p += 2*length;
+        size -= 3*length;
+    }
+    return crc;
+}
+
+XE_TARGET_SSE42 std::uint32_t update_sse42(std::uint32_t crc, const std::uint8_t *p, std::size_t size) {
+    const Tables &t = tables();
+    for(; size > 0 && (reinterpret_cast<std::uintptr_t>(p) & 7) != 0; --size, ++p) {
+        crc = _mm_crc32_u8(crc, *p);
+    }
+    crc = three_streams_sse42(crc, p, size, stream_long, t.shift_long);
+    crc = three_streams_sse42(crc, p, size, stream_short, t.shift_short);
+    std::uint64_t crc64 = crc;
+    for(; size >= 8; size -= 8, p += 8) {
+        crc64 = _mm_crc32_u64(crc64, load_u64(p));
+    }
+    crc = static_cast<std::uint32_t>(crc64);
+    for(; size > 0; --size, ++p) {
+        crc = _mm_crc32_u8(crc, *p);
+    }
+    return crc;
+}
+#endif
+
+#ifdef XE_CRC32C_ARM
+/// @brief  Runs the register over groups of three streams of length bytes while they fit, p being 8-byte aligned.
+std::uint32_t three_streams_armv8(std::uint32_t crc, const std::uint8_t *&p, std::size_t &size, std::size_t length, const std::uint32_t (&shift_table)[4][256]) {
+    while(size >= 3*length) {
+        std::uint32_t crc0 = crc, crc1 = 0, crc2 = 0;
+        for(const std::uint8_t *end = p + length; p < end; p += 8) {
+            crc0 = __crc32cd(crc0, load_u64(p));
+            crc1 = __crc32cd(crc1, load_u64(p + length));
+            crc2 = __crc32cd(crc2, load_u64(p + 2*length));
+        }
+        crc = shift(shift_table, crc0) ^ crc1;
+        crc = shift(shift_table, crc) ^ crc2;
+        p += 2*length;
+        size -= 3*length;
+    }
+    return crc;
+}
+
+std::uint32_t update_armv8(std::uint32_t crc, const std::uint8_t *p, std::size_t size) {
+    const Tables &t = tables();
+    for(; size > 0 && (reinterpret_cast<std::uintptr_t>(p) & 7) != 0; --size, ++p) {
+        crc = __crc32cb(crc, *p);
+    }
+    crc = three_streams_armv8(crc, p, size, stream_long, t.shift_long);
+    crc = three_streams_armv8(crc, p, size, stream_short, t.shift_short);
+    for(; size >= 8; size -= 8, p += 8) {
+        crc = __crc32cd(crc, load_u64(p));
+    }
+    for(; size > 0; --size, ++p) {
+        crc = __crc32cb(crc, *p);
+    }
+    return crc;
+}
+#endif
+
+using UpdateFunction = std::uint32_t (*)(std::uint32_t, const std::uint8_t*, std::size_t);
+
+struct Implementation {
+    UpdateFunction update;
+    const char *name;
+};
+
+Implementation detect_implementation() {
+#if defined(XE_CRC32C_X86)
+    if(__builtin_cpu_supports("sse4.2")) {
+        return Implementation{update_sse42, "sse4.2"};
+    }
+#elif defined(XE_CRC32C_ARM)
+    return Implementation{update_armv8, "armv8"};
+#endif
+    return Implementation{update_software, "software"};
+}
+
+const Implementation &implementation() {
+    static const Implementation selected = detect_implementation();
+    return selected;
+}
+
+} // namespace
+
+std::uint32_t crc32c(const void *data, std::size_t size, std::uint32_t crc) {
+    return ~implementation().update(~crc, static_cast<const std::uint8_t*>(data), size);
+}
+
+std::uint32_t crc32c_software(const void *data, std::size_t size, std::uint32_t crc) {
+    return ~update_software(~crc, static_cast<const std::uint8_t*>(data), size);
+}
+
+const char *crc32c_implementation() {
+    return implementation().name;
+}
+
+} // namespace XEFormat
@@ -0,0 +1,43 @@
+/**********************************************************************************************************************
+ * MIT License                                                                                                        *
+ *                                                                                                                    *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and                  *
+ * associated documentation files (the “Software”), to deal in the Software without restriction,                      *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,              *
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,              *
+ * subject to the following conditions:                                                                               *
+ *                                                                                                                    *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial               *
+ * portions of the Software.                                                                                          *
+ *                                                                                                                    *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,                                *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND               *
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES               *
+ * OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN                *
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ **********************************************************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace XEFormat {
+
+/// @brief  CRC-32C (Castagnoli polynomial) of a buffer, continuing from the checksum of the bytes before it, so that
+///         crc32c(b, nb, crc32c(a, na)) is the checksum of a followed by b. Uses the SSE4.2 crc32 instruction when the
+///         CPU has it (checked once at runtime) or the ARMv8 CRC instructions when the build targets them, running
+///         three independent streams to hide the latency of the instruction, and a table-driven loop otherwise.
+/// @param data buffer.
+/// @param size size of the buffer in bytes.
+/// @param crc checksum of the bytes before the buffer; 0 to start a new checksum.
+/// @return checksum of the bytes before and of the buffer.
+std::uint32_t crc32c(const void *data, std::size_t size, std::uint32_t crc = 0);
+
+/// @brief  Portable table-driven (slicing-by-8) CRC-32C, the fallback of crc32c(), with the same arguments.
+std::uint32_t crc32c_software(const void *data, std::size_t size, std::uint32_t crc = 0);
+
+/// @brief  Name of the implementation crc32c() uses on this CPU ("sse4.2", "armv8" or "software").
+const char *crc32c_implementation();
+
+} // namespace XEFormat
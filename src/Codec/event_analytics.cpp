@@ -0,0 +1,272 @@
+/**********************************************************************************************************************
+ * MIT License                                                                                                        *
+ *                                                                                                                    *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and                  *
+ * associated documentation files (the “Software”), to deal in the Software without restriction,                      *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,              *
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,              *
+ * subject to the following conditions:                                                                               *
+ *                                                                                                                    *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial               *
+ * portions of the Software.                                                                                          *
+ *                                                                                                                    *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,                                *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND               *
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES               *
+ * OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN                *
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ **********************************************************************************************************************/
+
+#include <algorithm>
+#include <stdexcept>
+#include "event_analytics.h"
+#include "bxe_codec.h"
+#include "thread_pool.h"
+#include "instrumentation.h"
+
+namespace XEFormat {
+
+namespace {
+
+/// @brief  Windows of count frames accumulated per pass over a batch: a batch spanning more windows takes more passes.
+constexpr std::size_t frames_per_pass = 4;
+
+/// @brief  Decoded events are handed to the accumulator in batches of at least this many events.
+constexpr std::size_t min_batch_events = 1 << 16;
+
+/// @brief  Decodes the segments of a compressed file into a batch and adds it to an accumulator.
+class AccumulatorSink : public DecodedEventSink {
+public:
+    AccumulatorSink(const FieldsDefinition &fdef, EventAccumulator &accumulator) : fdef_(fdef), accumulator_(accumulator) {}
+
+    void begin(timestamp_t abs_time_base, std::uint8_t, std::uint8_t) override {
+        abs_time_base_ = abs_time_base;
+    }
+
+    void segment(const std::uint8_t *event_bytes, const std::uint32_t *block_sizes, std::size_t num_blocks) override {
+        std::size_t n_events = 0;
+        for(std::size_t b=0; b<num_blocks; ++b) {
+            n_events += block_sizes[b];
+        }
+        batch_.clear();
+        Decoder::decode_events(event_bytes, n_events, abs_time_base_, fdef_, batch_);
+        accumulator_.add(batch_);
+    }
+
+    void finish() override {
+        accumulator_.finish();
+    }
+
+private:
+    FieldsDefinition fdef_;
+    EventAccumulator &accumulator_;
+    EventBatch batch_;
+    timestamp_t abs_time_base_ = 0;
+};
+
+} // namespace
+
+EventAccumulator::EventAccumulator(const FieldsDefinition &fdef, const AnalyticsOptions &options, FrameCallback on_frame)
+    : options_(options), on_frame_(std::move(on_frame)) {
+    if(fdef.cd_ev.x > 16 || fdef.cd_ev.y > 16 || fdef.cd_ev.polarity > 8) {
+        throw std::runtime_error("Fields definition too wide for EventBatch.");
+    }
+    width_ = options.width > 0 ? options.width : 1u << fdef.cd_ev.x;
+    height_ = options.height > 0 ? options.height : 1u << fdef.cd_ev.y;
+    num_polarities_ = 1u << fdef.cd_ev.polarity;
+
+    // one tile of rows per thread
+    pool_.reset(new ThreadPool(options.num_threads));
+    num_tiles_ = std::min<std::size_t>(pool_->size(), height_);
+    tile_rows_ = static_cast<unsigned>((height_ + num_tiles_ - 1)/num_tiles_);
+    num_tiles_ = (height_ + tile_rows_ - 1)/tile_rows_;
+    tile_events_.resize(num_tiles_);
+
+    const std::size_t plane = static_cast<std::size_t>(width_)*height_;
+    if(options.time_surface) {
+        time_surface_.assign(num_polarities_*plane, 0);
+    }
+    if(options.polarity_histogram) {
+        histogram_.assign(num_polarities_*plane, 0);
+    }
+    if(options.frame_period > 0) {
+        frames_.assign(frames_per_pass, std::vector<std::uint32_t>(plane, 0));
+    }
+}
+
+EventAccumulator::~EventAccumulator() = default;
+
+const timestamp_t *EventAccumulator::time_surface(unsigned polarity) const {
+    if(time_surface_.empty() || polarity >= num_polarities_) {
+        return nullptr;
+    }
+    return time_surface_.data() + static_cast<std::size_t>(polarity)*width_*height_;
+}
+
+const std::uint32_t *EventAccumulator::polarity_histogram(unsigned polarity) const {
+    if(histogram_.empty() || polarity >= num_polarities_) {
+        return nullptr;
+    }
+    return histogram_.data() + static_cast<std::size_t>(polarity)*width_*height_;
+}
+
+void EventAccumulator::accumulate_tile(const EventBatch &batch, std::size_t begin, std::size_t tile) {
+    const unsigned y0 = static_cast<unsigned>(tile)*tile_rows_;
+    const unsigned rows = std::min(tile_rows_, height_ - y0);
+    const std::size_t plane = static_cast<std::size_t>(width_)*height_;
+
+    // the frames of the windows opened by this pass start empty; frames_[0] goes on with the open window
+    for(std::size_t r=1; r<runs_.size(); ++r) {
+        std::fill(frames_[r].begin() + static_cast<std::ptrdiff_t>(static_cast<std::size_t>(y0)*width_),
+                  frames_[r].begin() + static_cast<std::ptrdiff_t>(static_cast<std::size_t>(y0 + rows)*width_), 0u);
+    }
+
+    const timestamp_t *timestamp = batch.timestamp();
+    const std::uint16_t *x = batch.x();
+    const std::uint16_t *y = batch.y();
+    const std::uint8_t *polarity = batch.polarity();
+    timestamp_t *surface = time_surface_.empty() ? nullptr : time_surface_.data();
+    std::uint32_t *histogram = histogram_.empty() ? nullptr : histogram_.data();
+    std::size_t accepted = 0;
+    std::size_t i = begin;
+    for(std::size_t r=0; r<runs_.size(); ++r) {
+        std::uint32_t *frame = frames_.empty() ? nullptr : frames_[r].data();
+        for(; i<runs_[r].end; ++i) {
+            // rows above the tile wrap around to large values
+            if(static_cast<unsigned>(y[i]) - y0 >= rows || x[i] >= width_) {
+                continue;
+            }
+            const std::size_t pixel = static_cast<std::size_t>(y[i])*width_ + x[i];
+            const std::size_t polarity_pixel = polarity[i]*plane + pixel;
+            ++accepted;
+            if(frame) {
+                ++frame[pixel];
+            }
+            if(surface) {
+                surface[polarity_pixel] = timestamp[i];
+            }
+            if(histogram) {
+                ++histogram[polarity_pixel];
+            }
+        }
+    }
+    tile_events_[tile] = accepted;
+}
+
+void EventAccumulator::emit(std::uint64_t window, std::size_t num_events, const std::uint32_t *counts) {
+    if(on_frame_) {
+        on_frame_(CountFrame{window, window*options_.frame_period, (window + 1)*options_.frame_period, num_events, counts});
+    }
+}
+
+void EventAccumulator::add(const EventBatch &batch) {
+    if(finished_) {
+        throw std::runtime_error("Events added to a finished accumulator.");
+    }
+    XE_METRICS_TIME(Accumulate);
+    const std::size_t n = batch.size();
+    const timestamp_t *timestamp = batch.timestamp();
+    const timestamp_t period = options_.frame_period;
+    std::size_t begin = 0;
+    while(begin < n) {
+        // splits the events into runs of one window each, the first one going on with the open window
+        runs_.clear();
+        if(period == 0) {
+            runs_.push_back(Run{n, 0});
+        } else {
+            if(!window_open_) {
+                open_window_ = timestamp[begin]/period;
+                window_open_ = true;
+            }
+            std::uint64_t window = open_window_;
+            std::size_t i = begin;
+            for(; i<n; ++i) {
+                const std::uint64_t event_window = timestamp[i]/period;
+                if(event_window > window) {
+                    runs_.push_back(Run{i, window});
+                    if(runs_.size() == frames_.size()) {
+                        break;
+                    }
+                    window = event_window;
+                }
+            }
+            if(i == n) {
+                runs_.push_back(Run{n, window});
+            }
+        }
+
+        if(num_tiles_ == 1) {
+            accumulate_tile(batch, begin, 0);
+        } else {
+            pool_->parallel_for(num_tiles_, [&](std::size_t tile) { accumulate_tile(batch, begin, tile); });
+        }
+        const std::size_t end = runs_.back().end;
+        std::size_t accepted = 0;
+        for(std::size_t events : tile_events_) {
+            accepted += events;
+        }
+        num_events_ += end - begin;
+        dropped_events_ += end - begin - accepted;
+
+        // every run but the last one closes its window
+        if(period > 0) {
+            std::size_t run_begin = begin;
+            for(std::size_t r=0; r+1<runs_.size(); ++r) {
+                emit(runs_[r].window, open_window_events_ + runs_[r].end - run_begin, frames_[r].data());
+                open_window_events_ = 0;
+                run_begin = runs_[r].end;
+            }
+            open_window_ = runs_.back().window;
+            open_window_events_ += end - run_begin;
+            std::swap(frames_[0], frames_[runs_.size() - 1]);
+        }
+        begin = end;
+    }
+}
+
+void EventAccumulator::finish() {
+    if(finished_) {
+        return;
+    }
+    finished_ = true;
+    if(window_open_) {
+        emit(open_window_, open_window_events_, frames_[0].data());
+    }
+}
+
+std::size_t accumulate_compressed_bxe(const std::uint8_t *data, std::size_t size, const FieldsDefinition &fdef, EventAccumulator &accumulator,
+                                      unsigned num_threads, const ModelStore *models) {
+    AccumulatorSink sink(fdef, accumulator);
+    return decompress_bxe(data, size, fdef, sink, num_threads, models);
+}
+
+std::size_t accumulate_bxe(const BlockXEFile &file, const FieldsDefinition &fdef, EventAccumulator &accumulator) {
+    // time base in effect before the first block, as compress_bxe finds it
+    const BlockXEFile::const_iterator first = file.begin();
+    timestamp_t abs_time_base = 0;
+    if(first != file.end() && first->has_time_base) {
+        abs_time_base = first->abs_time_base;
+    } else if(file.indexed() && file.num_indexed_blocks() > 0) {
+        abs_time_base = file.index_entry(0).abs_time_base;
+    }
+
+    // the blocks are decoded one after the other, carrying the time base over, and added in batches of many blocks
+    EventBatch batch;
+    std::size_t num_events = 0;
+    for(const BlockXEFile::Block &block : file) {
+        if(block.truncated()) {
+            throw std::runtime_error("Unexpected EOF while reading event.");
+        }
+        Decoder::decode_events(block.event_bytes, block.available_events, abs_time_base, fdef, batch);
+        num_events += block.available_events;
+        if(batch.size() >= min_batch_events) {
+            accumulator.add(batch);
+            batch.clear();
+        }
+    }
+    accumulator.add(batch);
+    accumulator.finish();
+    return num_events;
+}
+
+} // namespace XEFormat
@@ -0,0 +1,150 @@
+/**********************************************************************************************************************
+ * MIT License                                                                                                        *
+ *                                                                                                                    *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and                  *
+ * associated documentation files (the “Software”), to deal in the Software without restriction,                      *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,              *
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,              *
+ * subject to the following conditions:                                                                               *
+ *                                                                                                                    *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial               *
+ * portions of the Software.                                                                                          *
+ *                                                                                                                    *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,                                *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND               *
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES               *
+ * OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN                *
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ **********************************************************************************************************************/
+
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <functional>
+#include <cstddef>
+#include <cstdint>
+#include "xe_format.h"
+#include "event_batch.h"
+#include "mapped_file.h"
+#include "model_store.h"
+
+namespace XEFormat {
+
+class ThreadPool;
+
+/// @brief  What an EventAccumulator computes. The frame size defaults to the range of the coordinate fields
+///         (1 << fdef.cd_ev.x by 1 << fdef.cd_ev.y); events outside the frame are counted but not accumulated.
+struct AnalyticsOptions {
+    timestamp_t frame_period = 0;    // length in microseconds of the windows of the count frames; 0 computes no frames
+    bool time_surface = true;        // latest timestamp of each pixel, one surface per polarity
+    bool polarity_histogram = true;  // number of events of each pixel, one plane per polarity
+    unsigned width = 0;              // frame width; 0 uses 1 << fdef.cd_ev.x
+    unsigned height = 0;             // frame height; 0 uses 1 << fdef.cd_ev.y
+    unsigned num_threads = 0;        // threads accumulating tiles of rows in parallel; 0 uses every hardware thread
+};
+
+/// @brief  Number of events of each pixel over a time window, row-major.
+struct CountFrame {
+    std::uint64_t index;            // window number: the frame covers [index*frame_period, (index + 1)*frame_period)
+    timestamp_t begin;              // start of the window (included)
+    timestamp_t end;                // end of the window (excluded)
+    std::size_t num_events;         // CD events of the window, inside the frame or not
+    const std::uint32_t *counts;    // width*height counts, valid during the callback only
+};
+
+/// @brief  Accumulates CD events, batch after batch in stream order, into per-pixel analytics: count frames per time
+///         window, handed to a callback as each window closes, latest-timestamp surfaces and polarity histograms.
+///         The frame is split into tiles of rows accumulated in parallel, each tile scanning the batch for its own
+///         events, so that no two threads write the same pixel and every pixel sees its events in stream order.
+///         Windows are consecutive and aligned on multiples of the frame period. The stream is expected to be in time
+///         order: an event older than the open window is counted in the open window. Windows without events are
+///         skipped, so the index of a frame tells which window it covers.
+class EventAccumulator {
+public:
+    using FrameCallback = std::function<void(const CountFrame &)>;
+
+    /// @brief  Throws std::runtime_error if the coordinate or polarity fields do not fit the columns of an EventBatch.
+    /// @param fdef fields definition.
+    /// @param options what to compute.
+    /// @param on_frame called with each count frame, in window order, if options.frame_period is not 0.
+    EventAccumulator(const FieldsDefinition &fdef, const AnalyticsOptions &options, FrameCallback on_frame = FrameCallback());
+    ~EventAccumulator();
+
+    EventAccumulator(const EventAccumulator &) = delete;
+    EventAccumulator &operator=(const EventAccumulator &) = delete;
+
+    /// @brief  Accumulates the CD events of a batch; its trigger events are ignored.
+    void add(const EventBatch &batch);
+
+    /// @brief  Hands over the count frame of the last window. Nothing can be added afterwards.
+    void finish();
+
+    unsigned width() const { return width_; }
+    unsigned height() const { return height_; }
+    unsigned num_polarities() const { return num_polarities_; }
+
+    /// @brief  Number of CD events accumulated, and number of them outside the frame.
+    std::size_t num_events() const { return num_events_; }
+    std::size_t dropped_events() const { return dropped_events_; }
+
+    /// @brief  Latest timestamp of each pixel for a polarity, row-major; 0 for pixels without events. Null unless
+    ///         options.time_surface.
+    const timestamp_t *time_surface(unsigned polarity) const;
+
+    /// @brief  Number of events of each pixel for a polarity, row-major. Null unless options.polarity_histogram.
+    const std::uint32_t *polarity_histogram(unsigned polarity) const;
+
+private:
+    struct Run {
+        std::size_t end;        // index past the last event of the run
+        std::uint64_t window;   // window of the events of the run
+    };
+
+    void accumulate_tile(const EventBatch &batch, std::size_t begin, std::size_t tile);
+    void emit(std::uint64_t window, std::size_t num_events, const std::uint32_t *counts);
+
+    AnalyticsOptions options_;
+    FrameCallback on_frame_;
+    unsigned width_;
+    unsigned height_;
+    unsigned num_polarities_;
+    unsigned tile_rows_;
+    std::size_t num_tiles_;
+    std::unique_ptr<ThreadPool> pool_;
+    std::vector<timestamp_t> time_surface_;
+    std::vector<std::uint32_t> histogram_;
+    // frames of the runs of the current pass; frames_[0] is the open window
+    std::vector<std::vector<std::uint32_t>> frames_;
+    std::vector<Run> runs_;
+    std::vector<std::size_t> tile_events_;
+    bool window_open_ = false;
+    std::uint64_t open_window_ = 0;
+    std::size_t open_window_events_ = 0;
+    std::size_t num_events_ = 0;
+    std::size_t dropped_events_ = 0;
+    bool finished_ = false;
+};
+
+/// @brief  Decodes a compressed .bxe file straight into an accumulator, segment after segment, without rebuilding the
+///         .bxe or .xe files. Throws std::runtime_error on an invalid file (see decompress_bxe) and finishes the
+///         accumulator.
+/// @param data compressed file content.
+/// @param size compressed file size in bytes.
+/// @param fdef fields definition.
+/// @param accumulator accumulator to add the events to.
+/// @param num_threads threads decoding segments in parallel; 0 uses every hardware thread.
+/// @param models store of the pre-trained models, needed by files compressed with one.
+/// @return the number of events decoded (all types).
+std::size_t accumulate_compressed_bxe(const std::uint8_t *data, std::size_t size, const FieldsDefinition &fdef, EventAccumulator &accumulator,
+                                      unsigned num_threads = 0, const ModelStore *models = nullptr);
+
+/// @brief  Decodes a .bxe file into an accumulator and finishes it. Throws std::runtime_error on a truncated block or
+///         an unknown event type.
+/// @param file .bxe file.
+/// @param fdef fields definition.
+/// @param accumulator accumulator to add the events to.
+/// @return the number of events decoded (all types).
+std::size_t accumulate_bxe(const BlockXEFile &file, const FieldsDefinition &fdef, EventAccumulator &accumulator);
+
+} // namespace XEFormat
@@ -0,0 +1,226 @@
+/**********************************************************************************************************************
+ * MIT License                                                                                                        *
+ *                                                                                                                    *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and                  *
+ * associated documentation files (the “Software”), to deal in the Software without restriction,                      *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,              *
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,              *
+ * subject to the following conditions:                                                                               *
+ *                                                                                                                    *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial               *
+ * portions of the Software.                                                                                          *
+ *                                                                                                                    *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,                                *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND               *
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES               *
+ * OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN                *
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ **********************************************************************************************************************/
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <limits>
+#include "event_batch.h"
+#include "xe_layout.h"
+#include "instrumentation.h"
+
+namespace XEFormat {
+
+EventBatch::EventBatch(std::size_t initial_capacity) {
+    reserve(initial_capacity);
+}
+
+// Growing copies the columns to new arena memory, the old ones stay in the arena until the next clear().
+
+void EventBatch::reserve(std::size_t n) {
+    if(size_ + n <= capacity_) {
+        return;
+    }
+    const std::size_t capacity = size_ + n > 2*capacity_ ? size_ + n : 2*capacity_;
+    timestamp_t *timestamp = arena_.allocate_array<timestamp_t>(capacity);
+    std::uint16_t *x = arena_.allocate_array<std::uint16_t>(capacity);
+    std::uint16_t *y = arena_.allocate_array<std::uint16_t>(capacity);
+    std::uint8_t *polarity = arena_.allocate_array<std::uint8_t>(capacity);
+    if(size_ > 0) {
+        std::memcpy(timestamp, timestamp_, size_*sizeof(timestamp_t));
+        std::memcpy(x, x_, size_*sizeof(std::uint16_t));
+        std::memcpy(y, y_, size_*sizeof(std::uint16_t));
+        std::memcpy(polarity, polarity_, size_);
+    }
+    timestamp_ = timestamp;
+    x_ = x;
+    y_ = y;
+    polarity_ = polarity;
+    capacity_ = capacity;
+}
+
+void EventBatch::grow_triggers() {
+    const std::size_t capacity = trigger_capacity_ > 0 ? 2*trigger_capacity_ : 64;
+    timestamp_t *trigger_timestamp = arena_.allocate_array<timestamp_t>(capacity);
+    std::uint8_t *trigger_id = arena_.allocate_array<std::uint8_t>(capacity);
+    std::uint8_t *trigger_polarity = arena_.allocate_array<std::uint8_t>(capacity);
+    if(num_triggers_ > 0) {
+        std::memcpy(trigger_timestamp, trigger_timestamp_, num_triggers_*sizeof(timestamp_t));
+        std::memcpy(trigger_id, trigger_id_, num_triggers_);
+        std::memcpy(trigger_polarity, trigger_polarity_, num_triggers_);
+    }
+    trigger_timestamp_ = trigger_timestamp;
+    trigger_id_ = trigger_id;
+    trigger_polarity_ = trigger_polarity;
+    trigger_capacity_ = capacity;
+}
+
+void EventBatch::clear() {
+    arena_.reset();
+    capacity_ = 0;
+    trigger_capacity_ = 0;
+    size_ = 0;
+    num_triggers_ = 0;
+}
+
+namespace Decoder {
+
+namespace {
+
+/// @brief  Records classified at once by decode_into_batch.
+constexpr std::size_t classify_chunk = 512;
+
+/// @brief  Appends the CD events of a run of records sharing the same time base, keeping the ones in [t0, t1): every
+///         event is written and the write position only moves for the kept ones, so the loop does not branch.
+template <typename Layout>
+void decode_cd_run(const Layout &layout, const encoded_event_t *records, std::size_t n, timestamp_t abs_time_base, timestamp_t t0, timestamp_t t1, EventBatch &batch) {
+    const EventBatch::CDTail tail = batch.cd_tail();
+    std::size_t kept = 0;
+    for(std::size_t i=0; i<n; ++i) {
+        const CDEvent ev = layout.decode_event_cd(records[i], abs_time_base);
+        tail.timestamp[kept] = ev.timestamp;
+        tail.x[kept] = static_cast<std::uint16_t>(ev.x);
+        tail.y[kept] = static_cast<std::uint16_t>(ev.y);
+        tail.polarity[kept] = static_cast<std::uint8_t>(ev.polarity);
+        kept += ev.timestamp >= t0 && ev.timestamp < t1;
+    }
+    batch.commit_cd(kept);
+}
+
+template <typename Layout>
+void decode_into_batch(const Layout &layout, const std::uint8_t *event_bytes, std::size_t n_events, timestamp_t &abs_time_base, timestamp_t t0, timestamp_t t1, EventBatch &batch) {
+    const std::size_t ev_bytes = layout.event_size_bytes();
+    // the events of each type are counted once per call, from the batch sizes
+    [[maybe_unused]] const std::size_t cd_before = batch.size(), triggers_before = batch.num_triggers();
+    [[maybe_unused]] std::size_t time_base_events = 0;
+    encoded_event_t records[classify_chunk];
+    std::uint32_t markers[classify_chunk + 1];
+    for(std::size_t first=0; first<n_events; first+=classify_chunk) {
+        const std::size_t n = std::min(classify_chunk, n_events - first);
+        // first pass: unpacks the records with the bulk kernels and lists the positions of the events that are not
+        // CD events, which are rare, without branching
+        unpack_encoded_events(event_bytes + first*ev_bytes, n, layout.fields(), records);
+        std::size_t num_markers = 0;
+        for(std::size_t i=0; i<n; ++i) {
+            markers[num_markers] = static_cast<std::uint32_t>(i);
+            num_markers += layout.type_bits(records[i]) != EventType::CD;
+        }
+        markers[num_markers] = static_cast<std::uint32_t>(n);
+
+        // second pass: the time base of each CD event is the one set by the last time base marker before it (a
+        // prefix scan over the markers), so the run of CD events between two markers decodes with a single time base
+        std::size_t run_begin = 0;
+        for(std::size_t k=0; k<=num_markers; ++k) {
+            const std::size_t run_end = markers[k];
+            decode_cd_run(layout, records + run_begin, run_end - run_begin, abs_time_base, t0, t1, batch);
+            if(run_end == n) {
+                break;
+            }
+            const encoded_event_t encoded_event = records[run_end];
+            switch(layout.type_bits(encoded_event)) {
+                case EventType::Trigger: {
+                    const TriggerEvent ev = layout.decode_event_trigger(encoded_event, abs_time_base);
+                    if(ev.timestamp >= t0 && ev.timestamp < t1) {
+                        batch.push_trigger(ev.timestamp, ev.polarity, ev.triggerid);
+                    }
+                    break;
+                }
+                case EventType::ABSTimeStamp:
+                    abs_time_base = layout.decode_event_timestamp(encoded_event);
+                    ++time_base_events;
+                    break;
+                default:
+                    throw std::runtime_error("Event type not supported!");
+            }
+            run_begin = run_end + 1;
+        }
+    }
+    XE_METRICS_ADD(CDEventsDecoded, batch.size() - cd_before);
+    XE_METRICS_ADD(TriggerEventsDecoded, batch.num_triggers() - triggers_before);
+    XE_METRICS_ADD(TimeBaseEventsDecoded, time_base_events);
+}
+
+void check_batch_layout(const FieldsDefinition &fdef) {
+    if(fdef.cd_ev.x > 16 || fdef.cd_ev.y > 16 || fdef.cd_ev.polarity > 8 || fdef.tr_ev.polarity > 8 || fdef.tr_ev.triggerid > 8) {
+        throw std::runtime_error("Fields definition too wide for EventBatch.");
+    }
+}
+
+} // namespace
+
+void decode_events(const std::uint8_t *event_bytes, std::size_t n_events, timestamp_t &abs_time_base, const FieldsDefinition &fdef, EventBatch &batch) {
+    XE_METRICS_TIME(Decode);
+    check_batch_layout(fdef);
+    batch.reserve(n_events);
+    with_layout(fdef, [&](const auto &layout) {
+        decode_into_batch(layout, event_bytes, n_events, abs_time_base, 0, std::numeric_limits<timestamp_t>::max(), batch);
+    });
+}
+
+void decode_block(const BlockXEFile::Block &block, const FieldsDefinition &fdef, EventBatch &batch) {
+    if(!block.has_time_base) {
+        throw std::runtime_error("Block has no time base.");
+    }
+    if(block.truncated()) {
+        throw std::runtime_error("Unexpected EOF while reading event.");
+    }
+    timestamp_t abs_time_base = block.abs_time_base;
+    decode_events(block.event_bytes, block.available_events, abs_time_base, fdef, batch);
+}
+
+std::size_t decode_time_range(const BlockXEFile &file, timestamp_t t0, timestamp_t t1, const FieldsDefinition &fdef, EventBatch &batch) {
+    XE_METRICS_TIME(Decode);
+    check_batch_layout(fdef);
+    std::size_t num_blocks = 0;
+    with_layout(fdef, [&](const auto &layout) {
+        auto decode_window_block = [&](const BlockXEFile::Block &block, timestamp_t &abs_time_base) {
+            if(block.truncated()) {
+                throw std::runtime_error("Unexpected EOF while reading event.");
+            }
+            batch.reserve(block.num_events);
+            decode_into_batch(layout, block.event_bytes, block.available_events, abs_time_base, t0, t1, batch);
+            ++num_blocks;
+        };
+        if(file.indexed()) {
+            // only the blocks overlapping the window are touched, each one starting from its own time base
+            const std::pair<std::size_t, std::size_t> range = file.blocks_in_range(t0, t1);
+            for(std::size_t i=range.first; i<range.second; ++i) {
+                const BlockIndexEntry entry = file.index_entry(i);
+                const BlockXEFile::const_iterator block = file.block_at(static_cast<std::size_t>(entry.offset));
+                timestamp_t abs_time_base = block->has_time_base ? block->abs_time_base : entry.abs_time_base;
+                decode_window_block(*block, abs_time_base);
+            }
+        } else {
+            // no index: every block is decoded, the time base being replayed from the first block unless the
+            // blocks carry their own
+            timestamp_t abs_time_base = 0;
+            for(const BlockXEFile::Block &block : file) {
+                if(block.has_time_base) {
+                    abs_time_base = block.abs_time_base;
+                }
+                decode_window_block(block, abs_time_base);
+            }
+        }
+    });
+    return num_blocks;
+}
+
+} // namespace Decoder
+
+} // namespace XEFormat
@@ -0,0 +1,152 @@
+/**********************************************************************************************************************
+ * MIT License                                                                                                        *
+ *                                                                                                                    *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and                  *
+ * associated documentation files (the “Software”), to deal in the Software without restriction,                      *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,              *
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,              *
+ * subject to the following conditions:                                                                               *
+ *                                                                                                                    *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial               *
+ * portions of the Software.                                                                                          *
+ *                                                                                                                    *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,                                *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND               *
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES               *
+ * OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN                *
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ **********************************************************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "xe_format.h"
+#include "arena.h"
+#include "mapped_file.h"
+
+namespace XEFormat {
+
+/// @brief  Decoded events in structure-of-arrays form: one array per field, each of the narrowest type that holds the
+///         reference layout (16-bit coordinates, 8-bit polarity and trigger id), so that an analysis scanning a single
+///         field reads only that field. CD and trigger events are kept in separate columns, in stream order.
+///         The arrays live in an arena owned by the batch: clear() keeps the memory, so decoding block after block
+///         into the same batch does not allocate once the largest block has been seen.
+class EventBatch {
+public:
+    /// @param initial_capacity number of CD events to make room for up front.
+    explicit EventBatch(std::size_t initial_capacity = 0);
+
+    EventBatch(const EventBatch &) = delete;
+    EventBatch &operator=(const EventBatch &) = delete;
+
+    std::size_t size() const { return size_; }
+    std::size_t num_triggers() const { return num_triggers_; }
+    bool empty() const { return size_ == 0 && num_triggers_ == 0; }
+
+    const timestamp_t *timestamp() const { return timestamp_; }
+    const std::uint16_t *x() const { return x_; }
+    const std::uint16_t *y() const { return y_; }
+    const std::uint8_t *polarity() const { return polarity_; }
+
+    const timestamp_t *trigger_timestamp() const { return trigger_timestamp_; }
+    const std::uint8_t *trigger_id() const { return trigger_id_; }
+    const std::uint8_t *trigger_polarity() const { return trigger_polarity_; }
+
+    /// @brief  Returns the i-th CD event as a struct.
+    CDEvent cd_event(std::size_t i) const { return CDEvent{timestamp_[i], polarity_[i], x_[i], y_[i]}; }
+
+    /// @brief  Makes room for size() + n CD events, keeping the content.
+    void reserve(std::size_t n);
+
+    /// @brief  Removes every event, keeping the memory.
+    void clear();
+
+    /// @brief  Appends a CD event; reserve() must have made room for it.
+    void push_cd(timestamp_t timestamp, unsigned int polarity, unsigned int x, unsigned int y) {
+        timestamp_[size_] = timestamp;
+        polarity_[size_] = static_cast<std::uint8_t>(polarity);
+        x_[size_] = static_cast<std::uint16_t>(x);
+        y_[size_] = static_cast<std::uint16_t>(y);
+        ++size_;
+    }
+
+    /// @brief  Writable view of the CD columns past the last event, for decoders filling them in bulk.
+    struct CDTail {
+        timestamp_t *timestamp;
+        std::uint16_t *x;
+        std::uint16_t *y;
+        std::uint8_t *polarity;
+    };
+
+    /// @brief  Returns the CD columns from index size() on. reserve() must have made room for the events written
+    ///         there, which commit_cd() then adds to the batch.
+    CDTail cd_tail() { return CDTail{timestamp_ + size_, x_ + size_, y_ + size_, polarity_ + size_}; }
+
+    /// @brief  Adds the n events written through cd_tail() to the batch.
+    void commit_cd(std::size_t n) { size_ += n; }
+
+    /// @brief  Appends a trigger event. Trigger events are rare, their columns grow on demand.
+    void push_trigger(timestamp_t timestamp, unsigned int polarity, unsigned int trigger_id) {
+        if(num_triggers_ == trigger_capacity_) {
+            grow_triggers();
+        }
+        trigger_timestamp_[num_triggers_] = timestamp;
+        trigger_polarity_[num_triggers_] = static_cast<std::uint8_t>(polarity);
+        trigger_id_[num_triggers_] = static_cast<std::uint8_t>(trigger_id);
+        ++num_triggers_;
+    }
+
+private:
+    void grow_triggers();
+
+    Arena arena_;
+    std::size_t capacity_ = 0;
+    std::size_t trigger_capacity_ = 0;
+    std::size_t size_ = 0;
+    std::size_t num_triggers_ = 0;
+    timestamp_t *timestamp_ = nullptr;
+    std::uint16_t *x_ = nullptr;
+    std::uint16_t *y_ = nullptr;
+    std::uint8_t *polarity_ = nullptr;
+    timestamp_t *trigger_timestamp_ = nullptr;
+    std::uint8_t *trigger_id_ = nullptr;
+    std::uint8_t *trigger_polarity_ = nullptr;
+};
+
+namespace Decoder {
+
+/// @brief  Decodes consecutive big-endian records and appends them to an event batch. Absolute time base events
+///         update abs_time_base and are not stored. The records are classified a chunk at a time, then the runs of
+///         CD events between the other events are decoded with a constant time base, without branching per event.
+///         Throws std::runtime_error on an unknown event type, or if the fields of the layout do not fit the
+///         columns of the batch.
+/// @param event_bytes input buffer holding n_events*fdef.event_size_bytes bytes.
+/// @param n_events number of records.
+/// @param abs_time_base absolute time base, updated by the time base events found in the records.
+/// @param fdef fields definition.
+/// @param batch batch to append the events to.
+void decode_events(const std::uint8_t *event_bytes, std::size_t n_events, timestamp_t &abs_time_base, const FieldsDefinition &fdef, EventBatch &batch);
+
+/// @brief  Decodes a single block of a .bxe file into an event batch, starting from the time base stored in its
+///         header, so that the blocks of a file can be decoded independently (e.g. in parallel). Throws
+///         std::runtime_error if the block has no time base, is truncated, or holds an unknown event type.
+/// @param block block of a file with self-contained blocks.
+/// @param fdef fields definition.
+/// @param batch batch to append the events to.
+void decode_block(const BlockXEFile::Block &block, const FieldsDefinition &fdef, EventBatch &batch);
+
+/// @brief  Appends to an event batch the CD and trigger events of a .bxe file whose timestamps fall in [t0, t1).
+///         With an indexed file only the blocks overlapping the window are decoded; otherwise the whole file is
+///         replayed. Throws std::runtime_error on a truncated block or an unknown event type.
+/// @param file .bxe file.
+/// @param t0 start of the window (included).
+/// @param t1 end of the window (excluded).
+/// @param fdef fields definition.
+/// @param batch batch to append the events to.
+/// @return number of blocks decoded.
+std::size_t decode_time_range(const BlockXEFile &file, timestamp_t t0, timestamp_t t1, const FieldsDefinition &fdef, EventBatch &batch);
+
+} // namespace Decoder
+
+} // namespace XEFormat
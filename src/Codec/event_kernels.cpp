@@ -0,0 +1,523 @@
+/**********************************************************************************************************************
+ * MIT License                                                                                                        *
+ *                                                                                                                    *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and                  *
+ * associated documentation files (the “Software”), to deal in the Software without restriction,                      *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,              *
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,              *
+ * subject to the following conditions:                                                                               *
+ *                                                                                                                    *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial               *
+ * portions of the Software.                                                                                          *
+ *                                                                                                                    *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,                                *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND               *
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES               *
+ * OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN                *
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ **********************************************************************************************************************/
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include "event_kernels.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define XE_KERNELS_X86 1
+#include <immintrin.h>
+#define XE_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define XE_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace XEFormat {
+
+namespace {
+
+/// @brief  Shifts and masks of the CD event fields, computed once per call from the fields definition.
+struct CDLayout {
+    unsigned ts_shift, polarity_shift, x_shift, y_shift;
+    std::uint64_t ts_mask, polarity_mask, x_mask, y_mask;
+};
+
+CDLayout make_cd_layout(const FieldsDefinition &fdef) {
+    CDLayout layout;
+    layout.ts_shift = fdef.event_type_bit_size;
+    layout.polarity_shift = layout.ts_shift + fdef.cd_ev.relativetimestamp;
+    layout.x_shift = layout.polarity_shift + fdef.cd_ev.polarity;
+    layout.y_shift = layout.x_shift + fdef.cd_ev.x;
+    layout.ts_mask = (static_cast<std::uint64_t>(1) << fdef.cd_ev.relativetimestamp) - 1;
+    layout.polarity_mask = (static_cast<std::uint64_t>(1) << fdef.cd_ev.polarity) - 1;
+    layout.x_mask = (static_cast<std::uint64_t>(1) << fdef.cd_ev.x) - 1;
+    layout.y_mask = (static_cast<std::uint64_t>(1) << fdef.cd_ev.y) - 1;
+    return layout;
+}
+
+inline encoded_event_t encode_cd(timestamp_t timestamp, std::uint64_t polarity, std::uint64_t x, std::uint64_t y, timestamp_t abs_time_base, const CDLayout &layout) {
+    return EventType::CD | ((timestamp - abs_time_base) << layout.ts_shift) | (polarity << layout.polarity_shift) |
+           (x << layout.x_shift) | (y << layout.y_shift);
+}
+
+inline CDEvent decode_cd(encoded_event_t encoded_event, timestamp_t abs_time_base, const CDLayout &layout) {
+    CDEvent event;
+    event.timestamp = ((encoded_event >> layout.ts_shift) & layout.ts_mask) + abs_time_base;
+    event.polarity = static_cast<unsigned int>((encoded_event >> layout.polarity_shift) & layout.polarity_mask);
+    event.x = static_cast<unsigned int>((encoded_event >> layout.x_shift) & layout.x_mask);
+    event.y = static_cast<unsigned int>((encoded_event >> layout.y_shift) & layout.y_mask);
+    return event;
+}
+
+inline void store_record(encoded_event_t encoded_event, std::size_t ev_bytes, std::uint8_t *p) {
+    for(std::size_t b=0; b<ev_bytes; ++b) {
+        p[b] = static_cast<std::uint8_t>(encoded_event >> ((ev_bytes-1-b)*8));
+    }
+}
+
+inline encoded_event_t load_record(const std::uint8_t *p, std::size_t ev_bytes) {
+    encoded_event_t encoded_event = 0;
+    for(std::size_t b=0; b<ev_bytes; ++b) {
+        encoded_event = (encoded_event << 8) | p[b];
+    }
+    return encoded_event;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// Scalar kernels: any record size. They also finish the last events left over by the vector kernels.
+
+void pack_records_scalar(const encoded_event_t *encoded_events, std::size_t n, std::size_t ev_bytes, std::uint8_t *bytes) {
+    for(std::size_t i=0; i<n; ++i) {
+        store_record(encoded_events[i], ev_bytes, bytes + i*ev_bytes);
+    }
+}
+
+void unpack_records_scalar(const std::uint8_t *bytes, std::size_t n, std::size_t ev_bytes, encoded_event_t *encoded_events) {
+    for(std::size_t i=0; i<n; ++i) {
+        encoded_events[i] = load_record(bytes + i*ev_bytes, ev_bytes);
+    }
+}
+
+void pack_cd_scalar(const CDEvent *events, std::size_t n, timestamp_t abs_time_base, const CDLayout &layout, std::size_t ev_bytes, std::uint8_t *bytes) {
+    for(std::size_t i=0; i<n; ++i) {
+        const CDEvent &ev = events[i];
+        store_record(encode_cd(ev.timestamp, ev.polarity, ev.x, ev.y, abs_time_base, layout), ev_bytes, bytes + i*ev_bytes);
+    }
+}
+
+void unpack_cd_scalar(const std::uint8_t *bytes, std::size_t n, timestamp_t abs_time_base, const CDLayout &layout, std::size_t ev_bytes, CDEvent *events) {
+    for(std::size_t i=0; i<n; ++i) {
+        events[i] = decode_cd(load_record(bytes + i*ev_bytes, ev_bytes), abs_time_base, layout);
+    }
+}
+
+void pack_columns_scalar(const CDEventColumns &columns, std::size_t begin, std::size_t n, timestamp_t abs_time_base, const CDLayout &layout, std::size_t ev_bytes, std::uint8_t *bytes) {
+    for(std::size_t i=begin; i<n; ++i) {
+        store_record(encode_cd(columns.timestamp[i], columns.polarity[i], columns.x[i], columns.y[i], abs_time_base, layout), ev_bytes, bytes + i*ev_bytes);
+    }
+}
+
+void unpack_columns_scalar(const std::uint8_t *bytes, std::size_t begin, std::size_t n, timestamp_t abs_time_base, const CDLayout &layout, std::size_t ev_bytes, const CDEventColumns &columns) {
+    for(std::size_t i=begin; i<n; ++i) {
+        const CDEvent ev = decode_cd(load_record(bytes + i*ev_bytes, ev_bytes), abs_time_base, layout);
+        columns.timestamp[i] = ev.timestamp;
+        columns.polarity[i] = ev.polarity;
+        columns.x[i] = ev.x;
+        columns.y[i] = ev.y;
+    }
+}
+
+void pack_records_48_scalar(const encoded_event_t *encoded_events, std::size_t n, std::uint8_t *bytes) {
+    pack_records_scalar(encoded_events, n, 6, bytes);
+}
+
+void unpack_records_48_scalar(const std::uint8_t *bytes, std::size_t n, encoded_event_t *encoded_events) {
+    unpack_records_scalar(bytes, n, 6, encoded_events);
+}
+
+void pack_cd_48_scalar(const CDEvent *events, std::size_t n, timestamp_t abs_time_base, const CDLayout &layout, std::uint8_t *bytes) {
+    pack_cd_scalar(events, n, abs_time_base, layout, 6, bytes);
+}
+
+void unpack_cd_48_scalar(const std::uint8_t *bytes, std::size_t n, timestamp_t abs_time_base, const CDLayout &layout, CDEvent *events) {
+    unpack_cd_scalar(bytes, n, abs_time_base, layout, 6, events);
+}
+
+void pack_columns_48_scalar(const CDEventColumns &columns, std::size_t n, timestamp_t abs_time_base, const CDLayout &layout, std::uint8_t *bytes) {
+    pack_columns_scalar(columns, 0, n, abs_time_base, layout, 6, bytes);
+}
+
+void unpack_columns_48_scalar(const std::uint8_t *bytes, std::size_t n, timestamp_t abs_time_base, const CDLayout &layout, const CDEventColumns &columns) {
+    unpack_columns_scalar(bytes, 0, n, abs_time_base, layout, 6, columns);
+}
+
+#ifdef XE_KERNELS_X86
+
+// The vector kernels only handle 48-bit records: a byte shuffle turns two 6-byte big-endian records of a 128-bit
+// lane into two little-endian 64-bit words, and back. CDEvent is read and written as three 64-bit words
+// {timestamp, polarity | x << 32, y | padding}.
+static_assert(sizeof(CDEvent) == 24 && offsetof(CDEvent, polarity) == 8 && offsetof(CDEvent, x) == 12 &&
+              offsetof(CDEvent, y) == 16 && sizeof(unsigned int) == 4, "unexpected CDEvent layout");
+
+// -------------------------------------------------------------------------------------------------------------------
+// SSE4.1: two events per iteration.
+
+XE_TARGET_SSE41 inline __m128i records_to_words_sse(__m128i v) {
+    return _mm_shuffle_epi8(v, _mm_setr_epi8(5, 4, 3, 2, 1, 0, -1, -1, 11, 10, 9, 8, 7, 6, -1, -1));
+}
+
+XE_TARGET_SSE41 inline __m128i words_to_records_sse(__m128i v) {
+    return _mm_shuffle_epi8(v, _mm_setr_epi8(5, 4, 3, 2, 1, 0, 13, 12, 11, 10, 9, 8, -1, -1, -1, -1));
+}
+
+XE_TARGET_SSE41 inline __m128i load_records_sse(const std::uint8_t *p) {
+    std::uint32_t tail;
+    std::memcpy(&tail, p + 8, sizeof(tail));
+    return records_to_words_sse(_mm_insert_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p)), static_cast<int>(tail), 2));
+}
+
+XE_TARGET_SSE41 inline void store_records_sse(__m128i words, std::uint8_t *p) {
+    const __m128i v = words_to_records_sse(words);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(p), v);
+    const std::uint32_t tail = static_cast<std::uint32_t>(_mm_extract_epi32(v, 2));
+    std::memcpy(p + 8, &tail, sizeof(tail));
+}
+
+XE_TARGET_SSE41 inline __m128i encode_cd_sse(__m128i ts, __m128i polarity, __m128i x, __m128i y, timestamp_t abs_time_base, const CDLayout &layout) {
+    __m128i e = _mm_sll_epi64(_mm_sub_epi64(ts, _mm_set1_epi64x(static_cast<long long>(abs_time_base))), _mm_cvtsi32_si128(static_cast<int>(layout.ts_shift)));
+    e = _mm_or_si128(e, _mm_sll_epi64(polarity, _mm_cvtsi32_si128(static_cast<int>(layout.polarity_shift))));
+    e = _mm_or_si128(e, _mm_sll_epi64(x, _mm_cvtsi32_si128(static_cast<int>(layout.x_shift))));
+    e = _mm_or_si128(e, _mm_sll_epi64(y, _mm_cvtsi32_si128(static_cast<int>(layout.y_shift))));
+    return _mm_or_si128(e, _mm_set1_epi64x(EventType::CD));
+}
+
+XE_TARGET_SSE41 inline __m128i field_sse(__m128i e, unsigned shift, std::uint64_t mask) {
+    return _mm_and_si128(_mm_srl_epi64(e, _mm_cvtsi32_si128(static_cast<int>(shift))), _mm_set1_epi64x(static_cast<long long>(mask)));
+}
+
+XE_TARGET_SSE41 void pack_records_sse41(const encoded_event_t *encoded_events, std::size_t n, std::uint8_t *bytes) {
+    std::size_t i = 0;
+    for(; i+2 <= n; i+=2) {
+        store_records_sse(_mm_loadu_si128(reinterpret_cast<const __m128i*>(encoded_events + i)), bytes + i*6);
+    }
+    pack_records_scalar(encoded_events + i, n - i, 6, bytes + i*6);
+}
+
+XE_TARGET_SSE41 void unpack_records_sse41(const std::uint8_t *bytes, std::size_t n, encoded_event_t *encoded_events) {
+    std::size_t i = 0;
+    for(; i+2 <= n; i+=2) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(encoded_events + i), load_records_sse(bytes + i*6));
+    }
+    unpack_records_scalar(bytes + i*6, n - i, 6, encoded_events + i);
+}
+
+XE_TARGET_SSE41 void pack_cd_sse41(const CDEvent *events, std::size_t n, timestamp_t abs_time_base, const CDLayout &layout, std::uint8_t *bytes) {
+    const __m128i low_dword = _mm_set1_epi64x(0xFFFFFFFF);
+    std::size_t i = 0;
+    for(; i+2 <= n; i+=2) {
+        const __m128i *src = reinterpret_cast<const __m128i*>(events + i);
+        const __m128i a = _mm_loadu_si128(src), b = _mm_loadu_si128(src + 1), c = _mm_loadu_si128(src + 2);
+        const __m128i ts = _mm_blend_epi16(a, b, 0xF0);     // [ts0, ts1]
+        const __m128i px = _mm_alignr_epi8(c, a, 8);        // [polarity0 | x0, polarity1 | x1]
+        const __m128i y = _mm_and_si128(_mm_blend_epi16(b, c, 0xF0), low_dword);
+        const __m128i e = encode_cd_sse(ts, _mm_and_si128(px, low_dword), _mm_srli_epi64(px, 32), y, abs_time_base, layout);
+        store_records_sse(e, bytes + i*6);
+    }
+    pack_cd_scalar(events + i, n - i, abs_time_base, layout, 6, bytes + i*6);
+}
+
+XE_TARGET_SSE41 void unpack_cd_sse41(const std::uint8_t *bytes, std::size_t n, timestamp_t abs_time_base, const CDLayout &layout, CDEvent *events) {
+    const __m128i base = _mm_set1_epi64x(static_cast<long long>(abs_time_base));
+    std::size_t i = 0;
+    for(; i+2 <= n; i+=2) {
+        const __m128i e = load_records_sse(bytes + i*6);
+        const __m128i ts = _mm_add_epi64(field_sse(e, layout.ts_shift, layout.ts_mask), base);
+        const __m128i px = _mm_or_si128(field_sse(e, layout.polarity_shift, layout.polarity_mask), _mm_slli_epi64(field_sse(e, layout.x_shift, layout.x_mask), 32));
+        const __m128i y = field_sse(e, layout.y_shift, layout.y_mask);
+        __m128i *dst = reinterpret_cast<__m128i*>(events + i);
+        _mm_storeu_si128(dst, _mm_unpacklo_epi64(ts, px));
+        _mm_storeu_si128(dst + 1, _mm_blend_epi16(y, ts, 0xF0));
+        _mm_storeu_si128(dst + 2, _mm_unpackhi_epi64(px, y));
+    }
+    unpack_cd_scalar(bytes + i*6, n - i, abs_time_base, layout, 6, events + i);
+}
+
+XE_TARGET_SSE41 void pack_columns_sse41(const CDEventColumns &columns, std::size_t n, timestamp_t abs_time_base, const CDLayout &layout, std::uint8_t *bytes) {
+    std::size_t i = 0;
+    for(; i+2 <= n; i+=2) {
+        const __m128i ts = _mm_loadu_si128(reinterpret_cast<const __m128i*>(columns.timestamp + i));
+        const __m128i polarity = _mm_cvtepu32_epi64(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(columns.polarity + i)));
+        const __m128i x = _mm_cvtepu32_epi64(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(columns.x + i)));
+        const __m128i y = _mm_cvtepu32_epi64(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(columns.y + i)));
+        store_records_sse(encode_cd_sse(ts, polarity, x, y, abs_time_base, layout), bytes + i*6);
+    }
+    pack_columns_scalar(columns, i, n, abs_time_base, layout, 6, bytes);
+}
+
+XE_TARGET_SSE41 void unpack_columns_sse41(const std::uint8_t *bytes, std::size_t n, timestamp_t abs_time_base, const CDLayout &layout, const CDEventColumns &columns) {
+    const __m128i base = _mm_set1_epi64x(static_cast<long long>(abs_time_base));
+    std::size_t i = 0;
+    for(; i+2 <= n; i+=2) {
+        const __m128i e = load_records_sse(bytes + i*6);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(columns.timestamp + i), _mm_add_epi64(field_sse(e, layout.ts_shift, layout.ts_mask), base));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(columns.polarity + i), _mm_shuffle_epi32(field_sse(e, layout.polarity_shift, layout.polarity_mask), 0x08));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(columns.x + i), _mm_shuffle_epi32(field_sse(e, layout.x_shift, layout.x_mask), 0x08));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(columns.y + i), _mm_shuffle_epi32(field_sse(e, layout.y_shift, layout.y_mask), 0x08));
+    }
+    unpack_columns_scalar(bytes, i, n, abs_time_base, layout, 6, columns);
+}
+
+// -------------------------------------------------------------------------------------------------------------------
+// AVX2: four events per iteration. The 24 record bytes are spread over the two 128-bit lanes (12 bytes each) with a
+// dword permutation so that the lane-local byte shuffle of SSE can be reused.
+
+XE_TARGET_AVX2 inline __m256i load_records_avx2(const std::uint8_t *p) {
+    const __m256i v = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))),
+                                              _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p + 16)), 1);
+    const __m256i spread = _mm256_permutevar8x32_epi32(v, _mm256_setr_epi32(0, 1, 2, 2, 3, 4, 5, 5));
+    const __m128i mask = _mm_setr_epi8(5, 4, 3, 2, 1, 0, -1, -1, 11, 10, 9, 8, 7, 6, -1, -1);
+    return _mm256_shuffle_epi8(spread, _mm256_broadcastsi128_si256(mask));
+}
+
+XE_TARGET_AVX2 inline void store_records_avx2(__m256i words, std::uint8_t *p) {
+    const __m128i mask = _mm_setr_epi8(5, 4, 3, 2, 1, 0, 13, 12, 11, 10, 9, 8, -1, -1, -1, -1);
+    const __m256i v = _mm256_shuffle_epi8(words, _mm256_broadcastsi128_si256(mask));
+    const __m256i packed = _mm256_permutevar8x32_epi32(v, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7, 7));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p), _mm256_castsi256_si128(packed));
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(p + 16), _mm256_extracti128_si256(packed, 1));
+}
+
+XE_TARGET_AVX2 inline __m256i encode_cd_avx2(__m256i ts, __m256i polarity, __m256i x, __m256i y, timestamp_t abs_time_base, const CDLayout &layout) {
+    __m256i e = _mm256_sll_epi64(_mm256_sub_epi64(ts, _mm256_set1_epi64x(static_cast<long long>(abs_time_base))), _mm_cvtsi32_si128(static_cast<int>(layout.ts_shift)));
+    e = _mm256_or_si256(e, _mm256_sll_epi64(polarity, _mm_cvtsi32_si128(static_cast<int>(layout.polarity_shift))));
+    e = _mm256_or_si256(e, _mm256_sll_epi64(x, _mm_cvtsi32_si128(static_cast<int>(layout.x_shift))));
+    e = _mm256_or_si256(e, _mm256_sll_epi64(y, _mm_cvtsi32_si128(static_cast<int>(layout.y_shift))));
+    return _mm256_or_si256(e, _mm256_set1_epi64x(EventType::CD));
+}
+
+XE_TARGET_AVX2 inline __m256i field_avx2(__m256i e, unsigned shift, std::uint64_t mask) {
+    return _mm256_and_si256(_mm256_srl_epi64(e, _mm_cvtsi32_si128(static_cast<int>(shift))), _mm256_set1_epi64x(static_cast<long long>(mask)));
+}
+
+XE_TARGET_AVX2 inline __m128i narrow_avx2(__m256i v) {
+    return _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(v, _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6)));
+}
+
+XE_TARGET_AVX2 void pack_records_avx2(const encoded_event_t *encoded_events, std::size_t n, std::uint8_t *bytes) {
+    std::size_t i = 0;
+    for(; i+4 <= n; i+=4) {
+        store_records_avx2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(encoded_events + i)), bytes + i*6);
+    }
+    pack_records_scalar(encoded_events + i, n - i, 6, bytes + i*6);
+}
+
+XE_TARGET_AVX2 void unpack_records_avx2(const std::uint8_t *bytes, std::size_t n, encoded_event_t *encoded_events) {
+    std::size_t i = 0;
+    for(; i+4 <= n; i+=4) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(encoded_events + i), load_records_avx2(bytes + i*6));
+    }
+    unpack_records_scalar(bytes + i*6, n - i, 6, encoded_events + i);
+}
+
+// Four CDEvent are the 64-bit words a = [ts0, px0, y0, ts1], b = [px1, y1, ts2, px2] and c = [y2, ts3, px3, y3]:
+// two blends and one permutation gather (or scatter) each field.
+
+XE_TARGET_AVX2 void pack_cd_avx2(const CDEvent *events, std::size_t n, timestamp_t abs_time_base, const CDLayout &layout, std::uint8_t *bytes) {
+    const __m256i low_dword = _mm256_set1_epi64x(0xFFFFFFFF);
+    std::size_t i = 0;
+    for(; i+4 <= n; i+=4) {
+        const __m256i *src = reinterpret_cast<const __m256i*>(events + i);
+        const __m256i a = _mm256_loadu_si256(src), b = _mm256_loadu_si256(src + 1), c = _mm256_loadu_si256(src + 2);
+        const __m256i ts = _mm256_permute4x64_epi64(_mm256_blend_epi32(_mm256_blend_epi32(a, b, 0x30), c, 0x0C), _MM_SHUFFLE(1, 2, 3, 0));
+        const __m256i px = _mm256_permute4x64_epi64(_mm256_blend_epi32(_mm256_blend_epi32(a, b, 0xC3), c, 0x30), _MM_SHUFFLE(2, 3, 0, 1));
+        const __m256i y = _mm256_permute4x64_epi64(_mm256_blend_epi32(_mm256_blend_epi32(a, b, 0x0C), c, 0xC3), _MM_SHUFFLE(3, 0, 1, 2));
+        const __m256i e = encode_cd_avx2(ts, _mm256_and_si256(px, low_dword), _mm256_srli_epi64(px, 32), _mm256_and_si256(y, low_dword), abs_time_base, layout);
+        store_records_avx2(e, bytes + i*6);
+    }
+    pack_cd_scalar(events + i, n - i, abs_time_base, layout, 6, bytes + i*6);
+}
+
+XE_TARGET_AVX2 void unpack_cd_avx2(const std::uint8_t *bytes, std::size_t n, timestamp_t abs_time_base, const CDLayout &layout, CDEvent *events) {
+    const __m256i base = _mm256_set1_epi64x(static_cast<long long>(abs_time_base));
+    std::size_t i = 0;
+    for(; i+4 <= n; i+=4) {
+        const __m256i e = load_records_avx2(bytes + i*6);
+        const __m256i ts = _mm256_permute4x64_epi64(_mm256_add_epi64(field_avx2(e, layout.ts_shift, layout.ts_mask), base), _MM_SHUFFLE(1, 2, 3, 0));
+        const __m256i px = _mm256_permute4x64_epi64(_mm256_or_si256(field_avx2(e, layout.polarity_shift, layout.polarity_mask),
+                                                                    _mm256_slli_epi64(field_avx2(e, layout.x_shift, layout.x_mask), 32)), _MM_SHUFFLE(2, 3, 0, 1));
+        const __m256i y = _mm256_permute4x64_epi64(field_avx2(e, layout.y_shift, layout.y_mask), _MM_SHUFFLE(3, 0, 1, 2));
+        __m256i *dst = reinterpret_cast<__m256i*>(events + i);
+        _mm256_storeu_si256(dst, _mm256_blend_epi32(_mm256_blend_epi32(ts, px, 0x0C), y, 0x30));
+        _mm256_storeu_si256(dst + 1, _mm256_blend_epi32(_mm256_blend_epi32(px, y, 0x0C), ts, 0x30));
+        _mm256_storeu_si256(dst + 2, _mm256_blend_epi32(_mm256_blend_epi32(y, ts, 0x0C), px, 0x30));
+    }
+    unpack_cd_scalar(bytes + i*6, n - i, abs_time_base, layout, 6, events + i);
+}
+
+XE_TARGET_AVX2 void pack_columns_avx2(const CDEventColumns &columns, std::size_t n, timestamp_t abs_time_base, const CDLayout &layout, std::uint8_t *bytes) {
+    std::size_t i = 0;
+    for(; i+4 <= n; i+=4) {
+        const __m256i ts = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(columns.timestamp + i));
+        const __m256i polarity = _mm256_cvtepu32_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(columns.polarity + i)));
+        const __m256i x = _mm256_cvtepu32_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(columns.x + i)));
+        const __m256i y = _mm256_cvtepu32_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(columns.y + i)));
+        store_records_avx2(encode_cd_avx2(ts, polarity, x, y, abs_time_base, layout), bytes + i*6);
+    }
+    pack_columns_scalar(columns, i, n, abs_time_base, layout, 6, bytes);
+}
+
+XE_TARGET_AVX2 void unpack_columns_avx2(const std::uint8_t *bytes, std::size_t n, timestamp_t abs_time_base, const CDLayout &layout, const CDEventColumns &columns) {
+    const __m256i base = _mm256_set1_epi64x(static_cast<long long>(abs_time_base));
+    std::size_t i = 0;
+    for(; i+4 <= n; i+=4) {
+        const __m256i e = load_records_avx2(bytes + i*6);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(columns.timestamp + i), _mm256_add_epi64(field_avx2(e, layout.ts_shift, layout.ts_mask), base));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(columns.polarity + i), narrow_avx2(field_avx2(e, layout.polarity_shift, layout.polarity_mask)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(columns.x + i), narrow_avx2(field_avx2(e, layout.x_shift, layout.x_mask)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(columns.y + i), narrow_avx2(field_avx2(e, layout.y_shift, layout.y_mask)));
+    }
+    unpack_columns_scalar(bytes, i, n, abs_time_base, layout, 6, columns);
+}
+
+#endif // XE_KERNELS_X86
+
+/// @brief  Kernels of one instruction set for 48-bit records.
+struct KernelTable {
+    KernelISA isa;
+    void (*pack_records)(const encoded_event_t*, std::size_t, std::uint8_t*);
+    void (*unpack_records)(const std::uint8_t*, std::size_t, encoded_event_t*);
+    void (*pack_cd)(const CDEvent*, std::size_t, timestamp_t, const CDLayout&, std::uint8_t*);
+    void (*unpack_cd)(const std::uint8_t*, std::size_t, timestamp_t, const CDLayout&, CDEvent*);
+    void (*pack_columns)(const CDEventColumns&, std::size_t, timestamp_t, const CDLayout&, std::uint8_t*);
+    void (*unpack_columns)(const std::uint8_t*, std::size_t, timestamp_t, const CDLayout&, const CDEventColumns&);
+};
+
+const KernelTable scalar_kernels = {KernelISA::Scalar, pack_records_48_scalar, unpack_records_48_scalar, pack_cd_48_scalar,
+                                    unpack_cd_48_scalar, pack_columns_48_scalar, unpack_columns_48_scalar};
+#ifdef XE_KERNELS_X86
+const KernelTable sse41_kernels = {KernelISA::SSE41, pack_records_sse41, unpack_records_sse41, pack_cd_sse41,
+                                   unpack_cd_sse41, pack_columns_sse41, unpack_columns_sse41};
+const KernelTable avx2_kernels = {KernelISA::AVX2, pack_records_avx2, unpack_records_avx2, pack_cd_avx2,
+                                  unpack_cd_avx2, pack_columns_avx2, unpack_columns_avx2};
+#endif
+
+const KernelTable *kernel_table(KernelISA isa) {
+    switch(isa) {
+#ifdef XE_KERNELS_X86
+        case KernelISA::AVX2:
+            return &avx2_kernels;
+        case KernelISA::SSE41:
+            return &sse41_kernels;
+#endif
+        default:
+            return &scalar_kernels;
+    }
+}
+
+std::atomic<const KernelTable*> &active_kernels() {
+    static std::atomic<const KernelTable*> active{kernel_table(detect_kernel_isa())};
+    return active;
+}
+
+inline const KernelTable &kernels() {
+    return *active_kernels().load(std::memory_order_relaxed);
+}
+
+} // namespace
+
+KernelISA detect_kernel_isa() {
+#ifdef XE_KERNELS_X86
+    if(__builtin_cpu_supports("avx2")) {
+        return KernelISA::AVX2;
+    }
+    if(__builtin_cpu_supports("sse4.1")) {
+        return KernelISA::SSE41;
+    }
+#endif
+    return KernelISA::Scalar;
+}
+
+KernelISA kernel_isa() {
+    return kernels().isa;
+}
+
+bool set_kernel_isa(KernelISA isa) {
+    if(static_cast<std::uint8_t>(isa) > static_cast<std::uint8_t>(detect_kernel_isa())) {
+        return false;
+    }
+    active_kernels().store(kernel_table(isa), std::memory_order_relaxed);
+    return kernel_isa() == isa;
+}
+
+const char *kernel_isa_name(KernelISA isa) {
+    switch(isa) {
+        case KernelISA::SSE41:
+            return "sse4.1";
+        case KernelISA::AVX2:
+            return "avx2";
+        default:
+            return "scalar";
+    }
+}
+
+namespace Encoder {
+
+void pack_encoded_events(const encoded_event_t *encoded_events, std::size_t n_events, const FieldsDefinition &fdef, std::uint8_t *bytes) {
+    assert(fdef.event_size <= 64);  // implementation only supports up to 64 bits events
+    if(fdef.event_size_bytes == 6) {
+        kernels().pack_records(encoded_events, n_events, bytes);
+    } else {
+        pack_records_scalar(encoded_events, n_events, fdef.event_size_bytes, bytes);
+    }
+}
+
+void pack_cd_events(const CDEvent *events, std::size_t n_events, timestamp_t abs_time_base, const FieldsDefinition &fdef, std::uint8_t *bytes) {
+    const CDLayout layout = make_cd_layout(fdef);
+    if(fdef.event_size_bytes == 6) {
+        kernels().pack_cd(events, n_events, abs_time_base, layout, bytes);
+    } else {
+        pack_cd_scalar(events, n_events, abs_time_base, layout, fdef.event_size_bytes, bytes);
+    }
+}
+
+void pack_cd_columns(const CDEventColumns &columns, std::size_t n_events, timestamp_t abs_time_base, const FieldsDefinition &fdef, std::uint8_t *bytes) {
+    const CDLayout layout = make_cd_layout(fdef);
+    if(fdef.event_size_bytes == 6) {
+        kernels().pack_columns(columns, n_events, abs_time_base, layout, bytes);
+    } else {
+        pack_columns_scalar(columns, 0, n_events, abs_time_base, layout, fdef.event_size_bytes, bytes);
+    }
+}
+
+} // namespace Encoder
+
+namespace Decoder {
+
+void unpack_encoded_events(const std::uint8_t *bytes, std::size_t n_events, const FieldsDefinition &fdef, encoded_event_t *encoded_events) {
+    assert(fdef.event_size <= 64);  // implementation only supports up to 64 bits events
+    if(fdef.event_size_bytes == 6) {
+        kernels().unpack_records(bytes, n_events, encoded_events);
+    } else {
+        unpack_records_scalar(bytes, n_events, fdef.event_size_bytes, encoded_events);
+    }
+}
+
+void unpack_cd_events(const std::uint8_t *bytes, std::size_t n_events, timestamp_t abs_time_base, const FieldsDefinition &fdef, CDEvent *events) {
+    const CDLayout layout = make_cd_layout(fdef);
+    if(fdef.event_size_bytes == 6) {
+        kernels().unpack_cd(bytes, n_events, abs_time_base, layout, events);
+    } else {
+        unpack_cd_scalar(bytes, n_events, abs_time_base, layout, fdef.event_size_bytes, events);
+    }
+}
+
+void unpack_cd_columns(const std::uint8_t *bytes, std::size_t n_events, timestamp_t abs_time_base, const FieldsDefinition &fdef, const CDEventColumns &columns) {
+    const CDLayout layout = make_cd_layout(fdef);
+    if(fdef.event_size_bytes == 6) {
+        kernels().unpack_columns(bytes, n_events, abs_time_base, layout, columns);
+    } else {
+        unpack_columns_scalar(bytes, 0, n_events, abs_time_base, layout, fdef.event_size_bytes, columns);
+    }
+}
+
+} // namespace Decoder
+
+} // namespace XEFormat
@@ -0,0 +1,93 @@
+/**********************************************************************************************************************
+ * MIT License                                                                                                        *
+ *                                                                                                                    *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and                  *
+ * associated documentation files (the “Software”), to deal in the Software without restriction,                      *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,              *
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,              *
+ * subject to the following conditions:                                                                               *
+ *                                                                                                                    *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial               *
+ * portions of the Software.                                                                                          *
+ *                                                                                                                    *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,                                *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND               *
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES               *
+ * OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN                *
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ **********************************************************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "xe_format.h"
+
+namespace XEFormat {
+
+// Bulk conversions between events and packed big-endian records. Encoder::pack_encoded_events and
+// Decoder::unpack_encoded_events (declared in xe_format.h) are implemented here as well.
+
+/// @brief  Instruction sets of the bulk event kernels, selected once at runtime from the CPU features.
+enum class KernelISA : uint8_t {
+    Scalar = 0x00, // Portable code, used for layouts other than 48-bit events and on non x86 CPUs.
+    SSE41  = 0x01, // Two events per 128-bit register.
+    AVX2   = 0x02, // Four events per 256-bit register.
+};
+
+/// @brief  Destination/source of the column (structure-of-arrays) kernels: one array per CD event field.
+struct CDEventColumns {
+    timestamp_t *timestamp;
+    unsigned int *polarity;
+    unsigned int *x;
+    unsigned int *y;
+};
+
+/// @brief  Returns the best instruction set supported by the running CPU.
+KernelISA detect_kernel_isa();
+
+/// @brief  Returns the instruction set currently used by the bulk kernels (detect_kernel_isa() by default).
+KernelISA kernel_isa();
+
+/// @brief  Forces the instruction set used by the bulk kernels, e.g. to compare them in a benchmark.
+///         Not meant to be changed while other threads are running kernels.
+/// @param isa instruction set to use.
+/// @return true if the running CPU supports it, false otherwise (the selection is then left unchanged).
+bool set_kernel_isa(KernelISA isa);
+
+/// @brief  Returns a printable name of an instruction set ("scalar", "sse4.1" or "avx2").
+const char *kernel_isa_name(KernelISA isa);
+
+namespace Encoder {
+
+/// @brief  Encodes CD events straight into packed big-endian records, fusing encode_event_cd and the byte swap.
+///         Same preconditions as encode_event_cd for every event.
+/// @param events input array of n_events CD events.
+/// @param n_events number of events.
+/// @param abs_time_base absolute time base of all the events.
+/// @param fdef fields definition.
+/// @param bytes output buffer with room for n_events*fdef.event_size_bytes bytes.
+void pack_cd_events(const CDEvent *events, std::size_t n_events, timestamp_t abs_time_base, const FieldsDefinition &fdef, std::uint8_t *bytes);
+
+/// @brief  Same as pack_cd_events, reading the fields from one array per field.
+void pack_cd_columns(const CDEventColumns &columns, std::size_t n_events, timestamp_t abs_time_base, const FieldsDefinition &fdef, std::uint8_t *bytes);
+
+} // namespace Encoder
+
+namespace Decoder {
+
+/// @brief  Decodes packed big-endian records straight into CD events, fusing the byte swap and decode_event_cd.
+///         All the records must hold CD events; their type field is not checked.
+/// @param bytes input buffer holding n_events*fdef.event_size_bytes bytes.
+/// @param n_events number of events.
+/// @param abs_time_base absolute time base of all the events.
+/// @param fdef fields definition.
+/// @param events output array with room for n_events CD events.
+void unpack_cd_events(const std::uint8_t *bytes, std::size_t n_events, timestamp_t abs_time_base, const FieldsDefinition &fdef, CDEvent *events);
+
+/// @brief  Same as unpack_cd_events, writing the fields to one array per field.
+void unpack_cd_columns(const std::uint8_t *bytes, std::size_t n_events, timestamp_t abs_time_base, const FieldsDefinition &fdef, const CDEventColumns &columns);
+
+} // namespace Decoder
+
+} // namespace XEFormat
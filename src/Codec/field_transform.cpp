@@ -0,0 +1,221 @@
+/**********************************************************************************************************************
+ * MIT License                                                                                                        *
+ *                                                                                                                    *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and                  *
+ * associated documentation files (the “Software”), to deal in the Software without restriction,                      *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,              *
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,              *
+ * subject to the following conditions:                                                                               *
+ *                                                                                                                    *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial               *
+ * portions of the Software.                                                                                          *
+ *                                                                                                                    *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,                                *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND               *
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES               *
+ * OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN                *
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ **********************************************************************************************************************/
+
+#include <algorithm>
+#include <stdexcept>
+#include "field_transform.h"
+#include "xe_layout.h"
+
+namespace XEFormat {
+
+namespace {
+
+constexpr std::uint64_t mask_bits(unsigned bits) {
+    return bits >= 64 ? ~std::uint64_t(0) : (std::uint64_t(1) << bits) - 1;
+}
+
+std::uint64_t zigzag(std::int64_t value) {
+    return (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63);
+}
+
+std::int64_t unzigzag(std::uint64_t value) {
+    return static_cast<std::int64_t>(value >> 1) ^ -static_cast<std::int64_t>(value & 1);
+}
+
+/// @brief  Signed difference of two values of a bits-wide field, wrapped to the field width.
+std::int64_t wrapped_delta(std::uint64_t value, std::uint64_t previous, unsigned bits) {
+    const std::uint64_t delta = (value - previous) & mask_bits(bits);
+    return delta >= (std::uint64_t(1) << (bits - 1)) ? static_cast<std::int64_t>(delta) - static_cast<std::int64_t>(std::uint64_t(1) << bits) : static_cast<std::int64_t>(delta);
+}
+
+void put_varint(std::uint64_t value, std::vector<std::uint8_t> &stream) {
+    while(value >= 0x80) {
+        stream.push_back(static_cast<std::uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    stream.push_back(static_cast<std::uint8_t>(value));
+}
+
+template <typename Layout>
+void split_fields(const Layout &layout, const std::uint8_t *event_bytes, std::size_t n_events, std::vector<std::vector<std::uint8_t>> &streams) {
+    const FieldsDefinition &fdef = layout.fields();
+    const std::size_t ev_bytes = layout.event_size_bytes();
+    std::uint64_t prev_rel = 0, prev_x = 0, prev_y = 0, prev_abs = 0;
+    for(std::size_t i=0; i<n_events; ++i) {
+        const std::uint8_t *raw = event_bytes + i*ev_bytes;
+        const encoded_event_t encoded_event = layout.load_record(raw);
+        const std::uint64_t type = layout.type_bits(encoded_event);
+        if(type == EventType::CD) {
+            const CDEvent ev = layout.decode_event_cd(encoded_event, 0);
+            if(layout.encode_event_cd(ev, 0) != encoded_event) {
+                // bits not covered by the CD fields of this layout: keep the event raw
+                streams[TypeStream].push_back(event_type_escape);
+                streams[RawStream].insert(streams[RawStream].end(), raw, raw + ev_bytes);
+                continue;
+            }
+            streams[TypeStream].push_back(EventType::CD);
+            put_varint((ev.timestamp - prev_rel) & mask_bits(fdef.cd_ev.relativetimestamp), streams[TimeStream]);
+            streams[PolarityStream].push_back(static_cast<std::uint8_t>(ev.polarity));
+            put_varint(zigzag(wrapped_delta(ev.x, prev_x, fdef.cd_ev.x)), streams[XStream]);
+            put_varint(zigzag(wrapped_delta(ev.y, prev_y, fdef.cd_ev.y)), streams[YStream]);
+            prev_rel = ev.timestamp;
+            prev_x = ev.x;
+            prev_y = ev.y;
+            continue;
+        }
+        if(type == EventType::Trigger) {
+            const TriggerEvent ev = layout.decode_event_trigger(encoded_event, 0);
+            // the padding bits are dropped by the decoder: events with non-zero padding are stored raw
+            if(layout.encode_event_trigger(ev, 0) == encoded_event) {
+                streams[TypeStream].push_back(EventType::Trigger);
+                put_varint((ev.timestamp - prev_rel) & mask_bits(fdef.tr_ev.relativetimestamp), streams[TimeStream]);
+                streams[PolarityStream].push_back(static_cast<std::uint8_t>(ev.polarity));
+                put_varint(ev.triggerid, streams[TriggerStream]);
+                prev_rel = ev.timestamp;
+                continue;
+            }
+        } else if(type == EventType::ABSTimeStamp) {
+            const timestamp_t abs_ts = layout.decode_event_timestamp(encoded_event);
+            if(layout.encode_event_absts(abs_ts) == encoded_event) {
+                streams[TypeStream].push_back(EventType::ABSTimeStamp);
+                put_varint(zigzag(static_cast<std::int64_t>(abs_ts - prev_abs)), streams[AbsTimeStream]);
+                prev_abs = abs_ts;
+                continue;
+            }
+        }
+        streams[TypeStream].push_back(event_type_escape);
+        streams[RawStream].insert(streams[RawStream].end(), raw, raw + ev_bytes);
+    }
+}
+
+template <typename Layout>
+void merge_fields(const Layout &layout, std::vector<StreamReader> &streams, std::size_t n_events, std::uint8_t *event_bytes) {
+    const FieldsDefinition &fdef = layout.fields();
+    const std::size_t ev_bytes = layout.event_size_bytes();
+    std::uint64_t prev_rel = 0, prev_x = 0, prev_y = 0, prev_abs = 0;
+    for(std::size_t i=0; i<n_events; ++i) {
+        std::uint8_t *raw = event_bytes + i*ev_bytes;
+        encoded_event_t encoded_event;
+        switch(streams[TypeStream].byte()) {
+            case EventType::CD: {
+                CDEvent ev;
+                ev.timestamp = (prev_rel + streams[TimeStream].varint()) & mask_bits(fdef.cd_ev.relativetimestamp);
+                ev.polarity = streams[PolarityStream].byte() & mask_bits(fdef.cd_ev.polarity);
+                ev.x = static_cast<unsigned int>((prev_x + unzigzag(streams[XStream].varint())) & mask_bits(fdef.cd_ev.x));
+                ev.y = static_cast<unsigned int>((prev_y + unzigzag(streams[YStream].varint())) & mask_bits(fdef.cd_ev.y));
+                encoded_event = layout.encode_event_cd(ev, 0);
+                prev_rel = ev.timestamp;
+                prev_x = ev.x;
+                prev_y = ev.y;
+                break;
+            }
+            case EventType::Trigger: {
+                TriggerEvent ev;
+                ev.timestamp = (prev_rel + streams[TimeStream].varint()) & mask_bits(fdef.tr_ev.relativetimestamp);
+                ev.polarity = streams[PolarityStream].byte() & mask_bits(fdef.tr_ev.polarity);
+                ev.triggerid = static_cast<unsigned int>(streams[TriggerStream].varint() & mask_bits(fdef.tr_ev.triggerid));
+                ev.padding = 0;
+                encoded_event = layout.encode_event_trigger(ev, 0);
+                prev_rel = ev.timestamp;
+                break;
+            }
+            case EventType::ABSTimeStamp: {
+                const timestamp_t abs_ts = (prev_abs + static_cast<std::uint64_t>(unzigzag(streams[AbsTimeStream].varint()))) & mask_bits(fdef.absts.abstimestamp);
+                encoded_event = layout.encode_event_absts(abs_ts);
+                prev_abs = abs_ts;
+                break;
+            }
+            case event_type_escape: {
+                const std::uint8_t *src = streams[RawStream].bytes(ev_bytes);
+                std::copy(src, src + ev_bytes, raw);
+                continue;
+            }
+            default:
+                throw std::runtime_error("Corrupted event type stream.");
+        }
+        layout.store_record(encoded_event, raw);
+    }
+}
+
+} // namespace
+
+std::uint8_t StreamReader::byte() {
+    if(pos_ >= size_) {
+        throw std::runtime_error("Unexpected end of transformed stream.");
+    }
+    return data_[pos_++];
+}
+
+std::uint64_t StreamReader::varint() {
+    std::uint64_t value = 0;
+    for(unsigned shift=0; shift<64; shift+=7) {
+        const std::uint8_t b = byte();
+        value |= static_cast<std::uint64_t>(b & 0x7F) << shift;
+        if(!(b & 0x80)) {
+            return value;
+        }
+    }
+    throw std::runtime_error("Corrupted varint in transformed stream.");
+}
+
+const std::uint8_t *StreamReader::bytes(std::size_t n) {
+    if(n > size_ - pos_) {
+        throw std::runtime_error("Unexpected end of transformed stream.");
+    }
+    const std::uint8_t *p = data_ + pos_;
+    pos_ += n;
+    return p;
+}
+
+std::size_t transform_num_streams(EventTransform transform, const FieldsDefinition &fdef) {
+    switch(transform) {
+        case EventTransform::Raw:
+            return fdef.event_size_bytes;
+        case EventTransform::Fields:
+            return NumFieldStreams;
+        default:
+            throw std::runtime_error("Event transform not supported!");
+    }
+}
+
+void split_block(EventTransform transform, const std::uint8_t *event_bytes, std::size_t n_events, const FieldsDefinition &fdef, std::vector<std::vector<std::uint8_t>> &streams) {
+    if(transform == EventTransform::Fields) {
+        with_layout(fdef, [&](const auto &layout) { split_fields(layout, event_bytes, n_events, streams); });
+        return;
+    }
+    for(std::size_t i=0; i<n_events; ++i) {
+        for(std::size_t b=0; b<fdef.event_size_bytes; ++b) {
+            streams[b].push_back(*event_bytes++);
+        }
+    }
+}
+
+void merge_block(EventTransform transform, std::vector<StreamReader> &streams, std::size_t n_events, const FieldsDefinition &fdef, std::uint8_t *event_bytes) {
+    if(transform == EventTransform::Fields) {
+        with_layout(fdef, [&](const auto &layout) { merge_fields(layout, streams, n_events, event_bytes); });
+        return;
+    }
+    for(std::size_t i=0; i<n_events; ++i) {
+        for(std::size_t b=0; b<fdef.event_size_bytes; ++b) {
+            *event_bytes++ = streams[b].byte();
+        }
+    }
+}
+
+} // namespace XEFormat
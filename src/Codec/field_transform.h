@@ -0,0 +1,88 @@
+/**********************************************************************************************************************
+ * MIT License                                                                                                        *
+ *                                                                                                                    *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and                  *
+ * associated documentation files (the “Software”), to deal in the Software without restriction,                      *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,              *
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,              *
+ * subject to the following conditions:                                                                               *
+ *                                                                                                                    *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial               *
+ * portions of the Software.                                                                                          *
+ *                                                                                                                    *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,                                *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND               *
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES               *
+ * OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN                *
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ **********************************************************************************************************************/
+
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include "xe_format.h"
+
+namespace XEFormat {
+
+/// @brief  Transforms applied to the events of a block before entropy coding. Each transform splits the block into
+///         a fixed number of byte streams, and every stream is then coded with its own model.
+enum class EventTransform : std::uint8_t {
+    Raw     = 0x00, // One stream per byte position of the packed events.
+    Fields  = 0x01, // One stream per event field (see FieldStream), with delta coded timestamps and coordinates.
+};
+
+/// @brief  Streams produced by EventTransform::Fields.
+enum FieldStream : std::size_t {
+    TypeStream      = 0, // event type, one byte per event (event_type_escape for events stored raw)
+    TimeStream      = 1, // relative timestamp delta to the previous CD/trigger event of the block, varint
+    PolarityStream  = 2, // polarity of CD and trigger events, one byte per event
+    XStream         = 3, // x delta to the previous CD event of the block, zigzag varint
+    YStream         = 4, // y delta to the previous CD event of the block, zigzag varint
+    TriggerStream   = 5, // trigger ID, varint
+    AbsTimeStream   = 6, // absolute timestamp delta to the previous ABSTimeStamp event of the block, zigzag varint
+    RawStream       = 7, // packed bytes of the events that cannot be represented by their fields
+    NumFieldStreams = 8,
+};
+
+/// @brief  Type stream value marking an event copied verbatim to RawStream (unknown type or non-zero padding).
+constexpr std::uint8_t event_type_escape = 0xFF;
+
+/// @brief  Bounds-checked reader over one decoded stream. Throws std::runtime_error when reading past its end.
+class StreamReader {
+public:
+    StreamReader() = default;
+    StreamReader(const std::uint8_t *data, std::size_t size) : data_(data), size_(size) {}
+
+    std::uint8_t byte();
+    std::uint64_t varint();
+    const std::uint8_t *bytes(std::size_t n);
+
+private:
+    const std::uint8_t *data_ = nullptr;
+    std::size_t size_ = 0;
+    std::size_t pos_ = 0;
+};
+
+/// @brief  Number of streams produced by a transform.
+std::size_t transform_num_streams(EventTransform transform, const FieldsDefinition &fdef);
+
+/// @brief  Splits the packed events of a block into the streams of a transform. Blocks are transformed
+///         independently: every delta restarts at the beginning of the block.
+/// @param transform transform to apply.
+/// @param event_bytes packed events of the block.
+/// @param n_events number of events in the block.
+/// @param fdef fields definition.
+/// @param streams output streams (transform_num_streams entries), the block is appended to them.
+void split_block(EventTransform transform, const std::uint8_t *event_bytes, std::size_t n_events, const FieldsDefinition &fdef, std::vector<std::vector<std::uint8_t>> &streams);
+
+/// @brief  Rebuilds the packed events of a block from its streams, the inverse of split_block.
+/// @param transform transform applied to the block.
+/// @param streams readers positioned at the beginning of the block in each stream.
+/// @param n_events number of events in the block.
+/// @param fdef fields definition.
+/// @param event_bytes output buffer with room for n_events*fdef.event_size_bytes bytes.
+void merge_block(EventTransform transform, std::vector<StreamReader> &streams, std::size_t n_events, const FieldsDefinition &fdef, std::uint8_t *event_bytes);
+
+} // namespace XEFormat
@@ -0,0 +1,347 @@
+/**********************************************************************************************************************
+ * MIT License                                                                                                        *
+ *                                                                                                                    *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and                  *
+ * associated documentation files (the “Software”), to deal in the Software without restriction,                      *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,              *
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,              *
+ * subject to the following conditions:                                                                               *
+ *                                                                                                                    *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial               *
+ * portions of the Software.                                                                                          *
+ *                                                                                                                    *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,                                *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND               *
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES               *
+ * OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN                *
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ **********************************************************************************************************************/
+
+#include <queue>
+#include <algorithm>
+#include <cstring>
+#include <cassert>
+#include <stdexcept>
+#include "huffman.h"
+
+namespace XEFormat {
+
+namespace {
+
+constexpr unsigned table_bits = huffman_max_code_length;
+constexpr std::size_t num_symbols = 256;
+constexpr std::size_t num_streams = 4;
+
+/// @brief  Index of the first symbol coded in stream s when a run of n symbols is split in num_streams parts.
+std::size_t stream_begin(std::size_t n, std::size_t s) {
+    const std::size_t part = (n + num_streams - 1)/num_streams;
+    return std::min(n, s*part);
+}
+
+void write_varint(std::size_t value, std::vector<std::uint8_t> &output) {
+    while(value >= 0x80) {
+        output.push_back(static_cast<std::uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    output.push_back(static_cast<std::uint8_t>(value));
+}
+
+std::size_t read_varint(const std::uint8_t *data, std::size_t size, std::size_t &pos) {
+    std::size_t value = 0;
+    for(unsigned shift=0; shift<64; shift+=7) {
+        if(pos >= size) {
+            throw std::runtime_error("Truncated Huffman bitstream.");
+        }
+        const std::uint8_t byte = data[pos++];
+        value |= static_cast<std::size_t>(byte & 0x7F) << shift;
+        if(!(byte & 0x80)) {
+            return value;
+        }
+    }
+    throw std::runtime_error("Corrupted Huffman bitstream.");
+}
+
+/// @brief  Assigns canonical codes: shorter codes first, ties broken by symbol value.
+void assign_canonical_codes(const std::vector<std::uint8_t> &lengths, std::uint32_t *codes) {
+    unsigned bl_count[huffman_max_code_length+1] = {0};
+    for(std::size_t s=0; s<num_symbols; ++s) {
+        assert(lengths[s] >= 1 && lengths[s] <= huffman_max_code_length);
+        ++bl_count[lengths[s]];
+    }
+    std::uint32_t next_code[huffman_max_code_length+2] = {0};
+    std::uint32_t code = 0;
+    for(unsigned len=1; len<=huffman_max_code_length; ++len) {
+        code = (code + bl_count[len-1]) << 1;
+        next_code[len] = code;
+    }
+    for(std::size_t s=0; s<num_symbols; ++s) {
+        codes[s] = next_code[lengths[s]]++;
+    }
+}
+
+std::uint64_t load_be64(const std::uint8_t *p) {
+    std::uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+#if defined(__GNUC__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    v = __builtin_bswap64(v);
+#elif !defined(__GNUC__)
+    v = 0;
+    for(int i=0; i<8; ++i) {
+        v = (v << 8) | p[i];
+    }
+#endif
+    return v;
+}
+
+} // namespace
+
+std::vector<std::uint8_t> build_huffman_code_lengths(const std::vector<std::uint64_t> &counts) {
+    assert(counts.size() == num_symbols);
+    std::vector<std::uint64_t> weight(2*num_symbols);
+    std::vector<std::size_t> parent(2*num_symbols, 0);
+    using Node = std::pair<std::uint64_t, std::size_t>;
+    std::priority_queue<Node, std::vector<Node>, std::greater<Node>> queue;
+    for(std::size_t s=0; s<num_symbols; ++s) {
+        weight[s] = std::max<std::uint64_t>(counts[s], 1);
+        queue.push(Node(weight[s], s));
+    }
+    std::size_t next = num_symbols;
+    while(queue.size() > 1) {
+        const Node a = queue.top(); queue.pop();
+        const Node b = queue.top(); queue.pop();
+        weight[next] = a.first + b.first;
+        parent[a.second] = next;
+        parent[b.second] = next;
+        queue.push(Node(weight[next], next));
+        ++next;
+    }
+    const std::size_t root = next - 1;
+
+    std::vector<unsigned> lengths(num_symbols);
+    for(std::size_t s=0; s<num_symbols; ++s) {
+        unsigned len = 0;
+        for(std::size_t n=s; n!=root; n=parent[n]) {
+            ++len;
+        }
+        lengths[s] = len;
+    }
+
+    // length limiting: clamp the long codes, then lengthen the least frequent short codes until the Kraft
+    // inequality holds again, and finally shorten the most frequent codes while there is room left
+    const std::uint64_t kraft_cap = std::uint64_t(1) << huffman_max_code_length;
+    std::uint64_t kraft = 0;
+    for(unsigned &len : lengths) {
+        len = std::min(len, huffman_max_code_length);
+        kraft += std::uint64_t(1) << (huffman_max_code_length - len);
+    }
+    std::vector<std::size_t> by_count(num_symbols);
+    for(std::size_t s=0; s<num_symbols; ++s) {
+        by_count[s] = s;
+    }
+    std::sort(by_count.begin(), by_count.end(), [&weight](std::size_t a, std::size_t b) { return weight[a] < weight[b] || (weight[a] == weight[b] && a < b); });
+    while(kraft > kraft_cap) {
+        std::size_t best = num_symbols;
+        for(std::size_t s : by_count) {
+            if(lengths[s] < huffman_max_code_length && (best == num_symbols || lengths[s] > lengths[best])) {
+                best = s;
+            }
+        }
+        ++lengths[best];
+        kraft -= std::uint64_t(1) << (huffman_max_code_length - lengths[best]);
+    }
+    for(bool changed=true; changed; ) {
+        changed = false;
+        for(auto it=by_count.rbegin(); it!=by_count.rend(); ++it) {
+            const std::size_t s = *it;
+            const std::uint64_t gain = std::uint64_t(1) << (huffman_max_code_length - lengths[s]);
+            if(lengths[s] > 1 && kraft + gain <= kraft_cap) {
+                --lengths[s];
+                kraft += gain;
+                changed = true;
+            }
+        }
+    }
+
+    return std::vector<std::uint8_t>(lengths.begin(), lengths.end());
+}
+
+HuffmanEncoder::HuffmanEncoder(const std::vector<std::uint8_t> &code_lengths) {
+    assert(code_lengths.size() == num_symbols);
+    assign_canonical_codes(code_lengths, codes_);
+    std::copy(code_lengths.begin(), code_lengths.end(), lengths_);
+}
+
+void HuffmanEncoder::encode(const std::uint8_t *symbols, std::size_t n, std::vector<std::uint8_t> &output) const {
+    // the stream sizes are only known once coded: code into a scratch buffer, then write sizes and streams
+    thread_local std::vector<std::uint8_t> streams;
+    streams.clear();
+    std::size_t sizes[num_streams];
+    for(std::size_t s=0; s<num_streams; ++s) {
+        const std::size_t before = streams.size();
+        encode_stream(symbols + stream_begin(n, s), stream_begin(n, s+1) - stream_begin(n, s), streams);
+        sizes[s] = streams.size() - before;
+    }
+    for(std::size_t s=0; s<num_streams; ++s) {
+        write_varint(sizes[s], output);
+    }
+    output.insert(output.end(), streams.begin(), streams.end());
+}
+
+void HuffmanEncoder::encode_stream(const std::uint8_t *symbols, std::size_t n, std::vector<std::uint8_t> &output) const {
+    std::uint64_t acc = 0;
+    unsigned acc_bits = 0;
+    for(std::size_t i=0; i<n; ++i) {
+        const std::uint8_t s = symbols[i];
+        acc = (acc << lengths_[s]) | codes_[s];
+        acc_bits += lengths_[s];
+        if(acc_bits >= 32) {
+            for(int b=0; b<4; ++b) {
+                acc_bits -= 8;
+                output.push_back(static_cast<std::uint8_t>(acc >> acc_bits));
+            }
+        }
+    }
+    while(acc_bits >= 8) {
+        acc_bits -= 8;
+        output.push_back(static_cast<std::uint8_t>(acc >> acc_bits));
+    }
+    if(acc_bits > 0) {
+        output.push_back(static_cast<std::uint8_t>(acc << (8 - acc_bits)));
+    }
+}
+
+HuffmanDecoder::HuffmanDecoder(const std::vector<std::uint8_t> &code_lengths) : table_(std::size_t(1) << table_bits) {
+    assert(code_lengths.size() == num_symbols);
+    std::uint32_t codes[num_symbols];
+    assign_canonical_codes(code_lengths, codes);
+
+    // single symbol table: symbol and length of the code prefixing each window
+    std::vector<std::uint8_t> single_symbol(table_.size(), 0);
+    std::vector<std::uint8_t> single_length(table_.size(), 0);
+    for(std::size_t s=0; s<num_symbols; ++s) {
+        const unsigned len = code_lengths[s];
+        const std::size_t first = std::size_t(codes[s]) << (table_bits - len);
+        const std::size_t last = first + (std::size_t(1) << (table_bits - len));
+        for(std::size_t idx=first; idx<last; ++idx) {
+            single_symbol[idx] = static_cast<std::uint8_t>(s);
+            single_length[idx] = static_cast<std::uint8_t>(len);
+        }
+    }
+
+    // multi symbol table: as many complete codes as fit in each window
+    const std::size_t mask = table_.size() - 1;
+    for(std::size_t idx=0; idx<table_.size(); ++idx) {
+        Entry &e = table_[idx];
+        std::memset(&e, 0, sizeof(e));
+        unsigned consumed = 0;
+        while(e.count < 4) {
+            const std::size_t sub = (idx << consumed) & mask;
+            const unsigned len = single_length[sub];
+            if(len == 0 || consumed + len > table_bits) {
+                break;
+            }
+            e.symbols[e.count++] = single_symbol[sub];
+            consumed += len;
+            if(e.count == 1) {
+                e.first_bits = static_cast<std::uint8_t>(len);
+            }
+        }
+        e.bits = static_cast<std::uint8_t>(consumed);
+    }
+}
+
+std::size_t HuffmanDecoder::decode(const std::uint8_t *data, std::size_t size, std::uint8_t *symbols, std::size_t n) const {
+    std::size_t pos = 0;
+    std::size_t stream_sizes[num_streams];
+    std::size_t total = 0;
+    for(std::size_t s=0; s<num_streams; ++s) {
+        stream_sizes[s] = read_varint(data, size, pos);
+        total += stream_sizes[s];
+    }
+    if(total > size - pos) {
+        throw std::runtime_error("Truncated Huffman bitstream.");
+    }
+
+    // bit positions are relative to data, stream s ends at bit limit[s]
+    std::size_t bit_pos[num_streams];
+    std::size_t limit[num_streams];
+    std::uint8_t *out[num_streams];
+    std::uint8_t *out_end[num_streams];
+    for(std::size_t s=0; s<num_streams; ++s) {
+        bit_pos[s] = 8*pos;
+        pos += stream_sizes[s];
+        limit[s] = 8*pos;
+        out[s] = symbols + stream_begin(n, s);
+        out_end[s] = symbols + stream_begin(n, s+1);
+    }
+
+    const Entry *table = table_.data();
+    const std::size_t end_bytes = pos;
+
+    // fast path: the four streams advance together, each 64-bit refill gives at least 57 valid bits, enough for
+    // four lookups, and each lookup writes up to four symbols. The state is kept in locals so that the symbol
+    // stores cannot alias it.
+    static_assert(num_streams == 4, "the fast path is unrolled for four streams");
+    std::size_t p0 = bit_pos[0], p1 = bit_pos[1], p2 = bit_pos[2], p3 = bit_pos[3];
+    std::uint8_t *o0 = out[0], *o1 = out[1], *o2 = out[2], *o3 = out[3];
+    auto step = [table](std::size_t &p, std::uint8_t *&o, const std::uint8_t *src) {
+        std::uint64_t window = load_be64(src + (p >> 3)) << (p & 7);
+        for(int k=0; k<4; ++k) {
+            const Entry &e = table[window >> (64 - table_bits)];
+            std::memcpy(o, e.symbols, 4);
+            o += e.count;
+            window <<= e.bits;
+            p += e.bits;
+        }
+    };
+    auto safe_rounds = [&](std::size_t p, const std::uint8_t *o, std::size_t s) -> std::size_t {
+        // one round writes at most 16 symbols and reads at most 44 bits from a window of 64
+        const std::size_t by_output = static_cast<std::size_t>(out_end[s] - o)/16;
+        const std::size_t readable = end_bytes >= 8 ? 8*(end_bytes - 8) : 0;
+        const std::size_t by_input = p <= readable ? (readable - p)/44 + 1 : 0;
+        return std::min(by_output, by_input);
+    };
+    for(;;) {
+        const std::size_t rounds = std::min(std::min(safe_rounds(p0, o0, 0), safe_rounds(p1, o1, 1)), std::min(safe_rounds(p2, o2, 2), safe_rounds(p3, o3, 3)));
+        if(rounds == 0) {
+            break;
+        }
+        const std::size_t start = p0 + p1 + p2 + p3;
+        for(std::size_t r=0; r<rounds; ++r) {
+            step(p0, o0, data);
+            step(p1, o1, data);
+            step(p2, o2, data);
+            step(p3, o3, data);
+        }
+        if(p0 + p1 + p2 + p3 == start) {
+            throw std::runtime_error("Corrupted Huffman bitstream.");
+        }
+    }
+    bit_pos[0] = p0; bit_pos[1] = p1; bit_pos[2] = p2; bit_pos[3] = p3;
+    out[0] = o0; out[1] = o1; out[2] = o2; out[3] = o3;
+
+    // tail: one symbol at a time, reading zeros past the end of each stream
+    for(std::size_t s=0; s<num_streams; ++s) {
+        const std::size_t stream_end = limit[s] >> 3;
+        while(out[s] < out_end[s]) {
+            std::uint64_t window = 0;
+            for(std::size_t i=0; i<3; ++i) {
+                const std::size_t byte = (bit_pos[s] >> 3) + i;
+                window = (window << 8) | (byte < stream_end ? data[byte] : 0);
+            }
+            window = (window << (bit_pos[s] & 7)) >> (24 - table_bits);
+            const Entry &e = table[window & ((std::size_t(1) << table_bits) - 1)];
+            if(e.count == 0) {
+                throw std::runtime_error("Corrupted Huffman bitstream.");
+            }
+            *out[s]++ = e.symbols[0];
+            bit_pos[s] += e.first_bits;
+        }
+        if(bit_pos[s] > limit[s]) {
+            throw std::runtime_error("Truncated Huffman bitstream.");
+        }
+    }
+    return end_bytes;
+}
+
+} // namespace XEFormat
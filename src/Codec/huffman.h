@@ -0,0 +1,87 @@
+/**********************************************************************************************************************
+ * MIT License                                                                                                        *
+ *                                                                                                                    *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and                  *
+ * associated documentation files (the “Software”), to deal in the Software without restriction,                      *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,              *
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,              *
+ * subject to the following conditions:                                                                               *
+ *                                                                                                                    *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial               *
+ * portions of the Software.                                                                                          *
+ *                                                                                                                    *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,                                *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND               *
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES               *
+ * OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN                *
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ **********************************************************************************************************************/
+
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace XEFormat {
+
+/// @brief  Longest code produced for the byte alphabet, chosen so that any code resolves with one table lookup.
+constexpr unsigned huffman_max_code_length = 11;
+
+/// @brief  Computes length-limited Huffman code lengths for a 256 symbol alphabet. Every symbol gets a code, even
+///         the ones with a zero count, so the lengths can code any byte stream.
+/// @param counts number of occurrences of each byte value (256 entries).
+/// @return the code length of each byte value, between 1 and huffman_max_code_length.
+std::vector<std::uint8_t> build_huffman_code_lengths(const std::vector<std::uint64_t> &counts);
+
+/// @brief  Canonical Huffman encoder. Codes are derived from the code lengths alone, so the lengths are all that
+///         needs to be stored to rebuild the decoder.
+class HuffmanEncoder {
+public:
+    /// @param code_lengths code length of each byte value (256 entries).
+    explicit HuffmanEncoder(const std::vector<std::uint8_t> &code_lengths);
+
+    /// @brief  Encodes a run of bytes. The run is split in four equal parts coded as independent MSB-first
+    ///         bitstreams, preceded by their sizes, so that the decoder can work on the four of them at once.
+    /// @param symbols bytes to encode.
+    /// @param n number of bytes to encode.
+    /// @param output buffer to append the encoded run to.
+    void encode(const std::uint8_t *symbols, std::size_t n, std::vector<std::uint8_t> &output) const;
+
+private:
+    void encode_stream(const std::uint8_t *symbols, std::size_t n, std::vector<std::uint8_t> &output) const;
+
+    std::uint32_t codes_[256];
+    std::uint8_t lengths_[256];
+};
+
+/// @brief  Table-driven canonical Huffman decoder. Each lookup on a huffman_max_code_length bits window resolves up
+///         to four symbols, every 64-bit refill of a bit buffer feeds four lookups, and the four bitstreams of a run
+///         are decoded in the same loop so their lookups overlap.
+class HuffmanDecoder {
+public:
+    /// @param code_lengths code length of each byte value (256 entries), as given to the encoder.
+    explicit HuffmanDecoder(const std::vector<std::uint8_t> &code_lengths);
+
+    /// @brief  Decodes a run of bytes written by one call to HuffmanEncoder::encode.
+    ///         Throws std::runtime_error if the run is truncated or corrupted.
+    /// @param data encoded data, starting at the run.
+    /// @param size number of bytes available in data.
+    /// @param symbols output array with room for n symbols.
+    /// @param n number of symbols in the run.
+    /// @return the number of bytes of data used by the run.
+    std::size_t decode(const std::uint8_t *data, std::size_t size, std::uint8_t *symbols, std::size_t n) const;
+
+private:
+    struct Entry {
+        std::uint8_t symbols[4];
+        std::uint8_t count;      // number of complete symbols in the window
+        std::uint8_t bits;       // bits used by those symbols
+        std::uint8_t first_bits; // bits used by the first symbol alone
+        std::uint8_t pad;
+    };
+
+    std::vector<Entry> table_;
+};
+
+} // namespace XEFormat
@@ -0,0 +1,198 @@
+/**********************************************************************************************************************
+ * MIT License                                                                                                        *
+ *                                                                                                                    *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and                  *
+ * associated documentation files (the “Software”), to deal in the Software without restriction,                      *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,              *
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,              *
+ * subject to the following conditions:                                                                               *
+ *                                                                                                                    *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial               *
+ * portions of the Software.                                                                                          *
+ *                                                                                                                    *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,                                *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND               *
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES               *
+ * OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN                *
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ **********************************************************************************************************************/
+
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include "instrumentation.h"
+
+namespace XEFormat {
+
+namespace Metrics {
+
+namespace {
+
+const char *const counter_names[num_counters] = {
+    "bytes_read", "events_read", "cd_events_decoded", "trigger_events_decoded", "time_base_events_decoded",
+    "cd_events_encoded", "trigger_events_encoded", "time_base_updates", "blocks_written", "block_bytes_written",
+    "blocks_read", "segments_encoded", "segments_decoded",
+};
+
+const char *const stage_names[num_stages] = {
+    "header_parse", "read", "decode", "block", "write", "transform", "entropy_encode", "entropy_decode", "accumulate",
+};
+
+/// @brief  Owns the metrics of every thread that ever recorded one, and reports them when the program exits.
+class Registry {
+public:
+    ThreadMetrics &add_thread() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        threads_.push_back(std::make_unique<ThreadMetrics>());
+        return *threads_.back();
+    }
+
+    template <typename F>
+    void for_each_thread(F f) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for(const std::unique_ptr<ThreadMetrics> &metrics : threads_) {
+            f(*metrics);
+        }
+    }
+
+    ~Registry() {
+        const char *format = std::getenv("XE_METRICS");
+        if(format != nullptr && std::strcmp(format, "none") == 0) {
+            return;
+        }
+        const bool json = format != nullptr && std::strcmp(format, "json") == 0;
+        const char *path = std::getenv("XE_METRICS_FILE");
+        std::ofstream file;
+        if(path != nullptr) {
+            file.open(path);
+        }
+        std::ostream &os = file.is_open() ? static_cast<std::ostream&>(file) : std::cerr;
+        if(json) {
+            write_json(os);
+        } else {
+            write_summary(os);
+        }
+    }
+
+private:
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<ThreadMetrics>> threads_;
+};
+
+Registry &registry() {
+    static Registry instance;
+    return instance;
+}
+
+struct Totals {
+    std::uint64_t counters[num_counters] = {};
+    std::uint64_t stage_ns[num_stages] = {};
+    std::uint64_t stage_calls[num_stages] = {};
+
+    void add(const ThreadMetrics &metrics) {
+        for(std::size_t i=0; i<num_counters; ++i) {
+            counters[i] += metrics.counters[i].load(std::memory_order_relaxed);
+        }
+        for(std::size_t i=0; i<num_stages; ++i) {
+            stage_ns[i] += metrics.stage_ns[i].load(std::memory_order_relaxed);
+            stage_calls[i] += metrics.stage_calls[i].load(std::memory_order_relaxed);
+        }
+    }
+};
+
+/// @brief  Snapshot of every thread, followed by their sum.
+std::vector<Totals> snapshot() {
+    std::vector<Totals> threads;
+    registry().for_each_thread([&](const ThreadMetrics &metrics) {
+        threads.emplace_back();
+        threads.back().add(metrics);
+    });
+    Totals total;
+    for(const Totals &thread : threads) {
+        for(std::size_t i=0; i<num_counters; ++i) {
+            total.counters[i] += thread.counters[i];
+        }
+        for(std::size_t i=0; i<num_stages; ++i) {
+            total.stage_ns[i] += thread.stage_ns[i];
+            total.stage_calls[i] += thread.stage_calls[i];
+        }
+    }
+    threads.push_back(total);
+    return threads;
+}
+
+void write_totals_json(std::ostream &os, const Totals &totals) {
+    os << "{\"counters\": {";
+    for(std::size_t i=0; i<num_counters; ++i) {
+        os << (i ? ", " : "") << '"' << counter_names[i] << "\": " << totals.counters[i];
+    }
+    os << "}, \"stages\": {";
+    for(std::size_t i=0; i<num_stages; ++i) {
+        os << (i ? ", " : "") << '"' << stage_names[i] << "\": {\"seconds\": " << totals.stage_ns[i]/1e9 << ", \"calls\": " << totals.stage_calls[i] << "}";
+    }
+    os << "}}";
+}
+
+} // namespace
+
+ThreadMetrics &register_thread() {
+    return registry().add_thread();
+}
+
+const char *counter_name(Counter counter) {
+    return counter_names[static_cast<std::size_t>(counter)];
+}
+
+const char *stage_name(Stage stage) {
+    return stage_names[static_cast<std::size_t>(stage)];
+}
+
+void write_summary(std::ostream &os) {
+    const std::vector<Totals> threads = snapshot();
+    const Totals &total = threads.back();
+    const std::size_t num_threads = threads.size() - 1;
+    os << "---- metrics (" << num_threads << " threads) ----\n";
+    for(std::size_t i=0; i<num_counters; ++i) {
+        if(total.counters[i] == 0) {
+            continue;
+        }
+        os << std::left << std::setw(26) << counter_names[i] << std::right << std::setw(16) << total.counters[i] << "\n";
+    }
+    for(std::size_t i=0; i<num_stages; ++i) {
+        if(total.stage_calls[i] == 0) {
+            continue;
+        }
+        os << std::left << std::setw(26) << stage_names[i] << std::right << std::setw(13) << std::fixed << std::setprecision(3)
+           << total.stage_ns[i]/1e6 << " ms" << std::setw(12) << total.stage_calls[i] << " calls";
+        // wall time of the stage on each thread that ran it
+        for(std::size_t t=0; t<num_threads; ++t) {
+            if(threads[t].stage_calls[i] > 0) {
+                os << "  [thread " << t << ": " << threads[t].stage_ns[i]/1e6 << " ms]";
+            }
+        }
+        os << "\n";
+    }
+    os.unsetf(std::ios::floatfield);
+}
+
+void write_json(std::ostream &os) {
+    const std::vector<Totals> threads = snapshot();
+    os << "{\"total\": ";
+    write_totals_json(os, threads.back());
+    os << ", \"threads\": [";
+    for(std::size_t t=0; t+1<threads.size(); ++t) {
+        os << (t ? ", " : "");
+        write_totals_json(os, threads[t]);
+    }
+    os << "]}\n";
+}
+
+} // namespace Metrics
+
+} // namespace XEFormat
@@ -0,0 +1,140 @@
+/**********************************************************************************************************************
+ * MIT License                                                                                                        *
+ *                                                                                                                    *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and                  *
+ * associated documentation files (the “Software”), to deal in the Software without restriction,                      *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,              *
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,              *
+ * subject to the following conditions:                                                                               *
+ *                                                                                                                    *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial               *
+ * portions of the Software.                                                                                          *
+ *                                                                                                                    *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,                                *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND               *
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES               *
+ * OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN                *
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ **********************************************************************************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <ostream>
+#include <cstddef>
+#include <cstdint>
+
+// Hot-path instrumentation. Build with -DXE_INSTRUMENTATION (and instrumentation.cpp) to enable it; otherwise the
+// XE_METRICS_* macros expand to nothing and their arguments are not evaluated.
+//
+// Each thread updates its own counters and stage timers, registered on first use, so the hot path never shares a
+// cache line or takes a lock. Counters are added per call (a chunk, a block, a segment) wherever possible rather
+// than per event. At exit, the totals and the per-thread values are written to stderr: a text summary by default,
+// JSON with XE_METRICS=json, nothing with XE_METRICS=none. XE_METRICS_FILE=path writes them to a file instead.
+
+namespace XEFormat {
+
+namespace Metrics {
+
+enum class Counter : std::uint8_t {
+    BytesRead,              // bytes read from .xe streams by Decoder::read_encoded_events
+    EventsRead,             // events read from .xe streams
+    // events decoded by Decoder::decode_events, or counted per block by the callers of the per-event functions;
+    // the time bases read from block headers or while scanning events (indexing, windows) are not counted
+    CDEventsDecoded,
+    TriggerEventsDecoded,
+    TimeBaseEventsDecoded,  // absolute time base events
+    CDEventsEncoded,
+    TriggerEventsEncoded,
+    TimeBaseUpdates,        // absolute time base events emitted by the encoder
+    BlocksWritten,
+    BlockBytesWritten,      // .bxe bytes written by BlockXEWriter, headers included
+    BlocksRead,             // .bxe blocks visited by BlockXEFile iterators
+    SegmentsEncoded,
+    SegmentsDecoded,
+    Count
+};
+
+enum class Stage : std::uint8_t {
+    HeaderParse,            // JPEG_XE canonical header validation
+    Read,                   // reading events from the input
+    Decode,                 // decoding events into batches
+    Block,                  // splitting events into blocks
+    Write,                  // writing blocks
+    Transform,              // splitting events into field streams and merging them back
+    EntropyEncode,
+    EntropyDecode,
+    Accumulate,             // accumulating events into frames, surfaces and histograms
+    Count
+};
+
+constexpr std::size_t num_counters = static_cast<std::size_t>(Counter::Count);
+constexpr std::size_t num_stages = static_cast<std::size_t>(Stage::Count);
+
+/// @brief  Metrics of one thread. Only the owning thread writes them, other threads only read them for a report.
+struct ThreadMetrics {
+    std::atomic<std::uint64_t> counters[num_counters] = {};
+    std::atomic<std::uint64_t> stage_ns[num_stages] = {};
+    std::atomic<std::uint64_t> stage_calls[num_stages] = {};
+};
+
+/// @brief  Registers the calling thread. The metrics are kept, and reported, after the thread exits.
+ThreadMetrics &register_thread();
+
+inline thread_local ThreadMetrics *thread_metrics = nullptr;
+
+inline ThreadMetrics &local() {
+    if(thread_metrics == nullptr) {
+        thread_metrics = &register_thread();
+    }
+    return *thread_metrics;
+}
+
+/// @brief  Adds to a value owned by this thread; a plain load and store, no atomic read-modify-write.
+inline void bump(std::atomic<std::uint64_t> &value, std::uint64_t n) {
+    value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+inline void add(Counter counter, std::uint64_t n) {
+    bump(local().counters[static_cast<std::size_t>(counter)], n);
+}
+
+/// @brief  Adds the lifetime of the object to a stage of the calling thread.
+class ScopedTimer {
+public:
+    explicit ScopedTimer(Stage stage) : stage_(static_cast<std::size_t>(stage)), start_(std::chrono::steady_clock::now()) {}
+    ~ScopedTimer() {
+        const std::chrono::steady_clock::duration elapsed = std::chrono::steady_clock::now() - start_;
+        ThreadMetrics &metrics = local();
+        bump(metrics.stage_ns[stage_], static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+        bump(metrics.stage_calls[stage_], 1);
+    }
+    ScopedTimer(const ScopedTimer &) = delete;
+    ScopedTimer &operator=(const ScopedTimer &) = delete;
+
+private:
+    std::size_t stage_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+const char *counter_name(Counter counter);
+const char *stage_name(Stage stage);
+
+/// @brief  Writes the totals and the per-thread metrics as a table.
+void write_summary(std::ostream &os);
+
+/// @brief  Writes the totals and the per-thread metrics as JSON.
+void write_json(std::ostream &os);
+
+} // namespace Metrics
+
+} // namespace XEFormat
+
+#ifdef XE_INSTRUMENTATION
+#define XE_METRICS_ADD(counter, n) ::XEFormat::Metrics::add(::XEFormat::Metrics::Counter::counter, (n))
+#define XE_METRICS_TIME(stage) const ::XEFormat::Metrics::ScopedTimer xe_metrics_timer_(::XEFormat::Metrics::Stage::stage)
+#else
+#define XE_METRICS_ADD(counter, n) ((void)0)
+#define XE_METRICS_TIME(stage) ((void)0)
+#endif
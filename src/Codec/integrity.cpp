@@ -0,0 +1,125 @@
+/**********************************************************************************************************************
+ * MIT License                                                                                                        *
+ *                                                                                                                    *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and                  *
+ * associated documentation files (the “Software”), to deal in the Software without restriction,                      *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,              *
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,              *
+ * subject to the following conditions:                                                                               *
+ *                                                                                                                    *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial               *
+ * portions of the Software.                                                                                          *
+ *                                                                                                                    *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,                                *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND               *
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES               *
+ * OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN                *
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ **********************************************************************************************************************/
+
+#include <algorithm>
+#include "integrity.h"
+#include "bxe_format.h"
+#include "crc32c.h"
+#include "thread_pool.h"
+
+namespace XEFormat {
+
+namespace {
+
+/// @brief  Blocks checked per task of the thread pool.
+constexpr std::size_t blocks_per_task = 256;
+
+/// @brief  Outcome of the check of a block.
+enum class BlockStatus : std::uint8_t {
+    Intact,
+    ChecksumMismatch,
+    Truncated,
+    IndexMismatch,  // the block header does not match its index entry
+};
+
+const char *status_reason(BlockStatus status) {
+    switch(status) {
+        case BlockStatus::ChecksumMismatch:
+            return "checksum mismatch";
+        case BlockStatus::Truncated:
+            return "truncated";
+        case BlockStatus::IndexMismatch:
+            return "header does not match the index";
+        default:
+            return "intact";
+    }
+}
+
+BlockStatus check_block(const BlockXEFile &file, const BlockXEFile::Block &block, const FieldsDefinition &fdef) {
+    if(block.truncated()) {
+        return BlockStatus::Truncated;
+    }
+    return verify_block(file, block, fdef) ? BlockStatus::Intact : BlockStatus::ChecksumMismatch;
+}
+
+} // namespace
+
+bool verify_block(const BlockXEFile &file, const BlockXEFile::Block &block, const FieldsDefinition &fdef) {
+    if(block.truncated()) {
+        return false;
+    }
+    if(!block.has_checksum) {
+        return true;
+    }
+    // the checksum covers the header bytes before it, then the events
+    const std::uint8_t *header = file.mapping().data() + block.offset;
+    const std::size_t covered_header = block_header_size(file.flags(), fdef) - block_checksum_size;
+    const std::uint32_t crc = crc32c(block.event_bytes, static_cast<std::size_t>(block.num_events)*fdef.event_size_bytes, crc32c(header, covered_header));
+    return crc == block.checksum;
+}
+
+IntegrityReport verify_bxe(const BlockXEFile &file, const FieldsDefinition &fdef, unsigned num_threads) {
+    IntegrityReport report;
+    report.checksummed = file.checksummed_blocks();
+    const std::size_t header_size = block_header_size(file.flags(), fdef);
+
+    // the blocks are listed first (only their headers are read), then checked in parallel
+    // the index entries have no checksum: an entry pointing outside the blocks gives the end block, whose offset
+    // differs, and is reported at the offset of the entry
+    std::vector<BlockXEFile::Block> blocks;
+    std::vector<std::uint64_t> offsets;
+    std::vector<BlockStatus> status;
+    if(file.indexed()) {
+        blocks.reserve(file.num_indexed_blocks());
+        for(std::size_t i=0; i<file.num_indexed_blocks(); ++i) {
+            const BlockIndexEntry entry = file.index_entry(i);
+            blocks.push_back(*file.block_at(static_cast<std::size_t>(entry.offset)));
+            offsets.push_back(entry.offset);
+            status.push_back(blocks.back().offset != entry.offset || blocks.back().num_events != entry.num_events ? BlockStatus::IndexMismatch : BlockStatus::Intact);
+        }
+    } else {
+        for(const BlockXEFile::Block &block : file) {
+            blocks.push_back(block);
+            offsets.push_back(block.offset);
+        }
+        status.assign(blocks.size(), BlockStatus::Intact);
+    }
+
+    ThreadPool pool(num_threads);
+    const std::size_t num_tasks = (blocks.size() + blocks_per_task - 1)/blocks_per_task;
+    pool.parallel_for(num_tasks, [&](std::size_t task) {
+        const std::size_t end = std::min(blocks.size(), (task + 1)*blocks_per_task);
+        for(std::size_t b=task*blocks_per_task; b<end; ++b) {
+            if(status[b] == BlockStatus::Intact) {
+                status[b] = check_block(file, blocks[b], fdef);
+            }
+        }
+    });
+
+    report.num_blocks = blocks.size();
+    for(std::size_t b=0; b<blocks.size(); ++b) {
+        report.bytes_checked += header_size + blocks[b].available_events*fdef.event_size_bytes;
+        if(status[b] != BlockStatus::Intact) {
+            report.corrupted.push_back(CorruptedBlocks{offsets[b], b, 1, status_reason(status[b])});
+        }
+    }
+    return report;
+}
+
+} // namespace XEFormat
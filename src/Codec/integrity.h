@@ -0,0 +1,65 @@
+/**********************************************************************************************************************
+ * MIT License                                                                                                        *
+ *                                                                                                                    *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and                  *
+ * associated documentation files (the “Software”), to deal in the Software without restriction,                      *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,              *
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,              *
+ * subject to the following conditions:                                                                               *
+ *                                                                                                                    *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial               *
+ * portions of the Software.                                                                                          *
+ *                                                                                                                    *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,                                *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND               *
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES               *
+ * OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN                *
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ **********************************************************************************************************************/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include "xe_format.h"
+#include "mapped_file.h"
+
+namespace XEFormat {
+
+/// @brief  Blocks found corrupted by a verification: a single block of a .bxe file, or the blocks of a segment of a
+///         compressed file.
+struct CorruptedBlocks {
+    std::uint64_t offset;       // file offset of the block header or of the segment
+    std::size_t first_block;    // index of the first block in the file
+    std::size_t num_blocks;     // number of blocks
+    std::string reason;         // e.g. "checksum mismatch" or "truncated"
+};
+
+/// @brief  Result of the verification of a file.
+struct IntegrityReport {
+    bool checksummed = false;           // false if the file holds no checksums: only its structure could be checked
+    std::size_t num_blocks = 0;         // blocks checked
+    std::uint64_t bytes_checked = 0;    // bytes of the blocks (or segments) checked
+    std::vector<CorruptedBlocks> corrupted;  // in file order
+
+    bool ok() const { return corrupted.empty(); }
+};
+
+/// @brief  Checks a block of a .bxe file: it must be complete and, if the file has checksums, match its checksum.
+/// @param file .bxe file.
+/// @param block block of the file.
+/// @param fdef fields definition.
+/// @return true if the block is intact.
+bool verify_block(const BlockXEFile &file, const BlockXEFile::Block &block, const FieldsDefinition &fdef);
+
+/// @brief  Checks every block of a .bxe file on a thread pool, without decoding the events. With an indexed file the
+///         blocks are located through the index, so a corrupted block header does not hide the blocks after it.
+/// @param file .bxe file.
+/// @param fdef fields definition.
+/// @param num_threads threads checking blocks in parallel; 0 uses every hardware thread.
+/// @return the blocks checked and the corrupted ones.
+IntegrityReport verify_bxe(const BlockXEFile &file, const FieldsDefinition &fdef, unsigned num_threads = 0);
+
+} // namespace XEFormat
@@ -0,0 +1,157 @@
+/**********************************************************************************************************************
+ * MIT License                                                                                                        *
+ *                                                                                                                    *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and                  *
+ * associated documentation files (the “Software”), to deal in the Software without restriction,                      *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,              *
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,              *
+ * subject to the following conditions:                                                                               *
+ *                                                                                                                    *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial               *
+ * portions of the Software.                                                                                          *
+ *                                                                                                                    *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,                                *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND               *
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES               *
+ * OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN                *
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ **********************************************************************************************************************/
+
+#include <stdexcept>
+#include <utility>
+#include "live_encoder.h"
+
+namespace XEFormat {
+
+namespace {
+
+void put_varint(std::uint64_t value, std::vector<std::uint8_t> &output) {
+    while(value >= 0x80) {
+        output.push_back(static_cast<std::uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    output.push_back(static_cast<std::uint8_t>(value));
+}
+
+} // namespace
+
+LiveEncoder::LiveEncoder(const FieldsDefinition &fdef, const LiveEncoderOptions &options, BlockCallback callback, timestamp_t abs_time_base)
+    : fdef_(fdef), options_(options), callback_(std::move(callback)), abs_time_base_(abs_time_base), record_stream_(&buffer_),
+      models_(transform_num_streams(options.transform, fdef)) {
+    if(options_.max_block_events == 0) {
+        throw std::runtime_error("Live blocks need at least one event.");
+    }
+    // an event may be preceded by a time base event, so a block can end one record past its limit
+    const std::size_t max_block_bytes = (options_.max_block_events + 1)*fdef_.event_size_bytes;
+    records_.resize(max_block_bytes);
+    buffer_.reset(reinterpret_cast<char*>(records_.data()), records_.size());
+    // transformed streams hold at most a varint of each field per record, coded streams slightly more than their input
+    streams_.resize(models_.size());
+    for(std::vector<std::uint8_t> &stream : streams_) {
+        stream.reserve(2*max_block_bytes);
+    }
+    coded_.reserve(2*max_block_bytes + 16);
+    output_.reserve(models_.size()*(2*max_block_bytes + 32) + 16);
+}
+
+template <typename Event, typename WriteEvent>
+void LiveEncoder::push_events(const Event *events, std::size_t n_events, WriteEvent write_event) {
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    for(std::size_t i=0; i<n_events; ++i) {
+        if(buffer_.size() == 0) {
+            first_push_ = now;
+        }
+        write_event(events[i], abs_time_base_, fdef_, record_stream_);
+        if(buffer_.size() >= options_.max_block_events*fdef_.event_size_bytes) {
+            emit_block();
+        }
+    }
+    if(buffer_.size() > 0 && now - first_push_ >= options_.max_delay) {
+        emit_block();
+    }
+}
+
+void LiveEncoder::push(const CDEvent *events, std::size_t n_events) {
+    push_events(events, n_events, Encoder::write_event_cd);
+}
+
+void LiveEncoder::push(const TriggerEvent *events, std::size_t n_events) {
+    push_events(events, n_events, Encoder::write_event_trigger);
+}
+
+void LiveEncoder::poll() {
+    if(buffer_.size() > 0 && std::chrono::steady_clock::now() - first_push_ >= options_.max_delay) {
+        emit_block();
+    }
+}
+
+void LiveEncoder::flush() {
+    if(buffer_.size() > 0) {
+        emit_block();
+    }
+}
+
+void LiveEncoder::emit_block() {
+    const std::size_t n_records = buffer_.size()/fdef_.event_size_bytes;
+    for(std::vector<std::uint8_t> &stream : streams_) {
+        stream.clear();
+    }
+    split_block(options_.transform, records_.data(), n_records, fdef_, streams_);
+
+    output_.clear();
+    put_varint(n_records, output_);
+    for(const std::vector<std::uint8_t> &stream : streams_) {
+        put_varint(stream.size(), output_);
+    }
+    for(std::size_t k=0; k<streams_.size(); ++k) {
+        coded_.clear();
+        if(!streams_[k].empty()) {
+            RangeEncoder encoder(coded_);
+            for(std::uint8_t symbol : streams_[k]) {
+                encoder.encode(models_[k], symbol);
+            }
+            encoder.finish();
+        }
+        put_varint(coded_.size(), output_);
+        output_.insert(output_.end(), coded_.begin(), coded_.end());
+    }
+
+    const LiveBlock block{sequence_++, n_records, first_push_, output_.data(), output_.size()};
+    buffer_.reset(reinterpret_cast<char*>(records_.data()), records_.size());
+    callback_(block);
+}
+
+LiveDecoder::LiveDecoder(const FieldsDefinition &fdef, EventTransform transform)
+    : fdef_(fdef), transform_(transform), models_(transform_num_streams(transform, fdef)), streams_(models_.size()) {}
+
+std::size_t LiveDecoder::decode(const std::uint8_t *data, std::size_t size, std::vector<std::uint8_t> &event_bytes) {
+    StreamReader block(data, size);
+    const std::uint64_t n_records = block.varint();
+    if(n_records > (std::uint64_t(1) << 32)) {
+        throw std::runtime_error("Invalid live block.");
+    }
+    std::vector<std::size_t> stream_lengths(streams_.size());
+    for(std::size_t &length : stream_lengths) {
+        length = static_cast<std::size_t>(block.varint());
+        if(length > (n_records + 1)*16) {
+            throw std::runtime_error("Invalid live block.");
+        }
+    }
+    std::vector<StreamReader> readers(streams_.size());
+    for(std::size_t k=0; k<streams_.size(); ++k) {
+        const std::size_t coded_size = static_cast<std::size_t>(block.varint());
+        const std::uint8_t *coded = block.bytes(coded_size);
+        streams_[k].resize(stream_lengths[k]);
+        RangeDecoder decoder(coded, coded_size);
+        for(std::uint8_t &symbol : streams_[k]) {
+            symbol = static_cast<std::uint8_t>(decoder.decode(models_[k]));
+        }
+        readers[k] = StreamReader(streams_[k].data(), streams_[k].size());
+    }
+    const std::size_t offset = event_bytes.size();
+    event_bytes.resize(offset + static_cast<std::size_t>(n_records)*fdef_.event_size_bytes);
+    merge_block(transform_, readers, static_cast<std::size_t>(n_records), fdef_, event_bytes.data() + offset);
+    return static_cast<std::size_t>(n_records);
+}
+
+} // namespace XEFormat
@@ -0,0 +1,136 @@
+/**********************************************************************************************************************
+ * MIT License                                                                                                        *
+ *                                                                                                                    *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and                  *
+ * associated documentation files (the “Software”), to deal in the Software without restriction,                      *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,              *
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,              *
+ * subject to the following conditions:                                                                               *
+ *                                                                                                                    *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial               *
+ * portions of the Software.                                                                                          *
+ *                                                                                                                    *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,                                *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND               *
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES               *
+ * OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN                *
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ **********************************************************************************************************************/
+
+#pragma once
+
+#include <vector>
+#include <chrono>
+#include <ostream>
+#include <streambuf>
+#include <functional>
+#include <cstddef>
+#include <cstdint>
+#include "xe_format.h"
+#include "range_coder.h"
+#include "field_transform.h"
+
+namespace XEFormat {
+
+// A live stream is a sequence of compressed blocks delivered one by one as events arrive. Each block holds a varint
+// number of records, then like a .bxez segment the length of each transformed stream and each stream range coded.
+// The adaptive models carry over from one block to the next, so the blocks have to be decoded in order by a
+// LiveDecoder, but even a block of a few events codes with models already fitted to the sensor.
+
+struct LiveEncoderOptions {
+    std::size_t max_block_events = 1024;                // records per block (time base events included)
+    std::chrono::microseconds max_delay{2000};          // time the first event of a block may wait before a flush,
+                                                        // checked by push() and poll()
+    EventTransform transform = EventTransform::Fields;
+};
+
+/// @brief  Compressed block handed to the callback of a LiveEncoder. The bytes are only valid during the call.
+struct LiveBlock {
+    std::uint64_t sequence;                             // position of the block in the stream
+    std::size_t num_events;                             // number of records in the block
+    std::chrono::steady_clock::time_point first_push;   // time the first event of the block was pushed
+    const std::uint8_t *data;
+    std::size_t size;
+};
+
+/// @brief  Push-style encoder compressing events as they come off the sensor. Events are written with
+///         Encoder::write_event_cd/write_event_trigger into a fixed buffer, and a block is compressed and handed to
+///         the callback as soon as it is full or its first event has waited max_delay. All the buffers are sized on
+///         construction: once the models and streams have warmed up, pushing events does not allocate.
+///         The encoder has no timer of its own: the deadline is only checked by push() and poll(), on the caller's
+///         thread. To keep every block within max_delay when the sensor may go quiet, the caller must call poll()
+///         at least once per max_delay period while no events are pushed; otherwise a partial block waits for the
+///         next push or flush().
+class LiveEncoder {
+public:
+    using BlockCallback = std::function<void(const LiveBlock &)>;
+
+    /// @param fdef fields definition.
+    /// @param options block size, deadline and transform.
+    /// @param callback called with each compressed block, from the thread pushing the events.
+    /// @param abs_time_base absolute time base in effect before the first event.
+    LiveEncoder(const FieldsDefinition &fdef, const LiveEncoderOptions &options, BlockCallback callback, timestamp_t abs_time_base = 0);
+
+    LiveEncoder(const LiveEncoder &) = delete;
+    LiveEncoder &operator=(const LiveEncoder &) = delete;
+
+    /// @brief  Encodes CD events, in non-decreasing timestamp order.
+    void push(const CDEvent *events, std::size_t n_events);
+
+    /// @brief  Encodes trigger events, in non-decreasing timestamp order with the other events.
+    void push(const TriggerEvent *events, std::size_t n_events);
+
+    /// @brief  Flushes the current block if its first event has waited max_delay. Call it at least once per
+    ///         max_delay period while no events are pushed.
+    void poll();
+
+    /// @brief  Flushes the current block, if any. Call it once the last event has been pushed.
+    void flush();
+
+    std::uint64_t num_blocks() const { return sequence_; }
+
+private:
+    /// @brief  Output buffer of the record stream, over memory allocated once.
+    class RecordBuffer : public std::streambuf {
+    public:
+        void reset(char *begin, std::size_t size) { setp(begin, begin + size); }
+        std::size_t size() const { return static_cast<std::size_t>(pptr() - pbase()); }
+    };
+
+    template <typename Event, typename WriteEvent>
+    void push_events(const Event *events, std::size_t n_events, WriteEvent write_event);
+    void emit_block();
+
+    FieldsDefinition fdef_;
+    LiveEncoderOptions options_;
+    BlockCallback callback_;
+    timestamp_t abs_time_base_;
+    std::vector<std::uint8_t> records_;
+    RecordBuffer buffer_;
+    std::ostream record_stream_;
+    std::chrono::steady_clock::time_point first_push_;
+    std::vector<std::vector<std::uint8_t>> streams_;
+    std::vector<AdaptiveFrequencyModel> models_;
+    std::vector<std::uint8_t> coded_;
+    std::vector<std::uint8_t> output_;
+    std::uint64_t sequence_ = 0;
+};
+
+/// @brief  Decoder of the blocks of a LiveEncoder, fed in the order they were produced.
+class LiveDecoder {
+public:
+    LiveDecoder(const FieldsDefinition &fdef, EventTransform transform = EventTransform::Fields);
+
+    /// @brief  Decodes a block and appends its packed records to event_bytes. Throws std::runtime_error if the
+    ///         block is corrupted.
+    /// @return number of records of the block.
+    std::size_t decode(const std::uint8_t *data, std::size_t size, std::vector<std::uint8_t> &event_bytes);
+
+private:
+    FieldsDefinition fdef_;
+    EventTransform transform_;
+    std::vector<AdaptiveFrequencyModel> models_;
+    std::vector<std::vector<std::uint8_t>> streams_;
+};
+
+} // namespace XEFormat
@@ -0,0 +1,222 @@
+/**********************************************************************************************************************
+ * MIT License                                                                                                        *
+ *                                                                                                                    *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and                  *
+ * associated documentation files (the “Software”), to deal in the Software without restriction,                      *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,              *
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,              *
+ * subject to the following conditions:                                                                               *
+ *                                                                                                                    *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial               *
+ * portions of the Software.                                                                                          *
+ *                                                                                                                    *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,                                *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND               *
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES               *
+ * OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN                *
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ **********************************************************************************************************************/
+
+#include <stdexcept>
+#include <algorithm>
+#include <streambuf>
+#include <istream>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "mapped_file.h"
+#include "instrumentation.h"
+
+namespace XEFormat {
+
+namespace {
+
+/// @brief  Read-only stream buffer over a memory range, used to run the istream based header parser on a mapping.
+class MemoryStreamBuf : public std::streambuf {
+public:
+    MemoryStreamBuf(const std::uint8_t *data, std::size_t size) {
+        char *p = const_cast<char*>(reinterpret_cast<const char*>(data));
+        setg(p, p, p + size);
+    }
+
+    std::size_t consumed() const { return static_cast<std::size_t>(gptr() - eback()); }
+};
+
+} // namespace
+
+MappedFile::MappedFile(const std::string &path) {
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if(fd < 0) {
+        throw std::runtime_error("Cannot open file: " + path);
+    }
+    struct stat st;
+    if(::fstat(fd, &st) != 0) {
+        ::close(fd);
+        throw std::runtime_error("Cannot stat file: " + path);
+    }
+    size_ = static_cast<std::size_t>(st.st_size);
+    if(size_ > 0) {
+        void *p = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(p == MAP_FAILED) {
+            ::close(fd);
+            throw std::runtime_error("Cannot map file: " + path);
+        }
+        data_ = static_cast<std::uint8_t*>(p);
+        ::madvise(p, size_, MADV_SEQUENTIAL);
+    }
+    ::close(fd);
+}
+
+MappedFile::MappedFile(MappedFile &&other) noexcept : data_(other.data_), size_(other.size_) {
+    other.data_ = nullptr;
+    other.size_ = 0;
+}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept {
+    if(this != &other) {
+        if(data_) {
+            ::munmap(data_, size_);
+        }
+        data_ = other.data_;
+        size_ = other.size_;
+        other.data_ = nullptr;
+        other.size_ = 0;
+    }
+    return *this;
+}
+
+MappedFile::~MappedFile() {
+    if(data_) {
+        ::munmap(data_, size_);
+    }
+}
+
+void MappedFile::release_pages(std::size_t offset, std::size_t length) const {
+    if(!data_ || offset >= size_) {
+        return;
+    }
+    const std::size_t page_size = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+    const std::size_t end = std::min(offset + length, size_);
+    const std::size_t first_page = (offset + page_size - 1) / page_size * page_size;
+    const std::size_t last_page = end / page_size * page_size;
+    if(first_page < last_page) {
+        ::madvise(data_ + first_page, last_page - first_page, MADV_DONTNEED);
+    }
+}
+
+XEFile::XEFile(const std::string &path, const FieldsDefinition &fdef)
+    : file_(path), event_size_bytes_(fdef.event_size_bytes) {
+    assert(fdef.event_size <= 64);  // implementation only supports up to 64 bits events
+    MemoryStreamBuf buf(file_.data(), file_.size());
+    std::istream is(&buf);
+    if(!Decoder::assert_jpegxe_canonical_header(is)) {
+        throw std::runtime_error("Input is not a JPEG_XE canonical raw event file: " + path);
+    }
+    header_size_ = buf.consumed();
+    num_events_ = (file_.size() - header_size_) / event_size_bytes_;
+}
+
+BlockXEFile::BlockXEFile(const std::string &path, const FieldsDefinition &fdef)
+    : file_(path), fdef_(fdef) {
+    assert(fdef.event_size <= 64);  // implementation only supports up to 64 bits events
+    const std::uint8_t *data = file_.data();
+    const std::size_t size = file_.size();
+    blocks_end_ = size;
+    if(size < bxe_file_header_size || !std::equal(bxe_magic, bxe_magic + 4, data)) {
+        return;  // version 1: the file starts with the first block header
+    }
+    version_ = data[4];
+    flags_ = data[5];
+    if(version_ != bxe_version || (flags_ & ~bxe_supported_flags)) {
+        throw std::runtime_error("Unsupported .bxe file version.");
+    }
+    block_header_size_ = block_header_size(flags_, fdef);
+    blocks_begin_ = bxe_file_header_size;
+    if(size < bxe_file_header_size + bxe_footer_size) {
+        return;
+    }
+    const std::uint8_t *footer = data + size - bxe_footer_size;
+    const std::uint64_t index_offset = load_le<std::uint64_t>(footer);
+    const std::uint64_t num_blocks = load_le<std::uint32_t>(footer + 8);
+    if(!std::equal(bxe_index_magic, bxe_index_magic + 4, footer + 12) || index_offset < blocks_begin_ ||
+       index_offset > size - bxe_footer_size || (size - bxe_footer_size - index_offset) != num_blocks*bxe_index_entry_size) {
+        return;  // no footer: the blocks are read up to the end of the file
+    }
+    blocks_end_ = index_offset;
+    index_ = data + index_offset;
+    num_indexed_blocks_ = num_blocks;
+}
+
+std::pair<std::size_t, std::size_t> BlockXEFile::blocks_in_range(timestamp_t t0, timestamp_t t1) const {
+    assert(indexed());
+    // first block ending at or after t0, then first block starting at or after t1
+    std::size_t lo = 0, hi = num_indexed_blocks_;
+    while(lo < hi) {
+        const std::size_t mid = lo + (hi - lo)/2;
+        if(index_entry(mid).last_timestamp < t0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    const std::size_t first = lo;
+    hi = num_indexed_blocks_;
+    while(lo < hi) {
+        const std::size_t mid = lo + (hi - lo)/2;
+        if(index_entry(mid).first_timestamp < t1) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return {first, lo};
+}
+
+void BlockXEFile::const_iterator::load(std::size_t offset) {
+    const std::size_t size = file_->blocks_end_;
+    if(offset < file_->blocks_begin_ || offset > size || size - offset < file_->block_header_size_) {
+        // end of the blocks (a dangling partial header is ignored); an offset outside the blocks, e.g. from a
+        // corrupted index entry, also gives the end block, whose offset then differs from the one requested
+        block_ = Block{size, 0, 0, nullptr, false, 0, false, 0};
+        return;
+    }
+    const std::uint8_t *data = file_->file_.data();
+    std::uint32_t num_events;
+    if(file_->flags_ & bxe_flag_wide_count) {
+        WideBlockHeader header;
+        std::memcpy(&header, data + offset, sizeof(header));
+        num_events = header.num_events;
+    } else {
+        BlockHeader header;
+        std::memcpy(&header, data + offset, sizeof(header));
+        num_events = header.num_events;
+    }
+    block_.has_time_base = file_->self_contained_blocks();
+    block_.abs_time_base = 0;
+    if(block_.has_time_base) {
+        encoded_event_t time_base_event;
+        Decoder::unpack_encoded_events(data + offset + block_count_size(file_->flags_), 1, file_->fdef_, &time_base_event);
+        block_.abs_time_base = Decoder::decode_event_timestamp(time_base_event, file_->fdef_);
+    }
+    block_.has_checksum = file_->checksummed_blocks();
+    block_.checksum = block_.has_checksum ? load_le<std::uint32_t>(data + offset + file_->block_header_size_ - block_checksum_size) : 0;
+    const std::size_t payload_offset = offset + file_->block_header_size_;
+    const std::size_t max_events = (size - payload_offset) / file_->fdef_.event_size_bytes;
+    block_.offset = offset;
+    block_.num_events = num_events;
+    block_.available_events = std::min<std::size_t>(num_events, max_events);
+    block_.event_bytes = data + payload_offset;
+    XE_METRICS_ADD(BlocksRead, 1);
+}
+
+void BlockXEFile::const_iterator::next() {
+    if(block_.truncated()) {
+        load(file_->blocks_end_);
+        return;
+    }
+    load(block_.offset + file_->block_header_size_ + block_.available_events*file_->fdef_.event_size_bytes);
+}
+
+} // namespace XEFormat
@@ -0,0 +1,226 @@
+/**********************************************************************************************************************
+ * MIT License                                                                                                        *
+ *                                                                                                                    *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and                  *
+ * associated documentation files (the “Software”), to deal in the Software without restriction,                      *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,              *
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,              *
+ * subject to the following conditions:                                                                               *
+ *                                                                                                                    *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial               *
+ * portions of the Software.                                                                                          *
+ *                                                                                                                    *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,                                *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND               *
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES               *
+ * OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN                *
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ **********************************************************************************************************************/
+
+#pragma once
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <utility>
+#include "xe_format.h"
+#include "bxe_format.h"
+
+namespace XEFormat {
+
+/// @brief  Read-only memory mapping of a whole file. Move-only, the mapping is released on destruction.
+class MappedFile {
+public:
+    MappedFile() = default;
+
+    /// @brief  Maps the file at the given path. Throws std::runtime_error if the file cannot be opened or mapped.
+    /// @param path path of the file to map.
+    explicit MappedFile(const std::string &path);
+
+    MappedFile(MappedFile &&other) noexcept;
+    MappedFile &operator=(MappedFile &&other) noexcept;
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    ~MappedFile();
+
+    const std::uint8_t *data() const { return data_; }
+    std::size_t size() const { return size_; }
+
+    /// @brief  Drops the mapped pages fully contained in [offset, offset+length) from the process resident set.
+    ///         The content stays accessible, it is simply paged back in from the file if touched again.
+    /// @param offset offset of the first byte of the range.
+    /// @param length length of the range in bytes.
+    void release_pages(std::size_t offset, std::size_t length) const;
+
+private:
+    std::uint8_t *data_ = nullptr;
+    std::size_t size_ = 0;
+};
+
+/// @brief  Zero-copy view over a JPEG_XE canonical .xe file. The header is validated once when the file is opened,
+///         the events are then decoded on the fly from the mapped pages.
+class XEFile {
+public:
+    class const_iterator {
+    public:
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type = encoded_event_t;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = encoded_event_t;
+
+        const_iterator() = default;
+        const_iterator(const std::uint8_t *p, std::size_t event_size_bytes) : p_(p), ev_bytes_(event_size_bytes) {}
+
+        encoded_event_t operator*() const {
+            encoded_event_t encoded_event = 0;
+            for(std::size_t b=0; b<ev_bytes_; ++b) {
+                encoded_event = (encoded_event << 8) + p_[b];
+            }
+            return encoded_event;
+        }
+        encoded_event_t operator[](difference_type n) const { return *(*this + n); }
+
+        const_iterator &operator++() { p_ += ev_bytes_; return *this; }
+        const_iterator operator++(int) { const_iterator it = *this; ++*this; return it; }
+        const_iterator &operator--() { p_ -= ev_bytes_; return *this; }
+        const_iterator operator--(int) { const_iterator it = *this; --*this; return it; }
+        const_iterator &operator+=(difference_type n) { p_ += n*static_cast<difference_type>(ev_bytes_); return *this; }
+        const_iterator &operator-=(difference_type n) { p_ -= n*static_cast<difference_type>(ev_bytes_); return *this; }
+        const_iterator operator+(difference_type n) const { const_iterator it = *this; return it += n; }
+        const_iterator operator-(difference_type n) const { const_iterator it = *this; return it -= n; }
+        difference_type operator-(const_iterator other) const { return (p_ - other.p_)/static_cast<difference_type>(ev_bytes_); }
+
+        bool operator==(const_iterator other) const { return p_ == other.p_; }
+        bool operator!=(const_iterator other) const { return p_ != other.p_; }
+        bool operator<(const_iterator other) const { return p_ < other.p_; }
+
+        /// @brief  Address of the packed bytes of the current event in the mapping.
+        const std::uint8_t *raw() const { return p_; }
+
+    private:
+        const std::uint8_t *p_ = nullptr;
+        std::size_t ev_bytes_ = 0;
+    };
+
+    /// @brief  Opens and validates a .xe file. Throws std::runtime_error if the file cannot be mapped or if its
+    ///         header does not match the reference JPEG_XE canonical raw event format header.
+    /// @param path path of the .xe file.
+    /// @param fdef fields definition.
+    XEFile(const std::string &path, const FieldsDefinition &fdef);
+
+    /// @brief  Number of complete events stored after the header (a trailing partial event is ignored).
+    std::size_t num_events() const { return num_events_; }
+
+    /// @brief  Packed bytes of the events, num_events()*fdef.event_size_bytes bytes long.
+    const std::uint8_t *event_bytes() const { return file_.data() + header_size_; }
+
+    /// @brief  Size in bytes of the validated header.
+    std::size_t header_size() const { return header_size_; }
+
+    encoded_event_t operator[](std::size_t i) const { return begin()[static_cast<std::ptrdiff_t>(i)]; }
+    const_iterator begin() const { return const_iterator(event_bytes(), event_size_bytes_); }
+    const_iterator end() const { return const_iterator(event_bytes() + num_events_*event_size_bytes_, event_size_bytes_); }
+
+    const MappedFile &mapping() const { return file_; }
+
+private:
+    MappedFile file_;
+    std::size_t event_size_bytes_;
+    std::size_t header_size_;
+    std::size_t num_events_;
+};
+
+/// @brief  Zero-copy view over a .bxe file: a sequence of BlockHeader followed by the packed events of the block.
+class BlockXEFile {
+public:
+    /// @brief  A block as stored in the mapping.
+    struct Block {
+        std::size_t offset;              // offset of the block header in the file
+        std::uint32_t num_events;        // number of events announced by the header
+        std::size_t available_events;    // number of complete events actually present (lower if the file is truncated)
+        const std::uint8_t *event_bytes; // packed bytes of the events
+        bool has_time_base;              // true if the block header holds the time base of the block
+        timestamp_t abs_time_base;       // absolute time base in effect at the start of the block, if has_time_base
+        bool has_checksum;               // true if the block header holds the checksum of the block
+        std::uint32_t checksum;          // CRC-32C stored in the header, if has_checksum (see verify_block)
+
+        bool truncated() const { return available_events < num_events; }
+    };
+
+    class const_iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Block;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Block*;
+        using reference = const Block&;
+
+        const_iterator() = default;
+        const_iterator(const BlockXEFile *file, std::size_t offset) : file_(file) { load(offset); }
+
+        const Block &operator*() const { return block_; }
+        const Block *operator->() const { return &block_; }
+
+        const_iterator &operator++() { next(); return *this; }
+        const_iterator operator++(int) { const_iterator it = *this; ++*this; return it; }
+
+        bool operator==(const const_iterator &other) const { return block_.offset == other.block_.offset; }
+        bool operator!=(const const_iterator &other) const { return block_.offset != other.block_.offset; }
+
+    private:
+        void load(std::size_t offset);
+        void next();
+
+        const BlockXEFile *file_ = nullptr;
+        Block block_{};
+    };
+
+    /// @brief  Opens a .bxe file, version 1 (bare blocks) or 2 (file header and footer index). A version 2 file
+    ///         without a valid footer (e.g. an interrupted capture) is read as unindexed. Throws std::runtime_error
+    ///         if the file cannot be mapped or if its header is not supported.
+    /// @param path path of the .bxe file.
+    /// @param fdef fields definition.
+    BlockXEFile(const std::string &path, const FieldsDefinition &fdef);
+
+    const_iterator begin() const { return const_iterator(this, blocks_begin_); }
+    const_iterator end() const { return const_iterator(this, blocks_end_); }
+
+    /// @brief  Returns an iterator on the block whose header is at the given offset (e.g. from the index). An offset
+    ///         outside the blocks (e.g. from a corrupted index entry) gives end(), whose offset differs from it.
+    const_iterator block_at(std::size_t offset) const { return const_iterator(this, offset); }
+
+    const MappedFile &mapping() const { return file_; }
+    std::uint8_t version() const { return version_; }
+    std::uint8_t flags() const { return flags_; }
+
+    /// @brief  Returns true if every block header holds the time base of its block, so that blocks decode alone.
+    bool self_contained_blocks() const { return (flags_ & bxe_flag_time_base) != 0; }
+
+    /// @brief  Returns true if the blocks hold a checksum (files with the bxe_flag_checksum flag).
+    bool checksummed_blocks() const { return (flags_ & bxe_flag_checksum) != 0; }
+
+    /// @brief  Returns true if the file has a footer index.
+    bool indexed() const { return index_ != nullptr; }
+    std::size_t num_indexed_blocks() const { return num_indexed_blocks_; }
+    BlockIndexEntry index_entry(std::size_t i) const { return load_index_entry(index_ + i*bxe_index_entry_size); }
+
+    /// @brief  Finds the blocks holding events of the [t0, t1) window with two binary searches over the index,
+    ///         relying on the timestamps being non-decreasing along the file. Requires indexed().
+    /// @return range [first, last) of index entries.
+    std::pair<std::size_t, std::size_t> blocks_in_range(timestamp_t t0, timestamp_t t1) const;
+
+private:
+    MappedFile file_;
+    FieldsDefinition fdef_;
+    std::uint8_t version_ = 1;
+    std::uint8_t flags_ = 0;
+    std::size_t block_header_size_ = sizeof(BlockHeader);
+    std::size_t blocks_begin_ = 0;
+    std::size_t blocks_end_ = 0;
+    const std::uint8_t *index_ = nullptr;
+    std::size_t num_indexed_blocks_ = 0;
+};
+
+} // namespace XEFormat
@@ -0,0 +1,162 @@
+/**********************************************************************************************************************
+ * MIT License                                                                                                        *
+ *                                                                                                                    *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and                  *
+ * associated documentation files (the “Software”), to deal in the Software without restriction,                      *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,              *
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,              *
+ * subject to the following conditions:                                                                               *
+ *                                                                                                                    *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial               *
+ * portions of the Software.                                                                                          *
+ *                                                                                                                    *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,                                *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND               *
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES               *
+ * OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN                *
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ **********************************************************************************************************************/
+
+#include <fstream>
+#include <iterator>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <sys/stat.h>
+#include "model_store.h"
+#include "bxe_format.h"
+
+namespace XEFormat {
+
+namespace {
+
+const char model_magic[4] = {'B', 'X', 'E', 'M'};
+constexpr std::uint8_t model_version = 1;
+constexpr std::size_t model_header_size = 24;  // magic, version, coder, transform, reserved, u64 id, u32 events, u32 size
+
+} // namespace
+
+std::uint64_t model_id(std::uint8_t coder, std::uint8_t transform, const std::vector<std::uint8_t> &tables) {
+    std::uint64_t hash = 0xcbf29ce484222325ull;
+    auto add = [&hash](std::uint8_t byte) {
+        hash = (hash ^ byte)*0x100000001b3ull;
+    };
+    add(model_version);
+    add(coder);
+    add(transform);
+    for(std::uint8_t byte : tables) {
+        add(byte);
+    }
+    return hash;
+}
+
+std::string model_id_string(std::uint64_t id) {
+    char text[17];
+    std::snprintf(text, sizeof(text), "%016llx", static_cast<unsigned long long>(id));
+    return text;
+}
+
+bool parse_model_id(const std::string &text, std::uint64_t &id) {
+    if(text.size() != 16) {
+        return false;
+    }
+    std::uint64_t value = 0;
+    for(char c : text) {
+        unsigned digit;
+        if(c >= '0' && c <= '9') {
+            digit = static_cast<unsigned>(c - '0');
+        } else if(c >= 'a' && c <= 'f') {
+            digit = static_cast<unsigned>(c - 'a' + 10);
+        } else if(c >= 'A' && c <= 'F') {
+            digit = static_cast<unsigned>(c - 'A' + 10);
+        } else {
+            return false;
+        }
+        value = (value << 4) | digit;
+    }
+    id = value;
+    return true;
+}
+
+void write_model_file(const std::string &path, const PretrainedModel &model) {
+    std::vector<std::uint8_t> bytes(model_header_size);
+    std::memcpy(bytes.data(), model_magic, sizeof(model_magic));
+    bytes[4] = model_version;
+    bytes[5] = model.coder;
+    bytes[6] = model.transform;
+    bytes[7] = 0;
+    store_le<std::uint64_t>(model.id, bytes.data() + 8);
+    store_le<std::uint32_t>(model.trained_events, bytes.data() + 16);
+    store_le<std::uint32_t>(static_cast<std::uint32_t>(model.tables.size()), bytes.data() + 20);
+    bytes.insert(bytes.end(), model.tables.begin(), model.tables.end());
+    std::ofstream os(path, std::ios::binary);
+    os.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    os.close();
+    if(!os) {
+        throw std::runtime_error("Cannot write model file: " + path);
+    }
+}
+
+PretrainedModel read_model_file(const std::string &path) {
+    std::ifstream is(path, std::ios::binary);
+    if(!is) {
+        throw std::runtime_error("Cannot open model file: " + path);
+    }
+    const std::vector<std::uint8_t> bytes((std::istreambuf_iterator<char>(is)), std::istreambuf_iterator<char>());
+    if(bytes.size() < model_header_size || std::memcmp(bytes.data(), model_magic, sizeof(model_magic)) != 0) {
+        throw std::runtime_error("Not a model file: " + path);
+    }
+    if(bytes[4] != model_version) {
+        throw std::runtime_error("Model file version not supported: " + path);
+    }
+    PretrainedModel model;
+    model.coder = bytes[5];
+    model.transform = bytes[6];
+    model.id = load_le<std::uint64_t>(bytes.data() + 8);
+    model.trained_events = load_le<std::uint32_t>(bytes.data() + 16);
+    const std::uint32_t size = load_le<std::uint32_t>(bytes.data() + 20);
+    if(bytes.size() - model_header_size != size) {
+        throw std::runtime_error("Corrupted model file: " + path);
+    }
+    model.tables.assign(bytes.begin() + model_header_size, bytes.end());
+    if(model_id(model.coder, model.transform, model.tables) != model.id) {
+        throw std::runtime_error("Corrupted model file: " + path);
+    }
+    return model;
+}
+
+ModelStore::ModelStore(const std::string &directory) : directory_(directory) {}
+
+std::string ModelStore::path(std::uint64_t id) const {
+    return directory_ + "/" + model_id_string(id) + ".bxem";
+}
+
+std::string ModelStore::save(const PretrainedModel &model) const {
+    const std::string model_path = path(model.id);
+    struct stat st;
+    if(::stat(model_path.c_str(), &st) != 0) {
+        // written under a temporary name first, so a reader never sees a partial model
+        const std::string temp_path = model_path + ".tmp";
+        write_model_file(temp_path, model);
+        if(std::rename(temp_path.c_str(), model_path.c_str()) != 0) {
+            std::remove(temp_path.c_str());
+            throw std::runtime_error("Cannot write model file: " + model_path);
+        }
+    }
+    return model_path;
+}
+
+std::shared_ptr<const PretrainedModel> ModelStore::load(std::uint64_t id) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = cache_.find(id);
+    if(it == cache_.end()) {
+        std::shared_ptr<const PretrainedModel> model = std::make_shared<const PretrainedModel>(read_model_file(path(id)));
+        if(model->id != id) {
+            throw std::runtime_error("Model file does not hold model " + model_id_string(id) + ": " + path(id));
+        }
+        it = cache_.emplace(id, std::move(model)).first;
+    }
+    return it->second;
+}
+
+} // namespace XEFormat
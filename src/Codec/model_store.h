@@ -0,0 +1,89 @@
+/**********************************************************************************************************************
+ * MIT License                                                                                                        *
+ *                                                                                                                    *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and                  *
+ * associated documentation files (the “Software”), to deal in the Software without restriction,                      *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,              *
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,              *
+ * subject to the following conditions:                                                                               *
+ *                                                                                                                    *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial               *
+ * portions of the Software.                                                                                          *
+ *                                                                                                                    *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,                                *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND               *
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES               *
+ * OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN                *
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ **********************************************************************************************************************/
+
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace XEFormat {
+
+// A pre-trained model holds the entropy coder tables of every transformed stream, trained once on a corpus of .bxe
+// files instead of counted again for each file. A compressed file using it stores only the model ID, a 64-bit hash
+// of the model content, and the decompressor loads the model from a store: a directory holding one file per model,
+// named after its ID ("0123456789abcdef.bxem"). Model files hold the magic "BXEM", a u8 version, the u8 coder, the u8
+// transform, a u8 reserved byte, the u64 ID, the u32 number of events the model was trained on, the u32 size of the
+// tables and the tables, serialised as the model of a compressed file header. All the integers are little-endian.
+
+/// @brief  Entropy model trained on a corpus, identified by the hash of its content.
+struct PretrainedModel {
+    std::uint64_t id = 0;
+    std::uint8_t coder = 0;              // EntropyCoder the tables are for
+    std::uint8_t transform = 0;          // EventTransform of the streams
+    std::uint32_t trained_events = 0;    // number of events of the corpus (saturated), for information only
+    std::vector<std::uint8_t> tables;    // model as stored in a compressed file header
+};
+
+/// @brief  Computes the ID of a model from its coder, transform and tables (FNV-1a 64 over the three).
+std::uint64_t model_id(std::uint8_t coder, std::uint8_t transform, const std::vector<std::uint8_t> &tables);
+
+/// @brief  Formats a model ID as 16 lower-case hex digits.
+std::string model_id_string(std::uint64_t id);
+
+/// @brief  Parses a model ID formatted by model_id_string.
+/// @return true if the text is a valid ID, false otherwise.
+bool parse_model_id(const std::string &text, std::uint64_t &id);
+
+/// @brief  Writes a model file. Throws std::runtime_error if the file cannot be written.
+void write_model_file(const std::string &path, const PretrainedModel &model);
+
+/// @brief  Reads a model file, checking that its content matches its ID. Throws std::runtime_error if the file cannot
+///         be read, has an unsupported version or is corrupted.
+PretrainedModel read_model_file(const std::string &path);
+
+/// @brief  Directory of model files with an in-memory cache: each model is read from disk once, then shared by every
+///         file compressed or decompressed through the same store. Safe to use from several threads.
+class ModelStore {
+public:
+    /// @param directory directory holding the model files.
+    explicit ModelStore(const std::string &directory);
+
+    /// @brief  Writes a model into the store, unless a model with the same ID is already there.
+    /// @return the path of the model file.
+    std::string save(const PretrainedModel &model) const;
+
+    /// @brief  Returns the model with the given ID, from the cache or read from the directory.
+    ///         Throws std::runtime_error if the store has no valid model with that ID.
+    std::shared_ptr<const PretrainedModel> load(std::uint64_t id) const;
+
+    /// @brief  Path of the file of a model in the store.
+    std::string path(std::uint64_t id) const;
+
+private:
+    std::string directory_;
+    mutable std::mutex mutex_;
+    mutable std::map<std::uint64_t, std::shared_ptr<const PretrainedModel>> cache_;
+};
+
+} // namespace XEFormat
@@ -0,0 +1,460 @@
+/**********************************************************************************************************************
+ * MIT License                                                                                                        *
+ *                                                                                                                    *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and                  *
+ * associated documentation files (the “Software”), to deal in the Software without restriction,                      *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,              *
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,              *
+ * subject to the following conditions:                                                                               *
+ *                                                                                                                    *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial               *
+ * portions of the Software.                                                                                          *
+ *                                                                                                                    *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,                                *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND               *
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES               *
+ * OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN                *
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ **********************************************************************************************************************/
+
+#include <algorithm>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <stdexcept>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include "output_sink.h"
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#define XE_SINK_IO_URING 1
+#endif
+#endif
+#endif
+
+namespace XEFormat {
+
+/// @brief  Writes whole buffers at given file offsets in the background. Buffers are identified by their slot, and a
+///         slot is submitted again only after wait() has returned for it.
+class OutputSinkWriter {
+public:
+    virtual ~OutputSinkWriter() = default;
+    virtual void submit(std::size_t slot, const std::uint8_t *data, std::size_t size, std::uint64_t offset) = 0;
+    virtual void wait(std::size_t slot) = 0;
+    virtual const char *name() const = 0;
+};
+
+namespace {
+
+constexpr std::size_t page_size = 4096;
+
+/// @brief  Writes a whole range with pwrite, resuming after short writes and interruptions.
+void pwrite_all(int fd, const std::uint8_t *data, std::size_t size, std::uint64_t offset) {
+    while(size > 0) {
+        const ssize_t written = ::pwrite(fd, data, size, static_cast<off_t>(offset));
+        if(written < 0) {
+            if(errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error(std::string("Cannot write output file: ") + std::strerror(errno));
+        }
+        data += written;
+        size -= static_cast<std::size_t>(written);
+        offset += static_cast<std::uint64_t>(written);
+    }
+}
+
+/// @brief  Writer thread running pwrite on the submitted buffers, in submission order.
+class PwriteWriter : public OutputSinkWriter {
+public:
+    PwriteWriter(int fd, std::size_t num_slots) : fd_(fd), busy_(num_slots, false), thread_([this]() { run(); }) {}
+
+    ~PwriteWriter() override {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        wake_.notify_all();
+        thread_.join();
+    }
+
+    void submit(std::size_t slot, const std::uint8_t *data, std::size_t size, std::uint64_t offset) override {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            busy_[slot] = true;
+            jobs_.push_back(Job{slot, data, size, offset});
+        }
+        wake_.notify_all();
+    }
+
+    void wait(std::size_t slot) override {
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_.wait(lock, [&]() { return !busy_[slot]; });
+        if(!error_.empty()) {
+            throw std::runtime_error(error_);
+        }
+    }
+
+    const char *name() const override { return "pwrite"; }
+
+private:
+    struct Job {
+        std::size_t slot;
+        const std::uint8_t *data;
+        std::size_t size;
+        std::uint64_t offset;
+    };
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        for(;;) {
+            wake_.wait(lock, [&]() { return stopping_ || !jobs_.empty(); });
+            if(jobs_.empty()) {
+                return;
+            }
+            const Job job = jobs_.front();
+            jobs_.pop_front();
+            lock.unlock();
+            std::string error;
+            try {
+                pwrite_all(fd_, job.data, job.size, job.offset);
+            } catch(const std::runtime_error &e) {
+                error = e.what();
+            }
+            lock.lock();
+            if(error_.empty()) {
+                error_ = error;
+            }
+            busy_[job.slot] = false;
+            done_.notify_all();
+        }
+    }
+
+    int fd_;
+    std::vector<bool> busy_;
+    std::deque<Job> jobs_;
+    std::string error_;
+    bool stopping_ = false;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    std::thread thread_;
+};
+
+#ifdef XE_SINK_IO_URING
+
+/// @brief  io_uring submission and completion rings, driven with the raw system calls (no liburing needed). One
+///         write is queued per buffer; the kernel runs it while the sink fills the next buffer, and its completion
+///         is reaped when the buffer is needed again.
+class UringWriter : public OutputSinkWriter {
+public:
+    /// @brief  Sets up a ring with room for num_slots writes. Throws std::runtime_error if io_uring is not available
+    ///         (old kernel, disabled by the administrator or blocked by a seccomp filter).
+    UringWriter(int fd, std::size_t num_slots) : fd_(fd), slots_(num_slots) {
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        ring_fd_ = static_cast<int>(::syscall(__NR_io_uring_setup, static_cast<unsigned>(num_slots), &params));
+        if(ring_fd_ < 0) {
+            throw std::runtime_error("io_uring is not available.");
+        }
+        sq_ring_size_ = params.sq_off.array + params.sq_entries*sizeof(std::uint32_t);
+        cq_ring_size_ = params.cq_off.cqes + params.cq_entries*sizeof(io_uring_cqe);
+        single_mmap_ = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if(single_mmap_) {
+            sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+        }
+        sq_ring_ = map(sq_ring_size_, IORING_OFF_SQ_RING);
+        cq_ring_ = single_mmap_ ? sq_ring_ : map(cq_ring_size_, IORING_OFF_CQ_RING);
+        sqes_size_ = params.sq_entries*sizeof(io_uring_sqe);
+        sqes_ = static_cast<io_uring_sqe*>(map(sqes_size_, IORING_OFF_SQES));
+        if(sq_ring_ == MAP_FAILED || cq_ring_ == MAP_FAILED || sqes_ == MAP_FAILED) {
+            release();
+            throw std::runtime_error("io_uring is not available.");
+        }
+        std::uint8_t *sq = static_cast<std::uint8_t*>(sq_ring_);
+        std::uint8_t *cq = static_cast<std::uint8_t*>(cq_ring_);
+        sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sq_mask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cq_mask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+    }
+
+    ~UringWriter() override {
+        // the buffers must not be freed under a running write
+        for(std::size_t slot=0; slot<slots_.size(); ++slot) {
+            try {
+                wait(slot);
+            } catch(const std::runtime_error &) {
+            }
+        }
+        release();
+    }
+
+    void submit(std::size_t slot, const std::uint8_t *data, std::size_t size, std::uint64_t offset) override {
+        slots_[slot] = Slot{data, size, offset, true};
+        const unsigned tail = *sq_tail_;
+        const unsigned index = tail & sq_mask_;
+        io_uring_sqe &sqe = sqes_[index];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = IORING_OP_WRITE;
+        sqe.fd = fd_;
+        sqe.addr = reinterpret_cast<std::uint64_t>(data);
+        sqe.len = static_cast<std::uint32_t>(size);
+        sqe.off = offset;
+        sqe.user_data = slot;
+        sq_array_[index] = index;
+        __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+        while(::syscall(__NR_io_uring_enter, ring_fd_, 1u, 0u, 0u, nullptr, 0) < 0) {
+            if(errno != EINTR && errno != EAGAIN) {
+                slots_[slot].pending = false;
+                throw std::runtime_error(std::string("Cannot write output file: ") + std::strerror(errno));
+            }
+        }
+    }
+
+    void wait(std::size_t slot) override {
+        while(slots_[slot].pending) {
+            reap();
+        }
+        if(!error_.empty()) {
+            throw std::runtime_error(error_);
+        }
+    }
+
+    const char *name() const override { return "io_uring"; }
+
+private:
+    struct Slot {
+        const std::uint8_t *data = nullptr;
+        std::size_t size = 0;
+        std::uint64_t offset = 0;
+        bool pending = false;
+    };
+
+    void *map(std::size_t size, std::uint64_t offset) {
+        return ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, static_cast<off_t>(offset));
+    }
+
+    void release() {
+        if(sqes_ != MAP_FAILED) {
+            ::munmap(sqes_, sqes_size_);
+        }
+        if(cq_ring_ != MAP_FAILED && !single_mmap_) {
+            ::munmap(cq_ring_, cq_ring_size_);
+        }
+        if(sq_ring_ != MAP_FAILED) {
+            ::munmap(sq_ring_, sq_ring_size_);
+        }
+        ::close(ring_fd_);
+    }
+
+    /// @brief  Waits for at least one completion and processes all the available ones.
+    void reap() {
+        unsigned head = *cq_head_;
+        while(head == __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+            if(::syscall(__NR_io_uring_enter, ring_fd_, 0u, 1u, static_cast<unsigned>(IORING_ENTER_GETEVENTS), nullptr, 0) < 0
+               && errno != EINTR) {
+                throw std::runtime_error(std::string("Cannot write output file: ") + std::strerror(errno));
+            }
+        }
+        for(; head != __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE); ++head) {
+            const io_uring_cqe &cqe = cqes_[head & cq_mask_];
+            Slot &slot = slots_[static_cast<std::size_t>(cqe.user_data)];
+            try {
+                if(cqe.res < 0 && cqe.res != -EINVAL && cqe.res != -EOPNOTSUPP) {
+                    throw std::runtime_error(std::string("Cannot write output file: ") + std::strerror(-cqe.res));
+                }
+                // a short write is finished synchronously, as is the whole buffer on kernels without IORING_OP_WRITE
+                const std::size_t done = cqe.res < 0 ? 0 : static_cast<std::size_t>(cqe.res);
+                pwrite_all(fd_, slot.data + done, slot.size - done, slot.offset + done);
+            } catch(const std::runtime_error &e) {
+                if(error_.empty()) {
+                    error_ = e.what();
+                }
+            }
+            slot.pending = false;
+        }
+        __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+    }
+
+    int fd_;
+    int ring_fd_ = -1;
+    std::vector<Slot> slots_;
+    std::string error_;
+    bool single_mmap_ = false;
+    void *sq_ring_ = MAP_FAILED;
+    void *cq_ring_ = MAP_FAILED;
+    io_uring_sqe *sqes_ = static_cast<io_uring_sqe*>(MAP_FAILED);
+    std::size_t sq_ring_size_ = 0, cq_ring_size_ = 0, sqes_size_ = 0;
+    unsigned *sq_tail_ = nullptr, *sq_array_ = nullptr, *cq_head_ = nullptr, *cq_tail_ = nullptr;
+    unsigned sq_mask_ = 0, cq_mask_ = 0;
+    io_uring_cqe *cqes_ = nullptr;
+};
+
+#endif // XE_SINK_IO_URING
+
+} // namespace
+
+void OutputSink::FreeDeleter::operator()(std::uint8_t *p) const {
+    std::free(p);
+}
+
+OutputSink::OutputSink(const std::string &path, const OutputSinkOptions &options) : path_(path), stream_(this) {
+    buffer_bytes_ = std::max<std::size_t>(page_size, (options.buffer_bytes + page_size - 1)/page_size*page_size);
+    const std::size_t num_buffers = std::max<std::size_t>(2, options.num_buffers);
+    for(std::size_t i=0; i<num_buffers; ++i) {
+        std::uint8_t *buffer = static_cast<std::uint8_t*>(std::aligned_alloc(page_size, buffer_bytes_));
+        if(buffer == nullptr) {
+            throw std::bad_alloc();
+        }
+        buffers_.emplace_back(buffer);
+    }
+    fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(fd_ < 0) {
+        throw std::runtime_error("Cannot open output file: " + path);
+    }
+#ifdef XE_SINK_IO_URING
+    if(options.use_io_uring) {
+        try {
+            writer_.reset(new UringWriter(fd_, num_buffers));
+        } catch(const std::runtime_error &) {
+            // falls back to the writer thread
+        }
+    }
+#endif
+    if(!writer_) {
+        writer_.reset(new PwriteWriter(fd_, num_buffers));
+    }
+    char *begin = reinterpret_cast<char*>(buffers_[0].get());
+    setp(begin, begin + buffer_bytes_);
+}
+
+OutputSink::~OutputSink() {
+    if(!finished_) {
+        try {
+            finish();
+        } catch(const std::runtime_error &) {
+        }
+    }
+    writer_.reset();
+    if(fd_ >= 0) {
+        ::close(fd_);
+    }
+}
+
+void OutputSink::hand_off() {
+    const std::size_t size = static_cast<std::size_t>(pptr() - pbase());
+    if(size == 0) {
+        return;
+    }
+    writer_->submit(current_, buffers_[current_].get(), size, file_offset_);
+    file_offset_ += size;
+    current_ = (current_ + 1) % buffers_.size();
+    // only stalls when every buffer is still being written
+    writer_->wait(current_);
+    char *begin = reinterpret_cast<char*>(buffers_[current_].get());
+    setp(begin, begin + buffer_bytes_);
+}
+
+std::uint8_t *OutputSink::reserve(std::size_t n) {
+    if(finished_ || n > buffer_bytes_) {
+        throw std::runtime_error("Invalid output sink reservation.");
+    }
+    if(static_cast<std::size_t>(epptr() - pptr()) < n) {
+        hand_off();
+    }
+    return reinterpret_cast<std::uint8_t*>(pptr());
+}
+
+void OutputSink::write(const void *data, std::size_t n) {
+    const std::uint8_t *p = static_cast<const std::uint8_t*>(data);
+    while(n > 0) {
+        if(pptr() == epptr()) {
+            hand_off();
+        }
+        const std::size_t k = std::min(n, static_cast<std::size_t>(epptr() - pptr()));
+        std::memcpy(pptr(), p, k);
+        pbump(static_cast<int>(k));
+        p += k;
+        n -= k;
+    }
+}
+
+void OutputSink::write_encoded_events(const encoded_event_t *encoded_events, std::size_t n_events, const FieldsDefinition &fdef) {
+    const std::size_t ev_bytes = fdef.event_size_bytes;
+    while(n_events > 0) {
+        std::size_t k = static_cast<std::size_t>(epptr() - pptr())/ev_bytes;
+        if(k == 0) {
+            hand_off();
+            k = buffer_bytes_/ev_bytes;
+        }
+        k = std::min(k, n_events);
+        Encoder::pack_encoded_events(encoded_events, k, fdef, reinterpret_cast<std::uint8_t*>(pptr()));
+        pbump(static_cast<int>(k*ev_bytes));
+        encoded_events += k;
+        n_events -= k;
+    }
+}
+
+void OutputSink::finish() {
+    if(finished_) {
+        return;
+    }
+    finished_ = true;
+    hand_off();
+    for(std::size_t slot=0; slot<buffers_.size(); ++slot) {
+        writer_->wait(slot);
+    }
+    setp(nullptr, nullptr);
+    const int fd = fd_;
+    fd_ = -1;
+    if(::close(fd) != 0) {
+        throw std::runtime_error("Cannot write output file: " + path_);
+    }
+}
+
+const char *OutputSink::writer_name() const {
+    return writer_->name();
+}
+
+OutputSink::int_type OutputSink::overflow(int_type ch) {
+    if(finished_) {
+        return traits_type::eof();
+    }
+    try {
+        hand_off();
+    } catch(const std::runtime_error &) {
+        return traits_type::eof();
+    }
+    if(!traits_type::eq_int_type(ch, traits_type::eof())) {
+        *pptr() = traits_type::to_char_type(ch);
+        pbump(1);
+    }
+    return traits_type::not_eof(ch);
+}
+
+std::streamsize OutputSink::xsputn(const char *s, std::streamsize n) {
+    if(finished_) {
+        return 0;
+    }
+    try {
+        write(s, static_cast<std::size_t>(n));
+    } catch(const std::runtime_error &) {
+        return 0;
+    }
+    return n;
+}
+
+} // namespace XEFormat
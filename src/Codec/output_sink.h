@@ -0,0 +1,112 @@
+/**********************************************************************************************************************
+ * MIT License                                                                                                        *
+ *                                                                                                                    *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and                  *
+ * associated documentation files (the “Software”), to deal in the Software without restriction,                      *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,              *
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,              *
+ * subject to the following conditions:                                                                               *
+ *                                                                                                                    *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial               *
+ * portions of the Software.                                                                                          *
+ *                                                                                                                    *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,                                *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND               *
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES               *
+ * OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN                *
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ **********************************************************************************************************************/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <ostream>
+#include <streambuf>
+#include <cstddef>
+#include <cstdint>
+#include "xe_format.h"
+
+namespace XEFormat {
+
+/// @brief  Background writer of an OutputSink (io_uring or pwrite thread), defined in output_sink.cpp.
+class OutputSinkWriter;
+
+struct OutputSinkOptions {
+    std::size_t buffer_bytes = std::size_t(8) << 20;  // size of each buffer, rounded up to a whole number of pages
+    std::size_t num_buffers = 2;                      // buffers filled or in flight at the same time (at least 2)
+    bool use_io_uring = true;                         // submit the writes through io_uring when the kernel allows it
+};
+
+/// @brief  Output file written through a few large page-aligned buffers. Events are formatted straight into the
+///         current buffer; once it is full it is handed to a background writer and the next one is filled while the
+///         first is being written. The writes go through io_uring where the kernel supports it, and otherwise
+///         through pwrite on a writer thread, so filling the buffers never waits for a system call unless all of them
+///         are in flight.
+///         The sink is also a std::streambuf: stream() gives an std::ostream writing into the buffers, so the
+///         ostream based writers (Encoder::initialize_jpegxe_canonical_file, BlockXEWriter, ...) work unchanged.
+class OutputSink : public std::streambuf {
+public:
+    /// @brief  Creates (or truncates) the file and allocates the buffers. Throws std::runtime_error if the file
+    ///         cannot be opened.
+    /// @param path path of the output file.
+    /// @param options buffer sizes and writer.
+    explicit OutputSink(const std::string &path, const OutputSinkOptions &options = OutputSinkOptions());
+
+    /// @brief  Calls finish() if it was not called, ignoring errors.
+    ~OutputSink();
+
+    OutputSink(const OutputSink &) = delete;
+    OutputSink &operator=(const OutputSink &) = delete;
+
+    /// @brief  Stream writing into the buffers.
+    std::ostream &stream() { return stream_; }
+
+    /// @brief  Returns room for at least n bytes in the current buffer, handing it to the writer first if it is too
+    ///         full. The bytes written there are added to the file by commit().
+    /// @param n number of bytes, at most the buffer size.
+    std::uint8_t *reserve(std::size_t n);
+
+    /// @brief  Adds n bytes written at the address returned by the last reserve() to the file.
+    void commit(std::size_t n) { pbump(static_cast<int>(n)); }
+
+    /// @brief  Copies bytes to the file, across as many buffers as needed.
+    void write(const void *data, std::size_t n);
+
+    /// @brief  Packs encoded events straight into the buffers (see Encoder::pack_encoded_events).
+    void write_encoded_events(const encoded_event_t *encoded_events, std::size_t n_events, const FieldsDefinition &fdef);
+
+    /// @brief  Writes the last buffer, waits for every write and closes the file. Throws std::runtime_error if a
+    ///         write failed. Nothing can be written afterwards.
+    void finish();
+
+    /// @brief  Number of bytes given to the sink so far.
+    std::uint64_t bytes_written() const { return file_offset_ + static_cast<std::uint64_t>(pptr() - pbase()); }
+
+    /// @brief  Returns the writer in use: "io_uring" or "pwrite".
+    const char *writer_name() const;
+
+protected:
+    int_type overflow(int_type ch) override;
+    std::streamsize xsputn(const char *s, std::streamsize n) override;
+
+private:
+    void hand_off();
+
+    struct FreeDeleter {
+        void operator()(std::uint8_t *p) const;
+    };
+
+    std::string path_;
+    int fd_ = -1;
+    std::size_t buffer_bytes_;
+    std::vector<std::unique_ptr<std::uint8_t, FreeDeleter>> buffers_;
+    std::size_t current_ = 0;
+    std::uint64_t file_offset_ = 0;
+    std::unique_ptr<OutputSinkWriter> writer_;
+    std::ostream stream_;
+    bool finished_ = false;
+};
+
+} // namespace XEFormat
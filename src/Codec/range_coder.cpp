@@ -0,0 +1,159 @@
+/**********************************************************************************************************************
+ * MIT License                                                                                                        *
+ *                                                                                                                    *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and                  *
+ * associated documentation files (the “Software”), to deal in the Software without restriction,                      *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,              *
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,              *
+ * subject to the following conditions:                                                                               *
+ *                                                                                                                    *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial               *
+ * portions of the Software.                                                                                          *
+ *                                                                                                                    *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,                                *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND               *
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES               *
+ * OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN                *
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ **********************************************************************************************************************/
+
+#include <cassert>
+#include "range_coder.h"
+
+namespace XEFormat {
+
+namespace {
+
+constexpr std::uint32_t range_top = 1u << 24;
+constexpr std::uint32_t range_bottom = 1u << 16;
+
+} // namespace
+
+AdaptiveFrequencyModel::AdaptiveFrequencyModel(std::size_t num_symbols, std::uint32_t increment, std::uint32_t max_total)
+    : freqs_(num_symbols, 1), tree_(num_symbols + 1, 0), total_(0), increment_(increment), max_total_(max_total) {
+    assert(num_symbols > 0 && max_total <= RangeEncoder::max_total && num_symbols + increment <= max_total);
+    top_bit_ = 1;
+    while(top_bit_*2 <= num_symbols) {
+        top_bit_ *= 2;
+    }
+    rebuild();
+}
+
+void AdaptiveFrequencyModel::reset(const std::vector<std::uint32_t> &freqs) {
+    assert(freqs.size() == freqs_.size());
+    std::uint64_t sum = 0;
+    for(std::uint32_t f : freqs) {
+        sum += f ? f : 1;
+    }
+    // keep room for at least one update before the first rescale
+    const std::uint64_t limit = max_total_ - increment_;
+    for(std::size_t i=0; i<freqs.size(); ++i) {
+        std::uint64_t f = freqs[i] ? freqs[i] : 1;
+        if(sum > limit) {
+            f = f*(limit - freqs.size())/sum + 1;
+        }
+        freqs_[i] = static_cast<std::uint32_t>(f);
+    }
+    rebuild();
+}
+
+std::uint32_t AdaptiveFrequencyModel::low(std::size_t symbol) const {
+    std::uint32_t sum = 0;
+    for(std::size_t i=symbol; i>0; i &= i-1) {
+        sum += tree_[i];
+    }
+    return sum;
+}
+
+std::size_t AdaptiveFrequencyModel::find(std::uint32_t target, std::uint32_t &symbol_low) const {
+    // Fenwick descent: finds the largest prefix whose sum is not greater than the target
+    std::size_t pos = 0;
+    std::uint32_t sum = 0;
+    for(std::size_t step=top_bit_; step>0; step >>= 1) {
+        const std::size_t next = pos + step;
+        if(next < tree_.size() && sum + tree_[next] <= target) {
+            pos = next;
+            sum += tree_[next];
+        }
+    }
+    symbol_low = sum;
+    return pos;
+}
+
+void AdaptiveFrequencyModel::update(std::size_t symbol) {
+    freqs_[symbol] += increment_;
+    total_ += increment_;
+    if(total_ > max_total_) {
+        for(std::uint32_t &f : freqs_) {
+            f = (f + 1) >> 1;
+        }
+        rebuild();
+        return;
+    }
+    add(symbol, increment_);
+}
+
+void AdaptiveFrequencyModel::add(std::size_t symbol, std::uint32_t delta) {
+    for(std::size_t i=symbol+1; i<tree_.size(); i += i & (~i + 1)) {
+        tree_[i] += delta;
+    }
+}
+
+void AdaptiveFrequencyModel::rebuild() {
+    // O(n) Fenwick construction
+    total_ = 0;
+    for(std::size_t i=0; i<freqs_.size(); ++i) {
+        tree_[i+1] = freqs_[i];
+        total_ += freqs_[i];
+    }
+    for(std::size_t i=1; i<tree_.size(); ++i) {
+        const std::size_t parent = i + (i & (~i + 1));
+        if(parent < tree_.size()) {
+            tree_[parent] += tree_[i];
+        }
+    }
+}
+
+void RangeEncoder::encode(std::uint32_t low, std::uint32_t freq, std::uint32_t total) {
+    assert(freq > 0 && low + freq <= total && total <= max_total);
+    range_ /= total;
+    low_ += low*range_;
+    range_ *= freq;
+    // byte-wise renormalisation: emit the top byte once it is settled, or shrink the range when it underflows
+    while((low_ ^ (low_ + range_)) < range_top || (range_ < range_bottom && ((range_ = (0u - low_) & (range_bottom - 1)), true))) {
+        output_.push_back(static_cast<std::uint8_t>(low_ >> 24));
+        low_ <<= 8;
+        range_ <<= 8;
+    }
+}
+
+void RangeEncoder::finish() {
+    for(int i=0; i<4; ++i) {
+        output_.push_back(static_cast<std::uint8_t>(low_ >> 24));
+        low_ <<= 8;
+    }
+}
+
+RangeDecoder::RangeDecoder(const std::uint8_t *data, std::size_t size) : data_(data), size_(size) {
+    for(int i=0; i<4; ++i) {
+        code_ = (code_ << 8) | next_byte();
+    }
+}
+
+std::uint32_t RangeDecoder::target(std::uint32_t total) {
+    range_ /= total;
+    const std::uint32_t value = (code_ - low_)/range_;
+    return value < total ? value : total - 1;
+}
+
+void RangeDecoder::consume(std::uint32_t low, std::uint32_t freq) {
+    low_ += low*range_;
+    range_ *= freq;
+    while((low_ ^ (low_ + range_)) < range_top || (range_ < range_bottom && ((range_ = (0u - low_) & (range_bottom - 1)), true))) {
+        code_ = (code_ << 8) | next_byte();
+        low_ <<= 8;
+        range_ <<= 8;
+    }
+}
+
+} // namespace XEFormat
@@ -0,0 +1,130 @@
+/**********************************************************************************************************************
+ * MIT License                                                                                                        *
+ *                                                                                                                    *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and                  *
+ * associated documentation files (the “Software”), to deal in the Software without restriction,                      *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,              *
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,              *
+ * subject to the following conditions:                                                                               *
+ *                                                                                                                    *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial               *
+ * portions of the Software.                                                                                          *
+ *                                                                                                                    *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,                                *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND               *
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES               *
+ * OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN                *
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ **********************************************************************************************************************/
+
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace XEFormat {
+
+/// @brief  Adaptive frequency model over a fixed alphabet. Cumulative frequencies are kept in a Fenwick tree, so
+///         querying, updating and searching a symbol are all O(log n) instead of rebuilding a cumulative table.
+class AdaptiveFrequencyModel {
+public:
+    /// @brief  Creates a model where every symbol starts with a frequency of 1.
+    /// @param num_symbols size of the alphabet.
+    /// @param increment frequency added to a symbol each time it is coded.
+    /// @param max_total total frequency that triggers a rescale; must not exceed RangeEncoder::max_total.
+    explicit AdaptiveFrequencyModel(std::size_t num_symbols = 256, std::uint32_t increment = 24, std::uint32_t max_total = 1u << 16);
+
+    /// @brief  Resets the model to the given initial frequencies (scaled down if their sum exceeds max_total).
+    /// @param freqs initial frequency of each symbol; zero frequencies are raised to 1.
+    void reset(const std::vector<std::uint32_t> &freqs);
+
+    std::size_t num_symbols() const { return freqs_.size(); }
+    std::uint32_t total() const { return total_; }
+    std::uint32_t freq(std::size_t symbol) const { return freqs_[symbol]; }
+
+    /// @brief  Sum of the frequencies of all symbols lower than the given symbol.
+    std::uint32_t low(std::size_t symbol) const;
+
+    /// @brief  Finds the symbol whose cumulative interval [low, low+freq) contains the target.
+    /// @param target cumulative frequency, lower than total().
+    /// @param symbol_low output parameter to store the low of the found symbol.
+    /// @return the found symbol.
+    std::size_t find(std::uint32_t target, std::uint32_t &symbol_low) const;
+
+    /// @brief  Increments the frequency of the given symbol, halving all frequencies when max_total is reached.
+    void update(std::size_t symbol);
+
+private:
+    void add(std::size_t symbol, std::uint32_t delta);
+    void rebuild();
+
+    std::vector<std::uint32_t> freqs_;
+    std::vector<std::uint32_t> tree_;
+    std::size_t top_bit_;
+    std::uint32_t total_;
+    std::uint32_t increment_;
+    std::uint32_t max_total_;
+};
+
+/// @brief  Byte-oriented range encoder. The coder keeps the 32-bit state of ArithmeticCoderBase (num_state_bits = 32),
+///         but renormalises a whole byte at a time (carryless range coder), so it never handles individual bits.
+class RangeEncoder {
+public:
+    /// @brief  Largest total frequency accepted by encode().
+    static constexpr std::uint32_t max_total = 1u << 16;
+
+    /// @brief  Creates an encoder appending its output to the given buffer.
+    explicit RangeEncoder(std::vector<std::uint8_t> &output) : output_(output) {}
+
+    /// @brief  Encodes the interval [low, low+freq) of a distribution with the given total.
+    void encode(std::uint32_t low, std::uint32_t freq, std::uint32_t total);
+
+    /// @brief  Encodes a symbol with an adaptive model and updates the model.
+    void encode(AdaptiveFrequencyModel &model, std::size_t symbol) {
+        encode(model.low(symbol), model.freq(symbol), model.total());
+        model.update(symbol);
+    }
+
+    /// @brief  Flushes the remaining state bytes. Must be called once after the last symbol.
+    void finish();
+
+private:
+    std::vector<std::uint8_t> &output_;
+    std::uint32_t low_ = 0;
+    std::uint32_t range_ = 0xFFFFFFFFu;
+};
+
+/// @brief  Range decoder matching RangeEncoder. Bytes past the end of the input are read as zeros.
+class RangeDecoder {
+public:
+    RangeDecoder(const std::uint8_t *data, std::size_t size);
+
+    /// @brief  Returns the cumulative frequency of the next symbol for a distribution with the given total.
+    ///         Must be followed by a call to consume() with the interval of the decoded symbol.
+    std::uint32_t target(std::uint32_t total);
+
+    /// @brief  Removes the interval [low, low+freq) of the decoded symbol from the state.
+    void consume(std::uint32_t low, std::uint32_t freq);
+
+    /// @brief  Decodes a symbol with an adaptive model and updates the model.
+    std::size_t decode(AdaptiveFrequencyModel &model) {
+        std::uint32_t low;
+        const std::size_t symbol = model.find(target(model.total()), low);
+        consume(low, model.freq(symbol));
+        model.update(symbol);
+        return symbol;
+    }
+
+private:
+    std::uint8_t next_byte() { return pos_ < size_ ? data_[pos_++] : 0; }
+
+    const std::uint8_t *data_;
+    std::size_t size_;
+    std::size_t pos_ = 0;
+    std::uint32_t low_ = 0;
+    std::uint32_t range_ = 0xFFFFFFFFu;
+    std::uint32_t code_ = 0;
+};
+
+} // namespace XEFormat
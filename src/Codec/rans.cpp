@@ -0,0 +1,314 @@
+/**********************************************************************************************************************
+ * MIT License                                                                                                        *
+ *                                                                                                                    *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and                  *
+ * associated documentation files (the “Software”), to deal in the Software without restriction,                      *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,              *
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,              *
+ * subject to the following conditions:                                                                               *
+ *                                                                                                                    *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial               *
+ * portions of the Software.                                                                                          *
+ *                                                                                                                    *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,                                *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND               *
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES               *
+ * OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN                *
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ **********************************************************************************************************************/
+
+#include <algorithm>
+#include <stdexcept>
+#include "rans.h"
+#include "event_kernels.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define XE_RANS_X86 1
+#include <immintrin.h>
+#define XE_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace XEFormat {
+
+namespace {
+
+constexpr std::size_t num_symbols = 256;
+constexpr std::uint32_t scale_total = 1u << rans_scale_bits;
+constexpr std::uint32_t slot_mask = scale_total - 1;
+constexpr std::uint32_t state_low = 1u << 16;  // states stay in [state_low, 2^32) between symbols
+
+// slot entry: symbol in bits 0-7, frequency-1 in bits 8-19, offset of the slot in the symbol interval in bits 20-31
+inline std::uint32_t decode_slot(std::uint32_t x, std::uint32_t entry) {
+    return (((entry >> 8) & slot_mask) + 1)*(x >> rans_scale_bits) + (entry >> 20);
+}
+
+/// @brief  Decodes the symbols first to n-1 one at a time, first being the start of a step of the lanes, and
+///         advances the word pointer. The states are read from and written back to the states array.
+void decode_scalar(const std::uint32_t *table, std::uint32_t *states, unsigned lanes, std::size_t first, std::size_t n,
+                   const std::uint8_t *&words, const std::uint8_t *end, std::uint8_t *symbols) {
+    // local copies, which the compiler knows the symbol stores cannot alias
+    std::uint32_t x[32];
+    std::copy(states, states + lanes, x);
+    const std::uint8_t *p = words;
+    for(std::size_t i=first; i<n; i+=lanes) {
+        const unsigned step = static_cast<unsigned>(std::min<std::size_t>(lanes, n - i));
+        if(end - p >= static_cast<std::ptrdiff_t>(2*step)) {
+            // branchless: whether a state needs a word is close to random, so a branch would be mispredicted often
+            for(unsigned lane=0; lane<step; ++lane) {
+                const std::uint32_t entry = table[x[lane] & slot_mask];
+                symbols[i + lane] = static_cast<std::uint8_t>(entry);
+                const std::uint32_t y = decode_slot(x[lane], entry);
+                const bool refill = y < state_low;
+                x[lane] = refill ? (y << 16) | p[0] | (static_cast<std::uint32_t>(p[1]) << 8) : y;
+                p += 2*refill;
+            }
+        } else {
+            for(unsigned lane=0; lane<step; ++lane) {
+                const std::uint32_t entry = table[x[lane] & slot_mask];
+                symbols[i + lane] = static_cast<std::uint8_t>(entry);
+                x[lane] = decode_slot(x[lane], entry);
+                if(x[lane] < state_low) {
+                    if(end - p < 2) {
+                        throw std::runtime_error("Truncated rANS stream.");
+                    }
+                    x[lane] = (x[lane] << 16) | p[0] | (static_cast<std::uint32_t>(p[1]) << 8);
+                    p += 2;
+                }
+            }
+        }
+    }
+    std::copy(x, x + lanes, states);
+    words = p;
+}
+
+#ifdef XE_RANS_X86
+
+/// @brief  For each mask of the lanes of a register needing a word, the index of the word each lane takes among the
+///         words loaded for the register (lanes take consecutive words in lane order).
+struct RefillShuffles {
+    std::uint8_t index[256][8];
+
+    RefillShuffles() {
+        for(unsigned mask=0; mask<256; ++mask) {
+            unsigned next = 0;
+            for(unsigned lane=0; lane<8; ++lane) {
+                index[mask][lane] = static_cast<std::uint8_t>((mask >> lane) & 1 ? next++ : 0);
+            }
+        }
+    }
+};
+
+const RefillShuffles refill_shuffles;
+
+/// @brief  Decodes whole steps of lanes/8 registers while every register can load 8 words, and returns the number of
+///         symbols decoded. The states are read from and written back to the states array.
+template <unsigned Registers>
+XE_TARGET_AVX2 std::size_t decode_avx2(const std::uint32_t *table, std::uint32_t *states, std::size_t n,
+                                       const std::uint8_t *&words, const std::uint8_t *end, std::uint8_t *symbols) {
+    constexpr unsigned lanes = 8*Registers;
+    __m256i x[Registers];
+    for(unsigned r=0; r<Registers; ++r) {
+        x[r] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(states + 8*r));
+    }
+    const __m256i mask = _mm256_set1_epi32(slot_mask);
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i zero = _mm256_setzero_si256();
+    // first byte of each 32-bit entry to the low 4 bytes of each 128-bit half, then both halves together
+    const __m256i symbol_bytes = _mm256_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                                  0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m256i symbol_dwords = _mm256_setr_epi32(0, 4, 0, 0, 0, 0, 0, 0);
+    const std::uint8_t *p = words;
+    std::size_t i = 0;
+    for(; i+lanes<=n && end - p >= static_cast<std::ptrdiff_t>(16*Registers); i+=lanes) {
+        for(unsigned r=0; r<Registers; ++r) {
+            const __m256i entry = _mm256_i32gather_epi32(reinterpret_cast<const int*>(table), _mm256_and_si256(x[r], mask), 4);
+            const __m256i freq = _mm256_add_epi32(_mm256_and_si256(_mm256_srli_epi32(entry, 8), mask), one);
+            __m256i y = _mm256_add_epi32(_mm256_mullo_epi32(freq, _mm256_srli_epi32(x[r], rans_scale_bits)), _mm256_srli_epi32(entry, 20));
+            const __m256i bytes = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(entry, symbol_bytes), symbol_dwords);
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(symbols + i + 8*r), _mm256_castsi256_si128(bytes));
+
+            // renormalisation: the lanes below state_low take the next words of the stream, in lane order
+            const __m256i refill = _mm256_cmpeq_epi32(_mm256_srli_epi32(y, 16), zero);
+            const unsigned refill_mask = static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(refill)));
+            const __m256i loaded = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+            const __m256i shuffle = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(refill_shuffles.index[refill_mask])));
+            const __m256i refilled = _mm256_or_si256(_mm256_slli_epi32(y, 16), _mm256_permutevar8x32_epi32(loaded, shuffle));
+            x[r] = _mm256_blendv_epi8(y, refilled, refill);
+            p += 2*__builtin_popcount(refill_mask);
+        }
+    }
+    for(unsigned r=0; r<Registers; ++r) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(states + 8*r), x[r]);
+    }
+    words = p;
+    return i;
+}
+
+#endif // XE_RANS_X86
+
+} // namespace
+
+bool valid_rans_lanes(unsigned lanes) {
+    return lanes == 4 || lanes == 8 || lanes == 16 || lanes == 32;
+}
+
+std::vector<std::uint16_t> build_rans_frequencies(const std::vector<std::uint64_t> &counts_in, bool code_any_byte) {
+    std::vector<std::uint16_t> freqs(num_symbols, 0);
+    std::vector<std::uint64_t> counts = counts_in;
+    std::uint64_t total = 0;
+    for(std::uint64_t &c : counts) {
+        if(code_any_byte && c == 0) {
+            c = 1;
+        }
+        total += c;
+    }
+    if(total == 0) {
+        return freqs;
+    }
+    // rounded proportional share, at least 1 for the symbols that occur; the rounding error is then taken from (or
+    // given to) the most frequent symbols, where it costs the least
+    std::int64_t sum = 0;
+    for(std::size_t s=0; s<num_symbols; ++s) {
+        if(counts[s] > 0) {
+            const std::uint64_t scaled = static_cast<std::uint64_t>((static_cast<long double>(counts[s])*scale_total)/total + 0.5L);
+            freqs[s] = static_cast<std::uint16_t>(std::max<std::uint64_t>(1, scaled));
+            sum += freqs[s];
+        }
+    }
+    while(sum != scale_total) {
+        std::size_t largest = 0;
+        for(std::size_t s=1; s<num_symbols; ++s) {
+            if(freqs[s] > freqs[largest]) {
+                largest = s;
+            }
+        }
+        if(sum > scale_total) {
+            // never below 1: the largest frequency is above 1 as long as the sum exceeds the total
+            const std::int64_t cut = std::min<std::int64_t>(sum - scale_total, (freqs[largest] + 1)/2);
+            freqs[largest] = static_cast<std::uint16_t>(freqs[largest] - cut);
+            sum -= cut;
+        } else {
+            freqs[largest] = static_cast<std::uint16_t>(freqs[largest] + (scale_total - sum));
+            sum = scale_total;
+        }
+    }
+    return freqs;
+}
+
+bool valid_rans_frequencies(const std::vector<std::uint16_t> &freqs) {
+    if(freqs.size() != num_symbols) {
+        return false;
+    }
+    std::uint32_t sum = 0;
+    for(std::uint16_t f : freqs) {
+        sum += f;
+    }
+    return sum == scale_total;
+}
+
+RansEncoder::RansEncoder(const std::vector<std::uint16_t> &freqs, unsigned lanes) : lanes_(lanes) {
+    if(!valid_rans_frequencies(freqs) || !valid_rans_lanes(lanes)) {
+        throw std::runtime_error("Invalid rANS model.");
+    }
+    std::uint32_t start = 0;
+    for(std::size_t s=0; s<num_symbols; ++s) {
+        freqs_[s] = freqs[s];
+        starts_[s] = start;
+        start += freqs[s];
+    }
+}
+
+void RansEncoder::encode(const std::uint8_t *symbols, std::size_t n, std::vector<std::uint8_t> &output) const {
+    std::uint32_t states[32];
+    std::fill(states, states + lanes_, state_low);
+    // the symbols are coded backwards, so the words come out in the reverse of the order the decoder reads them
+    std::vector<std::uint16_t> words;
+    words.reserve(n/2 + 16);
+    unsigned lane = static_cast<unsigned>(n % lanes_);
+    for(std::size_t i=n; i-- > 0;) {
+        lane = lane == 0 ? lanes_ - 1 : lane - 1;
+        const std::uint8_t s = symbols[i];
+        const std::uint32_t freq = freqs_[s];
+        if(freq == 0) {
+            throw std::runtime_error("Symbol missing from the rANS model.");
+        }
+        std::uint32_t &x = states[lane];
+        if(x >= (static_cast<std::uint64_t>(freq) << (32 - rans_scale_bits))) {
+            words.push_back(static_cast<std::uint16_t>(x));
+            x >>= 16;
+        }
+        x = ((x/freq) << rans_scale_bits) + x%freq + starts_[s];
+    }
+
+    const std::size_t begin = output.size();
+    output.resize(begin + 4*lanes_ + 2*words.size());
+    std::uint8_t *p = output.data() + begin;
+    for(unsigned l=0; l<lanes_; ++l) {
+        for(unsigned b=0; b<4; ++b) {
+            *p++ = static_cast<std::uint8_t>(states[l] >> (8*b));
+        }
+    }
+    for(std::size_t w=words.size(); w-- > 0;) {
+        *p++ = static_cast<std::uint8_t>(words[w]);
+        *p++ = static_cast<std::uint8_t>(words[w] >> 8);
+    }
+}
+
+RansDecoder::RansDecoder(const std::vector<std::uint16_t> &freqs, unsigned lanes) : table_(scale_total), lanes_(lanes) {
+    if(!valid_rans_frequencies(freqs) || !valid_rans_lanes(lanes)) {
+        throw std::runtime_error("Invalid rANS model.");
+    }
+    std::uint32_t slot = 0;
+    for(std::uint32_t s=0; s<num_symbols; ++s) {
+        for(std::uint32_t k=0; k<freqs[s]; ++k, ++slot) {
+            table_[slot] = s | ((freqs[s] - 1u) << 8) | (k << 20);
+        }
+    }
+}
+
+std::size_t RansDecoder::decode(const std::uint8_t *data, std::size_t size, std::uint8_t *symbols, std::size_t n) const {
+    if(size < 4*lanes_) {
+        throw std::runtime_error("Truncated rANS stream.");
+    }
+    std::uint32_t states[32];
+    for(unsigned lane=0; lane<lanes_; ++lane) {
+        const std::uint8_t *p = data + 4*lane;
+        states[lane] = p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<std::uint32_t>(p[3]) << 24);
+        if(states[lane] < state_low) {
+            throw std::runtime_error("Corrupted rANS stream.");
+        }
+    }
+    const std::uint8_t *words = data + 4*lanes_;
+    const std::uint8_t *end = data + size;
+
+    std::size_t decoded = 0;
+#ifdef XE_RANS_X86
+    if(kernel_isa() == KernelISA::AVX2) {
+        switch(lanes_) {
+            case 8:
+                decoded = decode_avx2<1>(table_.data(), states, n, words, end, symbols);
+                break;
+            case 16:
+                decoded = decode_avx2<2>(table_.data(), states, n, words, end, symbols);
+                break;
+            case 32:
+                decoded = decode_avx2<4>(table_.data(), states, n, words, end, symbols);
+                break;
+            default:
+                break;
+        }
+    }
+#endif
+    // the scalar loop finishes the last steps, where the vector loads would run past the end of the run
+    decode_scalar(table_.data(), states, lanes_, decoded, n, words, end, symbols);
+
+    // the encoder starts every state at state_low, so a run decoded correctly ends on it
+    for(unsigned lane=0; lane<lanes_; ++lane) {
+        if(states[lane] != state_low) {
+            throw std::runtime_error("Corrupted rANS stream.");
+        }
+    }
+    return static_cast<std::size_t>(words - data);
+}
+
+} // namespace XEFormat
@@ -0,0 +1,96 @@
+/**********************************************************************************************************************
+ * MIT License                                                                                                        *
+ *                                                                                                                    *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and                  *
+ * associated documentation files (the “Software”), to deal in the Software without restriction,                      *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,              *
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,              *
+ * subject to the following conditions:                                                                               *
+ *                                                                                                                    *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial               *
+ * portions of the Software.                                                                                          *
+ *                                                                                                                    *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,                                *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND               *
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES               *
+ * OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN                *
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ **********************************************************************************************************************/
+
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace XEFormat {
+
+/// @brief  Precision of the static rANS frequency tables: the frequencies of a table sum to 1 << rans_scale_bits,
+///         so that the slot of a state resolves with one lookup in a table that fits the L1 cache.
+constexpr unsigned rans_scale_bits = 12;
+
+/// @brief  Number of interleaved states used unless told otherwise: four AVX2 registers of 8 states.
+constexpr unsigned rans_default_lanes = 32;
+
+/// @brief  Returns true for the numbers of interleaved states accepted by the coders: 4, 8, 16 or 32.
+bool valid_rans_lanes(unsigned lanes);
+
+/// @brief  Quantises byte counts to a static rANS table. Like the freqs of compress_block_arit.py the table comes from
+///         the counts of the whole file, but by default symbols that never occur keep a zero frequency instead of 1
+///         (the table only codes the data it was built from), and every other symbol gets at least 1.
+/// @param counts number of occurrences of each byte value (256 entries).
+/// @param code_any_byte gives every symbol a frequency of at least 1, for tables reused on other data.
+/// @return the frequency of each byte value, summing to 1 << rans_scale_bits (all zero if every count is zero and
+///         code_any_byte is false).
+std::vector<std::uint16_t> build_rans_frequencies(const std::vector<std::uint64_t> &counts, bool code_any_byte = false);
+
+/// @brief  Returns true if the table sums to 1 << rans_scale_bits, i.e. can be given to the coders.
+bool valid_rans_frequencies(const std::vector<std::uint16_t> &freqs);
+
+/// @brief  Static rANS encoder with interleaved states. Symbol i of a run is coded by state i % lanes; all the states
+///         share one stream of 16-bit words, ordered so that the decoder reads them in symbol order.
+class RansEncoder {
+public:
+    /// @brief  Throws std::runtime_error on an invalid table or lane count.
+    /// @param freqs frequency of each byte value (256 entries), as returned by build_rans_frequencies.
+    /// @param lanes number of interleaved states.
+    RansEncoder(const std::vector<std::uint16_t> &freqs, unsigned lanes = rans_default_lanes);
+
+    /// @brief  Encodes a run of bytes: the final states (u32 each), then the renormalisation words (u16), both
+    ///         little-endian. Throws std::runtime_error on a byte with a zero frequency.
+    /// @param symbols bytes to encode.
+    /// @param n number of bytes to encode.
+    /// @param output buffer to append the encoded run to.
+    void encode(const std::uint8_t *symbols, std::size_t n, std::vector<std::uint8_t> &output) const;
+
+private:
+    std::uint32_t freqs_[256];
+    std::uint32_t starts_[256];
+    unsigned lanes_;
+};
+
+/// @brief  Table-driven static rANS decoder. Each slot of the table packs the symbol, its frequency and the offset
+///         of the slot in the symbol interval in 32 bits, so that a whole step of the states decodes with gathers:
+///         with AVX2 (see kernel_isa()) and a multiple of 8 lanes, 8 states are decoded per 256-bit register.
+class RansDecoder {
+public:
+    /// @brief  Throws std::runtime_error on an invalid table or lane count.
+    /// @param freqs frequency of each byte value (256 entries), as given to the encoder.
+    /// @param lanes number of interleaved states, as given to the encoder.
+    RansDecoder(const std::vector<std::uint16_t> &freqs, unsigned lanes = rans_default_lanes);
+
+    /// @brief  Decodes a run of bytes written by one call to RansEncoder::encode.
+    ///         Throws std::runtime_error if the run is truncated or corrupted.
+    /// @param data encoded data, starting at the run.
+    /// @param size number of bytes available in data.
+    /// @param symbols output array with room for n symbols.
+    /// @param n number of symbols in the run.
+    /// @return the number of bytes of data used by the run.
+    std::size_t decode(const std::uint8_t *data, std::size_t size, std::uint8_t *symbols, std::size_t n) const;
+
+private:
+    std::vector<std::uint32_t> table_;
+    unsigned lanes_;
+};
+
+} // namespace XEFormat
@@ -0,0 +1,217 @@
+/**********************************************************************************************************************
+ * MIT License                                                                                                        *
+ *                                                                                                                    *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and                  *
+ * associated documentation files (the “Software”), to deal in the Software without restriction,                      *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,              *
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,              *
+ * subject to the following conditions:                                                                               *
+ *                                                                                                                    *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial               *
+ * portions of the Software.                                                                                          *
+ *                                                                                                                    *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,                                *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND               *
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES               *
+ * OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN                *
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ **********************************************************************************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+
+namespace XEFormat {
+
+/// @brief  Lock-free single-producer/single-consumer ring buffer. One thread writes, one thread reads, and neither
+///         ever takes a lock: the head (written by the producer) and the tail (written by the consumer) sit on
+///         separate cache lines, and each side keeps a private copy of the other side's index, only reloading it
+///         when the ring looks full or empty. Items are published and consumed in batches, through contiguous spans
+///         of the ring, so a reader can fill the ring in place and a block encoder can read it in place.
+///         The capacity is rounded up to a power of two.
+template <typename T>
+class SpscRing {
+public:
+    explicit SpscRing(std::size_t capacity) {
+        std::size_t size = 1;
+        while(size < capacity) {
+            size <<= 1;
+        }
+        items_.resize(size);
+        mask_ = size - 1;
+    }
+
+    SpscRing(const SpscRing &) = delete;
+    SpscRing &operator=(const SpscRing &) = delete;
+
+    std::size_t capacity() const { return items_.size(); }
+
+    // ---- producer side ----
+
+    /// @brief  Returns the contiguous free span at the head of the ring (possibly empty, and shorter than the free
+    ///         space when it wraps around). The items written to it become visible to the consumer on publish().
+    /// @param n output parameter to store the number of items of the span.
+    T *write_span(std::size_t &n) {
+        std::size_t free_items = capacity() - (head_local_ - cached_tail_);
+        if(free_items == 0) {
+            cached_tail_ = tail_.value.load(std::memory_order_acquire);
+            free_items = capacity() - (head_local_ - cached_tail_);
+        }
+        const std::size_t head = head_local_ & mask_;
+        n = std::min(free_items, capacity() - head);
+        return items_.data() + head;
+    }
+
+    /// @brief  Makes the next n written items visible to the consumer.
+    void publish(std::size_t n) {
+        head_local_ += n;
+        head_.value.store(head_local_, std::memory_order_release);
+    }
+
+    /// @brief  Copies as many items as fit (in at most two spans when the ring wraps around), then publishes them
+    ///         at once.
+    /// @return number of items written.
+    std::size_t try_push(const T *items, std::size_t n_items) {
+        std::size_t free_items = capacity() - (head_local_ - cached_tail_);
+        if(free_items < n_items) {
+            cached_tail_ = tail_.value.load(std::memory_order_acquire);
+            free_items = capacity() - (head_local_ - cached_tail_);
+        }
+        const std::size_t n = std::min(free_items, n_items);
+        const std::size_t head = head_local_ & mask_;
+        const std::size_t first = std::min(n, capacity() - head);
+        std::copy(items, items + first, items_.data() + head);
+        std::copy(items + first, items + n, items_.data());
+        if(n > 0) {
+            publish(n);
+        }
+        return n;
+    }
+
+    /// @brief  Waits until the ring has free space.
+    /// @param n output parameter to store the number of items of the span (at least 1).
+    T *wait_write_span(std::size_t &n) {
+        unsigned spins = 0;
+        for(;;) {
+            T *span = write_span(n);
+            if(n > 0) {
+                return span;
+            }
+            backoff(spins);
+        }
+    }
+
+    /// @brief  Copies every item, waiting while the ring is full.
+    void push(const T *items, std::size_t n_items) {
+        unsigned spins = 0;
+        while(n_items > 0) {
+            const std::size_t written = try_push(items, n_items);
+            items += written;
+            n_items -= written;
+            if(written == 0) {
+                backoff(spins);
+            } else {
+                spins = 0;
+            }
+        }
+    }
+
+    /// @brief  Marks the end of the stream, once every item has been published.
+    void close() { closed_.value.store(true, std::memory_order_release); }
+
+    // ---- consumer side ----
+
+    /// @brief  Returns the contiguous span of published items at the tail of the ring (possibly empty, and
+    ///         shorter than the published items when it wraps around). The items stay valid until consume().
+    /// @param n output parameter to store the number of items of the span.
+    const T *read_span(std::size_t &n) {
+        std::size_t ready = cached_head_ - tail_local_;
+        if(ready == 0) {
+            cached_head_ = head_.value.load(std::memory_order_acquire);
+            ready = cached_head_ - tail_local_;
+        }
+        const std::size_t tail = tail_local_ & mask_;
+        n = std::min(ready, capacity() - tail);
+        return items_.data() + tail;
+    }
+
+    /// @brief  Releases the next n read items to the producer.
+    void consume(std::size_t n) {
+        tail_local_ += n;
+        tail_.value.store(tail_local_, std::memory_order_release);
+    }
+
+    /// @brief  Waits until items are published or the stream is closed.
+    /// @param n output parameter to store the number of items of the span, 0 once the stream is closed and drained.
+    const T *wait_read_span(std::size_t &n) {
+        unsigned spins = 0;
+        for(;;) {
+            const T *span = read_span(n);
+            if(n > 0) {
+                return span;
+            }
+            if(closed_.value.load(std::memory_order_acquire)) {
+                // items published before close() are visible once the close is
+                return read_span(n);
+            }
+            backoff(spins);
+        }
+    }
+
+    /// @brief  Copies up to max_items items, waiting for at least one unless the stream is closed and drained.
+    /// @return number of items read, 0 at the end of the stream.
+    std::size_t pop(T *items, std::size_t max_items) {
+        std::size_t read = 0;
+        while(read < max_items) {
+            std::size_t n;
+            const T *span = read == 0 ? wait_read_span(n) : read_span(n);
+            if(n == 0) {
+                break;
+            }
+            n = std::min(n, max_items - read);
+            std::copy(span, span + n, items + read);
+            consume(n);
+            read += n;
+        }
+        return read;
+    }
+
+private:
+    static constexpr std::size_t cache_line = 64;
+
+    template <typename V>
+    struct alignas(cache_line) Padded {
+        V value{};
+    };
+
+    /// @brief  Waiting policy of the blocking calls: spin first, then yield, then sleep so that an idle stream
+    ///         (e.g. a quiet sensor) does not keep a core busy.
+    static void backoff(unsigned &spins) {
+        ++spins;
+        if(spins < 64) {
+            std::atomic_signal_fence(std::memory_order_seq_cst);
+        } else if(spins < 1024) {
+            std::this_thread::yield();
+        } else {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    }
+
+    std::vector<T> items_;
+    std::size_t mask_;
+    Padded<std::atomic<std::size_t>> head_;     // next item to write, only advanced by the producer
+    Padded<std::atomic<std::size_t>> tail_;     // next item to read, only advanced by the consumer
+    Padded<std::atomic<bool>> closed_;
+    // private state of each side, on its own cache line
+    alignas(cache_line) std::size_t head_local_ = 0;    // producer's value of head_
+    std::size_t cached_tail_ = 0;                       // producer's copy of tail_
+    alignas(cache_line) std::size_t tail_local_ = 0;    // consumer's value of tail_
+    std::size_t cached_head_ = 0;                       // consumer's copy of head_
+};
+
+} // namespace XEFormat
@@ -0,0 +1,123 @@
+/**********************************************************************************************************************
+ * MIT License                                                                                                        *
+ *                                                                                                                    *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and                  *
+ * associated documentation files (the “Software”), to deal in the Software without restriction,                      *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,              *
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,              *
+ * subject to the following conditions:                                                                               *
+ *                                                                                                                    *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial               *
+ * portions of the Software.                                                                                          *
+ *                                                                                                                    *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,                                *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND               *
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES               *
+ * OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN                *
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ **********************************************************************************************************************/
+
+#include <random>
+#include <vector>
+#include <cmath>
+#include <stdexcept>
+#include "synthetic_stream.h"
+
+namespace XEFormat {
+
+namespace {
+
+struct MovingObject {
+    double x, y;
+    double vx, vy;   // pixels per microsecond
+};
+
+// advances an object by dt microseconds, bouncing on the sensor borders
+void move_object(MovingObject &object, double dt, unsigned width, unsigned height) {
+    object.x += object.vx*dt;
+    object.y += object.vy*dt;
+    if(object.x < 0 || object.x >= width) {
+        object.vx = -object.vx;
+        object.x = std::fmin(std::fmax(object.x, 0.0), width - 1.0);
+    }
+    if(object.y < 0 || object.y >= height) {
+        object.vy = -object.vy;
+        object.y = std::fmin(std::fmax(object.y, 0.0), height - 1.0);
+    }
+}
+
+unsigned clamp_coordinate(double v, unsigned size) {
+    if(v < 0) {
+        return 0;
+    }
+    if(v >= size) {
+        return size - 1;
+    }
+    return static_cast<unsigned>(v);
+}
+
+} // namespace
+
+std::size_t write_synthetic_stream(const SyntheticStreamOptions &options, const FieldsDefinition &fdef, std::ostream &os) {
+    if(options.event_rate <= 0 || options.trigger_rate < 0 || options.clustering < 0 || options.clustering > 1
+       || options.on_fraction < 0 || options.on_fraction > 1 || options.width == 0 || options.height == 0
+       || options.width > (1u << fdef.cd_ev.x) || options.height > (1u << fdef.cd_ev.y)) {
+        throw std::runtime_error("Invalid synthetic stream options.");
+    }
+
+    std::mt19937_64 rng(options.seed);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    std::exponential_distribution<double> cd_gap(options.event_rate/1e6);
+    std::exponential_distribution<double> trigger_gap(options.trigger_rate > 0 ? options.trigger_rate/1e6 : 1.0);
+    std::normal_distribution<double> spread(0.0, options.object_radius);
+
+    std::vector<MovingObject> objects(options.num_objects);
+    for(MovingObject &object : objects) {
+        const double angle = 2*3.14159265358979323846*uniform(rng);
+        object = MovingObject{uniform(rng)*options.width, uniform(rng)*options.height,
+                              std::cos(angle)*options.object_speed/1e6, std::sin(angle)*options.object_speed/1e6};
+    }
+
+    timestamp_t abs_time_base = 0;
+    Encoder::initialize_jpegxe_canonical_file(abs_time_base, fdef, os);
+
+    double cd_time = 0, object_time = 0;
+    double trigger_time = options.trigger_rate > 0 ? trigger_gap(rng) : HUGE_VAL;
+    unsigned trigger_edge = 1;
+    std::size_t written = 0;
+    for(std::size_t i=0; i<options.num_events; ++i) {
+        cd_time += cd_gap(rng);
+        // trigger events due before the next CD event keep the stream in timestamp order
+        while(trigger_time <= cd_time) {
+            const TriggerEvent trigger{static_cast<timestamp_t>(trigger_time), trigger_edge, 0, 0};
+            Encoder::write_event_trigger(trigger, abs_time_base, fdef, os);
+            trigger_edge ^= 1;
+            trigger_time += trigger_gap(rng);
+            ++written;
+        }
+
+        unsigned x, y;
+        if(!objects.empty() && uniform(rng) < options.clustering) {
+            MovingObject &object = objects[rng() % objects.size()];
+            x = clamp_coordinate(object.x + spread(rng), options.width);
+            y = clamp_coordinate(object.y + spread(rng), options.height);
+        } else {
+            x = static_cast<unsigned>(rng() % options.width);
+            y = static_cast<unsigned>(rng() % options.height);
+        }
+        const unsigned polarity = uniform(rng) < options.on_fraction ? 1 : 0;
+        Encoder::write_event_cd(CDEvent{static_cast<timestamp_t>(cd_time), polarity, x, y}, abs_time_base, fdef, os);
+        ++written;
+
+        // objects move in steps of at least 100us, which is enough below a few pixels per 100us
+        if(cd_time - object_time >= 100) {
+            for(MovingObject &object : objects) {
+                move_object(object, cd_time - object_time, options.width, options.height);
+            }
+            object_time = cd_time;
+        }
+    }
+    return written;
+}
+
+} // namespace XEFormat
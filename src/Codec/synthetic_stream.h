@@ -0,0 +1,54 @@
+/**********************************************************************************************************************
+ * MIT License                                                                                                        *
+ *                                                                                                                    *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and                  *
+ * associated documentation files (the “Software”), to deal in the Software without restriction,                      *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,              *
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,              *
+ * subject to the following conditions:                                                                               *
+ *                                                                                                                    *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial               *
+ * portions of the Software.                                                                                          *
+ *                                                                                                                    *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,                                *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND               *
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES               *
+ * OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN                *
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ **********************************************************************************************************************/
+
+#pragma once
+
+#include <ostream>
+#include <cstddef>
+#include <cstdint>
+#include "xe_format.h"
+
+namespace XEFormat {
+
+/// @brief  Parameters of a synthetic event camera recording. The same options and seed always give the same stream.
+struct SyntheticStreamOptions {
+    std::size_t num_events = 1000000;   // CD events to generate (trigger events come on top)
+    double event_rate = 1e6;            // mean CD events per second, arrivals follow a Poisson process
+    double clustering = 0.8;            // fraction of the CD events fired by moving objects, the rest is uniform noise
+    std::size_t num_objects = 4;        // moving objects across the sensor
+    double object_radius = 12.0;        // standard deviation in pixels of the events around an object
+    double object_speed = 200.0;        // object speed in pixels per second
+    double on_fraction = 0.5;           // fraction of ON (polarity 1) CD events
+    double trigger_rate = 0.0;          // external trigger events per second, alternating rising and falling edges
+    unsigned width = 1280;
+    unsigned height = 720;
+    std::uint64_t seed = 1;
+};
+
+/// @brief  Writes a synthetic JPEG_XE canonical event file: the header from Encoder::initialize_jpegxe_canonical_file,
+///         then the CD and trigger events in timestamp order through Encoder::write_event_cd/write_event_trigger, so the
+///         absolute time base events appear exactly as in a recorded file.
+///         Throws std::runtime_error if the options are out of range.
+/// @param options stream parameters.
+/// @param fdef fields definition.
+/// @param os output stream to write the file to.
+/// @return the number of CD and trigger events written.
+std::size_t write_synthetic_stream(const SyntheticStreamOptions &options, const FieldsDefinition &fdef, std::ostream &os);
+
+} // namespace XEFormat
@@ -0,0 +1,106 @@
+/**********************************************************************************************************************
+ * MIT License                                                                                                        *
+ *                                                                                                                    *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and                  *
+ * associated documentation files (the “Software”), to deal in the Software without restriction,                      *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,              *
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,              *
+ * subject to the following conditions:                                                                               *
+ *                                                                                                                    *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial               *
+ * portions of the Software.                                                                                          *
+ *                                                                                                                    *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,                                *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND               *
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES               *
+ * OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN                *
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ **********************************************************************************************************************/
+
+#include <atomic>
+#include <algorithm>
+#include <exception>
+#include "thread_pool.h"
+
+namespace XEFormat {
+
+ThreadPool::ThreadPool(unsigned num_threads) {
+    if(num_threads == 0) {
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for(unsigned i=0; i<num_threads; ++i) {
+        workers_.emplace_back([this]() { worker_loop(); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for(std::thread &worker : workers_) {
+        worker.join();
+    }
+}
+
+void ThreadPool::worker_loop() {
+    for(;;) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [this]() { return stopping_ || !tasks_.empty(); });
+            if(tasks_.empty()) {
+                return;
+            }
+            task = std::move(tasks_.front());
+            tasks_.pop_front();
+        }
+        task();
+    }
+}
+
+void ThreadPool::parallel_for(std::size_t n, const std::function<void(std::size_t)> &f) {
+    if(n == 0) {
+        return;
+    }
+    // each runner pulls indices from a shared counter, so uneven calls balance themselves
+    std::atomic<std::size_t> next(0);
+    std::exception_ptr error;
+    std::mutex done_mutex;
+    std::condition_variable done;
+    const std::size_t num_runners = std::min<std::size_t>(n, workers_.size());
+    std::size_t running = num_runners;
+
+    auto runner = [&]() {
+        for(std::size_t i=next++; i<n; i=next++) {
+            try {
+                f(i);
+            } catch(...) {
+                std::lock_guard<std::mutex> lock(done_mutex);
+                if(!error) {
+                    error = std::current_exception();
+                }
+            }
+        }
+        std::lock_guard<std::mutex> lock(done_mutex);
+        if(--running == 0) {
+            done.notify_one();
+        }
+    };
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for(std::size_t r=0; r<num_runners; ++r) {
+            tasks_.push_back(runner);
+        }
+    }
+    wake_.notify_all();
+
+    std::unique_lock<std::mutex> lock(done_mutex);
+    done.wait(lock, [&running]() { return running == 0; });
+    if(error) {
+        std::rethrow_exception(error);
+    }
+}
+
+} // namespace XEFormat
@@ -0,0 +1,141 @@
+/**********************************************************************************************************************
+ * MIT License                                                                                                        *
+ *                                                                                                                    *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and                  *
+ * associated documentation files (the “Software”), to deal in the Software without restriction,                      *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,              *
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,              *
+ * subject to the following conditions:                                                                               *
+ *                                                                                                                    *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial               *
+ * portions of the Software.                                                                                          *
+ *                                                                                                                    *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,                                *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND               *
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES               *
+ * OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN                *
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ **********************************************************************************************************************/
+
+#include <algorithm>
+#include "work_stealing_pool.h"
+
+namespace XEFormat {
+
+namespace {
+
+// worker index of the calling thread in the pool it belongs to
+thread_local const WorkStealingPool *current_pool = nullptr;
+thread_local std::size_t current_worker = 0;
+
+} // namespace
+
+WorkStealingPool::WorkStealingPool(unsigned num_threads) {
+    if(num_threads == 0) {
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for(unsigned i=0; i<num_threads; ++i) {
+        workers_.push_back(std::make_unique<Worker>());
+    }
+    for(unsigned i=0; i<num_threads; ++i) {
+        threads_.emplace_back([this, i]() { worker_loop(i); });
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::unique_lock<std::mutex> lock(sleep_mutex_);
+        idle_.wait(lock, [this]() { return pending_.load() == 0; });
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for(std::thread &thread : threads_) {
+        thread.join();
+    }
+}
+
+void WorkStealingPool::submit(Task task) {
+    const std::size_t target = current_pool == this ? current_worker : next_worker_++ % workers_.size();
+    pending_.fetch_add(1);
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        queued_.fetch_add(1);
+    }
+    {
+        std::lock_guard<std::mutex> lock(workers_[target]->mutex);
+        workers_[target]->tasks.push_back(std::move(task));
+    }
+    wake_.notify_one();
+}
+
+void WorkStealingPool::wait() {
+    std::unique_lock<std::mutex> lock(sleep_mutex_);
+    idle_.wait(lock, [this]() { return pending_.load() == 0; });
+    if(error_) {
+        std::exception_ptr error = error_;
+        error_ = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+bool WorkStealingPool::pop_local(std::size_t self, Task &task) {
+    Worker &worker = *workers_[self];
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    if(worker.tasks.empty()) {
+        return false;
+    }
+    task = std::move(worker.tasks.back());
+    worker.tasks.pop_back();
+    queued_.fetch_sub(1);
+    return true;
+}
+
+bool WorkStealingPool::steal(std::size_t self, Task &task) {
+    for(std::size_t k=1; k<workers_.size(); ++k) {
+        Worker &victim = *workers_[(self + k) % workers_.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if(!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            queued_.fetch_sub(1);
+            steals_.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::run(Task &task) {
+    try {
+        task();
+    } catch(...) {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        if(!error_) {
+            error_ = std::current_exception();
+        }
+    }
+    task = nullptr;
+    if(pending_.fetch_sub(1) == 1) {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        idle_.notify_all();
+    }
+}
+
+void WorkStealingPool::worker_loop(std::size_t self) {
+    current_pool = this;
+    current_worker = self;
+    Task task;
+    for(;;) {
+        if(pop_local(self, task) || steal(self, task)) {
+            run(task);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleep_mutex_);
+        wake_.wait(lock, [this]() { return stopping_ || queued_.load() > 0; });
+        if(stopping_ && queued_.load() == 0) {
+            return;
+        }
+    }
+}
+
+} // namespace XEFormat
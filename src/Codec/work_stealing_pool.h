@@ -0,0 +1,93 @@
+/**********************************************************************************************************************
+ * MIT License                                                                                                        *
+ *                                                                                                                    *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and                  *
+ * associated documentation files (the “Software”), to deal in the Software without restriction,                      *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,              *
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,              *
+ * subject to the following conditions:                                                                               *
+ *                                                                                                                    *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial               *
+ * portions of the Software.                                                                                          *
+ *                                                                                                                    *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,                                *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND               *
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES               *
+ * OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN                *
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ **********************************************************************************************************************/
+
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <exception>
+#include <condition_variable>
+#include <functional>
+#include <cstddef>
+#include <cstdint>
+
+namespace XEFormat {
+
+/// @brief  Pool of worker threads for nested, uneven work (whole files that split themselves into parts). Each worker
+///         has its own deque: tasks submitted by a worker go to the back of its deque and it runs them last in, first
+///         out, while idle workers steal from the front of the other deques, taking the oldest, and usually largest,
+///         pending work first.
+class WorkStealingPool {
+public:
+    using Task = std::function<void()>;
+
+    /// @brief  Starts the worker threads.
+    /// @param num_threads number of workers; 0 uses the number of hardware threads.
+    explicit WorkStealingPool(unsigned num_threads = 0);
+
+    /// @brief  Waits for the pending tasks, then stops the workers.
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool &) = delete;
+    WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+    unsigned size() const { return static_cast<unsigned>(threads_.size()); }
+
+    /// @brief  Schedules a task. From a worker of this pool the task goes to that worker's deque, from any other
+    ///         thread the tasks are spread over the workers in turn.
+    void submit(Task task);
+
+    /// @brief  Waits until every submitted task, including the tasks they submitted, has run.
+    ///         If some tasks threw, the first exception is rethrown.
+    void wait();
+
+    /// @brief  Number of tasks run by another worker than the one they were queued on.
+    std::uint64_t num_steals() const { return steals_.load(std::memory_order_relaxed); }
+
+private:
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    bool pop_local(std::size_t self, Task &task);
+    bool steal(std::size_t self, Task &task);
+    void worker_loop(std::size_t self);
+    void run(Task &task);
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::vector<std::thread> threads_;
+    std::atomic<std::size_t> next_worker_{0};
+    std::atomic<std::uint64_t> steals_{0};
+
+    // queued_ is only increased under sleep_mutex_, so a worker checking it before sleeping cannot miss a task
+    std::mutex sleep_mutex_;
+    std::condition_variable wake_;
+    std::condition_variable idle_;
+    std::atomic<std::size_t> queued_{0};    // tasks in the deques
+    std::atomic<std::size_t> pending_{0};   // tasks submitted and not finished
+    bool stopping_ = false;
+    std::exception_ptr error_;
+};
+
+} // namespace XEFormat
@@ -19,35 +19,17 @@
 
 #include <sstream>
 #include <iomanip>
+#include <cstring>
 #include "xe_format.h"
+#include "instrumentation.h"
 #include "jpeg_xe_canonical_raw_event_format_ctc_header.h"
 
 namespace XEFormat {
 
-FieldsDefinition FieldsDefinition::make_reference() {
-    FieldsDefinition ref_def;
-    ref_def.event_size = 48;
-    ref_def.event_size_bytes = static_cast<std::uint8_t>(ref_def.event_size/8);
-    ref_def.event_type_bit_size = 2;
-
-    ref_def.absts.abstimestamp = 46;
-
-    ref_def.cd_ev.relativetimestamp = 23;
-    ref_def.cd_ev.polarity = 1;
-    ref_def.cd_ev.x = 11;
-    ref_def.cd_ev.y = 11;
-
-    ref_def.tr_ev.relativetimestamp = 23;
-    ref_def.tr_ev.polarity = 1;
-    ref_def.tr_ev.triggerid = 8;
-    ref_def.tr_ev.padding = 14;
-
-    return ref_def;
-}
-
 namespace Decoder {
 
 bool assert_jpegxe_canonical_header(std::istream &is) {
+    XE_METRICS_TIME(HeaderParse);
     const std::string ref_jpegxe_canonical_hex_header = REFERENCE_JPEG_XE_CANONICAL_RAW_EVENT_FORMAT_CTC_HEX_HEADER;
     const std::size_t ref_nfields = (ref_jpegxe_canonical_hex_header.size()-24)/8;
     
@@ -85,16 +67,27 @@ bool assert_jpegxe_canonical_header(std::istream &is) {
 }
 
 bool read_next_encoded_event(std::istream &is, const FieldsDefinition &fdef, encoded_event_t &read_encoded_event) {
+    return read_encoded_events(is, fdef, &read_encoded_event, 1) == 1;
+}
+
+std::size_t read_encoded_events(std::istream &is, const FieldsDefinition &fdef, encoded_event_t *encoded_events, std::size_t max_events) {
     assert(fdef.event_size <= 64);  // implementation only supports up to 64 bits events
-    read_encoded_event = 0;
-    for(int i=0; i<fdef.event_size_bytes; ++i) {
-        std::uint8_t read_byte;
-        if(!is.read((char*) &read_byte, 1)) {
-            return false;
-        }
-        read_encoded_event = (read_encoded_event << 8) + read_byte;
+    const std::size_t ev_bytes = fdef.event_size_bytes;
+    // the packed events are read into the tail of the output array: unpacking event i only overwrites bytes that
+    // were already consumed, so no intermediate buffer is needed
+    std::uint8_t *staging = reinterpret_cast<std::uint8_t*>(encoded_events) + max_events*(sizeof(encoded_event_t)-ev_bytes);
+    is.read(reinterpret_cast<char*>(staging), static_cast<std::streamsize>(max_events*ev_bytes));
+    const std::size_t n_events = static_cast<std::size_t>(is.gcount())/ev_bytes;
+    XE_METRICS_ADD(BytesRead, static_cast<std::uint64_t>(is.gcount()));
+    XE_METRICS_ADD(EventsRead, n_events);
+    if(n_events < max_events) {
+        // short read: move the complete events to where the in-place unpacking expects them
+        std::uint8_t *dst = reinterpret_cast<std::uint8_t*>(encoded_events) + n_events*(sizeof(encoded_event_t)-ev_bytes);
+        std::memmove(dst, staging, n_events*ev_bytes);
+        staging = dst;
     }
-    return true;
+    unpack_encoded_events(staging, n_events, fdef, encoded_events);
+    return n_events;
 }
 
 EventType decode_event_type(encoded_event_t encoded_event, const FieldsDefinition &fdef) {
@@ -112,7 +105,8 @@ EventType decode_event_type(encoded_event_t encoded_event, const FieldsDefinitio
 }
 
 timestamp_t decode_event_timestamp(encoded_event_t encoded_event, const FieldsDefinition &fdef) {
-    switch(decode_event_type(encoded_event, fdef)) {
+    // switches on the type bits directly rather than through decode_event_type, which callers have usually run already
+    switch(encoded_event & ((static_cast<std::uint64_t>(1)<<fdef.event_type_bit_size)-1)) {
         case ABSTimeStamp:
             return (encoded_event >> fdef.event_type_bit_size) & ((static_cast<std::uint64_t>(1)<<fdef.absts.abstimestamp)-1);
         case CD:
@@ -169,10 +163,13 @@ void initialize_jpegxe_canonical_file(timestamp_t abs_time_base, const FieldsDef
 }
 
 void write_encoded_event(std::ostream &os, const FieldsDefinition &fdef, const encoded_event_t &encoded_event) {
-    for(int i=fdef.event_size_bytes-1; i>=0; --i) {
-        const std::uint8_t byte = static_cast<std::uint8_t>((encoded_event >> (i*8)) & 0xFF);
-        os.write((char*) &byte, 1);
+    assert(fdef.event_size_bytes <= sizeof(encoded_event_t));
+    // the record is packed first and written with a single call, rather than one call per byte
+    char bytes[sizeof(encoded_event_t)];
+    for(std::size_t i=0; i<fdef.event_size_bytes; ++i) {
+        bytes[i] = static_cast<char>((encoded_event >> ((fdef.event_size_bytes-1-i)*8)) & 0xFF);
     }
+    os.write(bytes, static_cast<std::streamsize>(fdef.event_size_bytes));
 }
 
 encoded_event_t encode_event_absts(timestamp_t abs_time_base, const FieldsDefinition &fdef) {
@@ -211,11 +208,13 @@ encoded_event_t encode_event_trigger(const TriggerEvent &event_trigger, timestam
 bool update_absolute_time_base(timestamp_t &abs_time_base, timestamp_t next_timestamp, const FieldsDefinition &fdef) {
     assert(fdef.cd_ev.relativetimestamp == fdef.tr_ev.relativetimestamp);
     assert(abs_time_base <= next_timestamp);
-    bool updated = false;
-    const timestamp_t max_rel_ts = (static_cast<std::uint64_t>(1)<<fdef.cd_ev.relativetimestamp);
-    while(abs_time_base + max_rel_ts <= next_timestamp) {
-        abs_time_base += max_rel_ts;
-        updated = true;
+    // number of whole relative timestamp periods between the time base and the next event, so that a long silent
+    // period costs the same as a short one
+    const timestamp_t periods = (next_timestamp - abs_time_base) >> fdef.cd_ev.relativetimestamp;
+    abs_time_base += periods << fdef.cd_ev.relativetimestamp;
+    const bool updated = periods != 0;
+    if(updated) {
+        XE_METRICS_ADD(TimeBaseUpdates, 1);
     }
     return updated;
 }
@@ -227,6 +226,7 @@ void write_event_cd(const CDEvent &event_cd, timestamp_t &abs_time_base, const F
     }
     const encoded_event_t encoded_event = encode_event_cd(event_cd, abs_time_base, fdef);
     write_encoded_event(os, fdef, encoded_event);
+    XE_METRICS_ADD(CDEventsEncoded, 1);
 }
 
 void write_event_trigger(const TriggerEvent &event_trigger, timestamp_t &abs_time_base, const FieldsDefinition &fdef, std::ostream &os) {
@@ -236,6 +236,7 @@ void write_event_trigger(const TriggerEvent &event_trigger, timestamp_t &abs_tim
     }
     const encoded_event_t encoded_event = encode_event_trigger(event_trigger, abs_time_base, fdef);
     write_encoded_event(os, fdef, encoded_event);
+    XE_METRICS_ADD(TriggerEventsEncoded, 1);
 }
 
 } //namespace Encoder
@@ -21,6 +21,7 @@
 
 #include <vector>
 #include <istream>
+#include <cstddef>
 #include <cstdint>
 #include <cmath>
 #include <cassert>
@@ -53,7 +54,7 @@ struct CDEvent {
     unsigned int x;
     unsigned int y;
 
-    bool operator==(const CDEvent &other) const {
+    constexpr bool operator==(const CDEvent &other) const {
         return timestamp==other.timestamp && polarity==other.polarity && x==other.x && y==other.y;
     }
 };
@@ -63,7 +64,7 @@ struct TriggerEvent {
     unsigned int polarity;
     unsigned int triggerid;
     unsigned int padding;
-    bool operator==(const TriggerEvent &other) const {
+    constexpr bool operator==(const TriggerEvent &other) const {
         return timestamp==other.timestamp && polarity==other.polarity && triggerid==other.triggerid;
     }
 };
@@ -99,9 +100,30 @@ struct FieldsDefinition {
     Sizes_CDEvent cd_ev;
     Sizes_TriggerEvent tr_ev;
 
-    static FieldsDefinition make_reference();
+    static constexpr FieldsDefinition make_reference();
 };
 
+constexpr FieldsDefinition FieldsDefinition::make_reference() {
+    FieldsDefinition ref_def{};
+    ref_def.event_size = 48;
+    ref_def.event_size_bytes = static_cast<std::uint8_t>(ref_def.event_size/8);
+    ref_def.event_type_bit_size = 2;
+
+    ref_def.absts.abstimestamp = 46;
+
+    ref_def.cd_ev.relativetimestamp = 23;
+    ref_def.cd_ev.polarity = 1;
+    ref_def.cd_ev.x = 11;
+    ref_def.cd_ev.y = 11;
+
+    ref_def.tr_ev.relativetimestamp = 23;
+    ref_def.tr_ev.polarity = 1;
+    ref_def.tr_ev.triggerid = 8;
+    ref_def.tr_ev.padding = 14;
+
+    return ref_def;
+}
+
 using encoded_event_t = std::uint64_t;
 
 namespace Decoder {
@@ -118,6 +140,24 @@ bool assert_jpegxe_canonical_header(std::istream &is);
 /// @return true if the encoded event was successfully read, false otherwise.
 bool read_next_encoded_event(std::istream &is, const FieldsDefinition &fdef, encoded_event_t &read_encoded_event);
 
+/// @brief  Unpacks consecutive big-endian encoded events from a raw byte buffer (vectorised, see event_kernels.cpp).
+///         The output may overlap the end of the input as long as it starts at or before it.
+/// @param bytes raw buffer holding n_events*fdef.event_size_bytes bytes.
+/// @param n_events number of events to unpack.
+/// @param fdef fields definition.
+/// @param encoded_events output array with room for n_events encoded events.
+void unpack_encoded_events(const std::uint8_t *bytes, std::size_t n_events, const FieldsDefinition &fdef, encoded_event_t *encoded_events);
+
+/// @brief  Reads up to max_events encoded events from the input stream with a single bulk read.
+///         The raw bytes are staged in the tail of the output array and unpacked in place, so the chunk size is
+///         entirely controlled by the caller (1 to 16 MiB chunks work well for large files).
+/// @param is input stream to read the encoded events from.
+/// @param fdef fields definition.
+/// @param encoded_events output array with room for max_events encoded events.
+/// @param max_events maximum number of events to read.
+/// @return the number of complete encoded events read; lower than max_events only at the end of the stream.
+std::size_t read_encoded_events(std::istream &is, const FieldsDefinition &fdef, encoded_event_t *encoded_events, std::size_t max_events);
+
 /// @brief  Decodes the event type from the input encoded event.
 /// @param encoded_event encoded event.
 /// @param fdef fields definition.
@@ -160,6 +200,14 @@ void initialize_jpegxe_canonical_file(timestamp_t abs_time_base, const FieldsDef
 /// @param encoded_event encoded event to be written.
 void write_encoded_event(std::ostream &os, const FieldsDefinition &fdef, const encoded_event_t &encoded_event);
 
+/// @brief  Packs encoded events into consecutive big-endian records, the inverse of Decoder::unpack_encoded_events
+///         (vectorised, see event_kernels.cpp).
+/// @param encoded_events encoded events to pack.
+/// @param n_events number of events to pack.
+/// @param fdef fields definition.
+/// @param bytes output buffer with room for n_events*fdef.event_size_bytes bytes.
+void pack_encoded_events(const encoded_event_t *encoded_events, std::size_t n_events, const FieldsDefinition &fdef, std::uint8_t *bytes);
+
 /// @brief  Encodes an absolute time base event.
 /// @param abs_time_base the absolute time-base to be encoded.
 /// @param fdef fields definition.
@@ -0,0 +1,235 @@
+/**********************************************************************************************************************
+ * MIT License                                                                                                        *
+ *                                                                                                                    *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and                  *
+ * associated documentation files (the “Software”), to deal in the Software without restriction,                      *
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,              *
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,              *
+ * subject to the following conditions:                                                                               *
+ *                                                                                                                    *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial               *
+ * portions of the Software.                                                                                          *
+ *                                                                                                                    *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,                                *
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND               *
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES               *
+ * OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN                *
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                                         *
+ **********************************************************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "xe_format.h"
+
+namespace XEFormat {
+
+/// @brief  Reference 48-bit layout, usable as a template argument of StaticLayout.
+inline constexpr FieldsDefinition reference_fields_definition = FieldsDefinition::make_reference();
+
+/// @brief  Returns true if two fields definitions describe the same layout.
+constexpr bool same_layout(const FieldsDefinition &a, const FieldsDefinition &b) {
+    return a.event_size == b.event_size && a.event_size_bytes == b.event_size_bytes && a.event_type_bit_size == b.event_type_bit_size &&
+           a.absts.abstimestamp == b.absts.abstimestamp && a.cd_ev.relativetimestamp == b.cd_ev.relativetimestamp &&
+           a.cd_ev.polarity == b.cd_ev.polarity && a.cd_ev.x == b.cd_ev.x && a.cd_ev.y == b.cd_ev.y &&
+           a.tr_ev.relativetimestamp == b.tr_ev.relativetimestamp && a.tr_ev.polarity == b.tr_ev.polarity &&
+           a.tr_ev.triggerid == b.tr_ev.triggerid && a.tr_ev.padding == b.tr_ev.padding;
+}
+
+namespace LayoutDetail {
+
+constexpr std::uint64_t mask(unsigned bits) {
+    return bits >= 64 ? ~std::uint64_t(0) : (std::uint64_t(1) << bits) - 1;
+}
+
+/// @brief  Shifts and masks of every field, derived from a fields definition. The members are the same for the
+///         compile-time and the runtime layouts, only their storage differs.
+struct Shifts {
+    std::uint64_t type_mask;
+    unsigned ts_shift;
+    std::uint64_t cd_ts_mask, tr_ts_mask, abs_ts_mask;
+    unsigned cd_polarity_shift, cd_x_shift, cd_y_shift;
+    std::uint64_t cd_polarity_mask, cd_x_mask, cd_y_mask;
+    unsigned tr_polarity_shift, tr_id_shift;
+    std::uint64_t tr_polarity_mask, tr_id_mask;
+
+    constexpr explicit Shifts(const FieldsDefinition &fdef)
+        : type_mask(mask(fdef.event_type_bit_size)), ts_shift(fdef.event_type_bit_size),
+          cd_ts_mask(mask(fdef.cd_ev.relativetimestamp)), tr_ts_mask(mask(fdef.tr_ev.relativetimestamp)),
+          abs_ts_mask(mask(fdef.absts.abstimestamp)),
+          cd_polarity_shift(fdef.event_type_bit_size + fdef.cd_ev.relativetimestamp),
+          cd_x_shift(cd_polarity_shift + fdef.cd_ev.polarity), cd_y_shift(cd_x_shift + fdef.cd_ev.x),
+          cd_polarity_mask(mask(fdef.cd_ev.polarity)), cd_x_mask(mask(fdef.cd_ev.x)), cd_y_mask(mask(fdef.cd_ev.y)),
+          tr_polarity_shift(fdef.event_type_bit_size + fdef.tr_ev.relativetimestamp),
+          tr_id_shift(tr_polarity_shift + fdef.tr_ev.polarity),
+          tr_polarity_mask(mask(fdef.tr_ev.polarity)), tr_id_mask(mask(fdef.tr_ev.triggerid)) {}
+
+    /// @brief  Mask of the timestamp field of an event type, 0 for unknown types (no branch).
+    constexpr std::uint64_t timestamp_mask(std::uint64_t type) const {
+        return (type == EventType::CD ? cd_ts_mask : 0) | (type == EventType::Trigger ? tr_ts_mask : 0) |
+               (type == EventType::ABSTimeStamp ? abs_ts_mask : 0);
+    }
+};
+
+} // namespace LayoutDetail
+
+/// @brief  Event codec whose field widths are compile-time constants, so every shift and mask folds into the code.
+///         Same encoding as the functions of xe_format.h, without their runtime checks: the decoders do not check the
+///         event type (callers switch on type_bits() first), nothing throws, and update_absolute_time_base is O(1).
+/// @tparam Fdef layout, e.g. reference_fields_definition (see ReferenceLayout).
+template <const FieldsDefinition &Fdef>
+struct StaticLayout {
+    static constexpr LayoutDetail::Shifts shifts{Fdef};
+
+    static constexpr const FieldsDefinition &fields() { return Fdef; }
+    static constexpr std::size_t event_size_bytes() { return Fdef.event_size_bytes; }
+
+    static constexpr std::uint64_t type_bits(encoded_event_t encoded_event) { return encoded_event & shifts.type_mask; }
+
+    /// @brief  Same as Decoder::decode_event_timestamp, 0 for unknown event types.
+    static constexpr timestamp_t decode_event_timestamp(encoded_event_t encoded_event) {
+        return (encoded_event >> shifts.ts_shift) & shifts.timestamp_mask(type_bits(encoded_event));
+    }
+
+    static constexpr CDEvent decode_event_cd(encoded_event_t encoded_event, timestamp_t abs_time_base) {
+        return CDEvent{abs_time_base + ((encoded_event >> shifts.ts_shift) & shifts.cd_ts_mask),
+                       static_cast<unsigned int>((encoded_event >> shifts.cd_polarity_shift) & shifts.cd_polarity_mask),
+                       static_cast<unsigned int>((encoded_event >> shifts.cd_x_shift) & shifts.cd_x_mask),
+                       static_cast<unsigned int>((encoded_event >> shifts.cd_y_shift) & shifts.cd_y_mask)};
+    }
+
+    static constexpr TriggerEvent decode_event_trigger(encoded_event_t encoded_event, timestamp_t abs_time_base) {
+        return TriggerEvent{abs_time_base + ((encoded_event >> shifts.ts_shift) & shifts.tr_ts_mask),
+                            static_cast<unsigned int>((encoded_event >> shifts.tr_polarity_shift) & shifts.tr_polarity_mask),
+                            static_cast<unsigned int>((encoded_event >> shifts.tr_id_shift) & shifts.tr_id_mask), 0};
+    }
+
+    static constexpr encoded_event_t encode_event_absts(timestamp_t abs_time_base) {
+        return EventType::ABSTimeStamp | (abs_time_base << shifts.ts_shift);
+    }
+
+    static constexpr encoded_event_t encode_event_cd(const CDEvent &event_cd, timestamp_t abs_time_base) {
+        return EventType::CD | ((event_cd.timestamp - abs_time_base) << shifts.ts_shift) |
+               (static_cast<std::uint64_t>(event_cd.polarity) << shifts.cd_polarity_shift) |
+               (static_cast<std::uint64_t>(event_cd.x) << shifts.cd_x_shift) | (static_cast<std::uint64_t>(event_cd.y) << shifts.cd_y_shift);
+    }
+
+    static constexpr encoded_event_t encode_event_trigger(const TriggerEvent &event_trigger, timestamp_t abs_time_base) {
+        return EventType::Trigger | ((event_trigger.timestamp - abs_time_base) << shifts.ts_shift) |
+               (static_cast<std::uint64_t>(event_trigger.polarity) << shifts.tr_polarity_shift) |
+               (static_cast<std::uint64_t>(event_trigger.triggerid) << shifts.tr_id_shift);
+    }
+
+    /// @brief  Same as Encoder::update_absolute_time_base, jumping straight to the last time base.
+    static constexpr bool update_absolute_time_base(timestamp_t &abs_time_base, timestamp_t next_timestamp) {
+        const timestamp_t periods = (next_timestamp - abs_time_base) >> Fdef.cd_ev.relativetimestamp;
+        abs_time_base += periods << Fdef.cd_ev.relativetimestamp;
+        return periods != 0;
+    }
+
+    /// @brief  Reads one big-endian record of event_size_bytes() bytes.
+    static encoded_event_t load_record(const std::uint8_t *p) {
+        encoded_event_t encoded_event = 0;
+        for(std::size_t b=0; b<Fdef.event_size_bytes; ++b) {
+            encoded_event = (encoded_event << 8) | p[b];
+        }
+        return encoded_event;
+    }
+
+    /// @brief  Writes one big-endian record of event_size_bytes() bytes.
+    static void store_record(encoded_event_t encoded_event, std::uint8_t *p) {
+        for(std::size_t b=0; b<Fdef.event_size_bytes; ++b) {
+            p[b] = static_cast<std::uint8_t>(encoded_event >> ((Fdef.event_size_bytes-1-b)*8));
+        }
+    }
+};
+
+/// @brief  Compile-time codec of the reference 48-bit layout.
+using ReferenceLayout = StaticLayout<reference_fields_definition>;
+
+static_assert(ReferenceLayout::decode_event_cd(ReferenceLayout::encode_event_cd(CDEvent{(1 << 23) + 1234, 1, 1279, 719}, 1 << 23), 1 << 23) ==
+              CDEvent{(1 << 23) + 1234, 1, 1279, 719}, "reference layout CD round trip");
+static_assert(ReferenceLayout::decode_event_timestamp(ReferenceLayout::encode_event_absts(12345)) == 12345, "reference layout time base round trip");
+
+/// @brief  Same interface as StaticLayout for a layout only known at runtime, so that code templated on the layout
+///         can be instantiated for both (see with_layout).
+class RuntimeLayout {
+public:
+    explicit RuntimeLayout(const FieldsDefinition &fdef) : shifts(fdef), fdef_(fdef) {}
+
+    const LayoutDetail::Shifts shifts;
+
+    const FieldsDefinition &fields() const { return fdef_; }
+    std::size_t event_size_bytes() const { return fdef_.event_size_bytes; }
+
+    std::uint64_t type_bits(encoded_event_t encoded_event) const { return encoded_event & shifts.type_mask; }
+
+    timestamp_t decode_event_timestamp(encoded_event_t encoded_event) const {
+        return (encoded_event >> shifts.ts_shift) & shifts.timestamp_mask(type_bits(encoded_event));
+    }
+
+    CDEvent decode_event_cd(encoded_event_t encoded_event, timestamp_t abs_time_base) const {
+        return CDEvent{abs_time_base + ((encoded_event >> shifts.ts_shift) & shifts.cd_ts_mask),
+                       static_cast<unsigned int>((encoded_event >> shifts.cd_polarity_shift) & shifts.cd_polarity_mask),
+                       static_cast<unsigned int>((encoded_event >> shifts.cd_x_shift) & shifts.cd_x_mask),
+                       static_cast<unsigned int>((encoded_event >> shifts.cd_y_shift) & shifts.cd_y_mask)};
+    }
+
+    TriggerEvent decode_event_trigger(encoded_event_t encoded_event, timestamp_t abs_time_base) const {
+        return TriggerEvent{abs_time_base + ((encoded_event >> shifts.ts_shift) & shifts.tr_ts_mask),
+                            static_cast<unsigned int>((encoded_event >> shifts.tr_polarity_shift) & shifts.tr_polarity_mask),
+                            static_cast<unsigned int>((encoded_event >> shifts.tr_id_shift) & shifts.tr_id_mask), 0};
+    }
+
+    encoded_event_t encode_event_absts(timestamp_t abs_time_base) const {
+        return EventType::ABSTimeStamp | (abs_time_base << shifts.ts_shift);
+    }
+
+    encoded_event_t encode_event_cd(const CDEvent &event_cd, timestamp_t abs_time_base) const {
+        return EventType::CD | ((event_cd.timestamp - abs_time_base) << shifts.ts_shift) |
+               (static_cast<std::uint64_t>(event_cd.polarity) << shifts.cd_polarity_shift) |
+               (static_cast<std::uint64_t>(event_cd.x) << shifts.cd_x_shift) | (static_cast<std::uint64_t>(event_cd.y) << shifts.cd_y_shift);
+    }
+
+    encoded_event_t encode_event_trigger(const TriggerEvent &event_trigger, timestamp_t abs_time_base) const {
+        return EventType::Trigger | ((event_trigger.timestamp - abs_time_base) << shifts.ts_shift) |
+               (static_cast<std::uint64_t>(event_trigger.polarity) << shifts.tr_polarity_shift) |
+               (static_cast<std::uint64_t>(event_trigger.triggerid) << shifts.tr_id_shift);
+    }
+
+    bool update_absolute_time_base(timestamp_t &abs_time_base, timestamp_t next_timestamp) const {
+        const timestamp_t periods = (next_timestamp - abs_time_base) >> fdef_.cd_ev.relativetimestamp;
+        abs_time_base += periods << fdef_.cd_ev.relativetimestamp;
+        return periods != 0;
+    }
+
+    encoded_event_t load_record(const std::uint8_t *p) const {
+        encoded_event_t encoded_event = 0;
+        for(std::size_t b=0; b<fdef_.event_size_bytes; ++b) {
+            encoded_event = (encoded_event << 8) | p[b];
+        }
+        return encoded_event;
+    }
+
+    void store_record(encoded_event_t encoded_event, std::uint8_t *p) const {
+        for(std::size_t b=0; b<fdef_.event_size_bytes; ++b) {
+            p[b] = static_cast<std::uint8_t>(encoded_event >> ((fdef_.event_size_bytes-1-b)*8));
+        }
+    }
+
+private:
+    FieldsDefinition fdef_;
+};
+
+/// @brief  Calls f with ReferenceLayout if fdef is the reference layout, with a RuntimeLayout otherwise.
+///         f is typically a generic lambda, instantiated once for each kind of layout.
+template <typename F>
+decltype(auto) with_layout(const FieldsDefinition &fdef, F &&f) {
+    if(same_layout(fdef, reference_fields_definition)) {
+        return f(ReferenceLayout{});
+    }
+    return f(RuntimeLayout(fdef));
+}
+
+} // namespace XEFormat
@@ -0,0 +1,122 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <cstring>
+#include <cstdint>
+#include <cstdlib>
+#include <stdexcept>
+#include "../Codec/xe_format.h"
+#include "../Codec/mapped_file.h"
+#include "../Codec/bxe_codec.h"
+#include "../Codec/event_analytics.h"
+#include "../Codec/output_sink.h"
+#include "../Codec/model_store.h"
+
+using namespace XEFormat;
+
+int main(int argc, char* argv[]) {
+    const char* usage = " INPUT_FILE [--period US] [--frames OUTPUT_FILE] [--surface OUTPUT_FILE] [--histogram OUTPUT_FILE] [--width W] [--height H] [--threads N] [--models MODEL_DIR]";
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << usage << std::endl;
+        return 1;
+    }
+
+    AnalyticsOptions options;
+    std::string frames_path, surface_path, histogram_path, model_dir;
+    unsigned num_threads = 0;
+    for (int i = 2; i < argc; ++i) {
+        if (i + 1 < argc && std::strcmp(argv[i], "--period") == 0) {
+            options.frame_period = std::strtoull(argv[++i], nullptr, 10);
+        } else if (i + 1 < argc && std::strcmp(argv[i], "--frames") == 0) {
+            frames_path = argv[++i];
+        } else if (i + 1 < argc && std::strcmp(argv[i], "--surface") == 0) {
+            surface_path = argv[++i];
+        } else if (i + 1 < argc && std::strcmp(argv[i], "--histogram") == 0) {
+            histogram_path = argv[++i];
+        } else if (i + 1 < argc && std::strcmp(argv[i], "--width") == 0) {
+            options.width = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (i + 1 < argc && std::strcmp(argv[i], "--height") == 0) {
+            options.height = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (i + 1 < argc && std::strcmp(argv[i], "--threads") == 0) {
+            num_threads = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (i + 1 < argc && std::strcmp(argv[i], "--models") == 0) {
+            model_dir = argv[++i];
+        } else {
+            std::cerr << "Usage: " << argv[0] << usage << std::endl;
+            return 1;
+        }
+    }
+    if (!frames_path.empty() && options.frame_period == 0) {
+        std::cerr << "--frames needs a window length (--period)." << std::endl;
+        return 1;
+    }
+    //só se calcula o que vai ser escrito
+    options.time_surface = !surface_path.empty();
+    options.polarity_histogram = !histogram_path.empty();
+    options.num_threads = num_threads;
+
+    const FieldsDefinition fields_def = FieldsDefinition::make_reference();
+
+    try {
+        //as frames são escritas à medida que cada janela fecha: número da janela (u64), número de eventos (u64) e
+        //width*height contadores u32; as janelas sem eventos não são escritas
+        std::unique_ptr<OutputSink> frames_output;
+        if (!frames_path.empty())
+            frames_output.reset(new OutputSink(frames_path));
+        size_t num_frames = 0;
+        uint64_t first_window = 0;
+        EventAccumulator accumulator(fields_def, options, [&](const CountFrame &frame) {
+            if (num_frames++ == 0)
+                first_window = frame.index;
+            if (frames_output) {
+                const uint64_t header[2] = {frame.index, frame.num_events};
+                frames_output->write(header, sizeof(header));
+                frames_output->write(frame.counts, sizeof(uint32_t) * accumulator.width() * accumulator.height());
+            }
+        });
+
+        //o ficheiro de entrada pode ser comprimido (.bxez) ou um .bxe, reconhecido pelo cabeçalho
+        const auto start = std::chrono::steady_clock::now();
+        size_t num_events;
+        {
+            const MappedFile input_file(argv[1]);
+            if (is_compressed_bxe(input_file.data(), input_file.size())) {
+                const ModelStore models(model_dir.empty() ? "." : model_dir);
+                num_events = accumulate_compressed_bxe(input_file.data(), input_file.size(), fields_def, accumulator, num_threads, &models);
+            } else {
+                const BlockXEFile bxe_file(argv[1], fields_def);
+                num_events = accumulate_bxe(bxe_file, fields_def, accumulator);
+            }
+        }
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (frames_output)
+            frames_output->finish();
+
+        //superfícies e histogramas: um plano width*height por polaridade
+        const size_t plane = static_cast<size_t>(accumulator.width()) * accumulator.height();
+        if (!surface_path.empty()) {
+            OutputSink output(surface_path);
+            for (unsigned p = 0; p < accumulator.num_polarities(); ++p)
+                output.write(accumulator.time_surface(p), sizeof(timestamp_t) * plane);
+            output.finish();
+        }
+        if (!histogram_path.empty()) {
+            OutputSink output(histogram_path);
+            for (unsigned p = 0; p < accumulator.num_polarities(); ++p)
+                output.write(accumulator.polarity_histogram(p), sizeof(uint32_t) * plane);
+            output.finish();
+        }
+
+        std::cout << "Accumulated " << accumulator.num_events() << " CD events (" << accumulator.dropped_events() << " outside the "
+                  << accumulator.width() << "x" << accumulator.height() << " frame) out of " << num_events << " events in " << seconds << " s" << std::endl;
+        if (options.frame_period > 0)
+            std::cout << num_frames << " frames of " << options.frame_period << " us, the first one starting at " << first_window * options.frame_period << " us" << std::endl;
+    } catch (const std::runtime_error &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -1,68 +1,173 @@
 #include <iostream>
-#include <fstream>
 #include <vector>
 #include <cstdint>
-#include "../codec/xe_format.h"
+#include <cstdlib>
+#include <stdexcept>
+#include "../Codec/xe_format.h"
+#include "../Codec/bxe_format.h"
+#include "../Codec/mapped_file.h"
+#include "../Codec/integrity.h"
+#include "../Codec/output_sink.h"
+#include "../Codec/instrumentation.h"
 
 using namespace XEFormat;
 
-struct BlockHeader {
-    uint16_t num_events;
-};
+//escreve os eventos de um bloco com timestamp em [t0, t1); os eventos de base de tempo são sempre escritos
+//os registos seguidos que ficam na janela são copiados de uma vez para o buffer de saída
+static void write_window(const BlockXEFile::Block &block, timestamp_t &abs_time_base, timestamp_t t0, timestamp_t t1, const FieldsDefinition &fields_def, OutputSink &output) {
+    XE_METRICS_TIME(Decode);
+    const size_t ev_bytes = fields_def.event_size_bytes;
+    size_t run_start = 0;
+    for (size_t i = 0; i < block.available_events; ++i) {
+        const uint8_t* record = block.event_bytes + i * ev_bytes;
+        encoded_event_t ev;
+        Decoder::unpack_encoded_events(record, 1, fields_def, &ev);
+        if (Decoder::decode_event_type(ev, fields_def) == EventType::ABSTimeStamp) {
+            abs_time_base = Decoder::decode_event_timestamp(ev, fields_def);
+        } else {
+            const timestamp_t timestamp = abs_time_base + Decoder::decode_event_timestamp(ev, fields_def);
+            if (timestamp < t0 || timestamp >= t1) {
+                output.write(block.event_bytes + run_start * ev_bytes, (i - run_start) * ev_bytes);
+                run_start = i + 1;
+            }
+        }
+    }
+    output.write(block.event_bytes + run_start * ev_bytes, (block.available_events - run_start) * ev_bytes);
+}
 
-int main(int argc, char* argv[]) {
-    if (argc != 3) {
-        std::cerr << "Usage: " << argv[0] << " INPUT_BXE_FILE OUTPUT_XE_FILE" << std::endl;
-        return 1;
+//um bloco incompleto, cujo CRC-32C não confere ou cujo cabeçalho não confere com a entrada do índice é saltado e reportado,
+//em vez de corromper o resto da saída
+static bool intact_block(const BlockXEFile &file, const BlockXEFile::Block &block, const BlockIndexEntry *entry, const FieldsDefinition &fields_def, size_t &skipped) {
+    if (entry != nullptr && (block.offset != entry->offset || block.num_events != entry->num_events)) {
+        std::cerr << "Corrupted block at offset " << entry->offset << " (header does not match the index), skipped." << std::endl;
+        ++skipped;
+        return false;
     }
+    if (verify_block(file, block, fields_def))
+        return true;
+    if (block.truncated())
+        std::cerr << "Truncated block at offset " << block.offset << " (" << block.available_events << " of " << block.num_events << " events), skipped." << std::endl;
+    else
+        std::cerr << "Corrupted block at offset " << block.offset << " (" << block.num_events << " events, checksum mismatch), skipped." << std::endl;
+    ++skipped;
+    return false;
+}
 
-    const char* bxe_filename = argv[1];
-    const char* output_filename = argv[2];
+//percorre os blocos intactos; visit recebe o bloco e se algum bloco foi saltado desde o anterior.
+//com índice, cada bloco é lido na posição da sua entrada e um número de eventos corrompido não desloca os seguintes;
+//sem índice, a posição do bloco seguinte vem do cabeçalho do anterior, pelo que a leitura pára no primeiro bloco corrompido
+template <typename Visit>
+static void for_each_intact_block(const BlockXEFile &file, size_t first, size_t last, const FieldsDefinition &fields_def, size_t &skipped, Visit visit) {
+    bool resync = false;
+    if (file.indexed()) {
+        for (size_t i = first; i < last; ++i) {
+            const BlockIndexEntry entry = file.index_entry(i);
+            const BlockXEFile::const_iterator block = file.block_at(entry.offset);
+            if (!intact_block(file, *block, &entry, fields_def, skipped)) {
+                resync = true;
+                continue;
+            }
+            visit(*block, resync);
+            resync = false;
+        }
+        return;
+    }
+    for (const BlockXEFile::Block &block : file) {
+        if (!intact_block(file, block, nullptr, fields_def, skipped)) {
+            if (!block.truncated())
+                std::cerr << "File without index truncated after corruption at offset " << block.offset << ", the following blocks cannot be located." << std::endl;
+            return;
+        }
+        visit(block, resync);
+    }
+}
 
-    std::ifstream input_file(bxe_filename, std::ios::binary);
-    if (!input_file) {
-        std::cerr << "Cannot open input .bxe file: " << bxe_filename << std::endl;
-        return 1;
+//depois de um bloco saltado, a base de tempo volta a ser a guardada no cabeçalho do bloco seguinte
+static void resync_time_base(const BlockXEFile::Block &block, timestamp_t &abs_time_base, const FieldsDefinition &fields_def, std::ostream &output_file) {
+    if (block.has_time_base && block.abs_time_base != abs_time_base) {
+        abs_time_base = block.abs_time_base;
+        Encoder::write_encoded_event(output_file, fields_def, Encoder::encode_event_absts(abs_time_base, fields_def));
     }
+}
 
-    std::ofstream output_file(output_filename, std::ios::binary);
-    if (!output_file) {
-        std::cerr << "Cannot open output .xe file: " << output_filename << std::endl;
+int main(int argc, char* argv[]) {
+    if (argc != 3 && argc != 5) {
+        std::cerr << "Usage: " << argv[0] << " INPUT_BXE_FILE OUTPUT_XE_FILE [T0 T1]" << std::endl;
         return 1;
     }
 
-    const FieldsDefinition fields_def = FieldsDefinition::make_reference();
-    timestamp_t abs_time_base = 0;  // valor neutro se desconhecido
+    const char* bxe_filename = argv[1];
+    const char* output_filename = argv[2];
 
-    // Inicializa o header canônico JPEG_XE
-    Encoder::initialize_jpegxe_canonical_file(abs_time_base, fields_def, output_file);
+    const FieldsDefinition fields_def = FieldsDefinition::make_reference();
 
-    // Escreve o evento ABS inicial com timestamp base
-    encoded_event_t abs_event = Encoder::encode_event_absts(abs_time_base, fields_def);
-    Encoder::write_encoded_event(output_file, fields_def, abs_event);
+    try {
+        // ficheiro .bxe mapeado em memória, os blocos são lidos diretamente das páginas mapeadas
+        const BlockXEFile input_file(bxe_filename, fields_def);
 
-    // ---- Ler blocos e reescrever eventos ----
-    while (input_file) {
-        BlockHeader header;
-        if (!input_file.read(reinterpret_cast<char*>(&header), sizeof(header))) break;
+        //saída em buffers grandes escritos em segundo plano (io_uring ou pwrite), o cabeçalho vai para o primeiro buffer
+        OutputSink output(output_filename);
+        std::ostream &output_file = output.stream();
+        size_t skipped = 0;
 
-        for (int i = 0; i < header.num_events; ++i) {
-            uint8_t buffer[6];
-            if (!input_file.read(reinterpret_cast<char*>(buffer), 6)) {
-                std::cerr << "Unexpected EOF while reading event." << std::endl;
-                return 1;
+        if (argc == 5) {
+            //extrai apenas a janela [T0, T1): com o índice do ficheiro só os blocos dessa janela são lidos
+            const timestamp_t t0 = std::strtoull(argv[3], nullptr, 10);
+            const timestamp_t t1 = std::strtoull(argv[4], nullptr, 10);
+            if (input_file.indexed()) {
+                const std::pair<size_t, size_t> range = input_file.blocks_in_range(t0, t1);
+                timestamp_t abs_time_base = 0;
+                if (range.first < range.second) {
+                    //o primeiro bloco da janela traz a sua base de tempo no cabeçalho (ou no índice nos ficheiros antigos)
+                    const BlockXEFile::const_iterator first_block = input_file.block_at(input_file.index_entry(range.first).offset);
+                    abs_time_base = first_block->has_time_base ? first_block->abs_time_base : input_file.index_entry(range.first).abs_time_base;
+                }
+                Encoder::initialize_jpegxe_canonical_file(abs_time_base, fields_def, output_file);
+                for_each_intact_block(input_file, range.first, range.second, fields_def, skipped, [&](const BlockXEFile::Block &block, bool) {
+                    resync_time_base(block, abs_time_base, fields_def, output_file);
+                    write_window(block, abs_time_base, t0, t1, fields_def, output);
+                });
+                std::cout << "Read " << range.second - range.first << " of " << input_file.num_indexed_blocks() << " blocks" << std::endl;
+            } else {
+                //ficheiro sem índice: todos os blocos são lidos, a base de tempo vem do cabeçalho de cada bloco ou é reconstruída desde o início
+                timestamp_t abs_time_base = input_file.begin()->abs_time_base;
+                Encoder::initialize_jpegxe_canonical_file(abs_time_base, fields_def, output_file);
+                for_each_intact_block(input_file, 0, 0, fields_def, skipped, [&](const BlockXEFile::Block &block, bool) {
+                    resync_time_base(block, abs_time_base, fields_def, output_file);
+                    write_window(block, abs_time_base, t0, t1, fields_def, output);
+                });
             }
+        } else {
+            //base de tempo do início do primeiro bloco (0, valor neutro, se o ficheiro não a guarda)
+            timestamp_t abs_time_base = input_file.begin()->abs_time_base;
+            if (!input_file.begin()->has_time_base && input_file.indexed() && input_file.num_indexed_blocks() > 0)
+                abs_time_base = input_file.index_entry(0).abs_time_base;
 
-            encoded_event_t encoded = 0;
-            for (int b = 0; b < 6; ++b) {
-                encoded |= static_cast<encoded_event_t>(buffer[5 - b]) << (b * 8);
-            }
-            Encoder::write_encoded_event(output_file, fields_def, encoded);
+            // Inicializa o header canônico JPEG_XE (o cabeçalho já termina com o evento ABS inicial)
+            Encoder::initialize_jpegxe_canonical_file(abs_time_base, fields_def, output_file);
+
+            // ---- Ler blocos e reescrever eventos ----
+            XE_METRICS_TIME(Write);
+            const size_t num_blocks = input_file.indexed() ? input_file.num_indexed_blocks() : 0;
+            for_each_intact_block(input_file, 0, num_blocks, fields_def, skipped, [&](const BlockXEFile::Block &block, bool resync) {
+                //os registos não são lidos aqui: depois de um bloco saltado a base de tempo é sempre reescrita
+                if (resync && block.has_time_base)
+                    Encoder::write_encoded_event(output_file, fields_def, Encoder::encode_event_absts(block.abs_time_base, fields_def));
+
+                // os eventos já estão em big-endian no bloco, podem ser copiados tal como estão
+                output.write(block.event_bytes, block.available_events * fields_def.event_size_bytes);
+            });
         }
-    }
 
-    input_file.close();
-    output_file.close();
+        output.finish();
+        if (skipped > 0) {
+            std::cerr << skipped << " damaged block(s) skipped while writing " << output_filename << std::endl;
+            return 1;
+        }
+    } catch (const std::runtime_error &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
 
     std::cout << "Reconstructed .xe file with generated header written to " << output_filename << std::endl;
     return 0;
@@ -0,0 +1,60 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <cstdlib>
+#include <stdexcept>
+#include "../Codec/xe_format.h"
+#include "../Codec/mapped_file.h"
+#include "../Codec/bxe_codec.h"
+#include "../Codec/output_sink.h"
+#include "../Codec/model_store.h"
+
+using namespace XEFormat;
+
+int main(int argc, char* argv[]) {
+    //diretório dos modelos pré-treinados (--models DIR_MODELOS), para os ficheiros que só guardam o ID do modelo
+    std::string model_dir;
+    std::vector<char*> args;
+    for (int i = 0; i < argc; ++i) {
+        if (i > 0 && i + 1 < argc && std::strcmp(argv[i], "--models") == 0)
+            model_dir = argv[++i];
+        else
+            args.push_back(argv[i]);
+    }
+    argc = static_cast<int>(args.size());
+    argv = args.data();
+
+    if (argc != 3 && argc != 4) {
+        std::cerr << "Usage: " << argv[0] << " INPUT_COMPRESSED_FILE OUTPUT_BXE_FILE [NUM_THREADS (0 = ALL)] [--models MODEL_DIR]" << std::endl;
+        return 1;
+    }
+
+    const FieldsDefinition fields_def = FieldsDefinition::make_reference();
+
+    //os segmentos de blocos são descomprimidos em paralelo
+    const int num_threads = argc == 4 ? std::atoi(argv[3]) : 0;
+    if (num_threads < 0) {
+        std::cerr << "Invalid number of threads: " << argv[3] << std::endl;
+        return 1;
+    }
+
+    try {
+        //ficheiro comprimido mapeado em memória
+        const MappedFile input_file(argv[1]);
+
+        //os blocos são escritos em buffers grandes, entregues a um escritor em segundo plano (io_uring ou pwrite)
+        OutputSink output(argv[2]);
+        const ModelStore models(model_dir.empty() ? "." : model_dir);
+        const size_t num_events = decompress_bxe(input_file.data(), input_file.size(), fields_def, output.stream(), static_cast<unsigned>(num_threads), &models);
+        output.finish();
+
+        std::cout << "Decompressed " << num_events << " events into " << argv[2] << std::endl;
+    } catch (const std::runtime_error &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,85 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstring>
+#include <cstdint>
+#include <cstdlib>
+#include <stdexcept>
+#include "../Codec/xe_format.h"
+#include "../Codec/mapped_file.h"
+#include "../Codec/bxe_codec.h"
+#include "../Codec/integrity.h"
+#include "../Codec/crc32c.h"
+
+using namespace XEFormat;
+
+int main(int argc, char* argv[]) {
+    const char* usage = " INPUT_FILE... [--threads N]";
+    std::vector<std::string> input_paths;
+    unsigned num_threads = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (i + 1 < argc && std::strcmp(argv[i], "--threads") == 0) {
+            num_threads = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (std::strncmp(argv[i], "--", 2) == 0) {
+            std::cerr << "Usage: " << argv[0] << usage << std::endl;
+            return 1;
+        } else {
+            input_paths.push_back(argv[i]);
+        }
+    }
+    if (input_paths.empty()) {
+        std::cerr << "Usage: " << argv[0] << usage << std::endl;
+        return 1;
+    }
+
+    const FieldsDefinition fields_def = FieldsDefinition::make_reference();
+    std::cout << "CRC-32C implementation: " << crc32c_implementation() << std::endl;
+
+    //código de saída: 0 se tudo estiver intacto, 2 se algum ficheiro tiver blocos corrompidos, 1 em caso de erro
+    int status = 0;
+    for (const std::string &path : input_paths) {
+        try {
+            //o ficheiro pode ser comprimido (.bxez) ou um .bxe, reconhecido pelo cabeçalho; nenhum evento é descodificado
+            const auto start = std::chrono::steady_clock::now();
+            IntegrityReport report;
+            bool compressed;
+            {
+                const MappedFile input_file(path);
+                compressed = is_compressed_bxe(input_file.data(), input_file.size());
+                if (compressed) {
+                    report = verify_compressed_bxe(input_file.data(), input_file.size(), num_threads);
+                } else {
+                    const BlockXEFile bxe_file(path, fields_def);
+                    report = verify_bxe(bxe_file, fields_def, num_threads);
+                }
+            }
+            const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            std::cout << path << ": " << report.num_blocks << " blocks, " << report.bytes_checked << " bytes checked in " << seconds << " s ("
+                      << report.bytes_checked / seconds / 1e9 << " GB/s)" << std::endl;
+            if (!report.checksummed)
+                std::cout << "  no checksums in this file, only its structure was checked" << std::endl;
+            for (const CorruptedBlocks &c : report.corrupted) {
+                std::cout << "  " << (compressed ? "segment" : "block") << " at offset " << c.offset << ": ";
+                if (c.num_blocks == 1)
+                    std::cout << "block " << c.first_block << ", ";
+                else if (c.num_blocks > 1)
+                    std::cout << "blocks " << c.first_block << " to " << c.first_block + c.num_blocks - 1 << ", ";
+                std::cout << c.reason << std::endl;
+            }
+            if (report.ok()) {
+                std::cout << "  OK" << std::endl;
+            } else {
+                std::cout << "  " << report.corrupted.size() << " corrupted range(s)" << std::endl;
+                if (status == 0)
+                    status = 2;
+            }
+        } catch (const std::runtime_error &e) {
+            std::cerr << path << ": " << e.what() << std::endl;
+            status = 1;
+        }
+    }
+
+    return status;
+}
@@ -0,0 +1,276 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <set>
+#include <filesystem>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+#include <stdexcept>
+#include "../Codec/xe_format.h"
+#include "../Codec/bxe_format.h"
+#include "../Codec/mapped_file.h"
+#include "../Codec/work_stealing_pool.h"
+
+using namespace XEFormat;
+namespace fs = std::filesystem;
+
+//opções comuns a todos os ficheiros
+struct Settings {
+    FieldsDefinition fields_def = FieldsDefinition::make_reference();
+    BlockPolicy policy;
+    uint8_t flags = bxe_flag_time_base | bxe_flag_checksum;
+    size_t part_events = 4u << 20;
+};
+
+//totais de todo o lote
+struct Totals {
+    std::atomic<uint64_t> events{0}, input_bytes{0}, output_bytes{0}, blocks{0};
+    std::atomic<size_t> files{0}, failed{0};
+    std::mutex print_mutex;
+};
+
+//conversão de um ficheiro: o ficheiro grande é dividido em partes escritas em paralelo nas suas posições finais
+struct FileJob {
+    std::string input_path, output_path;
+    std::unique_ptr<XEFile> input;
+    std::ofstream output;
+    std::unique_ptr<BlockXEWriter> writer;
+    std::vector<BlockXEPart> parts;
+    std::atomic<size_t> parts_left{0};
+    std::atomic<bool> failed{false};
+    std::mutex error_mutex;
+    std::string error;
+};
+
+static void fail(FileJob &job, const std::string &error) {
+    std::lock_guard<std::mutex> lock(job.error_mutex);
+    if (!job.failed.exchange(true))
+        job.error = error;
+}
+
+//fecha o ficheiro (índice) e atualiza os totais
+static void finish_file(FileJob &job, Totals &totals, size_t num_parts) {
+    if (!job.failed) {
+        try {
+            for (const BlockXEPart &part : job.parts)
+                job.writer->append_part(part);
+            job.writer->finish();
+            job.output.close();
+            if (!job.output)
+                throw std::runtime_error("Cannot write output file: " + job.output_path);
+        } catch (const std::runtime_error &e) {
+            fail(job, e.what());
+        }
+    }
+    job.parts.clear();
+    std::lock_guard<std::mutex> lock(totals.print_mutex);
+    if (job.failed) {
+        if (job.writer)
+            std::remove(job.output_path.c_str());
+        ++totals.failed;
+        std::cerr << "Failed " << job.input_path << ": " << job.error << std::endl;
+        return;
+    }
+    ++totals.files;
+    totals.events += job.input->num_events();
+    totals.input_bytes += job.input->mapping().size();
+    totals.output_bytes += job.writer->bytes_written();
+    totals.blocks += job.writer->num_blocks();
+    std::cout << job.input_path << " -> " << job.output_path << ": " << job.input->num_events() << " events, "
+              << job.writer->num_blocks() << " blocks" << (num_parts > 1 ? ", " + std::to_string(num_parts) + " parts" : "") << std::endl;
+}
+
+//base de tempo em vigor antes do evento first: o último evento de base de tempo anterior (0 se não houver, como no xe_to_blockxe)
+static timestamp_t time_base_before(const XEFile &input, size_t first, const FieldsDefinition &fields_def) {
+    for (size_t i = first; i > 0; --i) {
+        const encoded_event_t ev = input[i - 1];
+        if (Decoder::decode_event_type(ev, fields_def) == EventType::ABSTimeStamp)
+            return Decoder::decode_event_timestamp(ev, fields_def);
+    }
+    return 0;
+}
+
+//escreve os blocos dos eventos [first, first + n) com o writer dado
+static void write_blocks(const XEFile &input, size_t first, size_t n, timestamp_t abs_time_base, const Settings &settings, BlockXEWriter &writer) {
+    const size_t ev_bytes = settings.fields_def.event_size_bytes;
+    BlockSplitter splitter(settings.policy, settings.fields_def, abs_time_base);
+    size_t index = first;
+    while (index < first + n) {
+        const uint8_t* block_bytes = input.event_bytes() + index * ev_bytes;
+        const size_t events_in_block = splitter.fill(block_bytes, first + n - index);
+        splitter.next_block();
+        writer.write_block(block_bytes, events_in_block);
+        index += events_in_block;
+    }
+}
+
+static void convert_part(const std::shared_ptr<FileJob> &job, size_t part, size_t first, size_t n, uint64_t offset, size_t num_parts, const Settings &settings, Totals &totals) {
+    if (!job->failed) {
+        try {
+            const timestamp_t abs_time_base = time_base_before(*job->input, first, settings.fields_def);
+            //cada parte abre o ficheiro só enquanto escreve os seus blocos: fica apenas com as entradas do índice
+            std::fstream stream(job->output_path, std::ios::in | std::ios::out | std::ios::binary);
+            if (!stream)
+                throw std::runtime_error("Cannot open output file: " + job->output_path);
+            stream.seekp(static_cast<std::streamoff>(offset));
+            BlockXEWriter writer(stream, settings.fields_def, abs_time_base, settings.flags, offset);
+            write_blocks(*job->input, first, n, abs_time_base, settings, writer);
+            stream.close();
+            if (!stream)
+                throw std::runtime_error("Cannot write output file: " + job->output_path);
+            job->parts[part] = writer.take_part();
+        } catch (const std::runtime_error &e) {
+            fail(*job, e.what());
+        }
+    }
+    //a última parte a terminar fecha o ficheiro
+    if (job->parts_left.fetch_sub(1) == 1)
+        finish_file(*job, totals, num_parts);
+}
+
+static void convert_file(const std::shared_ptr<FileJob> &job, WorkStealingPool &pool, const Settings &settings, Totals &totals) {
+    size_t num_parts = 1;
+    try {
+        job->input = std::make_unique<XEFile>(job->input_path, settings.fields_def);
+        job->output.open(job->output_path, std::ios::binary | std::ios::trunc);
+        if (!job->output)
+            throw std::runtime_error("Cannot open output file: " + job->output_path);
+        job->writer = std::make_unique<BlockXEWriter>(job->output, settings.fields_def, 0, settings.flags);
+
+        //só com blocos de tamanho fixo se sabe onde cada parte começa no ficheiro de saída; senão o ficheiro é convertido de uma vez
+        const BlockPolicy &policy = settings.policy;
+        const bool fixed_blocks = policy.max_events > 0 && policy.max_compressed_bytes == 0 && policy.max_time_span == 0;
+        const size_t total_events = job->input->num_events();
+        const size_t part_events = fixed_blocks ? std::max<size_t>(1, settings.part_events / policy.max_events) * policy.max_events : total_events;
+        if (!fixed_blocks || total_events <= part_events) {
+            write_blocks(*job->input, 0, total_events, 0, settings, *job->writer);
+            finish_file(*job, totals, num_parts);
+            return;
+        }
+
+        //partes com um número inteiro de blocos: os blocos (e portanto o ficheiro) são iguais aos de uma conversão sequencial
+        num_parts = (total_events + part_events - 1) / part_events;
+        const uint64_t header_bytes = block_header_size(settings.flags, settings.fields_def);
+        job->output.flush();
+        job->parts.resize(num_parts);
+        job->parts_left = num_parts;
+        uint64_t offset = job->writer->bytes_written();
+        for (size_t p = 0; p < num_parts; ++p) {
+            const size_t first = p * part_events;
+            const size_t n = std::min(part_events, total_events - first);
+            const uint64_t blocks = (n + policy.max_events - 1) / policy.max_events;
+            pool.submit([job, p, first, n, offset, num_parts, &settings, &totals]() {
+                convert_part(job, p, first, n, offset, num_parts, settings, totals);
+            });
+            offset += blocks * header_bytes + static_cast<uint64_t>(n) * settings.fields_def.event_size_bytes;
+        }
+    } catch (const std::runtime_error &e) {
+        fail(*job, e.what());
+        if (job->parts_left == 0)
+            finish_file(*job, totals, num_parts);
+    }
+}
+
+//ficheiros de entrada: ficheiros .xe, diretórios (os .xe que contêm) ou @lista (um caminho por linha)
+static bool collect_inputs(const std::string &arg, std::vector<std::string> &inputs) {
+    if (!arg.empty() && arg[0] == '@') {
+        std::ifstream list(arg.substr(1));
+        if (!list)
+            return false;
+        std::string line;
+        while (std::getline(list, line))
+            if (!line.empty())
+                inputs.push_back(line);
+        return true;
+    }
+    std::error_code ec;
+    if (fs::is_directory(arg, ec)) {
+        std::vector<std::string> found;
+        for (const fs::directory_entry &entry : fs::directory_iterator(arg, ec))
+            if (entry.is_regular_file() && entry.path().extension() == ".xe")
+                found.push_back(entry.path().string());
+        std::sort(found.begin(), found.end());
+        inputs.insert(inputs.end(), found.begin(), found.end());
+        return !ec;
+    }
+    inputs.push_back(arg);
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    const char* usage = " OUTPUT_DIR INPUT_XE_FILE|INPUT_DIR|@LIST_FILE... [--threads N] [--part-events N] [--block-events N] [--block-bytes N] [--block-span US]";
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << usage << std::endl;
+        return 1;
+    }
+
+    Settings settings;
+    unsigned num_threads = 0;
+    std::vector<std::string> inputs;
+    for (int i = 2; i < argc; ++i) {
+        if (i + 1 < argc && std::strcmp(argv[i], "--threads") == 0) {
+            num_threads = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (i + 1 < argc && std::strcmp(argv[i], "--part-events") == 0) {
+            settings.part_events = std::strtoull(argv[++i], nullptr, 10);
+        } else if (i + 1 < argc && std::strcmp(argv[i], "--block-events") == 0) {
+            settings.policy.max_events = std::strtoull(argv[++i], nullptr, 10);
+        } else if (i + 1 < argc && std::strcmp(argv[i], "--block-bytes") == 0) {
+            settings.policy.max_compressed_bytes = std::strtoull(argv[++i], nullptr, 10);
+        } else if (i + 1 < argc && std::strcmp(argv[i], "--block-span") == 0) {
+            settings.policy.max_time_span = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strncmp(argv[i], "--", 2) == 0) {
+            std::cerr << "Usage: " << argv[0] << usage << std::endl;
+            return 1;
+        } else if (!collect_inputs(argv[i], inputs)) {
+            std::cerr << "Cannot read input list: " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+    if (settings.policy.max_events == 0 || settings.policy.max_events > max_block_events(settings.flags))
+        settings.flags |= bxe_flag_wide_count;
+
+    //um ficheiro .bxe por ficheiro de entrada, com o mesmo nome: dois ficheiros com o mesmo nome não podem ir para o mesmo diretório
+    const fs::path output_dir(argv[1]);
+    std::error_code ec;
+    fs::create_directories(output_dir, ec);
+    std::vector<std::shared_ptr<FileJob>> jobs;
+    std::set<std::string> output_paths;
+    for (const std::string &input : inputs) {
+        auto job = std::make_shared<FileJob>();
+        job->input_path = input;
+        job->output_path = (output_dir / fs::path(input).filename().replace_extension(".bxe")).string();
+        if (!output_paths.insert(job->output_path).second) {
+            std::cerr << "Two inputs would be written to " << job->output_path << std::endl;
+            return 1;
+        }
+        jobs.push_back(job);
+    }
+
+    Totals totals;
+    const auto start = std::chrono::steady_clock::now();
+    uint64_t steals = 0;
+    unsigned pool_size = 0;
+    {
+        //cada ficheiro é uma tarefa; os ficheiros grandes criam tarefas por parte, que os workers livres roubam
+        WorkStealingPool pool(num_threads);
+        pool_size = pool.size();
+        for (const auto &job : jobs)
+            pool.submit([job, &pool, &settings, &totals]() { convert_file(job, pool, settings, totals); });
+        pool.wait();
+        steals = pool.num_steals();
+    }
+    const double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "Converted " << totals.files << " files (" << totals.failed << " failed) with " << pool_size << " threads in " << secs << " s: "
+              << totals.events << " events, " << totals.blocks << " blocks, " << totals.input_bytes / 1e6 << " MB -> " << totals.output_bytes / 1e6 << " MB, "
+              << totals.events / secs / 1e6 << " Mev/s, " << totals.input_bytes / secs / 1e6 << " MB/s (" << steals << " stolen tasks)" << std::endl;
+    return totals.failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,95 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <cstdlib>
+#include <stdexcept>
+#include "../Codec/xe_format.h"
+#include "../Codec/mapped_file.h"
+#include "../Codec/bxe_codec.h"
+#include "../Codec/model_store.h"
+
+using namespace XEFormat;
+
+int main(int argc, char* argv[]) {
+    //modelo pré-treinado opcional (--model FICHEIRO_MODELO), os restantes argumentos são posicionais
+    std::string model_path;
+    std::vector<char*> args;
+    for (int i = 0; i < argc; ++i) {
+        if (i > 0 && i + 1 < argc && std::strcmp(argv[i], "--model") == 0)
+            model_path = argv[++i];
+        else
+            args.push_back(argv[i]);
+    }
+    argc = static_cast<int>(args.size());
+    argv = args.data();
+
+    if (argc < 3 || argc > 6) {
+        std::cerr << "Usage: " << argv[0] << " INPUT_BXE_FILE OUTPUT_COMPRESSED_FILE [range|huffman|context|rans] [NUM_THREADS (0 = ALL)] [fields|raw] [--model MODEL_FILE]" << std::endl;
+        return 1;
+    }
+
+    const FieldsDefinition fields_def = FieldsDefinition::make_reference();
+    CompressionOptions options;
+
+    //codificador entrópico escolhido pelo utilizador (range por omissão)
+    if (argc >= 4 && !parse_entropy_coder(argv[3], options.coder)) {
+        std::cerr << "Unknown entropy coder: " << argv[3] << std::endl;
+        return 1;
+    }
+
+    //os segmentos de blocos são comprimidos em paralelo
+    if (argc >= 5) {
+        const int num_threads = std::atoi(argv[4]);
+        if (num_threads < 0) {
+            std::cerr << "Invalid number of threads: " << argv[4] << std::endl;
+            return 1;
+        }
+        options.num_threads = static_cast<unsigned>(num_threads);
+    }
+
+    //transformação dos eventos antes da codificação (separação por campos por omissão)
+    if (argc == 6 && !parse_event_transform(argv[5], options.transform)) {
+        std::cerr << "Unknown event transform: " << argv[5] << std::endl;
+        return 1;
+    }
+
+    try {
+        //com um modelo pré-treinado o ficheiro só guarda o ID do modelo, e não há passagem de contagem
+        PretrainedModel model;
+        if (!model_path.empty()) {
+            model = read_model_file(model_path);
+            if (argc < 4)
+                options.coder = static_cast<EntropyCoder>(model.coder);
+            if (argc < 6)
+                options.transform = static_cast<EventTransform>(model.transform);
+            options.model = &model;
+        }
+
+        //ficheiro .bxe mapeado em memória
+        const BlockXEFile input_file(argv[1], fields_def);
+
+        std::ofstream output_file(argv[2], std::ios::binary);
+        if (!output_file) {
+            std::cerr << "Cannot open output file: " << argv[2] << std::endl;
+            return 1;
+        }
+
+        const size_t compressed_size = compress_bxe(input_file, fields_def, options, output_file);
+        output_file.close();
+
+        //estatísticas
+        const size_t original_size = input_file.mapping().size();
+        std::cout << "Original size: " << original_size << " bytes" << std::endl;
+        std::cout << "Compressed size: " << compressed_size << " bytes" << std::endl;
+        if (original_size > 0)
+            std::cout << "Compression ratio: " << 100.0 * compressed_size / original_size << "%" << std::endl;
+    } catch (const std::runtime_error &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,72 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <memory>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include "../Codec/xe_format.h"
+#include "../Codec/mapped_file.h"
+#include "../Codec/bxe_codec.h"
+#include "../Codec/model_store.h"
+
+using namespace XEFormat;
+
+int main(int argc, char* argv[]) {
+    const char* usage = " MODEL_DIR INPUT_BXE_FILE... [--coder range|huffman|rans] [--transform fields|raw] [--lanes 4|8|16|32] [--threads N (0 = ALL)]";
+    CompressionOptions options;
+    std::vector<std::string> inputs;
+    std::string model_dir;
+    for (int i = 1; i < argc; ++i) {
+        if (i + 1 < argc && std::strcmp(argv[i], "--coder") == 0) {
+            if (!parse_entropy_coder(argv[++i], options.coder)) {
+                std::cerr << "Unknown entropy coder: " << argv[i] << std::endl;
+                return 1;
+            }
+        } else if (i + 1 < argc && std::strcmp(argv[i], "--transform") == 0) {
+            if (!parse_event_transform(argv[++i], options.transform)) {
+                std::cerr << "Unknown event transform: " << argv[i] << std::endl;
+                return 1;
+            }
+        } else if (i + 1 < argc && std::strcmp(argv[i], "--lanes") == 0) {
+            options.rans_lanes = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (i + 1 < argc && std::strcmp(argv[i], "--threads") == 0) {
+            options.num_threads = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (model_dir.empty()) {
+            model_dir = argv[i];
+        } else {
+            inputs.push_back(argv[i]);
+        }
+    }
+    if (model_dir.empty() || inputs.empty()) {
+        std::cerr << "Usage: " << argv[0] << usage << std::endl;
+        return 1;
+    }
+
+    const FieldsDefinition fields_def = FieldsDefinition::make_reference();
+
+    try {
+        //corpus de ficheiros .bxe mapeados em memória, todos contados para o mesmo modelo
+        std::vector<std::unique_ptr<BlockXEFile>> files;
+        std::vector<const BlockXEFile*> corpus;
+        for (const std::string &input : inputs) {
+            files.emplace_back(new BlockXEFile(input, fields_def));
+            corpus.push_back(files.back().get());
+        }
+
+        const PretrainedModel model = train_model(corpus, fields_def, options);
+        const ModelStore store(model_dir);
+        const std::string path = store.save(model);
+
+        //o ID é o que os ficheiros comprimidos guardam; o compress_blockxe recebe o ficheiro do modelo
+        std::cout << "Trained on " << model.trained_events << " events from " << inputs.size() << " files" << std::endl;
+        std::cout << "Model ID: " << model_id_string(model.id) << std::endl;
+        std::cout << "Model file: " << path << " (" << model.tables.size() << " bytes of tables)" << std::endl;
+    } catch (const std::runtime_error &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -2,26 +2,192 @@
 #include <fstream>
 #include <vector>
 #include <cstdlib>
+#include <cstring>
 #include <string>
 #include <cstdint>
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+#include <memory>
+#include <atomic>
+#include <exception>
 #include "../Codec/xe_format.h"
+#include "../Codec/bxe_format.h"
+#include "../Codec/mapped_file.h"
+#include "../Codec/bounded_queue.h"
+#include "../Codec/spsc_ring.h"
+#include "../Codec/instrumentation.h"
 
 using namespace XEFormat;
 
-struct BlockHeader {
-    uint16_t num_events;
+//numero de eventos lidos de cada vez no modo streaming (os blocos são fechados pela BlockPolicy)
+static const size_t read_chunk_events = 1024;
+
+//converte um ficheiro .xe mapeado em memória, escrevendo os blocos diretamente das páginas mapeadas
+static size_t convert_mapped(const XEFile &input_file, size_t max_events, const FieldsDefinition &fields_def, const BlockPolicy &policy, BlockXEWriter &writer) {
+    //numero de eventos a processar (todos ou o limite do utilizador)
+    size_t total_events = input_file.num_events();
+    if (max_events > 0)
+        total_events = std::min(total_events, max_events);
+
+    //de quantos em quantos bytes libertar as páginas já escritas (mantém o RSS constante)
+    const size_t release_interval = 64u << 20;
+    size_t released_until = 0;
+
+    //para iterar sobre os eventos mapeados
+    size_t index = 0;
+    BlockSplitter splitter(policy, fields_def);
+
+    while (index < total_events) {
+        //o bloco fecha no primeiro limite atingido (eventos, tamanho comprimido estimado ou intervalo de tempo)
+        const uint8_t* block_bytes = input_file.event_bytes() + index * fields_def.event_size_bytes;
+        const size_t events_in_block = splitter.fill(block_bytes, total_events - index);
+        splitter.next_block();
+
+        //os eventos do bloco já estão empacotados no ficheiro mapeado: escrita direta sem cópia intermédia
+        //(o writer escreve o cabeçalho do bloco e guarda a sua entrada no índice)
+        writer.write_block(block_bytes, events_in_block);
+
+        //incrementar o numero de eventos previamente organizados
+        index += events_in_block;
+
+        const size_t consumed = input_file.header_size() + index * fields_def.event_size_bytes;
+        if (consumed - released_until >= release_interval) {
+            input_file.mapping().release_pages(released_until, consumed - released_until);
+            released_until = consumed;
+        }
+    }
+    return index;
+}
+
+//bloco pronto a escrever: eventos empacotados
+struct BlockBuffer {
+    std::vector<uint8_t> bytes;
+    size_t num_events = 0;
 };
 
-int main(int argc, char* argv[]) {
-    
-    if (argc != 3) {
-        std::cerr << "Usage: " << argv[0] << " INPUT_XE_FILE NUM_EVENTS_TO_READ (0 = ALL)" << std::endl;
-        return 1;
+//converte um stream (ficheiro ou pipe) com memória constante: leitura -> blocos -> escrita em três threads.
+//a leitura entrega os eventos aos blocos através de um ring buffer sem locks (lidos diretamente para o ring);
+//os blocos são pré-alocados e reciclados, e cada bloco é escrito (e enviado) assim que fica completo
+static size_t convert_streaming(std::istream &input_file, size_t max_events, const FieldsDefinition &fields_def, const BlockPolicy &policy, std::ostream &output_file, BlockXEWriter &writer) {
+    //numero de buffers em circulação em cada etapa do pipeline
+    const size_t pipeline_depth = 8;
+
+    SpscRing<encoded_event_t> ring(pipeline_depth * read_chunk_events);
+    std::vector<BlockBuffer> blocks(pipeline_depth);
+    BoundedQueue<BlockBuffer*> free_blocks(pipeline_depth), full_blocks(pipeline_depth);
+    for (size_t i = 0; i < pipeline_depth; ++i) {
+        blocks[i].bytes.reserve(read_chunk_events * fields_def.event_size_bytes);
+        free_blocks.push(&blocks[i]);
+    }
+
+    size_t total_events = 0;
+
+    //uma exceção numa thread é guardada e relançada depois dos join; as outras etapas param e libertam as que esperam
+    std::exception_ptr reader_error, blocker_error, writer_error;
+    std::atomic<bool> stop{false};
+
+    //leitura: no máximo um chunk de eventos por leitura para que um pipe ao vivo produza output imediatamente
+    std::thread reader([&]() {
+        try {
+            while (!stop.load(std::memory_order_relaxed)) {
+                size_t events_to_read;
+                encoded_event_t* span = ring.wait_write_span(events_to_read);
+                events_to_read = std::min(events_to_read, read_chunk_events);
+                if (max_events > 0)
+                    events_to_read = std::min(events_to_read, max_events - total_events);
+                size_t count = 0;
+                if (events_to_read > 0) {
+                    XE_METRICS_TIME(Read);
+                    count = Decoder::read_encoded_events(input_file, fields_def, span, events_to_read);
+                }
+                total_events += count;
+                ring.publish(count);
+                if (count == 0 || count < events_to_read)
+                    break;
+            }
+        } catch (...) {
+            reader_error = std::current_exception();
+        }
+        ring.close();
+    });
+
+    //blocos: eventos empacotados em big-endian, acumulados até a BlockPolicy fechar o bloco (um bloco pode juntar vários chunks)
+    std::thread blocker([&]() {
+        try {
+            BlockSplitter splitter(policy, fields_def);
+            std::vector<uint8_t> packed(read_chunk_events * fields_def.event_size_bytes);
+            BlockBuffer* block = nullptr;
+            bool writing = free_blocks.pop(block);
+            if (writing)
+                block->bytes.clear();
+            size_t count;
+            const encoded_event_t* events;
+            while (writing && (events = ring.wait_read_span(count), count > 0)) {
+                count = std::min(count, read_chunk_events);
+                Encoder::pack_encoded_events(events, count, fields_def, packed.data());
+                ring.consume(count);
+                const uint8_t* p = packed.data();
+                size_t left = count;
+                while (writing && left > 0) {
+                    const size_t taken = splitter.fill(p, left);
+                    block->bytes.insert(block->bytes.end(), p, p + taken * fields_def.event_size_bytes);
+                    p += taken * fields_def.event_size_bytes;
+                    left -= taken;
+                    if (splitter.complete()) {
+                        block->num_events = splitter.block_events();
+                        splitter.next_block();
+                        full_blocks.push(block);
+                        writing = free_blocks.pop(block);
+                        if (writing)
+                            block->bytes.clear();
+                    }
+                }
+            }
+            //último bloco incompleto
+            if (writing && splitter.block_events() > 0) {
+                block->num_events = splitter.block_events();
+                full_blocks.push(block);
+            }
+        } catch (...) {
+            blocker_error = std::current_exception();
+            stop = true;
+        }
+        full_blocks.close();
+        //se a escrita parou antes do fim, o ring é esvaziado para a leitura não ficar à espera de espaço
+        size_t count;
+        while (ring.wait_read_span(count), count > 0)
+            ring.consume(count);
+    });
+
+    //escrita: cada bloco é enviado para o ficheiro assim que fica completo
+    try {
+        BlockBuffer* block;
+        while (full_blocks.pop(block)) {
+            writer.write_block(block->bytes.data(), block->num_events);
+            output_file.flush();
+            free_blocks.push(block);
+        }
+    } catch (...) {
+        writer_error = std::current_exception();
+        stop = true;
+        full_blocks.close();
     }
+    free_blocks.close();
+
+    reader.join();
+    blocker.join();
+    for (const std::exception_ptr &error : {reader_error, blocker_error, writer_error})
+        if (error)
+            std::rethrow_exception(error);
+    return total_events;
+}
+
+int main(int argc, char* argv[]) {
 
-    std::ifstream input_file(argv[1], std::ios::binary);
-    if (!input_file) {
-        std::cerr << "Cannot open input file: " << argv[1] << std::endl;
+    const char* usage = " INPUT_XE_FILE|- NUM_EVENTS_TO_READ (0 = ALL) [--stream] [--block-events N] [--block-bytes N] [--block-span US] [--output OUTPUT_BXE_FILE]";
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << usage << std::endl;
         return 1;
     }
 
@@ -31,75 +197,91 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
-    //necessário para poder ler cada evento
-    const FieldsDefinition fields_def = FieldsDefinition::make_reference();
-    //array de eventos 
-    std::vector<encoded_event_t> all_events;
-
-    while (input_file) {
-        //define evento 
-        encoded_event_t encoded_event;
-        
-        //se não tiver mais eventos
-        if (!Decoder::read_next_encoded_event(input_file, fields_def, encoded_event)) break;
-
-        //vai colocando os eventos em all_events
-        all_events.push_back(encoded_event);
-        
-        //se valor lido de eventos passar os dados pelo utilizador
-        if (max_events > 0 && all_events.size() >= static_cast<size_t>(max_events))
-            break;
-    }
-
-    //fecha ficheiro de input
-    input_file.close();
-    
-    //numero final de eventos lidos
-    std::cout << "Total events read: " << all_events.size() << std::endl;
-
-    //para escrever para o ficheiro .bxe em modo binario
-    std::ofstream output_file("../../Block_Files/encoded_output.bxe", std::ios::binary);
-    if (!output_file) {
-        std::cerr << "Cannot open output file." << std::endl;
-        return 1;
+    //regras de fecho dos blocos: o bloco fecha no primeiro limite atingido (0 desativa um limite, 1024 eventos por omissão)
+    BlockPolicy policy;
+    bool stream_option = false;
+    std::string output_path = "../../Block_Files/encoded_output.bxe";
+    for (int i = 3; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--stream") == 0) {
+            stream_option = true;
+        } else if (i + 1 < argc && std::strcmp(argv[i], "--block-events") == 0) {
+            policy.max_events = std::strtoull(argv[++i], nullptr, 10);
+        } else if (i + 1 < argc && std::strcmp(argv[i], "--block-bytes") == 0) {
+            policy.max_compressed_bytes = std::strtoull(argv[++i], nullptr, 10);
+        } else if (i + 1 < argc && std::strcmp(argv[i], "--block-span") == 0) {
+            policy.max_time_span = std::strtoull(argv[++i], nullptr, 10);
+        } else if (i + 1 < argc && (std::strcmp(argv[i], "--output") == 0 || std::strcmp(argv[i], "-o") == 0)) {
+            output_path = argv[++i];
+        } else {
+            std::cerr << "Usage: " << argv[0] << usage << std::endl;
+            return 1;
+        }
     }
 
-    //tamanho de cada bloco(x eventos)
-    const size_t block_size = 1024;
-    
-    //para iterar sobre all_events
-    size_t index = 0;
+    //"-" lê do stdin (por exemplo uma captura ao vivo), o que implica o modo streaming
+    const bool from_stdin = std::strcmp(argv[1], "-") == 0;
+    const bool streaming = from_stdin || stream_option;
 
-    //id do bloco
-    size_t block_id = 0;
+    //necessário para poder ler cada evento
+    const FieldsDefinition fields_def = FieldsDefinition::make_reference();
 
-    while (index < all_events.size()) {
-        //eventos que faltam processar
-        size_t events_remaining = all_events.size() - index;
+    try {
+        //a entrada é aberta e o seu cabeçalho validado antes de criar o ficheiro de saída, que não é criado para uma entrada inválida
+        std::ifstream file_input;
+        std::unique_ptr<XEFile> mapped_input;
+        if (streaming) {
+            if (!from_stdin) {
+                file_input.open(argv[1], std::ios::binary);
+                if (!file_input) {
+                    std::cerr << "Cannot open input file: " << argv[1] << std::endl;
+                    return 1;
+                }
+            }
+            std::cin.tie(nullptr);
 
-        //numero de eventos que vao entrar em cada bloco quando faltar menos de 1024 último bloco terá menos
-        size_t events_in_block = std::min(events_remaining, block_size);
+            //o cabeçalho é validado antes de arrancar o pipeline
+            if (!Decoder::assert_jpegxe_canonical_header(from_stdin ? std::cin : file_input)) {
+                std::cerr << "Input is not a JPEG_XE canonical raw event file: " << argv[1] << std::endl;
+                return 1;
+            }
+        } else {
+            //ficheiro .xe mapeado em memória, o cabeçalho é validado uma única vez na abertura
+            mapped_input = std::make_unique<XEFile>(argv[1], fields_def);
+        }
 
-        //cabeçalho de bloco contendo o numero de eventos dentro do bloco(ver o número maximo de eventos por blocos)
-        BlockHeader header{static_cast<uint16_t>(events_in_block)};
+        //para escrever para o ficheiro .bxe em modo binario
+        //ficheiro de saída escolhido com --output (várias conversões em paralelo não escrevem no mesmo ficheiro)
+        std::ofstream output_file(output_path, std::ios::binary);
+        if (!output_file) {
+            std::cerr << "Cannot open output file: " << output_path << std::endl;
+            return 1;
+        }
 
-        //escreve o cabeçalho no ficheiro
-        output_file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        //escreve o cabeçalho do ficheiro .bxe; o índice dos blocos é escrito no fim.
+        //o contador de eventos de cada bloco passa a 32 bits quando um bloco pode ter mais de 65535 eventos
+        //cada cabeçalho de bloco termina com o CRC-32C do bloco, verificado pelo verify_blockxe
+        uint8_t flags = bxe_flag_time_base | bxe_flag_checksum;
+        if (policy.max_events == 0 || policy.max_events > max_block_events(flags))
+            flags |= bxe_flag_wide_count;
+        BlockXEWriter writer(output_file, fields_def, 0, flags);
+        size_t total_events;
 
-        //escreve cada evento individual no ficheiro binário
-        for (size_t i = 0; i < events_in_block; ++i) {
-            Encoder::write_encoded_event(output_file, fields_def, all_events[index + i]);
-        }
+        if (streaming)
+            total_events = convert_streaming(from_stdin ? std::cin : file_input, static_cast<size_t>(max_events), fields_def, policy, output_file, writer);
+        else
+            total_events = convert_mapped(*mapped_input, static_cast<size_t>(max_events), fields_def, policy, writer);
 
-        //incrementar o numero de eventos previamente organizados
-        index += events_in_block;
+        //numero final de eventos lidos
+        std::cout << "Total events read: " << total_events << std::endl;
 
-        //seguir para o proximo bloco
-        ++block_id;
+        //índice dos blocos e fecha o ficheiro
+        writer.finish();
+        output_file.close();
+        std::cout << "Wrote " << total_events << " events into " << writer.num_blocks() << " blocks to the file " << output_path << std::endl;
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
     }
-    //fecha o ficheiro
-    output_file.close();
-    std::cout << "Wrote " << all_events.size() << " events into " << block_id << " blocks to the file encoded_output.bxe" << std::endl;
 
     return 0;
 }
@@ -0,0 +1,53 @@
+import os
+import sys
+import time
+
+# Adiciona a pasta src/ ao path para importar de Compressor/
+sys.path.append(os.path.abspath(os.path.join(os.path.dirname(__file__), "..")))
+
+from Compressor.ArithmeticEncoder import ArithmeticEncoder
+from Compressor.ArithmeticDecoder import ArithmeticDecoder
+from Compressor.SimpleFrequencyTable import SimpleFrequencyTable
+
+#leitura dos blocos do .bxe
+from bxe_blocks import iter_blocks
+
+# Mede a velocidade do codificador aritmético de referência (Python) para comparar com Benchmark/bench_range_coder
+# Uso: python3 bench_arit_reference.py INPUT_BXE_FILE [MAX_BYTES]
+if len(sys.argv) < 2:
+    print(f"Usage: {sys.argv[0]} INPUT_BXE_FILE [MAX_BYTES]")
+    sys.exit(1)
+
+bxe_path = sys.argv[1]
+max_bytes = int(sys.argv[2]) if len(sys.argv) > 2 else 1000000
+
+# Leitura dos blocos e eventos (limitada a max_bytes, o codificador Python é lento)
+event_bytes = bytearray()
+for _, event_data in iter_blocks(bxe_path):
+    if len(event_bytes) >= max_bytes:
+        break
+    event_bytes.extend(event_data)
+event_bytes = event_bytes[:max_bytes]
+
+freqs = [max(1, event_bytes.count(b)) for b in range(256)]
+freq_table = SimpleFrequencyTable(freqs)
+
+# Codificação
+start = time.perf_counter()
+compressed_bits = []
+bitout = ArithmeticEncoder(32, compressed_bits.append)
+for b in event_bytes:
+    bitout.write(freq_table, b)
+bitout.finish()
+encode_secs = time.perf_counter() - start
+
+# Descodificação
+start = time.perf_counter()
+decoder = ArithmeticDecoder(32, iter(compressed_bits))
+decoded = bytearray(decoder.read(freq_table) for _ in range(len(event_bytes)))
+decode_secs = time.perf_counter() - start
+
+assert decoded == event_bytes
+mb = len(event_bytes) / 1e6
+print(f"Python reference arithmetic coder: encode {mb / encode_secs:.3f} MB/s, decode {mb / decode_secs:.3f} MB/s")
+print(f"Compression ratio: {len(compressed_bits) / 8 / len(event_bytes):.2%}")
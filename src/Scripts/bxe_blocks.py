@@ -0,0 +1,148 @@
+#leitura dos blocos de um ficheiro .bxe, versão 1 (só blocos) ou 2 (cabeçalho + blocos + índice no fim)
+#com a flag FLAG_TIME_BASE cada cabeçalho de bloco traz também a base de tempo do bloco (um evento ABS)
+#com a flag FLAG_WIDE_COUNT o numero de eventos de cada bloco ocupa 4 bytes em vez de 2
+#com a flag FLAG_CHECKSUM cada cabeçalho de bloco termina com o CRC-32C do bloco (4 bytes, não verificado aqui)
+#write_bxe reconstrói o ficheiro com os mesmos bytes que o BlockXEWriter do C++ (cabeçalhos, CRC-32C e índice)
+import struct
+
+BXE_MAGIC = b"BXEF"
+BXE_INDEX_MAGIC = b"BXEI"
+FILE_HEADER_SIZE = 8
+FOOTER_SIZE = 16
+FLAG_TIME_BASE = 0x01
+FLAG_WIDE_COUNT = 0x02
+FLAG_CHECKSUM = 0x04
+INDEX_ENTRY_SIZE = 36
+
+#campos do formato de referência (eventos de 48 bits em big-endian, 2 bits de tipo)
+EVENT_TYPE_BITS = 2
+EVENT_ABS_TIMESTAMP = 0x02
+ABS_TIMESTAMP_MASK = (1 << 46) - 1
+RELATIVE_TIMESTAMP_MASK = (1 << 23) - 1
+
+
+def _crc32c_table():
+    table = []
+    for n in range(256):
+        crc = n
+        for _ in range(8):
+            crc = (crc >> 1) ^ (0x82F63B78 if crc & 1 else 0)
+        table.append(crc)
+    return table
+
+
+_CRC32C_TABLE = _crc32c_table()
+
+
+def crc32c(data, crc=0):
+    """CRC-32C (Castagnoli), encadeável como o crc32c do C++."""
+    crc ^= 0xFFFFFFFF
+    for b in data:
+        crc = _CRC32C_TABLE[(crc ^ b) & 0xFF] ^ (crc >> 8)
+    return crc ^ 0xFFFFFFFF
+
+
+def iter_blocks(bxe_path, event_size_bytes=6):
+    """Devolve (num_events, bytes dos eventos) para cada bloco do ficheiro."""
+    with open(bxe_path, "rb") as f:
+        data = f.read()
+
+    start, end = 0, len(data)
+    count_size, time_base_size, checksum_size = 2, 0, 0
+    if data[:4] == BXE_MAGIC:
+        if data[4] != 2 or data[5] & ~(FLAG_TIME_BASE | FLAG_WIDE_COUNT | FLAG_CHECKSUM):
+            raise ValueError("Unsupported .bxe file version.")
+        start = FILE_HEADER_SIZE
+        if data[5] & FLAG_TIME_BASE:
+            time_base_size = event_size_bytes
+        if data[5] & FLAG_WIDE_COUNT:
+            count_size = 4
+        if data[5] & FLAG_CHECKSUM:
+            checksum_size = 4
+        #o índice (se existir) começa onde acabam os blocos
+        if len(data) >= FILE_HEADER_SIZE + FOOTER_SIZE and data[-4:] == BXE_INDEX_MAGIC:
+            index_offset, _ = struct.unpack("<QI", data[-FOOTER_SIZE:-4])
+            end = index_offset
+
+    pos = start
+    while pos + count_size + time_base_size + checksum_size <= end:
+        #little-endian porque maioria dos sistemas modernos no C++ escrevem em little-endian
+        num_events = int.from_bytes(data[pos:pos + count_size], "little")
+        pos += count_size + time_base_size + checksum_size
+        yield num_events, data[pos:pos + num_events * event_size_bytes]
+        pos += num_events * event_size_bytes
+
+
+def read_bxe_header(bxe_path, event_size_bytes=6):
+    """Devolve (flags, base de tempo no início do primeiro bloco); flags é None para um ficheiro da versão 1."""
+    with open(bxe_path, "rb") as f:
+        data = f.read()
+    if data[:4] != BXE_MAGIC:
+        return None, 0
+    flags = data[5]
+    count_size = 4 if flags & FLAG_WIDE_COUNT else 2
+    abs_time_base = 0
+    if flags & FLAG_TIME_BASE and len(data) >= FILE_HEADER_SIZE + count_size + event_size_bytes:
+        pos = FILE_HEADER_SIZE + count_size
+        abs_time_base = (int.from_bytes(data[pos:pos + event_size_bytes], "big") >> EVENT_TYPE_BITS) & ABS_TIMESTAMP_MASK
+    elif len(data) >= FILE_HEADER_SIZE + FOOTER_SIZE and data[-4:] == BXE_INDEX_MAGIC:
+        index_offset, num_blocks = struct.unpack("<QI", data[-FOOTER_SIZE:-4])
+        if num_blocks > 0:
+            abs_time_base = struct.unpack_from("<Q", data, index_offset + 24)[0]
+    return flags, abs_time_base
+
+
+def _scan_block(block, abs_time_base, event_size_bytes):
+    #base de tempo depois do bloco e timestamps absolutos do primeiro e do último evento (como o scan_block do C++)
+    timestamp = abs_time_base
+    first = None
+    for pos in range(0, len(block), event_size_bytes):
+        ev = int.from_bytes(block[pos:pos + event_size_bytes], "big")
+        ev_type = ev & ((1 << EVENT_TYPE_BITS) - 1)
+        if ev_type == EVENT_ABS_TIMESTAMP:
+            abs_time_base = (ev >> EVENT_TYPE_BITS) & ABS_TIMESTAMP_MASK
+            timestamp = abs_time_base
+        elif ev_type in (0x00, 0x01):
+            timestamp = abs_time_base + ((ev >> EVENT_TYPE_BITS) & RELATIVE_TIMESTAMP_MASK)
+        else:
+            timestamp = abs_time_base
+        if first is None:
+            first = timestamp
+    return abs_time_base, timestamp if first is None else first, timestamp
+
+
+def write_bxe(bxe_path, flags, abs_time_base, block_sizes, event_bytes, event_size_bytes=6):
+    """Escreve os blocos num ficheiro .bxe: versão 1 (só blocos) se flags for None, senão versão 2 com as flags dadas."""
+    count_size = 4 if flags is not None and flags & FLAG_WIDE_COUNT else 2
+    if max(block_sizes, default=0) >= 1 << (8 * count_size):
+        raise ValueError("Too many events for a .bxe block.")
+    with open(bxe_path, "wb") as f:
+        offset = 0
+        if flags is None:
+            for num_events in block_sizes:
+                block_len = num_events * event_size_bytes
+                f.write(num_events.to_bytes(2, "little"))
+                f.write(event_bytes[offset:offset + block_len])
+                offset += block_len
+            return
+
+        f.write(BXE_MAGIC + bytes([2, flags, 0, 0]))
+        file_offset = FILE_HEADER_SIZE
+        index = bytearray()
+        for num_events in block_sizes:
+            block_len = num_events * event_size_bytes
+            block = event_bytes[offset:offset + block_len]
+            offset += block_len
+            header = bytearray(num_events.to_bytes(count_size, "little"))
+            if flags & FLAG_TIME_BASE:
+                header += ((abs_time_base << EVENT_TYPE_BITS) | EVENT_ABS_TIMESTAMP).to_bytes(event_size_bytes, "big")
+            if flags & FLAG_CHECKSUM:
+                header += struct.pack("<I", crc32c(block, crc32c(header)))
+            f.write(header)
+            f.write(block)
+            block_time_base = abs_time_base
+            abs_time_base, first, last = _scan_block(block, abs_time_base, event_size_bytes)
+            index += struct.pack("<QQQQI", file_offset, first, last, block_time_base, num_events)
+            file_offset += len(header) + block_len
+        f.write(index)
+        f.write(struct.pack("<QI", file_offset, len(block_sizes)) + BXE_INDEX_MAGIC)
@@ -8,6 +8,9 @@ sys.path.append(os.path.abspath(os.path.join(os.path.dirname(__file__), "..")))
 from Compressor.ArithmeticEncoder import ArithmeticEncoder
 from Compressor.SimpleFrequencyTable import SimpleFrequencyTable
 
+#leitura dos blocos do .bxe
+from bxe_blocks import iter_blocks, read_bxe_header
+
 # Caminho relativo à raiz do projeto
 BASE_DIR = os.path.abspath(os.path.join(os.path.dirname(__file__), "../.."))
 DATA_DIR = os.path.join(BASE_DIR, "Block_Files")
@@ -25,15 +28,9 @@ os.makedirs(OUTPUT_DIR, exist_ok=True)
 block_sizes = []
 event_bytes = bytearray()
 
-with open(bxe_path, "rb") as f:
-    while True:
-        header = f.read(2)
-        if not header:
-            break
-        num_events = int.from_bytes(header, "little")
-        block_sizes.append(num_events)
-        event_data = f.read(num_events * 6)
-        event_bytes.extend(event_data)
+for num_events, event_data in iter_blocks(bxe_path):
+    block_sizes.append(num_events)
+    event_bytes.extend(event_data)
 
 # Conta frequência de cada byte (0–255)
 freqs = [max(1, event_bytes.count(b)) for b in range(256)]  # garante mínimo 1
@@ -67,8 +64,10 @@ if count > 0:
 with open(compressed_path, "wb") as f:
     f.write(compressed_bytes)
 
+# tamanhos dos blocos e cabeçalho do .bxe (flags e base de tempo inicial) para a reconstrução
+flags, abs_time_base = read_bxe_header(bxe_path)
 with open(blocks_path, "wb") as f:
-    pickle.dump(block_sizes, f)
+    pickle.dump({"flags": flags, "abs_time_base": abs_time_base, "block_sizes": block_sizes}, f)
 
 with open(freqs_path, "wb") as f:
     pickle.dump(freqs, f)
@@ -7,6 +7,9 @@ import pickle
 #para os caminhos
 import os
 
+#leitura dos blocos do .bxe
+from bxe_blocks import iter_blocks, read_bxe_header
+
 
 # Caminho relativo à raiz do projeto
 BASE_DIR = os.path.abspath(os.path.join(os.path.dirname(__file__), "../.."))
@@ -28,26 +31,12 @@ block_sizes = []
 event_bytes = bytearray()
 
 #Ler o .bxe e extrair os eventos em ordem
-with open(bxe_path, "rb") as f:
-    while True:
-        #le 2 bytes do cabeçalho do bloco (16 bits)
-        header = f.read(2)
-        
-        #se header vazio, acaba o loop
-        if not header:
-            break
-
-        #little-endian porque maioria dos sistemas modernos no C++ escrevem em little-endian
-        num_events = int.from_bytes(header, "little")
-
-        #adicionar valor à lista block_sizes para recriar os blocos originais na descodificação (1024)
-        block_sizes.append(num_events)
-
-        #1024 * 6
-        event_data = f.read(num_events * 6)
+for num_events, event_data in iter_blocks(bxe_path):
+    #adicionar valor à lista block_sizes para recriar os blocos originais na descodificação (1024)
+    block_sizes.append(num_events)
 
-        #adiciona dados lidos à lista completa de eventos, no final do loop todos os eventos sao concatenados em sequencia
-        event_bytes.extend(event_data)
+    #adiciona dados lidos à lista completa de eventos, no final do loop todos os eventos sao concatenados em sequencia
+    event_bytes.extend(event_data)
 
 #Criar a tabela de Huffman fixa a partir dos bytes
 codec = HuffmanCodec.from_data(event_bytes)
@@ -62,8 +51,10 @@ with open(compressed_path, "wb") as f:
 with open(table_path, "wb") as f:
     pickle.dump(codec, f)
 
+#tamanhos dos blocos e cabeçalho do .bxe (flags e base de tempo inicial) para a reconstrução
+flags, abs_time_base = read_bxe_header(bxe_path)
 with open(blocks_path, "wb") as f:
-    pickle.dump(block_sizes, f)
+    pickle.dump({"flags": flags, "abs_time_base": abs_time_base, "block_sizes": block_sizes}, f)
 
 #Mostrar estatísticas
 print(f"Original size: {len(event_bytes)} bytes")
@@ -8,6 +8,10 @@ sys.path.append(os.path.abspath(os.path.join(os.path.dirname(__file__), "..")))
 from Compressor.ArithmeticDecoder import ArithmeticDecoder
 from Compressor.SimpleFrequencyTable import SimpleFrequencyTable
 
+# Escrita do .bxe reconstruído
+sys.path.append(os.path.dirname(os.path.abspath(__file__)))
+from bxe_blocks import write_bxe
+
 BASE_DIR = os.path.abspath(os.path.join(os.path.dirname(__file__), "../.."))
 RESULTS_DIR = os.path.join(BASE_DIR, "Results_Compression")
 
@@ -28,8 +32,12 @@ with open(compressed_path, "rb") as f:
 with open(freqs_path, "rb") as f:
     freqs = pickle.load(f)
 
+# Tamanhos dos blocos e cabeçalho do .bxe original (uma lista de tamanhos nos ficheiros antigos: versão 1)
 with open(blocks_path, "rb") as f:
-    block_sizes = pickle.load(f)
+    blocks_info = pickle.load(f)
+if isinstance(blocks_info, list):
+    blocks_info = {"flags": None, "abs_time_base": 0, "block_sizes": blocks_info}
+block_sizes = blocks_info["block_sizes"]
 
 # Reconstrói a tabela de frequências
 freq_table = SimpleFrequencyTable(freqs)
@@ -51,13 +59,7 @@ for _ in range(total_events * 6):
     symbol = decoder.read(freq_table)
     decoded_bytes.append(symbol)
 
-# Recria o .bxe com headers por bloco
-with open(output_path, "wb") as f:
-    offset = 0
-    for num_events in block_sizes:
-        f.write(num_events.to_bytes(2, "little"))
-        block_len = num_events * 6
-        f.write(decoded_bytes[offset:offset + block_len])
-        offset += block_len
+# Recria o .bxe na versão e com as flags do original (cabeçalhos, bases de tempo, CRC-32C e índice)
+write_bxe(output_path, blocks_info["flags"], blocks_info["abs_time_base"], block_sizes, decoded_bytes)
 
 print(f"Decompressed {total_events} events into {output_path}")
@@ -6,6 +6,9 @@ import os
 #usado para salvar a tabela e os blocos
 from dahuffman import HuffmanCodec
 
+#escrita do .bxe reconstruído
+from bxe_blocks import write_bxe
+
 # Diretórios base
 BASE_DIR = os.path.abspath(os.path.join(os.path.dirname(__file__), "../.."))
 RESULTS_DIR = os.path.join(BASE_DIR, "Results_Compression")
@@ -22,9 +25,12 @@ os.makedirs(RESULTS_DIR, exist_ok=True)
 with open(table_path, "rb") as f:
     codec: HuffmanCodec = pickle.load(f)
 
-#carregar os tamanhos dos blocos
+#carregar os tamanhos dos blocos e o cabeçalho do .bxe original (uma lista de tamanhos nos ficheiros antigos: versão 1)
 with open(block_sizes_path, "rb") as f:
-    block_sizes = pickle.load(f)
+    blocks_info = pickle.load(f)
+if isinstance(blocks_info, list):
+    blocks_info = {"flags": None, "abs_time_base": 0, "block_sizes": blocks_info}
+block_sizes = blocks_info["block_sizes"]
 
 #ler o stream de dados comprimido
 with open(compressed_path, "rb") as f:
@@ -36,20 +42,7 @@ decoded_bytes = codec.decode(compressed_data)
 #converter para tipo bytes para poder escrever diretamente
 decoded_bytes = bytes(decoded_bytes)
 
-#recriar o .bxe com headers por bloco
-with open(output_bxe_path, "wb") as f:
-    offset = 0
-    for num_events in block_sizes:
-        #calcula quantos bytes de eventos virão a seguir
-        block_len = num_events * 6
-
-        #escreve o cabeçalho do bloco com 2 bytes
-        f.write(num_events.to_bytes(2, "little"))
-
-        #escreve os block_len bytes de eventos
-        f.write(decoded_bytes[offset : offset + block_len])
-
-        #avança o offset no buffer de decoded_bytes para o próximo bloco 
-        offset += block_len
+#recriar o .bxe na versão e com as flags do original (cabeçalhos, bases de tempo, CRC-32C e índice)
+write_bxe(output_bxe_path, blocks_info["flags"], blocks_info["abs_time_base"], block_sizes, decoded_bytes)
 
 print(f"Reconstructed {len(block_sizes)} blocks into {output_bxe_path}")